@@ -110,6 +110,7 @@ endif ()
 option (URHO3D_PACKAGING "Enable resources packaging support, on Emscripten default to 1, on other platforms default to 0" ${EMSCRIPTEN})
 option (URHO3D_PROFILING "Enable profiling support" TRUE)
 option (URHO3D_LOGGING "Enable logging support" TRUE)
+option (URHO3D_MEMORY_TRACKING "Enable memory accounting by subsystem")
 option (URHO3D_TESTING "Enable testing support")
 if (URHO3D_TESTING)
     if (EMSCRIPTEN)
@@ -272,6 +273,11 @@ if (URHO3D_LOGGING)
     add_definitions (-DURHO3D_LOGGING)
 endif ()
 
+# Disable memory accounting by default. If enabled, pooled allocations carry a subsystem tag and live byte counts are kept per tag.
+if (URHO3D_MEMORY_TRACKING)
+    add_definitions (-DURHO3D_MEMORY_TRACKING)
+endif ()
+
 # If not on Windows platform, enable Unix mode for kNet library
 if (NOT WIN32)
     add_definitions (-DKNET_UNIX)
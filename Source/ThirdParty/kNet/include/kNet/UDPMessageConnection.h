@@ -86,6 +86,9 @@ public:
 
 	float PacketLossRate() const { return packetLossRate; }
 
+	// Urho3D: return the total number of messages that have been resent
+	unsigned long NumResentMessages() const { return numResentMessages; }
+
 private:
 	/// Reads all the new bytes available in the socket.
 	/// @return The number of bytes successfully read.
@@ -162,6 +165,7 @@ private:
 
 	float packetLossRate; ///< The currently estimated datagram packet loss rate, [0, 1].	
 	float packetLossCount; ///< The current packet loss in absolute packets/sec.
+	unsigned long numResentMessages; ///< Urho3D: the total number of messages that have been resent.
 
 	/// Info struct used to track acks of reliable packets.
 	struct PacketAckTrack
@@ -63,7 +63,7 @@ UDPMessageConnection::UDPMessageConnection(Network *owner, NetworkServer *ownerS
 retransmissionTimeout(1000.f), numAcksLastFrame(0), numLossesLastFrame(0), smoothedRTT(1000.f), rttVariation(0.f), rttCleared(true), // Set RTT initial values as per RFC 2988.
 lastReceivedInOrderPacketID(0), 
 lastSentInOrderPacketID(0), datagramPacketIDCounter(1),
-packetLossRate(0.f), packetLossCount(0.f), 
+packetLossRate(0.f), packetLossCount(0.f), numResentMessages(0),
 datagramSendRate(50.f), lowestDatagramSendRateOnPacketLoss(50.f), slowModeDelay(0),
 receivedPacketIDs(64 * 1024), outboundPacketAckTrack(1024),
 previousReceivedPacketID(0), queuedInboundDatagrams(128)
@@ -560,6 +560,9 @@ MessageConnection::PacketSendResult UDPMessageConnection::SendOutPacket()
 	// Sending the datagram succeeded - increment the send count of each message by one, to remember the retry timeout count.
 	for(size_t i = 0; i < datagramSerializedMessages.size(); ++i)
 	{
+		// Urho3D: count resent messages for statistics
+		if (datagramSerializedMessages[i]->sendCount > 0)
+			++numResentMessages;
 		++datagramSerializedMessages[i]->sendCount;
 
 #ifdef KNET_NETWORK_PROFILING
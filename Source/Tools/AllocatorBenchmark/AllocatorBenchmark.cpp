@@ -0,0 +1,222 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Container/Allocator.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/Core/Timer.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+static const char* usage =
+    "Usage: AllocatorBenchmark [options] [thread counts]\n\n"
+    "Measures allocating and freeing from the shared node pool compared to the heap,\n"
+    "once for each number of threads given. By default uses 1, 2 and 4 threads and\n"
+    "the number of physical CPU cores.\n\n"
+    "Options:\n"
+    "-a <x>  Number of allocations per thread, default 1000000\n"
+    "-l <x>  Number of live allocations per thread, default 1000\n"
+    "-s <x>  Maximum allocation size in bytes, at least 8, default 256\n";
+
+/// Thread which allocates and frees memory, keeping a window of live allocations.
+class AllocatorThread : public Thread
+{
+public:
+    /// Construct.
+    AllocatorThread(unsigned count, unsigned numLive, unsigned maxSize, bool usePool) :
+        count_(count),
+        maxSize_(maxSize),
+        usePool_(usePool)
+    {
+        live_.Resize(numLive);
+        sizes_.Resize(numLive);
+        for (unsigned i = 0; i < numLive; ++i)
+        {
+            live_[i] = 0;
+            sizes_[i] = 0;
+        }
+    }
+    
+    /// Perform the allocations.
+    virtual void ThreadFunction()
+    {
+        unsigned random = 1;
+        unsigned numLive = live_.Size();
+        
+        for (unsigned i = 0; i < count_; ++i)
+        {
+            // Replace the oldest live allocation with a new one of pseudo-random size, like a container replacing its nodes
+            unsigned slot = i % numLive;
+            Free(live_[slot], sizes_[slot]);
+            
+            random = random * 1103515245 + 12345;
+            unsigned size = 8 + (random >> 8) % (maxSize_ - 7);
+            live_[slot] = Reserve(size);
+            sizes_[slot] = size;
+            // Touch the memory so that it is actually used
+            *static_cast<unsigned char*>(live_[slot]) = (unsigned char)i;
+        }
+        
+        for (unsigned i = 0; i < numLive; ++i)
+        {
+            Free(live_[i], sizes_[i]);
+            live_[i] = 0;
+        }
+    }
+    
+private:
+    /// Reserve memory from the pool or the heap.
+    void* Reserve(unsigned size) { return usePool_ ? PoolReserve(size) : new unsigned char[size]; }
+    
+    /// Free memory to the pool or the heap.
+    void Free(void* ptr, unsigned size)
+    {
+        if (!ptr)
+            return;
+        if (usePool_)
+            PoolFree(ptr, size);
+        else
+            delete[] static_cast<unsigned char*>(ptr);
+    }
+    
+    /// Live allocations.
+    PODVector<void*> live_;
+    /// Sizes of the live allocations.
+    PODVector<unsigned> sizes_;
+    /// Number of allocations.
+    unsigned count_;
+    /// Maximum allocation size.
+    unsigned maxSize_;
+    /// Use the node pool flag.
+    bool usePool_;
+};
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+float Measure(unsigned numThreads, unsigned count, unsigned numLive, unsigned maxSize, bool usePool);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    unsigned count = 1000000;
+    unsigned numLive = 1000;
+    unsigned maxSize = 256;
+    PODVector<unsigned> threadCounts;
+    
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+            
+            if (argument == "a" && !value.Empty())
+            {
+                count = ToUInt(value);
+                ++i;
+            }
+            else if (argument == "l" && !value.Empty())
+            {
+                numLive = Max((int)ToUInt(value), 1);
+                ++i;
+            }
+            else if (argument == "s" && !value.Empty())
+            {
+                maxSize = Max((int)ToUInt(value), 8);
+                ++i;
+            }
+            else
+                ErrorExit(usage);
+        }
+        else if (ToUInt(arguments[i]))
+            threadCounts.Push(ToUInt(arguments[i]));
+        else
+            ErrorExit(usage);
+    }
+    
+    if (threadCounts.Empty())
+    {
+        threadCounts.Push(1);
+        threadCounts.Push(2);
+        threadCounts.Push(4);
+        if (GetNumPhysicalCPUs() > 4)
+            threadCounts.Push(GetNumPhysicalCPUs());
+    }
+    
+    PrintLine(String(count) + " allocations per thread, " + String(numLive) + " live, sizes 8-" + String(maxSize) +
+        " bytes");
+    
+    // Warm up both allocators so that the pool chunks and the heap arenas already exist for the measured runs
+    Measure(threadCounts.Back(), count / 10, numLive, maxSize, true);
+    Measure(threadCounts.Back(), count / 10, numLive, maxSize, false);
+    
+    for (unsigned i = 0; i < threadCounts.Size(); ++i)
+    {
+        float poolMs = Measure(threadCounts[i], count, numLive, maxSize, true);
+        float heapMs = Measure(threadCounts[i], count, numLive, maxSize, false);
+        float total = (float)count * threadCounts[i] * 1000.0f;
+        
+        PrintLine(String(threadCounts[i]) + " threads: pool " + String(poolMs) + " ms, " + String(total / poolMs) +
+            " per second; heap " + String(heapMs) + " ms, " + String(total / heapMs) + " per second");
+    }
+}
+
+float Measure(unsigned numThreads, unsigned count, unsigned numLive, unsigned maxSize, bool usePool)
+{
+    PODVector<AllocatorThread*> threads;
+    for (unsigned i = 0; i < numThreads; ++i)
+        threads.Push(new AllocatorThread(count, numLive, maxSize, usePool));
+    
+    HiresTimer timer;
+    for (unsigned i = 0; i < threads.Size(); ++i)
+        threads[i]->Run();
+    for (unsigned i = 0; i < threads.Size(); ++i)
+        threads[i]->Stop();
+    float ms = (float)timer.GetUSec(false) / 1000.0f;
+    
+    for (unsigned i = 0; i < threads.Size(); ++i)
+        delete threads[i];
+    
+    return Max(ms, 0.001f);
+}
@@ -0,0 +1,163 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Scene/Scene.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+SharedPtr<Context> context_(new Context());
+
+static const char* usage =
+    "Usage: AttributeBenchmark [options]\n\n"
+    "Measures getting and setting the serializable attributes of scene nodes through\n"
+    "the attribute interface, as done by scene saving, loading and replication.\n\n"
+    "Options:\n"
+    "-n <x>  Number of nodes, default 10000\n"
+    "-i <x>  Number of iterations, default 100\n"
+    "-v <x>  Number of elements in the variant vector variable of each node, default 16\n";
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    unsigned numNodes = 10000;
+    unsigned numIterations = 100;
+    unsigned vectorSize = 16;
+    
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+            if (value.Empty())
+                ErrorExit(usage);
+            
+            if (argument == "n")
+                numNodes = Max((int)ToUInt(value), 1);
+            else if (argument == "i")
+                numIterations = Max((int)ToUInt(value), 1);
+            else if (argument == "v")
+                vectorSize = ToUInt(value);
+            else
+                ErrorExit(usage);
+            ++i;
+        }
+        else
+            ErrorExit(usage);
+    }
+    
+    RegisterSceneLibrary(context_);
+    
+    // Every node gets a name, a transform and variables, one of which is a variant vector shared by all nodes, as when a
+    // script assigns the same value to many nodes
+    VariantVector path;
+    for (unsigned i = 0; i < vectorSize; ++i)
+        path.Push(Vector3(Random(100.0f), 0.0f, Random(100.0f)));
+    
+    SharedPtr<Scene> scene(new Scene(context_));
+    PODVector<Node*> nodes;
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        Node* node = scene->CreateChild("Node" + String(i));
+        node->SetPosition(Vector3(Random(100.0f), 0.0f, Random(100.0f)));
+        node->SetRotation(Quaternion(Random(360.0f), Vector3::UP));
+        node->SetVar("Health", 100);
+        node->SetVar("Path", path);
+        nodes.Push(node);
+    }
+    
+    // Measure the attributes that are saved to files
+    const Vector<AttributeInfo>* attributes = nodes[0]->GetAttributes();
+    PODVector<unsigned> indices;
+    for (unsigned i = 0; i < attributes->Size(); ++i)
+    {
+        if (attributes->At(i).mode_ & AM_FILE)
+            indices.Push(i);
+    }
+    
+    PrintLine(String(numNodes) + " nodes, " + String(indices.Size()) + " attributes per node, " + String(numIterations) +
+        " iterations");
+    
+    Vector<Variant> values(numNodes * indices.Size());
+    long long getTime = 0;
+    long long setTime = 0;
+    HiresTimer timer;
+    
+    for (unsigned i = 0; i < numIterations; ++i)
+    {
+        timer.Reset();
+        for (unsigned j = 0; j < nodes.Size(); ++j)
+        {
+            Variant* nodeValues = &values[j * indices.Size()];
+            for (unsigned k = 0; k < indices.Size(); ++k)
+                nodes[j]->OnGetAttribute(attributes->At(indices[k]), nodeValues[k]);
+        }
+        getTime += timer.GetUSec(false);
+        
+        // Set the values to the next node, so that the values actually change
+        timer.Reset();
+        for (unsigned j = 0; j < nodes.Size(); ++j)
+        {
+            Variant* nodeValues = &values[((j + 1) % nodes.Size()) * indices.Size()];
+            for (unsigned k = 0; k < indices.Size(); ++k)
+                nodes[j]->OnSetAttribute(attributes->At(indices[k]), nodeValues[k]);
+        }
+        setTime += timer.GetUSec(false);
+    }
+    
+    unsigned long long numAccesses = (unsigned long long)numIterations * values.Size();
+    float getMs = (float)getTime / 1000.0f;
+    float setMs = (float)setTime / 1000.0f;
+    PrintLine("Get: " + String(getMs / numIterations) + " ms per iteration, " + String((float)numAccesses * 1000.0f /
+        getMs) + " attributes per second");
+    PrintLine("Set: " + String(setMs / numIterations) + " ms per iteration, " + String((float)numAccesses * 1000.0f /
+        setMs) + " attributes per second");
+}
@@ -0,0 +1,237 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Network/InterestGrid.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkPriority.h>
+#include <Urho3D/Scene/Scene.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+SharedPtr<Context> context_(new Context());
+
+static const char* usage =
+    "Usage: InterestBenchmark [options]\n\n"
+    "Measures the per-update cost of interest management with a number of moving\n"
+    "replicated nodes and simulated clients, compared to checking the distance of\n"
+    "every node for every client.\n\n"
+    "Options:\n"
+    "-n <x>  Number of replicated nodes, default 10000\n"
+    "-c <x>  Number of simulated clients, default 100\n"
+    "-u <x>  Number of updates, default 100\n"
+    "-d <x>  Relevance distance, default 100\n"
+    "-s <x>  Grid cell size, default 100\n"
+    "-w <x>  World size, default 2000\n"
+    "-m <x>  Percentage of hierarchies that move on each update, default 100\n";
+
+/// Simulated client observer.
+struct Observer
+{
+    /// Observer position.
+    Vector3 position_;
+    /// Relevant interest group root node ID's.
+    HashSet<unsigned> relevantGroups_;
+};
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    unsigned numNodes = 10000;
+    unsigned numClients = 100;
+    unsigned numUpdates = 100;
+    float distance = 100.0f;
+    float cellSize = 100.0f;
+    float worldSize = 2000.0f;
+    float movePercentage = 100.0f;
+    
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+            if (value.Empty())
+                ErrorExit(usage);
+            
+            if (argument == "n")
+                numNodes = Max((int)ToUInt(value), 1);
+            else if (argument == "c")
+                numClients = Max((int)ToUInt(value), 1);
+            else if (argument == "u")
+                numUpdates = Max((int)ToUInt(value), 1);
+            else if (argument == "d")
+                distance = Max(ToFloat(value), 1.0f);
+            else if (argument == "s")
+                cellSize = Max(ToFloat(value), 1.0f);
+            else if (argument == "w")
+                worldSize = Max(ToFloat(value), 1.0f);
+            else if (argument == "m")
+                movePercentage = Clamp(ToFloat(value), 0.0f, 100.0f);
+            else
+                ErrorExit(usage);
+            ++i;
+        }
+        else
+            ErrorExit(usage);
+    }
+    
+    RegisterSceneLibrary(context_);
+    RegisterNetworkLibrary(context_);
+    
+    // Create the nodes at random positions on a plane. Every fourth node has a child node to have some hierarchies
+    SharedPtr<Scene> scene(new Scene(context_));
+    PODVector<Node*> nodes;
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        Node* node;
+        if ((i & 3) == 3)
+            node = nodes.Back()->CreateChild();
+        else
+        {
+            node = scene->CreateChild();
+            node->SetPosition(Vector3(Random(worldSize), 0.0f, Random(worldSize)));
+            NetworkPriority* priority = node->CreateComponent<NetworkPriority>();
+            priority->SetRelevanceDistance(distance);
+        }
+        nodes.Push(node);
+    }
+    
+    Vector<Observer> observers(numClients);
+    for (unsigned i = 0; i < numClients; ++i)
+        observers[i].position_ = Vector3(Random(worldSize), 0.0f, Random(worldSize));
+    
+    PrintLine(String(numNodes) + " nodes, " + String(numClients) + " clients, " + String(numUpdates) + " updates");
+    
+    InterestGrid grid;
+    grid.Build(scene, cellSize);
+    PODVector<Node*> movedNodes;
+    PODVector<const InterestGroup*> result;
+    HashSet<unsigned> newGroups;
+    long long updateTime = 0;
+    long long queryTime = 0;
+    long long scanTime = 0;
+    unsigned long long numRelevant = 0;
+    unsigned long long numChanged = 0;
+    HiresTimer timer;
+    
+    for (unsigned i = 0; i < numUpdates; ++i)
+    {
+        // Move the nodes and observers
+        movedNodes.Clear();
+        for (unsigned j = 0; j < nodes.Size(); ++j)
+        {
+            if (nodes[j]->GetParent() == scene && Random(100.0f) < movePercentage)
+            {
+                nodes[j]->Translate(Vector3(Random(2.0f) - 1.0f, 0.0f, Random(2.0f) - 1.0f));
+                movedNodes.Push(nodes[j]);
+            }
+        }
+        for (unsigned j = 0; j < observers.Size(); ++j)
+            observers[j].position_ += Vector3(Random(10.0f) - 5.0f, 0.0f, Random(10.0f) - 5.0f);
+        
+        timer.Reset();
+        grid.Update(scene, movedNodes, cellSize);
+        updateTime += timer.GetUSec(false);
+        
+        // Query the relevant hierarchies for each client and compare to the previous update, as Connection does
+        timer.Reset();
+        for (unsigned j = 0; j < observers.Size(); ++j)
+        {
+            Observer& observer = observers[j];
+            grid.Query(result, observer.position_, 0, observer.relevantGroups_);
+            
+            newGroups.Clear();
+            for (unsigned k = 0; k < result.Size(); ++k)
+            {
+                newGroups.Insert(result[k]->nodeID_);
+                if (!observer.relevantGroups_.Erase(result[k]->nodeID_))
+                    numChanged += result[k]->numNodes_;
+            }
+            for (HashSet<unsigned>::ConstIterator k = observer.relevantGroups_.Begin(); k != observer.relevantGroups_.End(); ++k)
+            {
+                const InterestGroup* group = grid.GetNodeGroup(*k);
+                if (group)
+                    numChanged += group->numNodes_;
+            }
+            
+            observer.relevantGroups_.Swap(newGroups);
+            numRelevant += result.Size();
+        }
+        queryTime += timer.GetUSec(false);
+        
+        // Visit every node for every client, as without interest management
+        timer.Reset();
+        unsigned numInRange = 0;
+        for (unsigned j = 0; j < observers.Size(); ++j)
+        {
+            for (unsigned k = 0; k < nodes.Size(); ++k)
+            {
+                NetworkPriority* priority = nodes[k]->GetComponent<NetworkPriority>();
+                if (priority && (nodes[k]->GetWorldPosition() - observers[j].position_).LengthSquared() <=
+                    priority->GetRelevanceDistance() * priority->GetRelevanceDistance())
+                    ++numInRange;
+            }
+        }
+        scanTime += timer.GetUSec(false);
+        
+        // Make sure the scan is not optimized away
+        if (numInRange > numNodes * numClients)
+            PrintLine("Error: invalid scan result");
+    }
+    
+    float updates = (float)numUpdates;
+    PrintLine("Grid update:       " + String((float)updateTime / 1000.0f / updates) + " ms per update");
+    PrintLine("Grid query:        " + String((float)queryTime / 1000.0f / updates) + " ms per update");
+    PrintLine("Full scan:         " + String((float)scanTime / 1000.0f / updates) + " ms per update");
+    PrintLine("Relevant groups:   " + String((float)numRelevant / updates / (float)numClients) + " per client of " +
+        String(grid.GetGroups().Size()));
+    PrintLine("Created + removed: " + String((float)numChanged / updates / (float)numClients) + " nodes per client per update");
+}
@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Audio/Audio.h>
+#include <Urho3D/Audio/Sound.h>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Graphics/Animation.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/Resource/Image.h>
+#include <Urho3D/Resource/JSONFile.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/XMLFile.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+SharedPtr<Context> context_(new Context());
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+StringHash GetResourceType(const String& fileName);
+float LoadAll(const Vector<Pair<StringHash, String> >& resources, unsigned numThreads);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    if (arguments.Size() < 1)
+    {
+        ErrorExit(
+            "Usage: LoadBenchmark <resource dir> [thread counts]\n\n"
+            "Background loads all images, models, animations, sounds, XML and JSON files\n"
+            "found in the resource directory and its subdirectories, once for each number\n"
+            "of background loading threads given. By default uses 1, 2 and 4 threads and\n"
+            "the number of physical CPU cores.\n"
+        );
+    }
+    
+    String resourceDir = AddTrailingSlash(arguments[0]);
+    
+    PODVector<unsigned> threadCounts;
+    for (unsigned i = 1; i < arguments.Size(); ++i)
+        threadCounts.Push(ToUInt(arguments[i]));
+    if (threadCounts.Empty())
+    {
+        threadCounts.Push(1);
+        threadCounts.Push(2);
+        threadCounts.Push(4);
+        if (GetNumPhysicalCPUs() > 4)
+            threadCounts.Push(GetNumPhysicalCPUs());
+    }
+    
+    context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new ResourceCache(context_));
+    context_->RegisterSubsystem(new WorkQueue(context_));
+    RegisterGraphicsLibrary(context_);
+    RegisterAudioLibrary(context_);
+    
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    if (!cache->AddResourceDir(resourceDir))
+        ErrorExit("Could not open resource directory " + resourceDir);
+    
+    Vector<String> fileNames;
+    context_->GetSubsystem<FileSystem>()->ScanDir(fileNames, resourceDir, "*.*", SCAN_FILES, true);
+    
+    Vector<Pair<StringHash, String> > resources;
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
+    {
+        StringHash type = GetResourceType(fileNames[i]);
+        if (type != StringHash::ZERO)
+            resources.Push(MakePair(type, fileNames[i]));
+    }
+    
+    if (resources.Empty())
+        ErrorExit("No resources found in " + resourceDir);
+    
+    // The first pass warms up the operating system's file cache and is not reported
+    PrintLine("Loading " + String(resources.Size()) + " resources");
+    LoadAll(resources, threadCounts[0]);
+    
+    for (unsigned i = 0; i < threadCounts.Size(); ++i)
+    {
+        float ms = LoadAll(resources, threadCounts[i]);
+        PrintLine(String(threadCounts[i]) + " threads: " + String(ms) + " ms, " + String((float)resources.Size() * 1000.0f / ms) +
+            " resources/s");
+    }
+}
+
+StringHash GetResourceType(const String& fileName)
+{
+    String extension = GetExtension(fileName);
+    
+    if (extension == ".png" || extension == ".jpg" || extension == ".tga" || extension == ".bmp" || extension == ".dds" ||
+        extension == ".ktx" || extension == ".pvr")
+        return Image::GetTypeStatic();
+    else if (extension == ".mdl")
+        return Model::GetTypeStatic();
+    else if (extension == ".ani")
+        return Animation::GetTypeStatic();
+    else if (extension == ".wav" || extension == ".ogg")
+        return Sound::GetTypeStatic();
+    else if (extension == ".xml")
+        return XMLFile::GetTypeStatic();
+    else if (extension == ".json")
+        return JSONFile::GetTypeStatic();
+    else
+        return StringHash::ZERO;
+}
+
+float LoadAll(const Vector<Pair<StringHash, String> >& resources, unsigned numThreads)
+{
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    cache->ReleaseAllResources(true);
+    cache->SetNumBackgroundLoadThreads(numThreads);
+    cache->SetFinishBackgroundResourcesMs(1000);
+    
+    HiresTimer timer;
+    
+    for (unsigned i = 0; i < resources.Size(); ++i)
+        cache->BackgroundLoadResource(resources[i].first_, resources[i].second_, false);
+    
+    // Finish resources as a frame loop would
+    unsigned frameNumber = 0;
+    while (cache->GetNumBackgroundLoadResources())
+    {
+        using namespace BeginFrame;
+        
+        VariantMap& eventData = context_->GetEventDataMap();
+        eventData[P_FRAMENUMBER] = ++frameNumber;
+        eventData[P_TIMESTEP] = 0.0f;
+        cache->SendEvent(E_BEGINFRAME, eventData);
+        Time::Sleep(1);
+    }
+    
+    return (float)timer.GetUSec(false) / 1000.0f;
+}
@@ -0,0 +1,226 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/XMLFile.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+SharedPtr<Context> context_(new Context());
+
+static const char* usage =
+    "Usage: LookupBenchmark [options] [thread counts]\n\n"
+    "Measures concurrent lookups of loaded resources by name from the resource cache,\n"
+    "once for each number of threads given. By default uses 1, 2 and 4 threads and\n"
+    "the number of physical CPU cores.\n\n"
+    "Options:\n"
+    "-r <x>  Number of names to look up, half of which are loaded, default 10000\n"
+    "-l <x>  Number of lookups per thread, default 1000000\n"
+    "-d <x>  Also measure opening the files of the given resource directory\n";
+
+/// Thread which repeatedly looks up resources or opens files from the resource cache.
+class LookupThread : public Thread
+{
+public:
+    /// Construct.
+    LookupThread(const Vector<String>& names, unsigned count, unsigned seed, bool openFiles) :
+        names_(names),
+        count_(count),
+        seed_(seed),
+        openFiles_(openFiles),
+        found_(0)
+    {
+    }
+    
+    /// Perform the lookups.
+    virtual void ThreadFunction()
+    {
+        ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+        StringHash type = XMLFile::GetTypeStatic();
+        unsigned index = seed_;
+        
+        for (unsigned i = 0; i < count_; ++i)
+        {
+            // Visit the names in a different pseudo-random order in each thread
+            index = index * 1103515245 + 12345;
+            const String& name = names_[(index >> 8) % names_.Size()];
+            if (openFiles_)
+            {
+                if (cache->GetFile(name, false))
+                    ++found_;
+            }
+            else if (cache->GetExistingResource(type, name))
+                ++found_;
+        }
+    }
+    
+    /// Resource or file names.
+    const Vector<String>& names_;
+    /// Number of lookups.
+    unsigned count_;
+    /// Random seed.
+    unsigned seed_;
+    /// Open files instead of looking up resources flag.
+    bool openFiles_;
+    /// Number of successful lookups.
+    unsigned found_;
+};
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+void Measure(const String& title, const Vector<String>& names, unsigned count, bool openFiles, const PODVector<unsigned>& threadCounts);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    unsigned numResources = 10000;
+    unsigned numLookups = 1000000;
+    String resourceDir;
+    PODVector<unsigned> threadCounts;
+    
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+            
+            if (argument == "r" && !value.Empty())
+            {
+                numResources = Max((int)ToUInt(value), 1);
+                ++i;
+            }
+            else if (argument == "l" && !value.Empty())
+            {
+                numLookups = ToUInt(value);
+                ++i;
+            }
+            else if (argument == "d" && !value.Empty())
+            {
+                resourceDir = AddTrailingSlash(value);
+                ++i;
+            }
+            else
+                ErrorExit(usage);
+        }
+        else if (ToUInt(arguments[i]))
+            threadCounts.Push(ToUInt(arguments[i]));
+        else
+            ErrorExit(usage);
+    }
+    
+    if (threadCounts.Empty())
+    {
+        threadCounts.Push(1);
+        threadCounts.Push(2);
+        threadCounts.Push(4);
+        if (GetNumPhysicalCPUs() > 4)
+            threadCounts.Push(GetNumPhysicalCPUs());
+    }
+    
+    context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new ResourceCache(context_));
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    
+    // Fill the cache with empty manual resources. Every other looked up name is missing
+    Vector<String> names;
+    for (unsigned i = 0; i < numResources; ++i)
+    {
+        String name = "Bench/Resource" + String(i) + ".xml";
+        if (i & 1)
+        {
+            SharedPtr<XMLFile> resource(new XMLFile(context_));
+            resource->SetName(name);
+            cache->AddManualResource(resource);
+        }
+        names.Push(name);
+    }
+    
+    Measure("Resource lookups", names, numLookups, false, threadCounts);
+    
+    if (!resourceDir.Empty())
+    {
+        if (!cache->AddResourceDir(resourceDir))
+            ErrorExit("Could not open resource directory " + resourceDir);
+        
+        Vector<String> fileNames;
+        context_->GetSubsystem<FileSystem>()->ScanDir(fileNames, resourceDir, "*.*", SCAN_FILES, true);
+        if (fileNames.Empty())
+            ErrorExit("No files found in " + resourceDir);
+        
+        // Opening files is much slower than lookups, so scale down the count
+        Measure("File opens", fileNames, Max((int)numLookups / 100, 1), true, threadCounts);
+    }
+}
+
+void Measure(const String& title, const Vector<String>& names, unsigned count, bool openFiles, const PODVector<unsigned>& threadCounts)
+{
+    PrintLine(title + ", " + String(names.Size()) + " names, " + String(count) + " per thread");
+    
+    for (unsigned i = 0; i < threadCounts.Size(); ++i)
+    {
+        PODVector<LookupThread*> threads;
+        for (unsigned j = 0; j < threadCounts[i]; ++j)
+            threads.Push(new LookupThread(names, count, j + 1, openFiles));
+        
+        HiresTimer timer;
+        for (unsigned j = 0; j < threads.Size(); ++j)
+            threads[j]->Run();
+        for (unsigned j = 0; j < threads.Size(); ++j)
+            threads[j]->Stop();
+        float ms = (float)timer.GetUSec(false) / 1000.0f;
+        
+        for (unsigned j = 0; j < threads.Size(); ++j)
+            delete threads[j];
+        
+        PrintLine(String(threadCounts[i]) + " threads: " + String(ms) + " ms, " +
+            String((float)count * threadCounts[i] * 1000.0f / ms) + " per second");
+    }
+}
@@ -0,0 +1,450 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Input/Controls.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkPriority.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+static const char* usage =
+    "Usage: NetworkLoadTest [options]\n\n"
+    "Runs a headless server scene with moving replicated objects and a number of\n"
+    "simulated clients connected over loopback in the same process, and reports\n"
+    "the server update cost, bandwidth per client and replication latency.\n\n"
+    "Options:\n"
+    "-c <x>  Number of simulated clients, default 16\n"
+    "-o <x>  Number of moving replicated objects, default 500\n"
+    "-t <x>  Measured duration in seconds, default 10\n"
+    "-f <x>  Frame and network update rate, default 30\n"
+    "-l <x>  Simulated latency in milliseconds, default 0\n"
+    "-p <x>  Simulated packet loss probability, default 0\n"
+    "-i <x>  Enable interest management with the given relevance distance, default 0 (off)\n"
+    "-s <x>  Enable delta snapshots (0/1), default 0\n"
+    "-w <x>  World size, default 500\n"
+    "-u <x>  UDP port, default 2345\n";
+
+static const StringHash VAR_CLOCK("Clock");
+static const unsigned CTRL_FORWARD = 1;
+static const float PLAYER_SPEED = 5.0f;
+static const int CONNECT_TIMEOUT_MSEC = 10000;
+
+/// Replicated object moving on a circle.
+struct MovingObject
+{
+    /// Scene node.
+    SharedPtr<Node> node_;
+    /// Circle center.
+    Vector3 center_;
+    /// Circle radius.
+    float radius_;
+    /// Angular speed in degrees per second.
+    float speed_;
+    /// Current angle.
+    float angle_;
+};
+
+/// Server-side player of a client connection.
+struct Player
+{
+    /// Client connection.
+    WeakPtr<Connection> connection_;
+    /// Player node.
+    SharedPtr<Node> node_;
+};
+
+/// Simulated client with its own execution context.
+struct SimulatedClient
+{
+    /// Client context.
+    SharedPtr<Context> context_;
+    /// Client scene.
+    SharedPtr<Scene> scene_;
+    /// Last received server clock value.
+    int lastClock_;
+    /// Number of replication delay samples.
+    unsigned numLatencySamples_;
+    /// Sum of replication delays in microseconds.
+    long long totalLatency_;
+    /// Maximum replication delay in microseconds.
+    long long maxLatency_;
+    /// Yaw turn speed in degrees per second.
+    float turnSpeed_;
+    /// Controls to send.
+    Controls controls_;
+};
+
+SharedPtr<Context> context_(new Context());
+HiresTimer clock_;
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+void UpdateClient(SimulatedClient& client, float timeStep);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    unsigned numClients = 16;
+    unsigned numObjects = 500;
+    float duration = 10.0f;
+    int fps = 30;
+    int latency = 0;
+    float packetLoss = 0.0f;
+    float relevanceDistance = 0.0f;
+    bool deltaSnapshots = false;
+    float worldSize = 500.0f;
+    unsigned short port = 2345;
+    
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+            if (value.Empty())
+                ErrorExit(usage);
+            
+            if (argument == "c")
+                numClients = Max((int)ToUInt(value), 1);
+            else if (argument == "o")
+                numObjects = ToUInt(value);
+            else if (argument == "t")
+                duration = Max(ToFloat(value), 1.0f);
+            else if (argument == "f")
+                fps = Clamp(ToInt(value), 1, 1000);
+            else if (argument == "l")
+                latency = Max(ToInt(value), 0);
+            else if (argument == "p")
+                packetLoss = Clamp(ToFloat(value), 0.0f, 1.0f);
+            else if (argument == "i")
+                relevanceDistance = Max(ToFloat(value), 0.0f);
+            else if (argument == "s")
+                deltaSnapshots = ToBool(value);
+            else if (argument == "w")
+                worldSize = Max(ToFloat(value), 1.0f);
+            else if (argument == "u")
+                port = (unsigned short)ToUInt(value);
+            else
+                ErrorExit(usage);
+            ++i;
+        }
+        else
+            ErrorExit(usage);
+    }
+    
+    // Set up the server context. The log instance is shared by all contexts, so create it only once
+    context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new ResourceCache(context_));
+    context_->RegisterSubsystem(new Log(context_));
+    context_->GetSubsystem<Log>()->SetLevel(LOG_WARNING);
+    WorkQueue* queue = new WorkQueue(context_);
+    context_->RegisterSubsystem(queue);
+    queue->CreateThreads(GetNumPhysicalCPUs() - 1);
+    RegisterSceneLibrary(context_);
+    Network* serverNetwork = new Network(context_);
+    context_->RegisterSubsystem(serverNetwork);
+    
+    serverNetwork->SetUpdateFps(fps);
+    serverNetwork->SetSimulatedLatency(latency);
+    serverNetwork->SetSimulatedPacketLoss(packetLoss);
+    serverNetwork->SetDeltaSnapshots(deltaSnapshots);
+    if (relevanceDistance > 0.0f)
+    {
+        serverNetwork->SetInterestManagement(true);
+        serverNetwork->SetInterestCellSize(relevanceDistance);
+    }
+    
+    SharedPtr<Scene> scene(new Scene(context_));
+    Node* clockNode = scene->CreateChild("Clock");
+    
+    Vector<MovingObject> objects(numObjects);
+    for (unsigned i = 0; i < numObjects; ++i)
+    {
+        MovingObject& object = objects[i];
+        object.node_ = scene->CreateChild("Object");
+        object.center_ = Vector3(Random(worldSize), 0.0f, Random(worldSize));
+        object.radius_ = Random(1.0f, 20.0f);
+        object.speed_ = Random(-90.0f, 90.0f);
+        object.angle_ = Random(360.0f);
+        if (relevanceDistance > 0.0f)
+        {
+            NetworkPriority* priority = object.node_->CreateComponent<NetworkPriority>(LOCAL);
+            priority->SetRelevanceDistance(relevanceDistance);
+        }
+    }
+    
+    if (!serverNetwork->StartServer(port))
+        ErrorExit("Could not start server on port " + String(port));
+    
+    // Set up the clients, each with its own context and Network subsystem
+    Vector<SimulatedClient> clients(numClients);
+    for (unsigned i = 0; i < numClients; ++i)
+    {
+        SimulatedClient& client = clients[i];
+        client.context_ = new Context();
+        client.context_->RegisterSubsystem(new FileSystem(client.context_));
+        client.context_->RegisterSubsystem(new ResourceCache(client.context_));
+        RegisterSceneLibrary(client.context_);
+        Network* network = new Network(client.context_);
+        client.context_->RegisterSubsystem(network);
+        network->SetUpdateFps(fps);
+        network->SetSimulatedLatency(latency);
+        network->SetSimulatedPacketLoss(packetLoss);
+        
+        client.scene_ = new Scene(client.context_);
+        client.lastClock_ = 0;
+        client.numLatencySamples_ = 0;
+        client.totalLatency_ = 0;
+        client.maxLatency_ = 0;
+        client.turnSpeed_ = Random(-45.0f, 45.0f);
+        client.controls_.yaw_ = Random(360.0f);
+        client.controls_.Set(CTRL_FORWARD);
+        if (!network->Connect("127.0.0.1", port, client.scene_))
+            ErrorExit("Could not connect client " + String(i));
+    }
+    
+    PrintLine(String(numClients) + " clients, " + String(numObjects) + " objects, " + String(fps) + " FPS, " +
+        String(latency) + " ms latency, " + String(packetLoss) + " packet loss");
+    
+    Vector<Player> players;
+    float timeStep = 1.0f / (float)fps;
+    long long frameUSec = 1000000LL / fps;
+    long long connectStart = clock_.GetUSec(false);
+    long long measureStart = 0;
+    bool measuring = false;
+    unsigned numFrames = 0;
+    long long totalTickTime = 0;
+    long long maxTickTime = 0;
+    HashMap<Connection*, unsigned long long> startBytesOut;
+    HashMap<Connection*, unsigned long long> startBytesIn;
+    HiresTimer tickTimer;
+    
+    for (;;)
+    {
+        long long frameStart = clock_.GetUSec(false);
+        
+        // Server frame: receive, run the logic and send the updates
+        tickTimer.Reset();
+        serverNetwork->Update(timeStep);
+        
+        Vector<SharedPtr<Connection> > connections = serverNetwork->GetClientConnections();
+        for (unsigned i = 0; i < connections.Size(); ++i)
+        {
+            Connection* connection = connections[i];
+            if (!connection->GetScene())
+            {
+                connection->SetScene(scene);
+                Player player;
+                player.connection_ = connection;
+                player.node_ = scene->CreateChild("Player");
+                player.node_->SetPosition(Vector3(Random(worldSize), 0.0f, Random(worldSize)));
+                players.Push(player);
+            }
+        }
+        
+        for (unsigned i = 0; i < objects.Size(); ++i)
+        {
+            MovingObject& object = objects[i];
+            object.angle_ += object.speed_ * timeStep;
+            object.node_->SetPosition(object.center_ + Vector3(Cos(object.angle_), 0.0f, Sin(object.angle_)) * object.radius_);
+        }
+        
+        for (unsigned i = players.Size() - 1; i < players.Size(); --i)
+        {
+            Player& player = players[i];
+            Connection* connection = player.connection_;
+            if (!connection)
+            {
+                player.node_->Remove();
+                players.Erase(i);
+                continue;
+            }
+            
+            const Controls& controls = connection->GetControls();
+            player.node_->SetRotation(Quaternion(controls.yaw_, Vector3::UP));
+            if (controls.IsDown(CTRL_FORWARD))
+                player.node_->Translate(Vector3::FORWARD * PLAYER_SPEED * timeStep);
+            connection->SetPosition(player.node_->GetPosition());
+        }
+        
+        clockNode->SetVar(VAR_CLOCK, (int)clock_.GetUSec(false));
+        serverNetwork->PostUpdate(timeStep);
+        long long tickTime = tickTimer.GetUSec(false);
+        
+        for (unsigned i = 0; i < clients.Size(); ++i)
+            UpdateClient(clients[i], timeStep);
+        
+        if (measuring)
+        {
+            ++numFrames;
+            totalTickTime += tickTime;
+            if (tickTime > maxTickTime)
+                maxTickTime = tickTime;
+            if (frameStart - measureStart >= (long long)(duration * 1000000.0f))
+                break;
+        }
+        else
+        {
+            // Start measuring once all clients have loaded the scene
+            unsigned numLoaded = 0;
+            for (unsigned i = 0; i < clients.Size(); ++i)
+            {
+                Connection* serverConnection = clients[i].context_->GetSubsystem<Network>()->GetServerConnection();
+                if (serverConnection && serverConnection->IsSceneLoaded())
+                    ++numLoaded;
+            }
+            
+            if (numLoaded == clients.Size() && connections.Size() == clients.Size())
+            {
+                measuring = true;
+                measureStart = frameStart;
+                for (unsigned i = 0; i < clients.Size(); ++i)
+                {
+                    clients[i].numLatencySamples_ = 0;
+                    clients[i].totalLatency_ = 0;
+                    clients[i].maxLatency_ = 0;
+                }
+                for (unsigned i = 0; i < connections.Size(); ++i)
+                {
+                    startBytesOut[connections[i]] = connections[i]->GetBytesOutTotal();
+                    startBytesIn[connections[i]] = connections[i]->GetBytesInTotal();
+                }
+            }
+            else if (frameStart - connectStart >= CONNECT_TIMEOUT_MSEC * 1000LL)
+                ErrorExit("Only " + String(numLoaded) + " of " + String(clients.Size()) + " clients joined the scene");
+        }
+        
+        // Sleep for the rest of the frame
+        long long elapsed = clock_.GetUSec(false) - frameStart;
+        if (elapsed < frameUSec)
+            Time::Sleep((unsigned)((frameUSec - elapsed) / 1000));
+    }
+    
+    float seconds = (float)(clock_.GetUSec(false) - measureStart) / 1000000.0f;
+    
+    PrintLine("Server tick:       " + String((float)totalTickTime / 1000.0f / (float)Max((int)numFrames, 1)) + " ms avg, " +
+        String((float)maxTickTime / 1000.0f) + " ms max");
+    
+    Vector<SharedPtr<Connection> > connections = serverNetwork->GetClientConnections();
+    float totalOut = 0.0f;
+    float minOut = M_INFINITY;
+    float maxOut = 0.0f;
+    float totalIn = 0.0f;
+    for (unsigned i = 0; i < connections.Size(); ++i)
+    {
+        Connection* connection = connections[i];
+        if (!startBytesOut.Contains(connection))
+            continue;
+        float out = (float)(connection->GetBytesOutTotal() - startBytesOut[connection]) / 1024.0f / seconds;
+        totalOut += out;
+        minOut = Min(minOut, out);
+        maxOut = Max(maxOut, out);
+        totalIn += (float)(connection->GetBytesInTotal() - startBytesIn[connection]) / 1024.0f / seconds;
+    }
+    float numConnections = (float)Max((int)connections.Size(), 1);
+    PrintLine("Bytes out:         " + String(totalOut / numConnections) + " KB/s avg per client, " + String(minOut) + " min, " +
+        String(maxOut) + " max");
+    PrintLine("Bytes in:          " + String(totalIn / numConnections) + " KB/s avg per client");
+    
+    unsigned numSamples = 0;
+    long long totalLatency = 0;
+    long long maxLatency = 0;
+    for (unsigned i = 0; i < clients.Size(); ++i)
+    {
+        const SimulatedClient& client = clients[i];
+        numSamples += client.numLatencySamples_;
+        totalLatency += client.totalLatency_;
+        if (client.maxLatency_ > maxLatency)
+            maxLatency = client.maxLatency_;
+    }
+    PrintLine("Replication delay: " + String((float)totalLatency / 1000.0f / (float)Max((int)numSamples, 1)) + " ms avg, " +
+        String((float)maxLatency / 1000.0f) + " ms max");
+    
+    for (unsigned i = 0; i < clients.Size(); ++i)
+        clients[i].context_->GetSubsystem<Network>()->Disconnect();
+    serverNetwork->StopServer();
+}
+
+void UpdateClient(SimulatedClient& client, float timeStep)
+{
+    Network* network = client.context_->GetSubsystem<Network>();
+    network->Update(timeStep);
+    
+    // Measure the delay from the server setting the clock to the client receiving it
+    Node* clockNode = client.scene_->GetChild("Clock");
+    if (clockNode)
+    {
+        int clock = clockNode->GetVar(VAR_CLOCK).GetInt();
+        if (clock && clock != client.lastClock_)
+        {
+            if (client.lastClock_)
+            {
+                long long delay = clock_.GetUSec(false) - clock;
+                ++client.numLatencySamples_;
+                client.totalLatency_ += delay;
+                if (delay > client.maxLatency_)
+                    client.maxLatency_ = delay;
+            }
+            client.lastClock_ = clock;
+        }
+    }
+    
+    // Steer with scripted controls
+    client.controls_.yaw_ += client.turnSpeed_ * timeStep;
+    Connection* serverConnection = network->GetServerConnection();
+    if (serverConnection)
+        serverConnection->SetControls(client.controls_);
+    
+    network->PostUpdate(timeStep);
+}
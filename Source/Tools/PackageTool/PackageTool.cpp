@@ -27,6 +27,7 @@
 #include <Urho3D/IO/File.h>
 #include <Urho3D/IO/FileSystem.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
 
 #ifdef WIN32
 #include <windows.h>
@@ -57,6 +58,7 @@ String basePath_;
 Vector<FileEntry> entries_;
 unsigned checksum_ = 0;
 bool compress_ = false;
+bool compressHC_ = false;
 bool quiet_ = false;
 unsigned blockSize_ = COMPRESSED_BLOCK_SIZE;
 
@@ -94,6 +96,9 @@ void Run(const Vector<String>& arguments)
             "\n"
             "Options:\n"
             "-c      Enable package file LZ4 compression\n"
+            "-h      Enable package file LZ4 high compression (slower to compress, same decompression speed)\n"
+            "-b <x>  Set uncompressed block size for compression, default 32768. Blocks can be\n"
+            "        decompressed independently and in parallel\n"
             "-q      Enable quiet mode\n"
         );
 
@@ -114,6 +119,18 @@ void Run(const Vector<String>& arguments)
                     case 'c':
                         compress_ = true;
                         break;
+                    case 'h':
+                        compress_ = true;
+                        compressHC_ = true;
+                        break;
+                    case 'b':
+                        if (i + 1 < arguments.Size())
+                        {
+                            blockSize_ = ToUInt(arguments[++i]);
+                            if (!blockSize_)
+                                ErrorExit("Invalid block size " + arguments[i]);
+                        }
+                        break;
                     case 'q':
                         quiet_ = true;
                         break;
@@ -224,28 +241,41 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         }
         else
         {
-            SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[LZ4_compressBound(blockSize_)]);
+            // Compress all blocks first, as the block index precedes the data
+            unsigned numBlocks = (dataSize + blockSize_ - 1) / blockSize_;
+            SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[numBlocks * LZ4_compressBound(blockSize_)]);
+            PODVector<unsigned> blockOffsets(numBlocks + 1);
 
             unsigned pos = 0;
-            unsigned totalPackedBytes = 0;
+            unsigned packedPos = 0;
+            unsigned indexSize = (2 + numBlocks + 1) * sizeof(unsigned);
 
-            while (pos < dataSize)
+            for (unsigned j = 0; j < numBlocks; ++j)
             {
                 unsigned unpackedSize = blockSize_;
                 if (pos + unpackedSize > dataSize)
                     unpackedSize = dataSize - pos;
 
-                unsigned packedSize = LZ4_compressHC((const char*)&buffer[pos], (char*)compressBuffer.Get(), unpackedSize);
+                const char* src = (const char*)&buffer[pos];
+                char* packed = (char*)compressBuffer.Get() + packedPos;
+                unsigned packedSize = compressHC_ ? LZ4_compressHC(src, packed, unpackedSize) : LZ4_compress(src, packed,
+                    unpackedSize);
                 if (!packedSize)
                     ErrorExit("LZ4 compression failed for file " + entries_[i].name_ + " at offset " + pos);
 
-                dest.WriteUShort(unpackedSize);
-                dest.WriteUShort(packedSize);
-                dest.Write(compressBuffer.Get(), packedSize);
-                totalPackedBytes += 6 + packedSize;
-
+                blockOffsets[j] = indexSize + packedPos;
+                packedPos += packedSize;
                 pos += unpackedSize;
             }
+            blockOffsets[numBlocks] = indexSize + packedPos;
+
+            dest.WriteUInt(blockSize_);
+            dest.WriteUInt(numBlocks);
+            for (unsigned j = 0; j <= numBlocks; ++j)
+                dest.WriteUInt(blockOffsets[j]);
+            dest.Write(compressBuffer.Get(), packedPos);
+
+            unsigned totalPackedBytes = indexSize + packedPos;
 
             if (!quiet_)
                 PrintLine(entries_[i].name_ + " in " + String(dataSize) + " out " + String(totalPackedBytes));
@@ -281,7 +311,7 @@ void WriteHeader(File& dest)
     if (!compress_)
         dest.WriteFileID("UPAK");
     else
-        dest.WriteFileID("ULZ4");
+        dest.WriteFileID("ULZB");
     dest.WriteUInt(entries_.Size());
     dest.WriteUInt(checksum_);
 }
@@ -0,0 +1,286 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Audio/Audio.h>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#ifdef URHO3D_NAVIGATION
+#include <Urho3D/Navigation/NavigationMesh.h>
+#endif
+#ifdef URHO3D_PHYSICS
+#include <Urho3D/Physics/PhysicsWorld.h>
+#endif
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/XMLFile.h>
+#include <Urho3D/Scene/FlatScene.h>
+#include <Urho3D/Scene/Node.h>
+#include <Urho3D/Scene/Scene.h>
+#ifdef URHO3D_URHO2D
+#include <Urho3D/Urho2D/Urho2D.h>
+#endif
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+SharedPtr<Context> context_(new Context());
+unsigned numSkippedComponents_ = 0;
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+void ConvertXMLNode(FlatSceneWriter& writer, const XMLElement& source, StringHash type, unsigned parentIndex);
+void ConvertXMLAttributes(FlatSceneWriter& writer, const XMLElement& source, StringHash type);
+void ConvertBinaryNode(FlatSceneWriter& writer, Deserializer& source, StringHash type, unsigned id, unsigned parentIndex);
+void ConvertBinaryAttributes(FlatSceneWriter& writer, Deserializer& source, StringHash type);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    if (arguments.Size() < 2)
+    {
+        ErrorExit(
+            "Usage: SceneConverter <input file> <output file>\n\n"
+            "Converts an XML or binary scene file into the flat binary scene format, which\n"
+            "is loaded with Scene::Load() without per-object parsing.\n"
+        );
+    }
+    
+    const String& inFile = arguments[0];
+    const String& outFile = arguments[1];
+    
+    // Register the object factories and attributes of all scene libraries. Components are not instantiated; only their
+    // attribute definitions are needed to convert the data
+    context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new ResourceCache(context_));
+    context_->RegisterSubsystem(new WorkQueue(context_));
+    RegisterSceneLibrary(context_);
+    RegisterGraphicsLibrary(context_);
+    RegisterAudioLibrary(context_);
+    #ifdef URHO3D_PHYSICS
+    RegisterPhysicsLibrary(context_);
+    #endif
+    #ifdef URHO3D_NAVIGATION
+    RegisterNavigationLibrary(context_);
+    #endif
+    #ifdef URHO3D_URHO2D
+    RegisterUrho2DLibrary(context_);
+    #endif
+    
+    File source(context_);
+    if (!source.Open(inFile))
+        ErrorExit("Could not open input file " + inFile);
+    
+    FlatSceneWriter writer(context_);
+    
+    PrintLine("Reading scene " + inFile);
+    String fileID = source.ReadFileID();
+    if (fileID == "USCN")
+        ConvertBinaryNode(writer, source, Scene::GetTypeStatic(), source.ReadUInt(), M_MAX_UNSIGNED);
+    else if (fileID == "USCF")
+        ErrorExit("Input file " + inFile + " is already a flat scene");
+    else
+    {
+        source.Seek(0);
+        XMLFile xml(context_);
+        if (!xml.Load(source))
+            ErrorExit("Could not parse input file " + inFile);
+        
+        XMLElement rootElem = xml.GetRoot("scene");
+        if (!rootElem)
+            ErrorExit("Input file " + inFile + " is not a scene file");
+        
+        ConvertXMLNode(writer, rootElem, Scene::GetTypeStatic(), M_MAX_UNSIGNED);
+    }
+    
+    if (numSkippedComponents_)
+        PrintLine("Warning: skipped " + String(numSkippedComponents_) + " components of unknown type");
+    
+    File dest(context_);
+    if (!dest.Open(outFile, FILE_WRITE))
+        ErrorExit("Could not open output file " + outFile);
+    
+    PrintLine("Writing flat scene with " + String(writer.GetNumNodes()) + " nodes and " + String(writer.GetNumComponents()) +
+        " components");
+    if (!writer.Save(dest))
+        ErrorExit("Could not write output file " + outFile);
+}
+
+void ConvertXMLNode(FlatSceneWriter& writer, const XMLElement& source, StringHash type, unsigned parentIndex)
+{
+    unsigned nodeIndex = writer.AddNode(type, source.GetUInt("id"), parentIndex);
+    ConvertXMLAttributes(writer, source, type);
+    if (source.GetChild("objectanimation") || source.GetChild("attributeanimation"))
+        PrintLine("Warning: inline object animation is not supported in flat scenes and was skipped");
+    
+    XMLElement compElem = source.GetChild("component");
+    while (compElem)
+    {
+        String typeName = compElem.GetAttribute("type");
+        StringHash compType(typeName);
+        if (context_->GetAttributes(compType))
+        {
+            writer.AddComponent(compType, compElem.GetUInt("id"));
+            ConvertXMLAttributes(writer, compElem, compType);
+        }
+        else
+        {
+            PrintLine("Warning: skipping component of unknown type " + typeName);
+            ++numSkippedComponents_;
+        }
+        
+        compElem = compElem.GetNext("component");
+    }
+    
+    XMLElement childElem = source.GetChild("node");
+    while (childElem)
+    {
+        ConvertXMLNode(writer, childElem, Node::GetTypeStatic(), nodeIndex);
+        childElem = childElem.GetNext("node");
+    }
+}
+
+void ConvertXMLAttributes(FlatSceneWriter& writer, const XMLElement& source, StringHash type)
+{
+    const Vector<AttributeInfo>* attributes = context_->GetAttributes(type);
+    if (!attributes)
+        return;
+    
+    for (unsigned i = 0; i < attributes->Size(); ++i)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        if (!(attr.mode_ & AM_FILE))
+            continue;
+        
+        Variant varValue;
+        
+        XMLElement attrElem = source.GetChild("attribute");
+        while (attrElem)
+        {
+            if (!attr.name_.Compare(attrElem.GetAttribute("name"), true))
+                break;
+            attrElem = attrElem.GetNext("attribute");
+        }
+        
+        if (attrElem)
+        {
+            // If enums specified, do enum lookup like Serializable::LoadXML()
+            if (attr.enumNames_)
+            {
+                String value = attrElem.GetAttribute("value");
+                int enumValue = 0;
+                const char** enumPtr = attr.enumNames_;
+                while (*enumPtr)
+                {
+                    if (!value.Compare(*enumPtr, false))
+                    {
+                        varValue = enumValue;
+                        break;
+                    }
+                    ++enumPtr;
+                    ++enumValue;
+                }
+                if (varValue.IsEmpty())
+                    PrintLine("Warning: unknown enum value " + value + " in attribute " + attr.name_);
+            }
+            else
+                varValue = attrElem.GetVariantValue(attr.type_);
+        }
+        
+        // Missing attributes keep their default value, as when loading the XML
+        writer.AddAttribute(varValue.IsEmpty() ? attr.defaultValue_ : varValue);
+    }
+}
+
+void ConvertBinaryNode(FlatSceneWriter& writer, Deserializer& source, StringHash type, unsigned id, unsigned parentIndex)
+{
+    unsigned nodeIndex = writer.AddNode(type, id, parentIndex);
+    ConvertBinaryAttributes(writer, source, type);
+    
+    unsigned numComponents = source.ReadVLE();
+    for (unsigned i = 0; i < numComponents; ++i)
+    {
+        VectorBuffer compBuffer(source, source.ReadVLE());
+        StringHash compType = compBuffer.ReadStringHash();
+        unsigned compID = compBuffer.ReadUInt();
+        if (context_->GetAttributes(compType))
+        {
+            writer.AddComponent(compType, compID);
+            ConvertBinaryAttributes(writer, compBuffer, compType);
+        }
+        else
+        {
+            PrintLine("Warning: skipping component of unknown type " + compType.ToString());
+            ++numSkippedComponents_;
+        }
+    }
+    
+    unsigned numChildren = source.ReadVLE();
+    for (unsigned i = 0; i < numChildren; ++i)
+    {
+        unsigned childID = source.ReadUInt();
+        ConvertBinaryNode(writer, source, Node::GetTypeStatic(), childID, nodeIndex);
+    }
+}
+
+void ConvertBinaryAttributes(FlatSceneWriter& writer, Deserializer& source, StringHash type)
+{
+    const Vector<AttributeInfo>* attributes = context_->GetAttributes(type);
+    if (!attributes)
+        return;
+    
+    for (unsigned i = 0; i < attributes->Size(); ++i)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        if (!(attr.mode_ & AM_FILE))
+            continue;
+        
+        if (source.IsEof())
+            ErrorExit("Unexpected end of binary scene data");
+        
+        writer.AddAttribute(source.ReadVariant(attr.type_));
+    }
+}
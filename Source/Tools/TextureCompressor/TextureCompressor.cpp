@@ -0,0 +1,190 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/Resource/Image.h>
+
+#include <cmath>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+SharedPtr<Context> context_(new Context());
+
+static const char* usage =
+    "Usage: TextureCompressor <input image> <output DDS> [options]\n\n"
+    "Compresses an image including its mip levels to DXT and saves it as a DDS file.\n"
+    "Prints the peak signal-to-noise ratio of the decompressed first mip level.\n\n"
+    "Options:\n"
+    "-f <x>  Format: dxt1, dxt3 or dxt5. Default dxt5 if the image has alpha, else dxt1\n"
+    "-t <x>  Number of worker threads, default the number of physical CPU cores - 1\n";
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+float CalculatePSNR(const Image* original, const unsigned char* decompressed, bool alpha);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    if (arguments.Size() < 2)
+        ErrorExit(usage);
+    
+    String inputName = arguments[0];
+    String outputName = arguments[1];
+    String formatName;
+    unsigned numThreads = GetNumPhysicalCPUs() > 1 ? GetNumPhysicalCPUs() - 1 : 0;
+    
+    for (unsigned i = 2; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+            
+            if (argument == "f" && !value.Empty())
+            {
+                formatName = value.ToLower();
+                ++i;
+            }
+            else if (argument == "t" && !value.Empty())
+            {
+                numThreads = ToUInt(value);
+                ++i;
+            }
+            else
+                ErrorExit(usage);
+        }
+        else
+            ErrorExit(usage);
+    }
+    
+    context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new WorkQueue(context_));
+    if (numThreads)
+        context_->GetSubsystem<WorkQueue>()->CreateThreads(numThreads);
+    
+    File inputFile(context_, inputName);
+    if (!inputFile.IsOpen())
+        ErrorExit("Could not open input image " + inputName);
+    
+    SharedPtr<Image> image(new Image(context_));
+    if (!image->Load(inputFile))
+        ErrorExit("Could not load input image " + inputName);
+    if (image->IsCompressed())
+        ErrorExit("Input image " + inputName + " is already compressed");
+    
+    bool hasAlpha = image->GetComponents() == 2 || image->GetComponents() == 4;
+    CompressedFormat format = hasAlpha ? CF_DXT5 : CF_DXT1;
+    if (formatName == "dxt1")
+        format = CF_DXT1;
+    else if (formatName == "dxt3")
+        format = CF_DXT3;
+    else if (formatName == "dxt5")
+        format = CF_DXT5;
+    else if (!formatName.Empty())
+        ErrorExit("Unrecognized format " + formatName);
+    
+    // Keep the uncompressed first level for measuring the quality
+    SharedPtr<Image> original(new Image(context_));
+    original->SetSize(image->GetWidth(), image->GetHeight(), image->GetComponents());
+    original->SetData(image->GetData());
+    
+    HiresTimer timer;
+    if (!image->Compress(format))
+        ErrorExit("Failed to compress " + inputName);
+    float ms = (float)timer.GetUSec(false) / 1000.0f;
+    
+    PrintLine("Compressed " + String(image->GetWidth()) + "x" + String(image->GetHeight()) + " image with " +
+        String(image->GetNumCompressedLevels()) + " mip levels in " + String(ms) + " ms using " + String(numThreads + 1) + " threads");
+    
+    // Measure the quality through the same decompression path as used when the hardware lacks DXT support
+    CompressedLevel level = image->GetCompressedLevel(0);
+    SharedArrayPtr<unsigned char> decompressed(new unsigned char[level.width_ * level.height_ * 4]);
+    if (!level.Decompress(decompressed.Get()))
+        ErrorExit("Failed to decompress " + inputName);
+    
+    PrintLine("RGB PSNR: " + String(CalculatePSNR(original, decompressed.Get(), false)) + " dB");
+    if (hasAlpha && format != CF_DXT1)
+        PrintLine("Alpha PSNR: " + String(CalculatePSNR(original, decompressed.Get(), true)) + " dB");
+    
+    if (!image->SaveDDS(outputName))
+        ErrorExit("Could not save output file " + outputName);
+}
+
+float CalculatePSNR(const Image* original, const unsigned char* decompressed, bool alpha)
+{
+    const unsigned char* data = original->GetData();
+    unsigned components = original->GetComponents();
+    unsigned numPixels = original->GetWidth() * original->GetHeight();
+    double squaredError = 0.0;
+    unsigned numSamples = 0;
+    
+    for (unsigned i = 0; i < numPixels; ++i)
+    {
+        const unsigned char* src = data + i * components;
+        const unsigned char* dest = decompressed + i * 4;
+        
+        // Images with 1 or 2 components are compressed as luminance and luminance-alpha
+        unsigned char reference[4];
+        reference[0] = src[0];
+        reference[1] = components >= 3 ? src[1] : src[0];
+        reference[2] = components >= 3 ? src[2] : src[0];
+        reference[3] = components == 4 ? src[3] : (components == 2 ? src[1] : 255);
+        
+        for (unsigned c = alpha ? 3 : 0; c < (alpha ? 4u : 3u); ++c)
+        {
+            double error = (double)reference[c] - dest[c];
+            squaredError += error * error;
+            ++numSamples;
+        }
+    }
+    
+    if (squaredError == 0.0)
+        return M_INFINITY;
+    return (float)(10.0 * log10(255.0 * 255.0 * numSamples / squaredError));
+}
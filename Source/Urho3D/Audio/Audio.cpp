@@ -137,6 +137,7 @@ bool Audio::SetMode(int bufferLengthMSec, int mixRate, bool stereo, bool interpo
 void Audio::Update(float timeStep)
 {
     PROFILE(UpdateAudio);
+    MEMORY_TAG(MT_AUDIO);
 
     // Update in reverse order, because sound sources might remove themselves
     for (unsigned i = soundSources_.Size() - 1; i < soundSources_.Size(); --i)
@@ -244,6 +245,7 @@ void SDLAudioCallback(void *userdata, Uint8* stream, int len)
 
 void Audio::MixOutput(void *dest, unsigned samples)
 {
+    MEMORY_TAG(MT_AUDIO);
     if (!playing_ || !clipBuffer_)
     {
         memset(dest, 0, samples * sampleSize_ * SAMPLE_SIZE_MUL);
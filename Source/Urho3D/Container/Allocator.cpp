@@ -21,14 +21,275 @@
 //
 
 #include "../Container/Allocator.h"
+#include "../Core/MemoryTracker.h"
+#include "../Core/Mutex.h"
 
 #include "stdio.h"
 
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
+/// Shared node pool chunk size in bytes.
+static const unsigned POOL_CHUNK_SIZE = 16384;
+/// Maximum number of free nodes moved between a thread cache and the shared free list at once.
+static const unsigned POOL_MAX_BATCH_SIZE = 64;
+#ifdef URHO3D_MEMORY_TRACKING
+/// Size of the memory accounting header prepended to tracked allocations.
+static const unsigned POOL_TRACKING_HEADER_SIZE = 16;
+#endif
+
+/// Shared node pool size class.
+struct PoolSizeClass
+{
+    /// Node size.
+    unsigned nodeSize_;
+    /// Number of nodes moved between a thread cache and the shared free list at once.
+    unsigned batchSize_;
+    /// First free node.
+    AllocatorNode* free_;
+    /// Number of free nodes.
+    unsigned numFree_;
+    /// Total number of nodes.
+    unsigned capacity_;
+    /// Number of chunks.
+    unsigned numChunks_;
+};
+
+/// Per-thread cache of free shared node pool nodes.
+struct PoolThreadCache
+{
+    /// First free node per size class.
+    AllocatorNode* free_[POOL_NUM_SIZE_CLASSES];
+    /// Number of free nodes per size class.
+    unsigned numFree_[POOL_NUM_SIZE_CLASSES];
+    /// Number of free nodes per size class as of the last exchange with the shared free list. Only accessed under the pool mutex.
+    unsigned publishedFree_[POOL_NUM_SIZE_CLASSES];
+    /// Previous thread cache.
+    PoolThreadCache* prev_;
+    /// Next thread cache.
+    PoolThreadCache* next_;
+};
+
+/// Shared node pool state. Allocated on first use and never freed, as containers may be destroyed during static deinitialization.
+struct PoolState
+{
+    /// Mutex for the shared free lists and the thread cache list.
+    Mutex mutex_;
+    /// Size classes.
+    PoolSizeClass classes_[POOL_NUM_SIZE_CLASSES];
+    /// Thread caches.
+    PoolThreadCache* caches_;
+};
+
+static PoolState* poolState = 0;
+
+#ifdef WIN32
+static DWORD poolTlsIndex = TLS_OUT_OF_INDEXES;
+static volatile LONG poolInitialized = 0;
+#else
+static pthread_key_t poolTlsKey;
+static pthread_once_t poolOnce = PTHREAD_ONCE_INIT;
+#endif
+
+static unsigned GetPoolSizeClassNodeSize(unsigned index)
+{
+    // 16 byte steps up to 128, 32 byte steps up to 256 and 64 byte steps up to 512
+    if (index < 8)
+        return (index + 1) << 4;
+    else if (index < 12)
+        return 128 + ((index - 7) << 5);
+    else
+        return 256 + ((index - 11) << 6);
+}
+
+static unsigned GetPoolSizeClass(unsigned size)
+{
+    if (size <= 128)
+        return size ? (size - 1) >> 4 : 0;
+    else if (size <= 256)
+        return 8 + ((size - 129) >> 5);
+    else
+        return 12 + ((size - 257) >> 6);
+}
+
+static void FreePoolThreadCache(void* data)
+{
+    PoolThreadCache* cache = static_cast<PoolThreadCache*>(data);
+    if (!cache)
+        return;
+    
+    {
+        MutexLock lock(poolState->mutex_);
+        
+        for (unsigned i = 0; i < POOL_NUM_SIZE_CLASSES; ++i)
+        {
+            PoolSizeClass& sizeClass = poolState->classes_[i];
+            AllocatorNode* node = cache->free_[i];
+            while (node)
+            {
+                AllocatorNode* next = node->next_;
+                node->next_ = sizeClass.free_;
+                sizeClass.free_ = node;
+                node = next;
+            }
+            sizeClass.numFree_ += cache->numFree_[i];
+        }
+        
+        if (cache->prev_)
+            cache->prev_->next_ = cache->next_;
+        else
+            poolState->caches_ = cache->next_;
+        if (cache->next_)
+            cache->next_->prev_ = cache->prev_;
+    }
+    
+    delete cache;
+}
+
+static void InitializePool()
+{
+    poolState = new PoolState();
+    poolState->caches_ = 0;
+    
+    for (unsigned i = 0; i < POOL_NUM_SIZE_CLASSES; ++i)
+    {
+        PoolSizeClass& sizeClass = poolState->classes_[i];
+        sizeClass.nodeSize_ = GetPoolSizeClassNodeSize(i);
+        sizeClass.batchSize_ = POOL_CHUNK_SIZE / 4 / sizeClass.nodeSize_;
+        if (sizeClass.batchSize_ > POOL_MAX_BATCH_SIZE)
+            sizeClass.batchSize_ = POOL_MAX_BATCH_SIZE;
+        sizeClass.free_ = 0;
+        sizeClass.numFree_ = 0;
+        sizeClass.capacity_ = 0;
+        sizeClass.numChunks_ = 0;
+    }
+    
+    #ifdef WIN32
+    poolTlsIndex = TlsAlloc();
+    #else
+    pthread_key_create(&poolTlsKey, FreePoolThreadCache);
+    #endif
+}
+
+static PoolThreadCache* GetPoolThreadCache()
+{
+    #ifdef WIN32
+    if (poolInitialized != 2)
+    {
+        if (InterlockedCompareExchange(&poolInitialized, 1, 0) == 0)
+        {
+            InitializePool();
+            InterlockedExchange(&poolInitialized, 2);
+        }
+        else
+        {
+            while (poolInitialized != 2)
+                Sleep(0);
+        }
+    }
+    PoolThreadCache* cache = static_cast<PoolThreadCache*>(TlsGetValue(poolTlsIndex));
+    #else
+    pthread_once(&poolOnce, InitializePool);
+    PoolThreadCache* cache = static_cast<PoolThreadCache*>(pthread_getspecific(poolTlsKey));
+    #endif
+    
+    if (!cache)
+    {
+        cache = new PoolThreadCache();
+        for (unsigned i = 0; i < POOL_NUM_SIZE_CLASSES; ++i)
+        {
+            cache->free_[i] = 0;
+            cache->numFree_[i] = 0;
+            cache->publishedFree_[i] = 0;
+        }
+        cache->prev_ = 0;
+        
+        {
+            MutexLock lock(poolState->mutex_);
+            cache->next_ = poolState->caches_;
+            if (cache->next_)
+                cache->next_->prev_ = cache;
+            poolState->caches_ = cache;
+        }
+        
+        #ifdef WIN32
+        TlsSetValue(poolTlsIndex, cache);
+        #else
+        pthread_setspecific(poolTlsKey, cache);
+        #endif
+    }
+    
+    return cache;
+}
+
+static void RefillPoolThreadCache(PoolThreadCache* cache, unsigned index)
+{
+    MutexLock lock(poolState->mutex_);
+    PoolSizeClass& sizeClass = poolState->classes_[index];
+    
+    if (!sizeClass.free_)
+    {
+        // Shared free nodes have been exhausted. Carve a new chunk
+        unsigned nodeSize = sizeClass.nodeSize_;
+        unsigned capacity = POOL_CHUNK_SIZE / nodeSize;
+        unsigned char* chunkPtr = new unsigned char[capacity * nodeSize];
+        unsigned char* nodePtr = chunkPtr;
+        
+        for (unsigned i = 0; i < capacity - 1; ++i)
+        {
+            AllocatorNode* newNode = reinterpret_cast<AllocatorNode*>(nodePtr);
+            newNode->next_ = reinterpret_cast<AllocatorNode*>(nodePtr + nodeSize);
+            nodePtr += nodeSize;
+        }
+        reinterpret_cast<AllocatorNode*>(nodePtr)->next_ = 0;
+        
+        sizeClass.free_ = reinterpret_cast<AllocatorNode*>(chunkPtr);
+        sizeClass.numFree_ += capacity;
+        sizeClass.capacity_ += capacity;
+        ++sizeClass.numChunks_;
+    }
+    
+    // Move a batch of nodes to the thread cache
+    for (unsigned i = 0; i < sizeClass.batchSize_ && sizeClass.free_; ++i)
+    {
+        AllocatorNode* node = sizeClass.free_;
+        sizeClass.free_ = node->next_;
+        node->next_ = cache->free_[index];
+        cache->free_[index] = node;
+        --sizeClass.numFree_;
+        ++cache->numFree_[index];
+    }
+    
+    cache->publishedFree_[index] = cache->numFree_[index];
+}
+
+static void TrimPoolThreadCache(PoolThreadCache* cache, unsigned index)
+{
+    MutexLock lock(poolState->mutex_);
+    PoolSizeClass& sizeClass = poolState->classes_[index];
+    
+    // Return a batch of nodes to the shared free list
+    for (unsigned i = 0; i < sizeClass.batchSize_ && cache->free_[index]; ++i)
+    {
+        AllocatorNode* node = cache->free_[index];
+        cache->free_[index] = node->next_;
+        node->next_ = sizeClass.free_;
+        sizeClass.free_ = node;
+        --cache->numFree_[index];
+        ++sizeClass.numFree_;
+    }
+    
+    cache->publishedFree_[index] = cache->numFree_[index];
+}
+
 AllocatorBlock* AllocatorReserveBlock(AllocatorBlock* allocator, unsigned nodeSize, unsigned capacity)
 {
     if (!capacity)
@@ -121,4 +382,106 @@ void AllocatorFree(AllocatorBlock* allocator, void* ptr)
     allocator->free_ = node;
 }
 
+static void* ReservePoolNode(unsigned size)
+{
+    if (size > POOL_MAX_NODE_SIZE)
+        return new unsigned char[size];
+    
+    unsigned index = GetPoolSizeClass(size);
+    PoolThreadCache* cache = GetPoolThreadCache();
+    if (!cache->free_[index])
+        RefillPoolThreadCache(cache, index);
+    
+    AllocatorNode* node = cache->free_[index];
+    cache->free_[index] = node->next_;
+    --cache->numFree_[index];
+    
+    return node;
+}
+
+static void FreePoolNode(void* ptr, unsigned size)
+{
+    if (size > POOL_MAX_NODE_SIZE)
+    {
+        delete[] static_cast<unsigned char*>(ptr);
+        return;
+    }
+    
+    unsigned index = GetPoolSizeClass(size);
+    PoolThreadCache* cache = GetPoolThreadCache();
+    AllocatorNode* node = static_cast<AllocatorNode*>(ptr);
+    node->next_ = cache->free_[index];
+    cache->free_[index] = node;
+    
+    // Keep at most two batches cached, so that memory freed on one thread can be reused by others
+    if (++cache->numFree_[index] > 2 * poolState->classes_[index].batchSize_)
+        TrimPoolThreadCache(cache, index);
+}
+
+void* PoolReserve(unsigned size)
+{
+    #ifdef URHO3D_MEMORY_TRACKING
+    // Store the memory accounting tag in a header that keeps the nodes 16-byte aligned
+    MemoryTag tag = GetMemoryTag();
+    TrackAllocation(tag, size);
+    unsigned char* ptr = static_cast<unsigned char*>(ReservePoolNode(size + POOL_TRACKING_HEADER_SIZE));
+    *reinterpret_cast<MemoryTag*>(ptr) = tag;
+    return ptr + POOL_TRACKING_HEADER_SIZE;
+    #else
+    return ReservePoolNode(size);
+    #endif
+}
+
+void PoolFree(void* ptr, unsigned size)
+{
+    if (!ptr)
+        return;
+    
+    #ifdef URHO3D_MEMORY_TRACKING
+    unsigned char* headerPtr = static_cast<unsigned char*>(ptr) - POOL_TRACKING_HEADER_SIZE;
+    TrackFree(*reinterpret_cast<MemoryTag*>(headerPtr), size);
+    FreePoolNode(headerPtr, size + POOL_TRACKING_HEADER_SIZE);
+    #else
+    FreePoolNode(ptr, size);
+    #endif
+}
+
+void PoolFlushThreadCache()
+{
+    if (!poolState)
+        return;
+    
+    #ifdef WIN32
+    PoolThreadCache* cache = static_cast<PoolThreadCache*>(TlsGetValue(poolTlsIndex));
+    TlsSetValue(poolTlsIndex, 0);
+    #else
+    PoolThreadCache* cache = static_cast<PoolThreadCache*>(pthread_getspecific(poolTlsKey));
+    pthread_setspecific(poolTlsKey, 0);
+    #endif
+    
+    FreePoolThreadCache(cache);
+}
+
+PoolSizeClassInfo GetPoolSizeClassInfo(unsigned index)
+{
+    PoolSizeClassInfo ret;
+    if (index >= POOL_NUM_SIZE_CLASSES)
+        return ret;
+    
+    ret.nodeSize_ = GetPoolSizeClassNodeSize(index);
+    if (!poolState)
+        return ret;
+    
+    MutexLock lock(poolState->mutex_);
+    const PoolSizeClass& sizeClass = poolState->classes_[index];
+    ret.numChunks_ = sizeClass.numChunks_;
+    ret.capacity_ = sizeClass.capacity_;
+    ret.numFree_ = sizeClass.numFree_;
+    // The threads update their own cache counts without locking, so use the counts they published when they last took the lock
+    for (PoolThreadCache* cache = poolState->caches_; cache; cache = cache->next_)
+        ret.numCached_ += cache->publishedFree_[index];
+    
+    return ret;
+}
+
 }
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <new>
 
 namespace Urho3D
@@ -61,6 +62,45 @@ URHO3D_API void* AllocatorReserve(AllocatorBlock* allocator);
 /// Free a node. Does not free any blocks.
 URHO3D_API void AllocatorFree(AllocatorBlock* allocator, void* ptr);
 
+/// Number of size classes in the shared node pool.
+static const unsigned POOL_NUM_SIZE_CLASSES = 16;
+/// Largest allocation served by the shared node pool. Larger allocations go to the heap.
+static const unsigned POOL_MAX_NODE_SIZE = 512;
+
+/// Shared node pool size class usage information.
+struct PoolSizeClassInfo
+{
+    /// Construct.
+    PoolSizeClassInfo() :
+        nodeSize_(0),
+        numChunks_(0),
+        capacity_(0),
+        numFree_(0),
+        numCached_(0)
+    {
+    }
+    
+    /// Node size in bytes.
+    unsigned nodeSize_;
+    /// Number of memory chunks allocated for this size class.
+    unsigned numChunks_;
+    /// Total number of nodes carved from the chunks.
+    unsigned capacity_;
+    /// Number of free nodes in the shared free list.
+    unsigned numFree_;
+    /// Number of free nodes held in per-thread caches, as of each thread's last exchange with the shared free list.
+    unsigned numCached_;
+};
+
+/// Reserve memory from the shared, thread-safe node pool. Allocations larger than POOL_MAX_NODE_SIZE go to the heap. The pool never returns its chunks to the heap, so its memory use stays at the high-water mark of each size class.
+URHO3D_API void* PoolReserve(unsigned size);
+/// Free memory reserved from the shared node pool. The size must match the size given on reserve.
+URHO3D_API void PoolFree(void* ptr, unsigned size);
+/// Return the calling thread's cached free nodes to the shared free lists. Called automatically when an engine thread exits.
+URHO3D_API void PoolFlushThreadCache();
+/// Return usage information of a shared node pool size class.
+URHO3D_API PoolSizeClassInfo GetPoolSizeClassInfo(unsigned index);
+
 /// %Allocator template class. Allocates objects of a specific class.
 template <class T> class Allocator
 {
@@ -119,3 +159,20 @@ private:
 };
 
 }
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define POOL_ALLOCATED_DEBUG_NEW() \
+    void* operator new(size_t size, int, const char*, int) { return Urho3D::PoolReserve((unsigned)size); } \
+    void operator delete(void*, int, const char*, int) {}
+#else
+#define POOL_ALLOCATED_DEBUG_NEW()
+#endif
+
+/// Allocate instances of the class from the shared node pool. The class must have a virtual destructor if it is deleted through a base class pointer.
+#define POOL_ALLOCATED() \
+    public: \
+        void* operator new(size_t size) { return Urho3D::PoolReserve((unsigned)size); } \
+        void* operator new(size_t, void* place) { return place; } \
+        void operator delete(void* ptr, size_t size) { Urho3D::PoolFree(ptr, (unsigned)size); } \
+        void operator delete(void*, void*) {} \
+        POOL_ALLOCATED_DEBUG_NEW()
@@ -100,8 +100,7 @@ public:
     
     /// Construct.
     HashBase() :
-        ptrs_(0),
-        allocator_(0)
+        ptrs_(0)
     {
     }
 
@@ -111,7 +110,6 @@ public:
         Urho3D::Swap(head_, rhs.head_);
         Urho3D::Swap(tail_, rhs.tail_);
         Urho3D::Swap(ptrs_, rhs.ptrs_);
-        Urho3D::Swap(allocator_, rhs.allocator_);
     }
     
     /// Return number of elements.
@@ -137,8 +135,6 @@ protected:
     HashNodeBase* tail_;
     /// Bucket head pointers.
     HashNodeBase** ptrs_;
-    /// Node allocator.
-    AllocatorBlock* allocator_;
 };
 
 }
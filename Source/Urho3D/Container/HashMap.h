@@ -173,15 +173,13 @@ public:
     HashMap()
     {
         // Reserve the tail node
-        allocator_ = AllocatorInitialize(sizeof(Node));
         head_ = tail_ = ReserveNode();
     }
     
     /// Construct from another hash map.
     HashMap(const HashMap<T, U>& map)
     {
-        // Reserve the tail node + initial capacity according to the map's size
-        allocator_ = AllocatorInitialize(sizeof(Node), map.Size() + 1);
+        // Reserve the tail node
         head_ = tail_ = ReserveNode();
         *this = map;
     }
@@ -191,7 +189,6 @@ public:
     {
         Clear();
         FreeNode(Tail());
-        AllocatorUninitialize(allocator_);
         delete[] ptrs_;
     }
     
@@ -612,7 +609,7 @@ private:
     /// Reserve a node.
     Node* ReserveNode()
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(PoolReserve(sizeof(Node)));
         new(newNode) Node();
         return newNode;
     }
@@ -620,7 +617,7 @@ private:
     /// Reserve a node with specified key and value.
     Node* ReserveNode(const T& key, const U& value)
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(PoolReserve(sizeof(Node)));
         new(newNode) Node(key, value);
         return newNode;
     }
@@ -629,7 +626,7 @@ private:
     void FreeNode(Node* node)
     {
         (node)->~Node();
-        AllocatorFree(allocator_, node);
+        PoolFree(node, sizeof(Node));
     }
     
     /// Rehash the buckets.
@@ -129,15 +129,13 @@ public:
     HashSet()
     {
         // Reserve the tail node
-        allocator_ = AllocatorInitialize(sizeof(Node));
         head_ = tail_ = ReserveNode();
     }
     
     /// Construct from another hash set.
     HashSet(const HashSet<T>& set)
     {
-        // Reserve the tail node + initial capacity according to the set's size
-        allocator_ = AllocatorInitialize(sizeof(Node), set.Size() + 1);
+        // Reserve the tail node
         head_ = tail_ = ReserveNode();
         *this = set;
     }
@@ -147,7 +145,6 @@ public:
     {
         Clear();
         FreeNode(Tail());
-        AllocatorUninitialize(allocator_);
         delete[] ptrs_;
     }
     
@@ -510,7 +507,7 @@ private:
     /// Reserve a node.
     Node* ReserveNode()
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(PoolReserve(sizeof(Node)));
         new(newNode) Node();
         return newNode;
     }
@@ -518,7 +515,7 @@ private:
     /// Reserve a node with specified key.
     Node* ReserveNode(const T& key)
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(PoolReserve(sizeof(Node)));
         new(newNode) Node(key);
         return newNode;
     }
@@ -527,7 +524,7 @@ private:
     void FreeNode(Node* node)
     {
         (node)->~Node();
-        AllocatorFree(allocator_, node);
+        PoolFree(node, sizeof(Node));
     }
     
     /// Rehash the buckets.
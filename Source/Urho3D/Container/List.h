@@ -123,15 +123,13 @@ public:
     /// Construct empty.
     List()
     {
-        allocator_ = AllocatorInitialize(sizeof(Node));
         head_ = tail_ = ReserveNode();
     }
     
     /// Construct from another list.
     List(const List<T>& list)
     {
-        // Reserve the tail node + initial capacity according to the list's size
-        allocator_ = AllocatorInitialize(sizeof(Node), list.Size() + 1);
+        // Reserve the tail node
         head_ = tail_ = ReserveNode();
         *this = list;
     }
@@ -141,7 +139,6 @@ public:
     {
         Clear();
         FreeNode(Tail());
-        AllocatorUninitialize(allocator_);
     }
     
     /// Assign from another list.
@@ -390,7 +387,7 @@ private:
     /// Reserve a node.
     Node* ReserveNode()
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(PoolReserve(sizeof(Node)));
         new(newNode) Node();
         return newNode;
     }
@@ -398,7 +395,7 @@ private:
     /// Reserve a node with initial value.
     Node* ReserveNode(const T& value)
     {
-        Node* newNode = static_cast<Node*>(AllocatorReserve(allocator_));
+        Node* newNode = static_cast<Node*>(PoolReserve(sizeof(Node)));
         new(newNode) Node(value);
         return newNode;
     }
@@ -407,7 +404,7 @@ private:
     void FreeNode(Node* node)
     {
         (node)->~Node();
-        AllocatorFree(allocator_, node);
+        PoolFree(node, sizeof(Node));
     }
 };
 
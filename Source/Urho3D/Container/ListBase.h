@@ -88,7 +88,6 @@ class URHO3D_API ListBase
 public:
     /// Construct.
     ListBase() :
-        allocator_(0),
         size_(0)
     {
     }
@@ -98,7 +97,6 @@ public:
     {
         Urho3D::Swap(head_, rhs.head_);
         Urho3D::Swap(tail_, rhs.tail_);
-        Urho3D::Swap(allocator_, rhs.allocator_);
         Urho3D::Swap(size_, rhs.size_);
     }
     
@@ -107,8 +105,6 @@ protected:
     ListNodeBase* head_;
     /// Tail node pointer.
     ListNodeBase* tail_;
-    /// Node allocator.
-    AllocatorBlock* allocator_;
     /// Number of nodes.
     unsigned size_;
 };
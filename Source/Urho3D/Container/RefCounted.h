@@ -22,12 +22,16 @@
 
 #pragma once
 
+#include "../Container/Allocator.h"
+
 namespace Urho3D
 {
 
 /// Reference count structure.
 struct RefCount
 {
+    POOL_ALLOCATED();
+    
     /// Construct.
     RefCount() :
         refs_(0),
@@ -49,6 +49,46 @@ static const unsigned AM_NODEIDVECTOR = 0x40;
 
 class Serializable;
 
+/// Quantized encoding of a float, vector or quaternion attribute for network replication.
+struct AttributeNetworkEncoding
+{
+    /// Construct as not quantized.
+    AttributeNetworkEncoding() :
+        minValue_(0.0f),
+        maxValue_(0.0f),
+        precision_(0.0f),
+        bits_(0)
+    {
+    }
+
+    /// Construct with a value range and bit count per component. Precision is (maxValue - minValue) / (2^bits - 1). For quaternions only the bit count is used.
+    AttributeNetworkEncoding(float minValue, float maxValue, unsigned bits) :
+        minValue_(minValue),
+        maxValue_(maxValue),
+        precision_(0.0f),
+        bits_(bits)
+    {
+    }
+
+    /// Construct with a precision for values without a fixed range. Values closer to zero use fewer bits.
+    explicit AttributeNetworkEncoding(float precision) :
+        minValue_(0.0f),
+        maxValue_(0.0f),
+        precision_(precision),
+        bits_(0)
+    {
+    }
+
+    /// Minimum value of a component.
+    float minValue_;
+    /// Maximum value of a component.
+    float maxValue_;
+    /// Precision for values without a range, or zero if a range is used.
+    float precision_;
+    /// Bits per component when a range is used, or zero if not quantized.
+    unsigned bits_;
+};
+
 /// Abstract base class for invoking attribute accessors.
 class URHO3D_API AttributeAccessor : public RefCounted
 {
@@ -136,6 +176,8 @@ struct AttributeInfo
     Variant defaultValue_;
     /// Attribute mode: whether to use for serialization, network replication, or both.
     unsigned mode_;
+    /// Quantized encoding for network replication.
+    AttributeNetworkEncoding netEncoding_;
     /// Attribute data pointer if elsewhere than in the Serializable.
     void* ptr_;
 };
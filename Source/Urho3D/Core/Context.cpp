@@ -85,7 +85,13 @@ SharedPtr<Object> Context::CreateObject(StringHash objectType)
 {
     HashMap<StringHash, SharedPtr<ObjectFactory> >::ConstIterator i = factories_.Find(objectType);
     if (i != factories_.End())
+    {
+        #ifdef URHO3D_MEMORY_TRACKING
+        MemoryTag tag = i->second_->GetMemoryTag();
+        MemoryTagBlock tagBlock(tag != MT_GENERAL ? tag : GetMemoryTag());
+        #endif
         return i->second_->CreateObject();
+    }
     else
         return SharedPtr<Object>();
 }
@@ -105,7 +111,10 @@ void Context::RegisterFactory(ObjectFactory* factory, const char* category)
 
     RegisterFactory(factory);
     if (String::CStringLength(category))
+    {
         objectCategories_[category].Push(factory->GetType());
+        factory->SetMemoryTag(GetCategoryMemoryTag(category));
+    }
 }
 
 void Context::RegisterSubsystem(Object* object)
@@ -148,6 +157,24 @@ void Context::UpdateAttributeDefaultValue(StringHash objectType, const char* nam
         info->defaultValue_ = defaultValue;
 }
 
+void Context::UpdateAttributeNetworkEncoding(StringHash objectType, const char* name, const AttributeNetworkEncoding& encoding)
+{
+    AttributeInfo* info = GetAttribute(objectType, name);
+    if (info)
+        info->netEncoding_ = encoding;
+
+    // The network attributes are separate copies, so update them too
+    HashMap<StringHash, Vector<AttributeInfo> >::Iterator i = networkAttributes_.Find(objectType);
+    if (i != networkAttributes_.End())
+    {
+        for (Vector<AttributeInfo>::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
+        {
+            if (!j->name_.Compare(name, true))
+                j->netEncoding_ = encoding;
+        }
+    }
+}
+
 VariantMap& Context::GetEventDataMap()
 {
     unsigned nestingLevel = eventSenders_.Size();
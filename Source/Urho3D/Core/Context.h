@@ -56,6 +56,8 @@ public:
     void RemoveAttribute(StringHash objectType, const char* name);
     /// Update object attribute's default value.
     void UpdateAttributeDefaultValue(StringHash objectType, const char* name, const Variant& defaultValue);
+    /// Update object attribute's network replication encoding, to quantize float, vector or quaternion values.
+    void UpdateAttributeNetworkEncoding(StringHash objectType, const char* name, const AttributeNetworkEncoding& encoding);
     /// Return a preallocated map for event data. Used for optimization to avoid constant re-allocation of event data maps.
     VariantMap& GetEventDataMap();
 
@@ -75,6 +77,8 @@ public:
     template <class T, class U> void CopyBaseAttributes();
     /// Template version of updating an object attribute's default value.
     template <class T> void UpdateAttributeDefaultValue(const char* name, const Variant& defaultValue);
+    /// Template version of updating an object attribute's network replication encoding.
+    template <class T> void UpdateAttributeNetworkEncoding(const char* name, const AttributeNetworkEncoding& encoding);
 
     /// Return subsystem by type.
     Object* GetSubsystem(StringHash type) const;
@@ -183,5 +187,6 @@ template <class T, class U> void Context::CopyBaseAttributes() { CopyBaseAttribu
 template <class T> T* Context::GetSubsystem() const { return static_cast<T*>(GetSubsystem(T::GetTypeStatic())); }
 template <class T> AttributeInfo* Context::GetAttribute(const char* name) { return GetAttribute(T::GetTypeStatic(), name); }
 template <class T> void Context::UpdateAttributeDefaultValue(const char* name, const Variant& defaultValue) { UpdateAttributeDefaultValue(T::GetTypeStatic(), name, defaultValue); }
+template <class T> void Context::UpdateAttributeNetworkEncoding(const char* name, const AttributeNetworkEncoding& encoding) { UpdateAttributeNetworkEncoding(T::GetTypeStatic(), name, encoding); }
 
 }
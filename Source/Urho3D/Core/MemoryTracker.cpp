@@ -0,0 +1,163 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/MemoryTracker.h"
+
+#include <cstring>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const char* memoryTagNames[] =
+{
+    "General",
+    "Scene",
+    "Render",
+    "Physics",
+    "Audio",
+    "UI",
+    "Script",
+    "Network",
+    "Resource",
+    0
+};
+
+static volatile long long tagBytes[MAX_MEMORY_TAGS];
+static volatile long tagAllocations[MAX_MEMORY_TAGS];
+static volatile long tagTotalAllocations[MAX_MEMORY_TAGS];
+
+#ifdef WIN32
+static DWORD tagTlsIndex = TLS_OUT_OF_INDEXES;
+static volatile LONG tagTlsInitialized = 0;
+#else
+static pthread_key_t tagTlsKey;
+static pthread_once_t tagTlsOnce = PTHREAD_ONCE_INIT;
+
+static void InitializeTagTls()
+{
+    pthread_key_create(&tagTlsKey, 0);
+}
+#endif
+
+MemoryTag GetMemoryTag()
+{
+    #ifdef WIN32
+    if (tagTlsInitialized != 2)
+        return MT_GENERAL;
+    return (MemoryTag)(size_t)TlsGetValue(tagTlsIndex);
+    #else
+    pthread_once(&tagTlsOnce, InitializeTagTls);
+    return (MemoryTag)(size_t)pthread_getspecific(tagTlsKey);
+    #endif
+}
+
+void SetMemoryTag(MemoryTag tag)
+{
+    #ifdef WIN32
+    if (tagTlsInitialized != 2)
+    {
+        if (InterlockedCompareExchange(&tagTlsInitialized, 1, 0) == 0)
+        {
+            tagTlsIndex = TlsAlloc();
+            InterlockedExchange(&tagTlsInitialized, 2);
+        }
+        else
+        {
+            while (tagTlsInitialized != 2)
+                Sleep(0);
+        }
+    }
+    TlsSetValue(tagTlsIndex, (void*)(size_t)tag);
+    #else
+    pthread_once(&tagTlsOnce, InitializeTagTls);
+    pthread_setspecific(tagTlsKey, (void*)(size_t)tag);
+    #endif
+}
+
+void TrackAllocation(MemoryTag tag, unsigned size)
+{
+    #ifdef WIN32
+    InterlockedExchangeAdd64(&tagBytes[tag], size);
+    InterlockedIncrement(&tagAllocations[tag]);
+    InterlockedIncrement(&tagTotalAllocations[tag]);
+    #else
+    __sync_fetch_and_add(&tagBytes[tag], (long long)size);
+    __sync_fetch_and_add(&tagAllocations[tag], 1);
+    __sync_fetch_and_add(&tagTotalAllocations[tag], 1);
+    #endif
+}
+
+void TrackFree(MemoryTag tag, unsigned size)
+{
+    #ifdef WIN32
+    InterlockedExchangeAdd64(&tagBytes[tag], -(long long)size);
+    InterlockedDecrement(&tagAllocations[tag]);
+    #else
+    __sync_fetch_and_sub(&tagBytes[tag], (long long)size);
+    __sync_fetch_and_sub(&tagAllocations[tag], 1);
+    #endif
+}
+
+MemoryTagInfo GetMemoryTagInfo(MemoryTag tag)
+{
+    MemoryTagInfo ret;
+    if (tag < MAX_MEMORY_TAGS)
+    {
+        ret.bytes_ = tagBytes[tag];
+        ret.allocations_ = (int)tagAllocations[tag];
+        ret.totalAllocations_ = (unsigned)tagTotalAllocations[tag];
+    }
+    
+    return ret;
+}
+
+const char* GetMemoryTagName(MemoryTag tag)
+{
+    return tag < MAX_MEMORY_TAGS ? memoryTagNames[tag] : "";
+}
+
+MemoryTag GetCategoryMemoryTag(const char* category)
+{
+    static const char* categories[] = { "Scene", "Logic", "Geometry", "Urho2D", "Physics", "Audio", "UI", "Network", "Navigation", 0 };
+    static const MemoryTag tags[] = { MT_SCENE, MT_SCENE, MT_RENDER, MT_RENDER, MT_PHYSICS, MT_AUDIO, MT_UI, MT_NETWORK, MT_SCENE };
+    
+    if (!category)
+        return MT_GENERAL;
+    
+    for (unsigned i = 0; categories[i]; ++i)
+    {
+        if (!strcmp(category, categories[i]))
+            return tags[i];
+    }
+    
+    return MT_GENERAL;
+}
+
+}
@@ -0,0 +1,105 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+namespace Urho3D
+{
+
+/// %Memory accounting tag that attributes allocations to an engine subsystem.
+enum MemoryTag
+{
+    MT_GENERAL = 0,
+    MT_SCENE,
+    MT_RENDER,
+    MT_PHYSICS,
+    MT_AUDIO,
+    MT_UI,
+    MT_SCRIPT,
+    MT_NETWORK,
+    MT_RESOURCE,
+    MAX_MEMORY_TAGS
+};
+
+/// %Memory accounting counters of one tag.
+struct MemoryTagInfo
+{
+    /// Construct.
+    MemoryTagInfo() :
+        bytes_(0),
+        allocations_(0),
+        totalAllocations_(0)
+    {
+    }
+    
+    /// Currently allocated bytes.
+    long long bytes_;
+    /// Current number of allocations.
+    int allocations_;
+    /// Total number of allocations made.
+    unsigned totalAllocations_;
+};
+
+/// Return the calling thread's memory accounting tag.
+URHO3D_API MemoryTag GetMemoryTag();
+/// Set the calling thread's memory accounting tag. Allocations tracked through the node pool are attributed to it.
+URHO3D_API void SetMemoryTag(MemoryTag tag);
+/// Record an allocation to a memory accounting tag. Thread-safe.
+URHO3D_API void TrackAllocation(MemoryTag tag, unsigned size);
+/// Record a deallocation from a memory accounting tag. Thread-safe.
+URHO3D_API void TrackFree(MemoryTag tag, unsigned size);
+/// Return the counters of a memory accounting tag.
+URHO3D_API MemoryTagInfo GetMemoryTagInfo(MemoryTag tag);
+/// Return the name of a memory accounting tag.
+URHO3D_API const char* GetMemoryTagName(MemoryTag tag);
+/// Return the memory accounting tag corresponding to an object factory category, or MT_GENERAL if none.
+URHO3D_API MemoryTag GetCategoryMemoryTag(const char* category);
+
+/// Helper class that sets the calling thread's memory accounting tag for its lifetime.
+class URHO3D_API MemoryTagBlock
+{
+public:
+    /// Construct. Set the new tag and remember the previous.
+    MemoryTagBlock(MemoryTag tag) :
+        previousTag_(GetMemoryTag())
+    {
+        SetMemoryTag(tag);
+    }
+    
+    /// Destruct. Restore the previous tag.
+    ~MemoryTagBlock()
+    {
+        SetMemoryTag(previousTag_);
+    }
+    
+private:
+    /// Previous tag.
+    MemoryTag previousTag_;
+};
+
+}
+
+#ifdef URHO3D_MEMORY_TRACKING
+#define MEMORY_TAG(tag) Urho3D::MemoryTagBlock memoryTag_ ## tag (Urho3D::tag)
+#else
+#define MEMORY_TAG(tag)
+#endif
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Container/LinkedList.h"
+#include "../Core/MemoryTracker.h"
 #include "../Core/Variant.h"
 
 namespace Urho3D
@@ -48,6 +49,10 @@ class EventHandler;
 class URHO3D_API Object : public RefCounted
 {
     BASEOBJECT(Object);
+    #ifdef URHO3D_MEMORY_TRACKING
+    // Allocate from the node pool so that objects are attributed to memory accounting tags
+    POOL_ALLOCATED();
+    #endif
     
     friend class Context;
     
@@ -132,7 +137,8 @@ class URHO3D_API ObjectFactory : public RefCounted
 public:
     /// Construct.
     ObjectFactory(Context* context) :
-        context_(context)
+        context_(context),
+        memoryTag_(MT_GENERAL)
     {
         assert(context_);
     }
@@ -148,6 +154,10 @@ public:
     StringHash GetBaseType() const { return baseType_; }
     /// Return type name of objects created by this factory.
     const String& GetTypeName() const { return typeName_; }
+    /// Set memory accounting tag of objects created by this factory. MT_GENERAL keeps the calling thread's tag.
+    void SetMemoryTag(MemoryTag tag) { memoryTag_ = tag; }
+    /// Return memory accounting tag of objects created by this factory.
+    MemoryTag GetMemoryTag() const { return memoryTag_; }
     
 protected:
     /// Execution context.
@@ -158,6 +168,8 @@ protected:
     StringHash baseType_;
     /// Object type name.
     String typeName_;
+    /// Memory accounting tag.
+    MemoryTag memoryTag_;
 };
 
 /// Template implementation of the object factory.
@@ -22,6 +22,7 @@
 
 #include "../Core/Mutex.h"
 #include "../Core/ProcessUtils.h"
+#include "../IO/Log.h"
 #include "../Math/MathDefs.h"
 
 #include <cstdio>
@@ -128,6 +129,9 @@ void ErrorDialog(const String& title, const String& message)
 
 void ErrorExit(const String& message, int exitCode)
 {
+    // Write out queued log messages first, so that they appear before the exit message
+    Log::FlushInstance();
+    
     if (!message.Empty())
         PrintLine(message, true);
 
@@ -20,6 +20,7 @@
 // THE SOFTWARE.
 //
 
+#include "../Container/Allocator.h"
 #include "../Core/Thread.h"
 
 #ifdef WIN32
@@ -38,6 +39,7 @@ DWORD WINAPI ThreadFunctionStatic(void* data)
 {
     Thread* thread = static_cast<Thread*>(data);
     thread->ThreadFunction();
+    PoolFlushThreadCache();
     return 0;
 }
 #else
@@ -45,6 +47,7 @@ void* ThreadFunctionStatic(void* data)
 {
     Thread* thread = static_cast<Thread*>(data);
     thread->ThreadFunction();
+    PoolFlushThreadCache();
 #ifdef EMSCRIPTEN
 // note: emscripten doesn't have this function but doesn't use threading anyway
 // so #ifdef it out to prevent linker warnings
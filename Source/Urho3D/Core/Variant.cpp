@@ -63,6 +63,22 @@ static const char* typeNames[] =
 
 Variant& Variant::operator = (const Variant& rhs)
 {
+    // Share the heap-allocated value instead of copying it. Take the reference before releasing the old value, as the
+    // right hand side may be contained within it
+    if (IsSharedType(rhs.type_))
+    {
+        if (type_ == rhs.type_ && value_.ptr_ == rhs.value_.ptr_)
+            return *this;
+        
+        VariantType newType = rhs.type_;
+        void* newPtr = rhs.value_.ptr_;
+        ++static_cast<VariantPayloadBase*>(newPtr)->refs_;
+        SetType(VAR_NONE);
+        type_ = newType;
+        value_.ptr_ = newPtr;
+        return *this;
+    }
+    
     SetType(rhs.GetType());
 
     switch (type_)
@@ -71,10 +87,6 @@ Variant& Variant::operator = (const Variant& rhs)
         *(reinterpret_cast<String*>(&value_)) = *(reinterpret_cast<const String*>(&rhs.value_));
         break;
 
-    case VAR_BUFFER:
-        *(reinterpret_cast<PODVector<unsigned char>*>(&value_)) = *(reinterpret_cast<const PODVector<unsigned char>*>(&rhs.value_));
-        break;
-
     case VAR_RESOURCEREF:
         *(reinterpret_cast<ResourceRef*>(&value_)) = *(reinterpret_cast<const ResourceRef*>(&rhs.value_));
         break;
@@ -83,30 +95,10 @@ Variant& Variant::operator = (const Variant& rhs)
         *(reinterpret_cast<ResourceRefList*>(&value_)) = *(reinterpret_cast<const ResourceRefList*>(&rhs.value_));
         break;
 
-    case VAR_VARIANTVECTOR:
-        *(reinterpret_cast<VariantVector*>(&value_)) = *(reinterpret_cast<const VariantVector*>(&rhs.value_));
-        break;
-
-    case VAR_VARIANTMAP:
-        *(reinterpret_cast<VariantMap*>(&value_)) = *(reinterpret_cast<const VariantMap*>(&rhs.value_));
-        break;
-
     case VAR_PTR:
         *(reinterpret_cast<WeakPtr<RefCounted>*>(&value_)) = *(reinterpret_cast<const WeakPtr<RefCounted>*>(&rhs.value_));
         break;
-        
-    case VAR_MATRIX3:
-        *(reinterpret_cast<Matrix3*>(value_.ptr_)) = *(reinterpret_cast<const Matrix3*>(rhs.value_.ptr_));
-        break;
-        
-    case VAR_MATRIX3X4:
-        *(reinterpret_cast<Matrix3x4*>(value_.ptr_)) = *(reinterpret_cast<const Matrix3x4*>(rhs.value_.ptr_));
-        break;
-        
-    case VAR_MATRIX4:
-        *(reinterpret_cast<Matrix4*>(value_.ptr_)) = *(reinterpret_cast<const Matrix4*>(rhs.value_.ptr_));
-        break;
-        
+
     default:
         value_ = rhs.value_;
         break;
@@ -121,6 +113,9 @@ bool Variant::operator == (const Variant& rhs) const
         return GetVoidPtr() == rhs.GetVoidPtr();
     else if (type_ != rhs.type_)
         return false;
+    // Shared values are equal without comparing them
+    else if (IsSharedType(type_) && value_.ptr_ == rhs.value_.ptr_)
+        return true;
     
     switch (type_)
     {
@@ -149,7 +144,7 @@ bool Variant::operator == (const Variant& rhs) const
         return *(reinterpret_cast<const String*>(&value_)) == *(reinterpret_cast<const String*>(&rhs.value_));
 
     case VAR_BUFFER:
-        return *(reinterpret_cast<const PODVector<unsigned char>*>(&value_)) == *(reinterpret_cast<const PODVector<unsigned char>*>(&rhs.value_));
+        return GetPayload<PODVector<unsigned char> >() == rhs.GetPayload<PODVector<unsigned char> >();
 
     case VAR_RESOURCEREF:
         return *(reinterpret_cast<const ResourceRef*>(&value_)) == *(reinterpret_cast<const ResourceRef*>(&rhs.value_));
@@ -158,10 +153,10 @@ bool Variant::operator == (const Variant& rhs) const
         return *(reinterpret_cast<const ResourceRefList*>(&value_)) == *(reinterpret_cast<const ResourceRefList*>(&rhs.value_));
 
     case VAR_VARIANTVECTOR:
-        return *(reinterpret_cast<const VariantVector*>(&value_)) == *(reinterpret_cast<const VariantVector*>(&rhs.value_));
+        return GetPayload<VariantVector>() == rhs.GetPayload<VariantVector>();
 
     case VAR_VARIANTMAP:
-        return *(reinterpret_cast<const VariantMap*>(&value_)) == *(reinterpret_cast<const VariantMap*>(&rhs.value_));
+        return GetPayload<VariantMap>() == rhs.GetPayload<VariantMap>();
 
     case VAR_INTRECT:
         return *(reinterpret_cast<const IntRect*>(&value_)) == *(reinterpret_cast<const IntRect*>(&rhs.value_));
@@ -170,13 +165,13 @@ bool Variant::operator == (const Variant& rhs) const
         return *(reinterpret_cast<const IntVector2*>(&value_)) == *(reinterpret_cast<const IntVector2*>(&rhs.value_));
 
     case VAR_MATRIX3:
-        return *(reinterpret_cast<const Matrix3*>(value_.ptr_)) == *(reinterpret_cast<const Matrix3*>(rhs.value_.ptr_));
+        return GetPayload<Matrix3>() == rhs.GetPayload<Matrix3>();
 
     case VAR_MATRIX3X4:
-        return *(reinterpret_cast<const Matrix3x4*>(value_.ptr_)) == *(reinterpret_cast<const Matrix3x4*>(rhs.value_.ptr_));
+        return GetPayload<Matrix3x4>() == rhs.GetPayload<Matrix3x4>();
 
     case VAR_MATRIX4:
-        return *(reinterpret_cast<const Matrix4*>(value_.ptr_)) == *(reinterpret_cast<const Matrix4*>(rhs.value_.ptr_));
+        return GetPayload<Matrix4>() == rhs.GetPayload<Matrix4>();
 
     default:
         return true;
@@ -241,7 +236,7 @@ void Variant::FromString(VariantType type, const char* value)
     case VAR_BUFFER:
         {
             SetType(VAR_BUFFER);
-            PODVector<unsigned char>& buffer = *(reinterpret_cast<PODVector<unsigned char>*>(&value_));
+            PODVector<unsigned char>& buffer = GetMutablePayload<PODVector<unsigned char> >();
             StringToBuffer(buffer, value);
         }
         break;
@@ -315,7 +310,7 @@ void Variant::SetBuffer(const void* data, unsigned size)
         size = 0;
 
     SetType(VAR_BUFFER);
-    PODVector<unsigned char>& buffer = *(reinterpret_cast<PODVector<unsigned char>*>(&value_));
+    PODVector<unsigned char>& buffer = GetMutablePayload<PODVector<unsigned char> >();
     buffer.Resize(size);
     if (size)
         memcpy(&buffer[0], data, size);
@@ -359,7 +354,7 @@ String Variant::ToString() const
 
     case VAR_BUFFER:
         {
-            const PODVector<unsigned char>& buffer = *(reinterpret_cast<const PODVector<unsigned char>*>(&value_));
+            const PODVector<unsigned char>& buffer = GetPayload<PODVector<unsigned char> >();
             String ret;
             BufferToString(ret, buffer.Begin().ptr_, buffer.Size());
             return ret;
@@ -383,13 +378,13 @@ String Variant::ToString() const
         return String::EMPTY;
 
     case VAR_MATRIX3:
-        return (reinterpret_cast<const Matrix3*>(value_.ptr_))->ToString();
+        return GetPayload<Matrix3>().ToString();
 
     case VAR_MATRIX3X4:
-        return (reinterpret_cast<const Matrix3x4*>(value_.ptr_))->ToString();
+        return GetPayload<Matrix3x4>().ToString();
         
     case VAR_MATRIX4:
-        return (reinterpret_cast<const Matrix4*>(value_.ptr_))->ToString();
+        return GetPayload<Matrix4>().ToString();
     }
 }
 
@@ -426,7 +421,7 @@ bool Variant::IsZero() const
         return reinterpret_cast<const String*>(&value_)->Empty();
 
     case VAR_BUFFER:
-        return reinterpret_cast<const PODVector<unsigned char>*>(&value_)->Empty();
+        return GetPayload<PODVector<unsigned char> >().Empty();
 
     case VAR_VOIDPTR:
         return value_.ptr_ == 0;
@@ -446,10 +441,10 @@ bool Variant::IsZero() const
     }
 
     case VAR_VARIANTVECTOR:
-        return reinterpret_cast<const VariantVector*>(&value_)->Empty();
+        return GetPayload<VariantVector>().Empty();
 
     case VAR_VARIANTMAP:
-        return reinterpret_cast<const VariantMap*>(&value_)->Empty();
+        return GetPayload<VariantMap>().Empty();
 
     case VAR_INTRECT:
         return *reinterpret_cast<const IntRect*>(&value_) == IntRect::ZERO;
@@ -461,13 +456,13 @@ bool Variant::IsZero() const
         return *reinterpret_cast<const WeakPtr<RefCounted>*>(&value_) == (RefCounted*)0;
         
     case VAR_MATRIX3:
-        return *reinterpret_cast<const Matrix3*>(value_.ptr_) == Matrix3::IDENTITY;
+        return GetPayload<Matrix3>() == Matrix3::IDENTITY;
         
     case VAR_MATRIX3X4:
-        return *reinterpret_cast<const Matrix3x4*>(value_.ptr_) == Matrix3x4::IDENTITY;
+        return GetPayload<Matrix3x4>() == Matrix3x4::IDENTITY;
         
     case VAR_MATRIX4:
-        return *reinterpret_cast<const Matrix4*>(value_.ptr_) == Matrix4::IDENTITY;
+        return GetPayload<Matrix4>() == Matrix4::IDENTITY;
         
     default:
         return true;
@@ -486,7 +481,7 @@ void Variant::SetType(VariantType newType)
         break;
 
     case VAR_BUFFER:
-        (reinterpret_cast<PODVector<unsigned char>*>(&value_))->~PODVector<unsigned char>();
+        ReleasePayload<PODVector<unsigned char> >();
         break;
 
     case VAR_RESOURCEREF:
@@ -498,11 +493,11 @@ void Variant::SetType(VariantType newType)
         break;
 
     case VAR_VARIANTVECTOR:
-        (reinterpret_cast<VariantVector*>(&value_))->~VariantVector();
+        ReleasePayload<VariantVector>();
         break;
 
     case VAR_VARIANTMAP:
-        (reinterpret_cast<VariantMap*>(&value_))->~VariantMap();
+        ReleasePayload<VariantMap>();
         break;
 
     case VAR_PTR:
@@ -510,15 +505,15 @@ void Variant::SetType(VariantType newType)
         break;
         
     case VAR_MATRIX3:
-        delete reinterpret_cast<Matrix3*>(value_.ptr_);
+        ReleasePayload<Matrix3>();
         break;
         
     case VAR_MATRIX3X4:
-        delete reinterpret_cast<Matrix3x4*>(value_.ptr_);
+        ReleasePayload<Matrix3x4>();
         break;
         
     case VAR_MATRIX4:
-        delete reinterpret_cast<Matrix4*>(value_.ptr_);
+        ReleasePayload<Matrix4>();
         break;
         
     default:
@@ -534,7 +529,7 @@ void Variant::SetType(VariantType newType)
         break;
 
     case VAR_BUFFER:
-        new(reinterpret_cast<PODVector<unsigned char>*>(&value_)) PODVector<unsigned char>();
+        value_.ptr_ = static_cast<VariantPayloadBase*>(new VariantPayload<PODVector<unsigned char> >());
         break;
 
     case VAR_RESOURCEREF:
@@ -546,11 +541,11 @@ void Variant::SetType(VariantType newType)
         break;
 
     case VAR_VARIANTVECTOR:
-        new(reinterpret_cast<VariantVector*>(&value_)) VariantVector();
+        value_.ptr_ = static_cast<VariantPayloadBase*>(new VariantPayload<VariantVector>());
         break;
 
     case VAR_VARIANTMAP:
-        new(reinterpret_cast<VariantMap*>(&value_)) VariantMap();
+        value_.ptr_ = static_cast<VariantPayloadBase*>(new VariantPayload<VariantMap>());
         break;
 
     case VAR_PTR:
@@ -558,15 +553,15 @@ void Variant::SetType(VariantType newType)
         break;
         
     case VAR_MATRIX3:
-        value_.ptr_ = new Matrix3();
+        value_.ptr_ = static_cast<VariantPayloadBase*>(new VariantPayload<Matrix3>());
         break;
         
     case VAR_MATRIX3X4:
-        value_.ptr_ = new Matrix3x4();
+        value_.ptr_ = static_cast<VariantPayloadBase*>(new VariantPayload<Matrix3x4>());
         break;
         
     case VAR_MATRIX4:
-        value_.ptr_ = new Matrix4();
+        value_.ptr_ = static_cast<VariantPayloadBase*>(new VariantPayload<Matrix4>());
         break;
         
     default:
@@ -172,6 +172,39 @@ typedef Vector<Variant> VariantVector;
 /// Map of variants.
 typedef HashMap<StringHash, Variant> VariantMap;
 
+/// Reference count of a variant value that is shared between variant copies.
+struct VariantPayloadBase
+{
+    /// Construct.
+    VariantPayloadBase() :
+        refs_(1)
+    {
+    }
+    
+    /// Number of variants referring to the value.
+    unsigned refs_;
+};
+
+/// Large variant value stored on the heap. Shared between variant copies and copied only when modified through a shared reference.
+template <class T> struct VariantPayload : public VariantPayloadBase
+{
+    POOL_ALLOCATED();
+    
+    /// Construct with default value.
+    VariantPayload()
+    {
+    }
+    
+    /// Construct with value.
+    VariantPayload(const T& value) :
+        value_(value)
+    {
+    }
+    
+    /// Value.
+    T value_;
+};
+
 /// Variable that supports a fixed set of types.
 class URHO3D_API Variant
 {
@@ -397,7 +430,14 @@ public:
         SetType(VAR_NONE);
     }
 
-    /// Assign from another variant.
+    /// Swap with another variant without copying the values.
+    void Swap(Variant& rhs)
+    {
+        Urho3D::Swap(type_, rhs.type_);
+        Urho3D::Swap(value_, rhs.value_);
+    }
+
+    /// Assign from another variant. Buffers, variant vectors, variant maps and matrices are shared until modified.
     Variant& operator = (const Variant& rhs);
 
     /// Assign from an integer.
@@ -500,7 +540,7 @@ public:
     Variant& operator = (const PODVector<unsigned char>& rhs)
     {
         SetType(VAR_BUFFER);
-        *(reinterpret_cast<PODVector<unsigned char>*>(&value_)) = rhs;
+        SetPayload(rhs);
         return *this;
     }
 
@@ -532,7 +572,7 @@ public:
     Variant& operator = (const VariantVector& rhs)
     {
         SetType(VAR_VARIANTVECTOR);
-        *(reinterpret_cast<VariantVector*>(&value_)) = rhs;
+        SetPayload(rhs);
         return *this;
     }
 
@@ -540,7 +580,7 @@ public:
     Variant& operator = (const VariantMap& rhs)
     {
         SetType(VAR_VARIANTMAP);
-        *(reinterpret_cast<VariantMap*>(&value_)) = rhs;
+        SetPayload(rhs);
         return *this;
     }
 
@@ -572,7 +612,7 @@ public:
     Variant& operator = (const Matrix3& rhs)
     {
         SetType(VAR_MATRIX3);
-        *(reinterpret_cast<Matrix3*>(value_.ptr_)) = rhs;
+        SetPayload(rhs);
         return *this;
     }
     
@@ -580,7 +620,7 @@ public:
     Variant& operator = (const Matrix3x4& rhs)
     {
         SetType(VAR_MATRIX3X4);
-        *(reinterpret_cast<Matrix3x4*>(value_.ptr_)) = rhs;
+        SetPayload(rhs);
         return *this;
     }
     
@@ -588,7 +628,7 @@ public:
     Variant& operator = (const Matrix4& rhs)
     {
         SetType(VAR_MATRIX4);
-        *(reinterpret_cast<Matrix4*>(value_.ptr_)) = rhs;
+        SetPayload(rhs);
         return *this;
     }
     
@@ -615,7 +655,7 @@ public:
     /// Test for equality with a string. To return true, both the type and value must match.
     bool operator == (const String& rhs) const { return type_ == VAR_STRING ? *(reinterpret_cast<const String*>(&value_)) == rhs : false; }
     /// Test for equality with a buffer. To return true, both the type and value must match.
-    bool operator == (const PODVector<unsigned char>& rhs) const { return type_ == VAR_BUFFER ? *(reinterpret_cast<const PODVector<unsigned char>*>(&value_)) == rhs : false; }
+    bool operator == (const PODVector<unsigned char>& rhs) const { return type_ == VAR_BUFFER ? GetPayload<PODVector<unsigned char> >() == rhs : false; }
     
     /// Test for equality with a void pointer. To return true, both the type and value must match, with the exception that a RefCounted pointer is also allowed.
     bool operator == (void* rhs) const
@@ -633,9 +673,9 @@ public:
     /// Test for equality with a resource reference list. To return true, both the type and value must match.
     bool operator == (const ResourceRefList& rhs) const { return type_ == VAR_RESOURCEREFLIST ? *(reinterpret_cast<const ResourceRefList*>(&value_)) == rhs : false; }
     /// Test for equality with a variant vector. To return true, both the type and value must match.
-    bool operator == (const VariantVector& rhs) const { return type_ == VAR_VARIANTVECTOR ? *(reinterpret_cast<const VariantVector*>(&value_)) == rhs : false; }
+    bool operator == (const VariantVector& rhs) const { return type_ == VAR_VARIANTVECTOR ? GetPayload<VariantVector>() == rhs : false; }
     /// Test for equality with a variant map. To return true, both the type and value must match.
-    bool operator == (const VariantMap& rhs) const { return type_ == VAR_VARIANTMAP ? *(reinterpret_cast<const VariantMap*>(&value_)) == rhs : false; }
+    bool operator == (const VariantMap& rhs) const { return type_ == VAR_VARIANTMAP ? GetPayload<VariantMap>() == rhs : false; }
     /// Test for equality with an integer rect. To return true, both the type and value must match.
     bool operator == (const IntRect& rhs) const { return type_ == VAR_INTRECT ? *(reinterpret_cast<const IntRect*>(&value_)) == rhs : false; }
     /// Test for equality with an IntVector2. To return true, both the type and value must match.
@@ -655,11 +695,11 @@ public:
     }
     
     /// Test for equality with a Matrix3. To return true, both the type and value must match.
-    bool operator == (const Matrix3& rhs) const { return type_ == VAR_MATRIX3 ? *(reinterpret_cast<const Matrix3*>(value_.ptr_)) == rhs : false; }
+    bool operator == (const Matrix3& rhs) const { return type_ == VAR_MATRIX3 ? GetPayload<Matrix3>() == rhs : false; }
     /// Test for equality with a Matrix3x4. To return true, both the type and value must match.
-    bool operator == (const Matrix3x4& rhs) const { return type_ == VAR_MATRIX3X4 ? *(reinterpret_cast<const Matrix3x4*>(value_.ptr_)) == rhs : false; }
+    bool operator == (const Matrix3x4& rhs) const { return type_ == VAR_MATRIX3X4 ? GetPayload<Matrix3x4>() == rhs : false; }
     /// Test for equality with a Matrix4. To return true, both the type and value must match.
-    bool operator == (const Matrix4& rhs) const { return type_ == VAR_MATRIX4 ? *(reinterpret_cast<const Matrix4*>(value_.ptr_)) == rhs : false; }
+    bool operator == (const Matrix4& rhs) const { return type_ == VAR_MATRIX4 ? GetPayload<Matrix4>() == rhs : false; }
     
     /// Test for inequality with another variant.
     bool operator != (const Variant& rhs) const { return !(*this == rhs); }
@@ -742,7 +782,7 @@ public:
     /// Return string or empty on type mismatch.
     const String& GetString() const { return type_ == VAR_STRING ? *reinterpret_cast<const String*>(&value_) : String::EMPTY; }
     /// Return buffer or empty on type mismatch.
-    const PODVector<unsigned char>& GetBuffer() const { return type_ == VAR_BUFFER ? *reinterpret_cast<const PODVector<unsigned char>*>(&value_) : emptyBuffer; }
+    const PODVector<unsigned char>& GetBuffer() const { return type_ == VAR_BUFFER ? GetPayload<PODVector<unsigned char> >() : emptyBuffer; }
     
     /// Return void pointer or null on type mismatch. RefCounted pointer will be converted.
     void* GetVoidPtr() const
@@ -760,9 +800,9 @@ public:
     /// Return a resource reference list or empty on type mismatch.
     const ResourceRefList& GetResourceRefList() const { return type_ == VAR_RESOURCEREFLIST ? *reinterpret_cast<const ResourceRefList*>(&value_) : emptyResourceRefList; }
     /// Return a variant vector or empty on type mismatch.
-    const VariantVector& GetVariantVector() const { return type_ == VAR_VARIANTVECTOR ? *reinterpret_cast<const VariantVector*>(&value_) : emptyVariantVector; }
+    const VariantVector& GetVariantVector() const { return type_ == VAR_VARIANTVECTOR ? GetPayload<VariantVector>() : emptyVariantVector; }
     /// Return a variant map or empty on type mismatch.
-    const VariantMap& GetVariantMap() const { return type_ == VAR_VARIANTMAP ? *reinterpret_cast<const VariantMap*>(&value_) : emptyVariantMap; }
+    const VariantMap& GetVariantMap() const { return type_ == VAR_VARIANTMAP ? GetPayload<VariantMap>() : emptyVariantMap; }
     /// Return an integer rect or empty on type mismatch.
     const IntRect& GetIntRect() const { return type_ == VAR_INTRECT ? *reinterpret_cast<const IntRect*>(&value_) : IntRect::ZERO; }
     /// Return an IntVector2 or empty on type mismatch.
@@ -770,11 +810,11 @@ public:
     /// Return a RefCounted pointer or null on type mismatch. Will return null if holding a void pointer, as it can not be safely verified that the object is a RefCounted.
     RefCounted* GetPtr() const { return type_ == VAR_PTR ? *reinterpret_cast<const WeakPtr<RefCounted>*>(&value_) : (RefCounted*)0; }
     /// Return a Matrix3 or identity on type mismatch.
-    const Matrix3& GetMatrix3() const { return type_ == VAR_MATRIX3 ? *(reinterpret_cast<const Matrix3*>(value_.ptr_)) : Matrix3::IDENTITY; }
+    const Matrix3& GetMatrix3() const { return type_ == VAR_MATRIX3 ? GetPayload<Matrix3>() : Matrix3::IDENTITY; }
     /// Return a Matrix3x4 or identity on type mismatch.
-    const Matrix3x4& GetMatrix3x4() const { return type_ == VAR_MATRIX3X4 ? *(reinterpret_cast<const Matrix3x4*>(value_.ptr_)) : Matrix3x4::IDENTITY; }
+    const Matrix3x4& GetMatrix3x4() const { return type_ == VAR_MATRIX3X4 ? GetPayload<Matrix3x4>() : Matrix3x4::IDENTITY; }
     /// Return a Matrix4 or identity on type mismatch.
-    const Matrix4& GetMatrix4() const { return type_ == VAR_MATRIX4 ? *(reinterpret_cast<const Matrix4*>(value_.ptr_)) : Matrix4::IDENTITY; }
+    const Matrix4& GetMatrix4() const { return type_ == VAR_MATRIX4 ? GetPayload<Matrix4>() : Matrix4::IDENTITY; }
     /// Return value's type.
     VariantType GetType() const { return type_; }
     /// Return value's type name.
@@ -789,11 +829,11 @@ public:
     template <class T> T Get() const;
     
     /// Return a pointer to a modifiable buffer or null on type mismatch.
-    PODVector<unsigned char>* GetBufferPtr() { return type_ == VAR_BUFFER ? reinterpret_cast<PODVector<unsigned char>*>(&value_) : 0; }
+    PODVector<unsigned char>* GetBufferPtr() { return type_ == VAR_BUFFER ? &GetMutablePayload<PODVector<unsigned char> >() : 0; }
     /// Return a pointer to a modifiable variant vector or null on type mismatch.
-    VariantVector* GetVariantVectorPtr() { return type_ == VAR_VARIANTVECTOR ? reinterpret_cast<VariantVector*>(&value_) : 0; }
+    VariantVector* GetVariantVectorPtr() { return type_ == VAR_VARIANTVECTOR ? &GetMutablePayload<VariantVector>() : 0; }
     /// Return a pointer to a modifiable variant map or null on type mismatch.
-    VariantMap* GetVariantMapPtr() { return type_ == VAR_VARIANTMAP ? reinterpret_cast<VariantMap*>(&value_) : 0; }
+    VariantMap* GetVariantMapPtr() { return type_ == VAR_VARIANTMAP ? &GetMutablePayload<VariantMap>() : 0; }
 
     /// Return name for variant type.
     static String GetTypeName(VariantType type);
@@ -818,6 +858,53 @@ public:
 private:
     /// Set new type and allocate/deallocate memory as necessary.
     void SetType(VariantType newType);
+    
+    /// Return a heap-allocated value.
+    template <class T> const T& GetPayload() const
+    {
+        return static_cast<const VariantPayload<T>*>(static_cast<const VariantPayloadBase*>(value_.ptr_))->value_;
+    }
+    
+    /// Return a heap-allocated value for modification. Copy it first if it is shared with other variants.
+    template <class T> T& GetMutablePayload()
+    {
+        VariantPayload<T>* payload = static_cast<VariantPayload<T>*>(static_cast<VariantPayloadBase*>(value_.ptr_));
+        if (payload->refs_ > 1)
+        {
+            --payload->refs_;
+            payload = new VariantPayload<T>(payload->value_);
+            value_.ptr_ = static_cast<VariantPayloadBase*>(payload);
+        }
+        return payload->value_;
+    }
+    
+    /// Set a heap-allocated value. Allocate a new one if the current is shared with other variants.
+    template <class T> void SetPayload(const T& value)
+    {
+        VariantPayload<T>* payload = static_cast<VariantPayload<T>*>(static_cast<VariantPayloadBase*>(value_.ptr_));
+        if (payload->refs_ > 1)
+        {
+            --payload->refs_;
+            value_.ptr_ = static_cast<VariantPayloadBase*>(new VariantPayload<T>(value));
+        }
+        else
+            payload->value_ = value;
+    }
+    
+    /// Release a reference to a heap-allocated value and delete it if no longer shared.
+    template <class T> void ReleasePayload()
+    {
+        VariantPayload<T>* payload = static_cast<VariantPayload<T>*>(static_cast<VariantPayloadBase*>(value_.ptr_));
+        if (!--payload->refs_)
+            delete payload;
+    }
+    
+    /// Return whether a type is stored on the heap and shared between copies.
+    static bool IsSharedType(VariantType type)
+    {
+        return type == VAR_BUFFER || type == VAR_VARIANTVECTOR || type == VAR_VARIANTMAP || type == VAR_MATRIX3 ||
+            type == VAR_MATRIX3X4 || type == VAR_MATRIX4;
+    }
 
     /// Variant type.
     VariantType type_;
@@ -40,6 +40,8 @@ class WorkerThread;
 /// Work queue item.
 struct WorkItem : public RefCounted
 {
+    POOL_ALLOCATED();
+    
     friend class WorkQueue;
 
 public:
@@ -21,13 +21,19 @@
 //
 
 #include "../Core/CoreEvents.h"
+#include "../Core/MemoryTracker.h"
 #include "../Engine/DebugHud.h"
 #include "../Engine/Engine.h"
 #include "../UI/Font.h"
 #include "../Graphics/Graphics.h"
 #include "../IO/Log.h"
+#ifdef URHO3D_NETWORK
+#include "../Network/Connection.h"
+#include "../Network/Network.h"
+#endif
 #include "../Core/Profiler.h"
 #include "../Graphics/Renderer.h"
+#include "../Resource/ResourceCache.h"
 #include "../UI/Text.h"
 #include "../UI/UI.h"
 
@@ -79,6 +85,18 @@ DebugHud::DebugHud(Context* context) :
     profilerText_->SetVisible(false);
     uiRoot->AddChild(profilerText_);
 
+    memoryText_ = new Text(context_);
+    memoryText_->SetAlignment(HA_RIGHT, VA_BOTTOM);
+    memoryText_->SetPriority(100);
+    memoryText_->SetVisible(false);
+    uiRoot->AddChild(memoryText_);
+
+    networkText_ = new Text(context_);
+    networkText_->SetAlignment(HA_CENTER, VA_TOP);
+    networkText_->SetPriority(100);
+    networkText_->SetVisible(false);
+    uiRoot->AddChild(networkText_);
+
     SubscribeToEvent(E_POSTUPDATE, HANDLER(DebugHud, HandlePostUpdate));
 }
 
@@ -87,6 +105,8 @@ DebugHud::~DebugHud()
     statsText_->Remove();
     modeText_->Remove();
     profilerText_->Remove();
+    memoryText_->Remove();
+    networkText_->Remove();
 }
 
 void DebugHud::Update()
@@ -104,6 +124,8 @@ void DebugHud::Update()
         uiRoot->AddChild(statsText_);
         uiRoot->AddChild(modeText_);
         uiRoot->AddChild(profilerText_);
+        uiRoot->AddChild(memoryText_);
+        uiRoot->AddChild(networkText_);
     }
 
     if (statsText_->IsVisible())
@@ -156,6 +178,76 @@ void DebugHud::Update()
         modeText_->SetText(mode);
     }
 
+    if (memoryText_->IsVisible())
+    {
+        String memory;
+#ifdef URHO3D_MEMORY_TRACKING
+        memory.Append("Tracked memory (partial)\n");
+        for (unsigned i = 0; i < MAX_MEMORY_TAGS; ++i)
+        {
+            MemoryTagInfo info = GetMemoryTagInfo((MemoryTag)i);
+            memory.AppendWithFormat("%s %u kB in %d allocations\n", GetMemoryTagName((MemoryTag)i),
+                (unsigned)(info.bytes_ >> 10), info.allocations_);
+        }
+        memory.Append("\n");
+#endif
+
+        ResourceCache* cache = GetSubsystem<ResourceCache>();
+        if (cache)
+        {
+            const HashMap<StringHash, ResourceGroup>& groups = cache->GetAllResources();
+            for (HashMap<StringHash, ResourceGroup>::ConstIterator i = groups.Begin(); i != groups.End(); ++i)
+            {
+                if (i->second_.resources_.Empty())
+                    continue;
+                memory.AppendWithFormat("%s %u kB in %u resources\n",
+                    i->second_.resources_.Begin()->second_->GetTypeName().CString(), i->second_.memoryUse_ >> 10,
+                    i->second_.resources_.Size());
+            }
+            memory.AppendWithFormat("Resources total %u kB", cache->GetTotalMemoryUse() >> 10);
+        }
+
+        memoryText_->SetText(memory);
+    }
+
+    if (networkText_->IsVisible())
+    {
+        String networkStats;
+#ifdef URHO3D_NETWORK
+        Network* network = GetSubsystem<Network>();
+        if (network)
+        {
+            Connection* serverConnection = network->GetServerConnection();
+            if (serverConnection)
+            {
+                networkStats.AppendWithFormat("Server %s RTT %.1f ms In %.1f kB/s Out %.1f kB/s\n",
+                    serverConnection->ToString().CString(), serverConnection->GetRoundTripTime(),
+                    serverConnection->GetBytesInPerSec() / 1024.0f, serverConnection->GetBytesOutPerSec() / 1024.0f);
+                networkStats += serverConnection->GetStatistics().ToString(context_);
+            }
+            else if (network->IsServerRunning())
+            {
+                // Show the totals of all client connections
+                Vector<SharedPtr<Connection> > connections = network->GetClientConnections();
+                NetworkStatistics statistics;
+                float bytesIn = 0.0f;
+                float bytesOut = 0.0f;
+                for (unsigned i = 0; i < connections.Size(); ++i)
+                {
+                    statistics.Merge(connections[i]->GetStatistics());
+                    bytesIn += connections[i]->GetBytesInPerSec();
+                    bytesOut += connections[i]->GetBytesOutPerSec();
+                }
+                networkStats.AppendWithFormat("Clients %u In %.1f kB/s Out %.1f kB/s\n", connections.Size(),
+                    bytesIn / 1024.0f, bytesOut / 1024.0f);
+                networkStats += statistics.ToString(context_);
+            }
+        }
+#endif
+
+        networkText_->SetText(networkStats);
+    }
+
     Profiler* profiler = GetSubsystem<Profiler>();
     if (profiler)
     {
@@ -185,6 +277,10 @@ void DebugHud::SetDefaultStyle(XMLFile* style)
     modeText_->SetStyle("DebugHudText");
     profilerText_->SetDefaultStyle(style);
     profilerText_->SetStyle("DebugHudText");
+    memoryText_->SetDefaultStyle(style);
+    memoryText_->SetStyle("DebugHudText");
+    networkText_->SetDefaultStyle(style);
+    networkText_->SetStyle("DebugHudText");
 }
 
 void DebugHud::SetMode(unsigned mode)
@@ -192,6 +288,8 @@ void DebugHud::SetMode(unsigned mode)
     statsText_->SetVisible((mode & DEBUGHUD_SHOW_STATS) != 0);
     modeText_->SetVisible((mode & DEBUGHUD_SHOW_MODE) != 0);
     profilerText_->SetVisible((mode & DEBUGHUD_SHOW_PROFILER) != 0);
+    memoryText_->SetVisible((mode & DEBUGHUD_SHOW_MEMORY) != 0);
+    networkText_->SetVisible((mode & DEBUGHUD_SHOW_NETWORK) != 0);
 
     mode_ = mode;
 }
@@ -37,7 +37,9 @@ static const unsigned DEBUGHUD_SHOW_NONE = 0x0;
 static const unsigned DEBUGHUD_SHOW_STATS = 0x1;
 static const unsigned DEBUGHUD_SHOW_MODE = 0x2;
 static const unsigned DEBUGHUD_SHOW_PROFILER = 0x4;
-static const unsigned DEBUGHUD_SHOW_ALL = 0x7;
+static const unsigned DEBUGHUD_SHOW_MEMORY = 0x8;
+static const unsigned DEBUGHUD_SHOW_NETWORK = 0x10;
+static const unsigned DEBUGHUD_SHOW_ALL = 0x1f;
 
 /// Displays rendering stats and profiling information.
 class URHO3D_API DebugHud : public Object
@@ -75,6 +77,10 @@ public:
     Text* GetModeText() const { return modeText_; }
     /// Return profiler text.
     Text* GetProfilerText() const { return profilerText_; }
+    /// Return memory usage text.
+    Text* GetMemoryText() const { return memoryText_; }
+    /// Return network statistics text.
+    Text* GetNetworkText() const { return networkText_; }
     /// Return currently shown elements.
     unsigned GetMode() const { return mode_; }
     /// Return maximum profiler block depth.
@@ -103,6 +109,10 @@ private:
     SharedPtr<Text> modeText_;
     /// Profiling information text.
     SharedPtr<Text> profilerText_;
+    /// Memory usage text.
+    SharedPtr<Text> memoryText_;
+    /// Network statistics text.
+    SharedPtr<Text> networkText_;
     /// Hashmap containing application specific stats.
     HashMap<String, String> appStats_;
     /// Profiler timer.
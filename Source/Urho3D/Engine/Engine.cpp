@@ -25,6 +25,7 @@
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../Engine/DebugHud.h"
+#include "../Resource/DerivedDataCache.h"
 #include "../Engine/Engine.h"
 #include "../IO/FileSystem.h"
 #include "../Graphics/Graphics.h"
@@ -119,6 +120,7 @@ Engine::Engine(Context* context) :
     context_->RegisterSubsystem(new Log(context_));
     #endif
     context_->RegisterSubsystem(new ResourceCache(context_));
+    context_->RegisterSubsystem(new DerivedDataCache(context_));
     #ifdef URHO3D_NETWORK
     context_->RegisterSubsystem(new Network(context_));
     #endif
@@ -178,6 +180,7 @@ bool Engine::Initialize(const VariantMap& parameters)
         if (HasParameter(parameters, "LogLevel"))
             log->SetLevel(GetParameter(parameters, "LogLevel").GetInt());
         log->SetQuiet(GetParameter(parameters, "LogQuiet", false).GetBool());
+        log->SetAsync(GetParameter(parameters, "LogAsync", false).GetBool());
         log->Open(GetParameter(parameters, "LogName", "Urho3D.log").GetString());
     }
 
@@ -201,6 +204,16 @@ bool Engine::Initialize(const VariantMap& parameters)
     // Add resource paths
     ResourceCache* cache = GetSubsystem<ResourceCache>();
     FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    cache->SetMemoryMapPackages(GetParameter(parameters, "MemoryMapPackages", false).GetBool());
+
+    // Enable the derived data cache if a directory is given. Relative paths are relative to the executable
+    String derivedDataCacheDir = GetParameter(parameters, "DerivedDataCache").GetString();
+    if (!derivedDataCacheDir.Empty())
+    {
+        if (!IsAbsolutePath(derivedDataCacheDir))
+            derivedDataCacheDir = fileSystem->GetProgramDir() + derivedDataCacheDir;
+        GetSubsystem<DerivedDataCache>()->SetCacheDir(derivedDataCacheDir);
+    }
 
     String resourcePrefixPath = AddTrailingSlash(GetParameter(parameters, "ResourcePrefixPath", getenv("URHO3D_PREFIX_PATH")).GetString());
     if (resourcePrefixPath.Empty())
@@ -605,7 +618,41 @@ void Engine::DumpMemory()
 
     LOGRAW("Total allocated memory " + String(total) + " bytes in " + String(blocks) + " blocks\n\n");
     #else
-    LOGRAW("DumpMemory() supported on MSVC debug mode only\n\n");
+    LOGRAW("DumpMemory() heap block dump supported on MSVC debug mode only\n\n");
+    #endif
+
+    unsigned poolTotal = 0;
+    unsigned poolUsed = 0;
+
+    for (unsigned i = 0; i < POOL_NUM_SIZE_CLASSES; ++i)
+    {
+        PoolSizeClassInfo info = GetPoolSizeClassInfo(i);
+        if (!info.capacity_)
+            continue;
+
+        unsigned numFree = info.numFree_ + info.numCached_;
+        unsigned used = info.capacity_ > numFree ? info.capacity_ - numFree : 0;
+        LOGRAW("Pool size class " + String(info.nodeSize_) + ": " + String(used) + " / " + String(info.capacity_) + " nodes used, " +
+            String(info.numCached_) + " cached in threads, " + String(info.numChunks_) + " chunks\n");
+
+        poolTotal += info.capacity_ * info.nodeSize_;
+        poolUsed += used * info.nodeSize_;
+    }
+
+    LOGRAW("Total node pool memory " + String(poolTotal) + " bytes, " + String(poolUsed) + " bytes used\n\n");
+
+    #ifdef URHO3D_MEMORY_TRACKING
+    long long tagTotal = 0;
+
+    for (unsigned i = 0; i < MAX_MEMORY_TAGS; ++i)
+    {
+        MemoryTagInfo info = GetMemoryTagInfo((MemoryTag)i);
+        LOGRAW("Memory tag " + String(GetMemoryTagName((MemoryTag)i)) + ": " + String((unsigned)info.bytes_) + " bytes in " +
+            String(info.allocations_) + " allocations, " + String(info.totalAllocations_) + " allocations total\n");
+        tagTotal += info.bytes_;
+    }
+
+    LOGRAW("Total tracked memory " + String((unsigned)tagTotal) + " bytes\n\n");
     #endif
     #endif
 }
@@ -70,7 +70,7 @@ public:
     void DumpProfiler();
     /// Dump information of all resources to the log.
     void DumpResources(bool dumpFileName = false);
-    /// Dump information of all memory allocations to the log. Supported in MSVC debug mode only.
+    /// Dump information of all memory allocations to the log. Per-allocation heap information is supported in MSVC debug mode only, node pool usage on all platforms.
     void DumpMemory();
     
     /// Get timestep of the next frame. Updated by ApplyFrameLimit().
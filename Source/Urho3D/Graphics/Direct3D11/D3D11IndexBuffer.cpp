@@ -24,6 +24,7 @@
 #include "../../Graphics/Graphics.h"
 #include "../../Graphics/GraphicsImpl.h"
 #include "../../Graphics/IndexBuffer.h"
+#include "../../Graphics/ShadowData.h"
 #include "../../IO/Log.h"
 
 #include "../../DebugNew.h"
@@ -50,6 +51,7 @@ IndexBuffer::IndexBuffer(Context* context) :
 
 IndexBuffer::~IndexBuffer()
 {
+    ResizeShadowData(shadowData_, indexCount_ * indexSize_, 0);
     Release();
 }
 
@@ -78,10 +80,7 @@ void IndexBuffer::SetShadowed(bool enable)
     
     if (enable != shadowed_)
     {
-        if (enable && indexCount_ && indexSize_)
-            shadowData_ = new unsigned char[indexCount_ * indexSize_];
-        else
-            shadowData_.Reset();
+        ResizeShadowData(shadowData_, indexCount_ * indexSize_, enable ? indexCount_ * indexSize_ : 0);
         
         shadowed_ = enable;
     }
@@ -90,15 +89,13 @@ void IndexBuffer::SetShadowed(bool enable)
 bool IndexBuffer::SetSize(unsigned indexCount, bool largeIndices, bool dynamic)
 {
     Unlock();
+    unsigned oldShadowSize = indexCount_ * indexSize_;
     
     dynamic_ = dynamic;
     indexCount_ = indexCount;
     indexSize_ = largeIndices ? sizeof(unsigned) : sizeof(unsigned short);
     
-    if (shadowed_ && indexCount_ && indexSize_)
-        shadowData_ = new unsigned char[indexCount_ * indexSize_];
-    else
-        shadowData_.Reset();
+    ResizeShadowData(shadowData_, oldShadowSize, shadowed_ ? indexCount_ * indexSize_ : 0);
     
     return Create();
 }
@@ -22,6 +22,7 @@
 
 #include "../../Graphics/Graphics.h"
 #include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/ShadowData.h"
 #include "../../IO/Log.h"
 #include "../../Graphics/VertexBuffer.h"
 
@@ -119,6 +120,7 @@ VertexBuffer::VertexBuffer(Context* context) :
 
 VertexBuffer::~VertexBuffer()
 {
+    ResizeShadowData(shadowData_, vertexCount_ * vertexSize_, 0);
     Release();
 }
 
@@ -150,10 +152,7 @@ void VertexBuffer::SetShadowed(bool enable)
     
     if (enable != shadowed_)
     {
-        if (enable && vertexSize_ && vertexCount_)
-            shadowData_ = new unsigned char[vertexCount_ * vertexSize_];
-        else
-            shadowData_.Reset();
+        ResizeShadowData(shadowData_, vertexCount_ * vertexSize_, enable ? vertexCount_ * vertexSize_ : 0);
         
         shadowed_ = enable;
     }
@@ -162,6 +161,7 @@ void VertexBuffer::SetShadowed(bool enable)
 bool VertexBuffer::SetSize(unsigned vertexCount, unsigned elementMask, bool dynamic)
 {
     Unlock();
+    unsigned oldShadowSize = vertexCount_ * vertexSize_;
     
     dynamic_ = dynamic;
     vertexCount_ = vertexCount;
@@ -169,10 +169,7 @@ bool VertexBuffer::SetSize(unsigned vertexCount, unsigned elementMask, bool dyna
     
     UpdateOffsets();
     
-    if (shadowed_ && vertexCount_ && vertexSize_)
-        shadowData_ = new unsigned char[vertexCount_ * vertexSize_];
-    else
-        shadowData_.Reset();
+    ResizeShadowData(shadowData_, oldShadowSize, shadowed_ ? vertexCount_ * vertexSize_ : 0);
     
     return Create();
 }
@@ -28,6 +28,7 @@
 #include "../../IO/Log.h"
 #include "../../Graphics/Renderer.h"
 #include "../../Core/Profiler.h"
+#include "../../Core/WorkQueue.h"
 #include "../../Resource/ResourceCache.h"
 #include "../../Graphics/Texture2D.h"
 #include "../../Resource/XMLFile.h"
@@ -415,7 +416,7 @@ bool Texture2D::SetData(SharedPtr<Image> image, bool useAlpha)
             else
             {
                 unsigned char* rgbaData = new unsigned char[level.width_ * level.height_ * 4];
-                level.Decompress(rgbaData);
+                level.Decompress(rgbaData, GetSubsystem<WorkQueue>());
                 SetData(i, 0, 0, level.width_, level.height_, rgbaData);
                 memoryUse += level.width_ * level.height_ * 4;
                 delete[] rgbaData;
@@ -22,6 +22,7 @@
 
 #include "../../Graphics/Graphics.h"
 #include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/ShadowData.h"
 #include "../../IO/Log.h"
 #include "../../Graphics/VertexBuffer.h"
 
@@ -69,6 +70,7 @@ VertexBuffer::VertexBuffer(Context* context) :
 
 VertexBuffer::~VertexBuffer()
 {
+    ResizeShadowData(shadowData_, vertexCount_ * vertexSize_, 0);
     Release();
 }
 
@@ -119,10 +121,7 @@ void VertexBuffer::SetShadowed(bool enable)
     
     if (enable != shadowed_)
     {
-        if (enable && vertexSize_ && vertexCount_)
-            shadowData_ = new unsigned char[vertexCount_ * vertexSize_];
-        else
-            shadowData_.Reset();
+        ResizeShadowData(shadowData_, vertexCount_ * vertexSize_, enable ? vertexCount_ * vertexSize_ : 0);
         
         shadowed_ = enable;
     }
@@ -131,6 +130,7 @@ void VertexBuffer::SetShadowed(bool enable)
 bool VertexBuffer::SetSize(unsigned vertexCount, unsigned elementMask, bool dynamic)
 {
     Unlock();
+    unsigned oldShadowSize = vertexCount_ * vertexSize_;
     
     if (dynamic)
     {
@@ -148,10 +148,7 @@ bool VertexBuffer::SetSize(unsigned vertexCount, unsigned elementMask, bool dyna
     
     UpdateOffsets();
     
-    if (shadowed_ && vertexCount_ && vertexSize_)
-        shadowData_ = new unsigned char[vertexCount_ * vertexSize_];
-    else
-        shadowData_.Reset();
+    ResizeShadowData(shadowData_, oldShadowSize, shadowed_ ? vertexCount_ * vertexSize_ : 0);
     
     return Create();
 }
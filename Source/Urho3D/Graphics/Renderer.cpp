@@ -549,6 +549,7 @@ unsigned Renderer::GetNumOccluders(bool allViews) const
 void Renderer::Update(float timeStep)
 {
     PROFILE(UpdateViews);
+    MEMORY_TAG(MT_RENDER);
     
     views_.Clear();
     
@@ -643,6 +644,7 @@ void Renderer::Update(float timeStep)
 
 void Renderer::Render()
 {
+    MEMORY_TAG(MT_RENDER);
     // Engine does not render when window is closed or device is lost
     assert(graphics_ && graphics_->IsInitialized() && !graphics_->IsDeviceLost());
     
@@ -0,0 +1,199 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../IO/BitStream.h"
+#include "../IO/Deserializer.h"
+#include "../IO/Serializer.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Maximum bits per quantized float component, as more would exceed float precision.
+static const unsigned MAX_QUANTIZED_BITS = 24;
+/// Bits used for the bit count of a precision float.
+static const unsigned PRECISION_LENGTH_BITS = 5;
+/// Largest magnitude of a precision float in multiples of precision, so that the zigzag encoded value fits in 31 bits.
+static const int MAX_PRECISION_STEPS = 0x3fffffff;
+/// Largest possible magnitude of the three smallest components of a normalized quaternion.
+static const float QUATERNION_COMPONENT_RANGE = 0.707107f;
+
+static unsigned GetMask(unsigned numBits)
+{
+    return numBits < 32 ? (1U << numBits) - 1 : 0xffffffff;
+}
+
+BitWriter::BitWriter(Serializer& dest) :
+    dest_(dest),
+    buffer_(0),
+    numBuffered_(0),
+    numBits_(0)
+{
+}
+
+void BitWriter::WriteBits(unsigned value, unsigned numBits)
+{
+    if (!numBits)
+        return;
+    numBits = Min((int)numBits, 32);
+
+    buffer_ |= (unsigned long long)(value & GetMask(numBits)) << numBuffered_;
+    numBuffered_ += numBits;
+    numBits_ += numBits;
+
+    while (numBuffered_ >= 8)
+    {
+        dest_.WriteUByte((unsigned char)(buffer_ & 0xff));
+        buffer_ >>= 8;
+        numBuffered_ -= 8;
+    }
+}
+
+void BitWriter::WriteBool(bool value)
+{
+    WriteBits(value ? 1 : 0, 1);
+}
+
+void BitWriter::WriteQuantizedFloat(float value, float minValue, float maxValue, unsigned numBits)
+{
+    numBits = Clamp((int)numBits, 1, (int)MAX_QUANTIZED_BITS);
+    float range = maxValue - minValue;
+    float steps = (float)GetMask(numBits);
+    float normalized = range > 0.0f ? (Clamp(value, minValue, maxValue) - minValue) / range : 0.0f;
+    WriteBits((unsigned)(normalized * steps + 0.5f), numBits);
+}
+
+void BitWriter::WritePrecisionFloat(float value, float precision)
+{
+    float steps = precision > 0.0f ? floorf(value / precision + 0.5f) : 0.0f;
+    // Clamp also as an integer, as the float limits round up to the next power of two
+    int intValue = Clamp((int)Clamp(steps, (float)-MAX_PRECISION_STEPS, (float)MAX_PRECISION_STEPS), -MAX_PRECISION_STEPS,
+        MAX_PRECISION_STEPS);
+
+    // Zigzag encode so that small negative values also use few bits, then write the bit count followed by the value
+    unsigned encoded = ((unsigned)intValue << 1) ^ (unsigned)(intValue >> 31);
+    unsigned length = 0;
+    while (length < 32 && (encoded >> length))
+        ++length;
+    WriteBits(length, PRECISION_LENGTH_BITS);
+    WriteBits(encoded, length);
+}
+
+void BitWriter::WriteQuantizedQuaternion(const Quaternion& value, unsigned numBits)
+{
+    Quaternion norm = value.Normalized();
+    float components[4] = { norm.w_, norm.x_, norm.y_, norm.z_ };
+
+    unsigned largest = 0;
+    for (unsigned i = 1; i < 4; ++i)
+    {
+        if (Abs(components[i]) > Abs(components[largest]))
+            largest = i;
+    }
+
+    // The quaternion and its negation represent the same rotation, so the largest component can be assumed positive
+    float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+    WriteBits(largest, 2);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+            WriteQuantizedFloat(components[i] * sign, -QUATERNION_COMPONENT_RANGE, QUATERNION_COMPONENT_RANGE, numBits);
+    }
+}
+
+void BitWriter::Flush()
+{
+    if (numBuffered_)
+    {
+        dest_.WriteUByte((unsigned char)(buffer_ & 0xff));
+        numBits_ += 8 - numBuffered_;
+        buffer_ = 0;
+        numBuffered_ = 0;
+    }
+}
+
+BitReader::BitReader(Deserializer& source) :
+    source_(source),
+    buffer_(0),
+    numBuffered_(0)
+{
+}
+
+unsigned BitReader::ReadBits(unsigned numBits)
+{
+    if (!numBits)
+        return 0;
+    numBits = Min((int)numBits, 32);
+
+    while (numBuffered_ < numBits)
+    {
+        buffer_ |= (unsigned long long)source_.ReadUByte() << numBuffered_;
+        numBuffered_ += 8;
+    }
+
+    unsigned ret = (unsigned)(buffer_ & GetMask(numBits));
+    buffer_ >>= numBits;
+    numBuffered_ -= numBits;
+    return ret;
+}
+
+bool BitReader::ReadBool()
+{
+    return ReadBits(1) != 0;
+}
+
+float BitReader::ReadQuantizedFloat(float minValue, float maxValue, unsigned numBits)
+{
+    numBits = Clamp((int)numBits, 1, (int)MAX_QUANTIZED_BITS);
+    float steps = (float)GetMask(numBits);
+    return minValue + (float)ReadBits(numBits) / steps * (maxValue - minValue);
+}
+
+float BitReader::ReadPrecisionFloat(float precision)
+{
+    unsigned length = ReadBits(PRECISION_LENGTH_BITS);
+    unsigned encoded = ReadBits(length);
+    int intValue = (int)(encoded >> 1) ^ -(int)(encoded & 1);
+    return (float)intValue * precision;
+}
+
+Quaternion BitReader::ReadQuantizedQuaternion(unsigned numBits)
+{
+    unsigned largest = ReadBits(2);
+    float components[4];
+    float sumSquared = 0.0f;
+
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+        {
+            components[i] = ReadQuantizedFloat(-QUATERNION_COMPONENT_RANGE, QUATERNION_COMPONENT_RANGE, numBits);
+            sumSquared += components[i] * components[i];
+        }
+    }
+
+    components[largest] = sqrtf(Max(1.0f - sumSquared, 0.0f));
+    return Quaternion(components[0], components[1], components[2], components[3]).Normalized();
+}
+
+}
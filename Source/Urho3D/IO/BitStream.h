@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Math/Quaternion.h"
+
+namespace Urho3D
+{
+
+class Deserializer;
+class Serializer;
+
+/// Writes values with arbitrary bit counts to a serializer, least significant bit first. Call Flush() after the last value to write the remaining bits padded to a whole byte.
+class URHO3D_API BitWriter
+{
+public:
+    /// Construct with destination serializer.
+    BitWriter(Serializer& dest);
+
+    /// Write an unsigned value using 0-32 bits.
+    void WriteBits(unsigned value, unsigned numBits);
+    /// Write a bool using one bit.
+    void WriteBool(bool value);
+    /// Write a float quantized to a range using 1-24 bits. The value is clamped to the range.
+    void WriteQuantizedFloat(float value, float minValue, float maxValue, unsigned numBits);
+    /// Write a float rounded to a multiple of precision. Uses fewer bits for values closer to zero.
+    void WritePrecisionFloat(float value, float precision);
+    /// Write a normalized quaternion as its three smallest components, quantized using 1-24 bits each, and the index of the largest component.
+    void WriteQuantizedQuaternion(const Quaternion& value, unsigned numBits);
+    /// Write the remaining bits padded to a whole byte.
+    void Flush();
+
+    /// Return number of bits written so far.
+    unsigned GetNumBits() const { return numBits_; }
+
+private:
+    /// Destination serializer.
+    Serializer& dest_;
+    /// Bits not yet written to the destination.
+    unsigned long long buffer_;
+    /// Number of bits not yet written to the destination.
+    unsigned numBuffered_;
+    /// Total number of bits written.
+    unsigned numBits_;
+};
+
+/// Reads values written by BitWriter from a deserializer. Reads whole bytes from the source only as needed, so that reading can continue from the source after the last value.
+class URHO3D_API BitReader
+{
+public:
+    /// Construct with source deserializer.
+    BitReader(Deserializer& source);
+
+    /// Read an unsigned value using 0-32 bits.
+    unsigned ReadBits(unsigned numBits);
+    /// Read a bool.
+    bool ReadBool();
+    /// Read a float quantized to a range.
+    float ReadQuantizedFloat(float minValue, float maxValue, unsigned numBits);
+    /// Read a float rounded to a multiple of precision.
+    float ReadPrecisionFloat(float precision);
+    /// Read a quaternion written as its three smallest components.
+    Quaternion ReadQuantizedQuaternion(unsigned numBits);
+
+private:
+    /// Source deserializer.
+    Deserializer& source_;
+    /// Bits read from the source but not yet consumed.
+    unsigned long long buffer_;
+    /// Number of bits read from the source but not yet consumed.
+    unsigned numBuffered_;
+};
+
+}
@@ -55,6 +55,11 @@ unsigned Deserializer::GetChecksum()
     return 0;
 }
 
+const unsigned char* Deserializer::GetInPlaceData() const
+{
+    return 0;
+}
+
 int Deserializer::ReadInt()
 {
     int ret;
@@ -351,7 +356,11 @@ VariantVector Deserializer::ReadVariantVector()
 {
     VariantVector ret(ReadVLE());
     for (unsigned i = 0; i < ret.Size(); ++i)
-        ret[i] = ReadVariant();
+    {
+        // Swap the read value into place to avoid copying it
+        Variant value = ReadVariant();
+        ret[i].Swap(value);
+    }
     return ret;
 }
 
@@ -363,7 +372,8 @@ VariantMap Deserializer::ReadVariantMap()
     for (unsigned i = 0; i < num; ++i)
     {
         StringHash key = ReadStringHash();
-        ret[key] = ReadVariant();
+        Variant value = ReadVariant();
+        ret[key].Swap(value);
     }
     
     return ret;
@@ -48,6 +48,8 @@ public:
     virtual const String& GetName() const;
     /// Return a checksum if applicable.
     virtual unsigned GetChecksum();
+    /// Return pointer to the whole stream data if it resides in memory and can be parsed in place without reading, or null if it must be read. The data stays valid for the lifetime of the stream.
+    virtual const unsigned char* GetInPlaceData() const;
     /// Return current position.
     unsigned GetPosition() const { return position_; }
     /// Return size.
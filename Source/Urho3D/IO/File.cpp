@@ -26,6 +26,8 @@
 #include "../IO/MemoryBuffer.h"
 #include "../IO/PackageFile.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 
 #include <cstdio>
 #include <LZ4/lz4.h>
@@ -57,6 +59,53 @@ static const char* openMode[] =
 static const unsigned READ_BUFFER_SIZE = 32768;
 #endif
 static const unsigned SKIP_BUFFER_SIZE = 1024;
+static const unsigned MIN_PARALLEL_DECOMPRESS_BLOCKS = 4;
+
+/// Run of compressed blocks to decompress, possibly in a worker thread.
+struct BlockRange
+{
+    /// Compressed data of the first block.
+    const unsigned char* src_;
+    /// Compressed block offsets starting from the first block, with one extra offset for the end of the last block.
+    const unsigned* offsets_;
+    /// Destination for the uncompressed data.
+    unsigned char* dest_;
+    /// Uncompressed block size.
+    unsigned blockSize_;
+    /// Total uncompressed size of the run. The last block may be shorter than the block size.
+    unsigned size_;
+    /// Number of blocks.
+    unsigned count_;
+    /// Success flag.
+    bool success_;
+};
+
+static void DecompressBlockRange(BlockRange& range)
+{
+    const unsigned char* src = range.src_;
+    unsigned char* dest = range.dest_;
+    unsigned sizeLeft = range.size_;
+
+    range.success_ = true;
+    for (unsigned i = 0; i < range.count_; ++i)
+    {
+        unsigned packedSize = range.offsets_[i + 1] - range.offsets_[i];
+        unsigned unpackedSize = Min((int)range.blockSize_, (int)sizeLeft);
+        if (LZ4_decompress_safe((const char*)src, (char*)dest, packedSize, unpackedSize) != (int)unpackedSize)
+        {
+            range.success_ = false;
+            return;
+        }
+        src += packedSize;
+        dest += unpackedSize;
+        sizeLeft -= unpackedSize;
+    }
+}
+
+void DecompressBlockRangeWork(const WorkItem* item, unsigned threadIndex)
+{
+    DecompressBlockRange(*reinterpret_cast<BlockRange*>(item->start_));
+}
 
 File::File(Context* context) :
     Object(context),
@@ -65,8 +114,13 @@ File::File(Context* context) :
     #ifdef ANDROID
     assetHandle_(0),
     #endif
+    mapping_(0),
+    mappedData_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
+    blockSize_(0),
+    currentBlock_(M_MAX_UNSIGNED),
+    inputBufferSize_(0),
     offset_(0),
     checksum_(0),
     compressed_(false),
@@ -82,8 +136,13 @@ File::File(Context* context, const String& fileName, FileMode mode) :
     #ifdef ANDROID
     assetHandle_(0),
     #endif
+    mapping_(0),
+    mappedData_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
+    blockSize_(0),
+    currentBlock_(M_MAX_UNSIGNED),
+    inputBufferSize_(0),
     offset_(0),
     checksum_(0),
     compressed_(false),
@@ -100,8 +159,13 @@ File::File(Context* context, PackageFile* package, const String& fileName) :
     #ifdef ANDROID
     assetHandle_(0),
     #endif
+    mapping_(0),
+    mappedData_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
+    blockSize_(0),
+    currentBlock_(M_MAX_UNSIGNED),
+    inputBufferSize_(0),
     offset_(0),
     checksum_(0),
     compressed_(false),
@@ -220,6 +284,24 @@ bool File::Open(PackageFile* package, const String& fileName)
     if (!entry)
         return false;
 
+    // Read directly from a memory-mapped package without opening a file handle
+    if (package->IsMemoryMapped())
+    {
+        mapping_ = package->GetMapping();
+        mapping_->AddRef();
+        mappedData_ = mapping_->GetData() + entry->offset_;
+        fileName_ = fileName;
+        mode_ = FILE_READ;
+        offset_ = entry->offset_;
+        checksum_ = entry->checksum_;
+        position_ = 0;
+        size_ = entry->size_;
+        compressed_ = false;
+        readSyncNeeded_ = false;
+        writeSyncNeeded_ = false;
+        return true;
+    }
+
     #ifdef WIN32
     handle_ = _wfopen(GetWideNativePath(package->GetName()).CString(), L"rb");
     #else
@@ -242,11 +324,43 @@ bool File::Open(PackageFile* package, const String& fileName)
     writeSyncNeeded_ = false;
 
     fseek((FILE*)handle_, offset_, SEEK_SET);
+
+    if (compressed_ && package->HasBlockIndex())
+    {
+        // Read the block index, which allows decompressing any block independently
+        unsigned header[2];
+        bool success = fread(header, sizeof header, 1, (FILE*)handle_) == 1 && header[0] &&
+            header[1] == (size_ + header[0] - 1) / header[0];
+        if (success)
+        {
+            blockOffsets_.Resize(header[1] + 1);
+            success = fread(&blockOffsets_[0], sizeof(unsigned) * blockOffsets_.Size(), 1, (FILE*)handle_) == 1;
+        }
+        if (!success)
+        {
+            LOGERROR("Corrupt block index in compressed file " + fileName);
+            Close();
+            return false;
+        }
+
+        blockSize_ = header[0];
+        currentBlock_ = M_MAX_UNSIGNED;
+    }
+
     return true;
 }
 
 unsigned File::Read(void* dest, unsigned size)
 {
+    if (mappedData_)
+    {
+        if (size + position_ > size_)
+            size = size_ - position_;
+        memcpy(dest, mappedData_ + position_, size);
+        position_ += size;
+        return size;
+    }
+
     #ifdef ANDROID
     if (!handle_ && !assetHandle_)
     #else
@@ -296,6 +410,9 @@ unsigned File::Read(void* dest, unsigned size)
     #endif
     if (compressed_)
     {
+        if (!blockOffsets_.Empty())
+            return ReadBlocks(dest, size);
+
         unsigned sizeLeft = size;
         unsigned char* destPtr = (unsigned char*)dest;
 
@@ -358,6 +475,12 @@ unsigned File::Read(void* dest, unsigned size)
 
 unsigned File::Seek(unsigned position)
 {
+    if (mappedData_)
+    {
+        position_ = Min((int)position, (int)size_);
+        return position_;
+    }
+
     #ifdef ANDROID
     if (!handle_ && !assetHandle_)
     #else
@@ -384,6 +507,13 @@ unsigned File::Seek(unsigned position)
     #endif
     if (compressed_)
     {
+        // With a block index, decompress lazily on the next read
+        if (!blockOffsets_.Empty())
+        {
+            position_ = position;
+            return position_;
+        }
+
         // Start over from the beginning
         if (position == 0)
         {
@@ -493,6 +623,21 @@ void File::Close()
 
     readBuffer_.Reset();
     inputBuffer_.Reset();
+    blockOffsets_.Clear();
+    blockSize_ = 0;
+    currentBlock_ = M_MAX_UNSIGNED;
+    inputBufferSize_ = 0;
+
+    if (mappedData_)
+    {
+        mapping_->ReleaseRef();
+        mapping_ = 0;
+        mappedData_ = 0;
+        position_ = 0;
+        size_ = 0;
+        offset_ = 0;
+        checksum_ = 0;
+    }
 
     if (handle_)
     {
@@ -519,10 +664,147 @@ void File::SetName(const String& name)
 bool File::IsOpen() const
 {
     #ifdef ANDROID
-        return handle_ != 0 || assetHandle_ != 0;
+        return handle_ != 0 || assetHandle_ != 0 || mappedData_ != 0;
     #else
-        return handle_ != 0;
+        return handle_ != 0 || mappedData_ != 0;
     #endif
 }
 
+unsigned File::ReadBlocks(void* dest, unsigned size)
+{
+    unsigned numBlocks = blockOffsets_.Size() - 1;
+    unsigned sizeLeft = size;
+    unsigned char* destPtr = (unsigned char*)dest;
+
+    while (sizeLeft)
+    {
+        unsigned block = position_ / blockSize_;
+        unsigned blockStart = block * blockSize_;
+        unsigned blockUnpackedSize = Min((int)blockSize_, (int)(size_ - blockStart));
+        unsigned offsetInBlock = position_ - blockStart;
+
+        if (!offsetInBlock && sizeLeft >= blockUnpackedSize && block != currentBlock_)
+        {
+            // Decompress all whole blocks covered by the read directly to the destination
+            unsigned endPosition = position_ + sizeLeft;
+            unsigned endBlock = endPosition == size_ ? numBlocks : endPosition / blockSize_;
+            unsigned runSize = Min((int)(endBlock * blockSize_), (int)size_) - position_;
+            if (!DecompressBlocks(block, endBlock - block, destPtr))
+                break;
+
+            destPtr += runSize;
+            sizeLeft -= runSize;
+            position_ += runSize;
+        }
+        else
+        {
+            // Partial block: decompress to the read buffer, which also serves subsequent small reads
+            if (block != currentBlock_)
+            {
+                if (!readBuffer_)
+                    readBuffer_ = new unsigned char[blockSize_];
+                if (!DecompressBlocks(block, 1, readBuffer_.Get()))
+                    break;
+                currentBlock_ = block;
+            }
+
+            unsigned copySize = Min((int)(blockUnpackedSize - offsetInBlock), (int)sizeLeft);
+            memcpy(destPtr, readBuffer_.Get() + offsetInBlock, copySize);
+            destPtr += copySize;
+            sizeLeft -= copySize;
+            position_ += copySize;
+        }
+    }
+
+    return size - sizeLeft;
+}
+
+bool File::DecompressBlocks(unsigned first, unsigned count, unsigned char* dest)
+{
+    unsigned packedStart = blockOffsets_[first];
+    unsigned packedSize = blockOffsets_[first + count] - packedStart;
+    if (packedSize > inputBufferSize_)
+    {
+        inputBuffer_ = new unsigned char[packedSize];
+        inputBufferSize_ = packedSize;
+    }
+
+    // Read the whole compressed run at once
+    fseek((FILE*)handle_, offset_ + packedStart, SEEK_SET);
+    if (fread(inputBuffer_.Get(), packedSize, 1, (FILE*)handle_) != 1)
+    {
+        LOGERROR("Error while reading from file " + GetName());
+        return false;
+    }
+
+    unsigned firstStart = first * blockSize_;
+    unsigned runSize = Min((int)((first + count) * blockSize_), (int)size_) - firstStart;
+
+    // Blocks are independent, so spread a large run across the worker threads. The work queue may only be used from
+    // the main thread; background loading threads decompress sequentially, as they already run in parallel
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (count >= MIN_PARALLEL_DECOMPRESS_BLOCKS && queue && queue->GetNumThreads() && Thread::IsMainThread())
+    {
+        PROFILE(DecompressBlocks);
+
+        unsigned numRanges = Min((int)queue->GetNumThreads() + 1, (int)count);
+        unsigned blocksPerRange = count / numRanges;
+        PODVector<BlockRange> ranges(numRanges);
+
+        unsigned rangeFirst = first;
+        for (unsigned i = 0; i < numRanges; ++i)
+        {
+            unsigned rangeCount = i < numRanges - 1 ? blocksPerRange : first + count - rangeFirst;
+            unsigned rangeStart = rangeFirst * blockSize_;
+
+            BlockRange& range = ranges[i];
+            range.src_ = inputBuffer_.Get() + blockOffsets_[rangeFirst] - packedStart;
+            range.offsets_ = &blockOffsets_[rangeFirst];
+            range.dest_ = dest + rangeStart - firstStart;
+            range.blockSize_ = blockSize_;
+            range.size_ = Min((int)((rangeFirst + rangeCount) * blockSize_), (int)size_) - rangeStart;
+            range.count_ = rangeCount;
+            range.success_ = false;
+
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = DecompressBlockRangeWork;
+            item->start_ = &range;
+            queue->AddWorkItem(item);
+
+            rangeFirst += rangeCount;
+        }
+
+        // Help the worker threads, then wait for all ranges to finish
+        queue->Complete(M_MAX_UNSIGNED);
+
+        for (unsigned i = 0; i < numRanges; ++i)
+        {
+            if (!ranges[i].success_)
+            {
+                LOGERROR("Error while decompressing file " + GetName());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    BlockRange range;
+    range.src_ = inputBuffer_.Get();
+    range.offsets_ = &blockOffsets_[first];
+    range.dest_ = dest;
+    range.blockSize_ = blockSize_;
+    range.size_ = runSize;
+    range.count_ = count;
+    DecompressBlockRange(range);
+    if (!range.success_)
+    {
+        LOGERROR("Error while decompressing file " + GetName());
+        return false;
+    }
+
+    return true;
+}
+
 }
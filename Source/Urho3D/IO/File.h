@@ -43,6 +43,7 @@ enum FileMode
 };
 
 class PackageFile;
+class PackageMapping;
 
 /// %File opened either through the filesystem or from within a package file.
 class URHO3D_API File : public Object, public Deserializer, public Serializer
@@ -69,6 +70,8 @@ public:
     virtual const String& GetName() const { return fileName_; }
     /// Return a checksum of the file contents using the SDBM hash algorithm.
     virtual unsigned GetChecksum();
+    /// Return pointer to the file data if opened from a memory-mapped package file, or null otherwise.
+    virtual const unsigned char* GetInPlaceData() const { return mappedData_; }
     
     /// Open a filesystem file. Return true if successful.
     bool Open(const String& fileName, FileMode mode = FILE_READ);
@@ -89,8 +92,15 @@ public:
     void* GetHandle() const { return handle_; }
     /// Return whether the file originates from a package.
     bool IsPackaged() const { return offset_ != 0; }
+    /// Return whether the file is read from a memory-mapped package file.
+    bool IsMemoryMapped() const { return mappedData_ != 0; }
     
 private:
+    /// Read from a compressed file with block index.
+    unsigned ReadBlocks(void* dest, unsigned size);
+    /// Decompress a run of consecutive blocks from a compressed file with block index. Return true if successful.
+    bool DecompressBlocks(unsigned first, unsigned count, unsigned char* dest);
+    
     /// File name.
     String fileName_;
     /// Open mode.
@@ -105,10 +115,22 @@ private:
     SharedArrayPtr<unsigned char> readBuffer_;
     /// Decompression input buffer for compressed file loading.
     SharedArrayPtr<unsigned char> inputBuffer_;
+    /// Compressed block offsets relative to the file start, with one extra offset for the end of the last block. Empty if the file has no block index.
+    PODVector<unsigned> blockOffsets_;
+    /// Memory mapping of the package file being read from. Holds a reference so that the mapping stays valid after the package is removed.
+    PackageMapping* mapping_;
+    /// File data within the memory-mapped package file.
+    const unsigned char* mappedData_;
     /// Read buffer position.
     unsigned readBufferOffset_;
     /// Bytes in the current read buffer.
     unsigned readBufferSize_;
+    /// Uncompressed block size of a compressed file with block index.
+    unsigned blockSize_;
+    /// Index of the block decompressed into the read buffer, or M_MAX_UNSIGNED if none.
+    unsigned currentBlock_;
+    /// Allocated size of the decompression input buffer.
+    unsigned inputBufferSize_;
     /// Start position within a package file, 0 for regular files.
     unsigned offset_;
     /// Content checksum.
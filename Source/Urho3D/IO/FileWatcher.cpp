@@ -45,6 +45,12 @@ namespace Urho3D
 #ifndef __APPLE__
 static const unsigned BUFFERSIZE = 4096;
 #endif
+/// Maximum time in milliseconds to hold back changes during a continuous burst of changes.
+static const unsigned MAX_BURST_MSEC = 5000;
+#if defined(__linux__) && !defined(WIN32)
+/// Watched inotify events. Modified files are notified once when closed instead of on each write.
+static const unsigned WATCH_FLAGS = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO;
+#endif
 
 FileWatcher::FileWatcher(Context* context) :
     Object(context),
@@ -110,8 +116,7 @@ bool FileWatcher::StartWatching(const String& pathName, bool watchSubDirs)
         return false;
     }
 #elif defined(__linux__)
-    int flags = IN_CREATE|IN_DELETE|IN_MODIFY|IN_MOVED_FROM|IN_MOVED_TO;
-    int handle = inotify_add_watch(watchHandle_, pathName.CString(), flags);
+    int handle = inotify_add_watch(watchHandle_, pathName.CString(), WATCH_FLAGS);
 
     if (handle < 0)
     {
@@ -137,7 +142,7 @@ bool FileWatcher::StartWatching(const String& pathName, bool watchSubDirs)
                 // Don't watch ./ or ../ sub-directories
                 if (!subDirFullPath.EndsWith("./"))
                 {
-                    handle = inotify_add_watch(watchHandle_, subDirFullPath.CString(), flags);
+                    handle = inotify_add_watch(watchHandle_, subDirFullPath.CString(), WATCH_FLAGS);
                     if (handle < 0)
                         LOGERROR("Failed to start watching subdirectory path " + subDirFullPath);
                     else
@@ -266,6 +271,7 @@ void FileWatcher::ThreadFunction()
     }
 #elif defined(__linux__)
     unsigned char buffer[BUFFERSIZE];
+    Vector<String> fileNames;
 
     while (shouldRun_)
     {
@@ -278,19 +284,34 @@ void FileWatcher::ThreadFunction()
         while (i < length)
         {
             inotify_event* event = (inotify_event*)&buffer[i];
+            HashMap<int, String>::ConstIterator dir = dirHandle_.Find(event->wd);
 
-            if (event->len > 0)
+            if (event->mask & IN_Q_OVERFLOW)
+                LOGWARNING("Too many file changes in " + path_ + ", some changes were not notified");
+            else if (event->mask & IN_IGNORED)
+                dirHandle_.Erase(event->wd);
+            else if (event->len > 0 && dir != dirHandle_.End())
             {
-                if (event->mask & IN_MODIFY || event->mask & IN_MOVE)
+                String fileName = dir->second_ + event->name;
+                
+                if (event->mask & IN_ISDIR)
                 {
-                    String fileName;
-                    fileName = dirHandle_[event->wd] + event->name;
-                    AddChange(fileName);
+                    if (watchSubDirs_)
+                        AddSubDirWatch(fileName, fileNames);
                 }
+                else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                    fileNames.Push(fileName);
             }
 
             i += sizeof(inotify_event) + event->len;
         }
+        
+        // Add the changes of one read at once, so that the change buffer is locked only once during a burst of changes
+        if (!fileNames.Empty())
+        {
+            AddChanges(fileNames);
+            fileNames.Clear();
+        }
     }
 #elif defined(__APPLE__) && !defined(IOS)
     while (shouldRun_)
@@ -309,21 +330,65 @@ void FileWatcher::ThreadFunction()
 #endif
 }
 
+#if defined(__linux__) && !defined(WIN32)
+void FileWatcher::AddSubDirWatch(const String& subDir, Vector<String>& fileNames)
+{
+    String relativePath = AddTrailingSlash(subDir);
+    int handle = inotify_add_watch(watchHandle_, (path_ + relativePath).CString(), WATCH_FLAGS);
+    if (handle < 0)
+    {
+        LOGERROR("Failed to start watching subdirectory path " + path_ + relativePath);
+        return;
+    }
+    
+    dirHandle_[handle] = relativePath;
+    
+    // Files may have been written into the new directory before it was watched, so notify them now
+    Vector<String> entries;
+    fileSystem_->ScanDir(entries, path_ + relativePath, "*", SCAN_FILES, false);
+    for (unsigned i = 0; i < entries.Size(); ++i)
+        fileNames.Push(relativePath + entries[i]);
+    
+    fileSystem_->ScanDir(entries, path_ + relativePath, "*", SCAN_DIRS, false);
+    for (unsigned i = 0; i < entries.Size(); ++i)
+    {
+        if (entries[i] != "." && entries[i] != "..")
+            AddSubDirWatch(relativePath + entries[i], fileNames);
+    }
+}
+#endif
+
 void FileWatcher::AddChange(const String& fileName)
 {
     MutexLock lock(changesMutex_);
     
+    if (changes_.Empty())
+        burstTimer_.Reset();
+    lastChangeTimer_.Reset();
+    
     // Reset the timer associated with the filename. Will be notified once timer exceeds the delay
     changes_[fileName].Reset();
 }
 
+void FileWatcher::AddChanges(const Vector<String>& fileNames)
+{
+    MutexLock lock(changesMutex_);
+    
+    if (changes_.Empty())
+        burstTimer_.Reset();
+    lastChangeTimer_.Reset();
+    
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
+        changes_[fileNames[i]].Reset();
+}
+
 bool FileWatcher::GetNextChange(String& dest)
 {
     MutexLock lock(changesMutex_);
     
     unsigned delayMsec = (unsigned)(delay_ * 1000.0f);
     
-    if (changes_.Empty())
+    if (changes_.Empty() || IsBurstInProgress(delayMsec))
         return false;
     else
     {
@@ -341,4 +406,35 @@ bool FileWatcher::GetNextChange(String& dest)
     }
 }
 
+bool FileWatcher::GetNextChanges(Vector<String>& dest)
+{
+    MutexLock lock(changesMutex_);
+    
+    unsigned delayMsec = (unsigned)(delay_ * 1000.0f);
+    
+    if (changes_.Empty() || IsBurstInProgress(delayMsec))
+        return false;
+    
+    unsigned oldSize = dest.Size();
+    for (HashMap<String, Timer>::Iterator i = changes_.Begin(); i != changes_.End();)
+    {
+        if (i->second_.GetMSec(false) >= delayMsec)
+        {
+            dest.Push(i->first_);
+            i = changes_.Erase(i);
+        }
+        else
+            ++i;
+    }
+    
+    return dest.Size() > oldSize;
+}
+
+bool FileWatcher::IsBurstInProgress(unsigned delayMsec)
+{
+    // A continuous burst is notified in parts after a while, so that eg. a file being written constantly does not hold back others
+    unsigned maxBurstMsec = Max((int)MAX_BURST_MSEC, (int)delayMsec * 2);
+    return lastChangeTimer_.GetMSec(false) < delayMsec && burstTimer_.GetMSec(false) < maxBurstMsec;
+}
+
 }
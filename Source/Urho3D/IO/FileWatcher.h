@@ -51,12 +51,16 @@ public:
     bool StartWatching(const String& pathName, bool watchSubDirs);
     /// Stop watching the directory.
     void StopWatching();
-    /// Set the delay in seconds before file changes are notified. This (hopefully) avoids notifying when a file save is still in progress. Default 1 second.
+    /// Set the delay in seconds before file changes are notified. This (hopefully) avoids notifying when a file save is still in progress. Changes are also held back until no file has changed for the delay, so that a burst of changes such as a version control checkout is notified together. Default 1 second.
     void SetDelay(float interval);
     /// Add a file change into the changes queue.
     void AddChange(const String& fileName);
+    /// Add several file changes into the changes queue at once.
+    void AddChanges(const Vector<String>& fileNames);
     /// Return a file change (true if was found, false if not.)
     bool GetNextChange(String& dest);
+    /// Append all file changes that are ready to be notified. Return true if any were found.
+    bool GetNextChanges(Vector<String>& dest);
     
     /// Return the path being watched, or empty if not watching.
     const String& GetPath() const { return path_; }
@@ -64,6 +68,13 @@ public:
     float GetDelay() const { return delay_;}
     
 private:
+    /// Return whether a burst of changes is still in progress and the changes should be held back. Called with the mutex held.
+    bool IsBurstInProgress(unsigned delayMsec);
+#if defined(__linux__) && !defined(WIN32)
+    /// Start watching a subdirectory created after watching was started, and its subdirectories. Append the files already written into them.
+    void AddSubDirWatch(const String& subDir, Vector<String>& fileNames);
+#endif
+    
     /// Filesystem.
     SharedPtr<FileSystem> fileSystem_;
     /// The path being watched.
@@ -72,6 +83,10 @@ private:
     HashMap<String, Timer> changes_;
     /// Mutex for the change buffer.
     Mutex changesMutex_;
+    /// Time since the last change.
+    Timer lastChangeTimer_;
+    /// Time since the first change of the current burst of changes.
+    Timer burstTimer_;
     /// Delay in seconds for notifying changes.
     float delay_;
     /// Watch subdirectories flag.
@@ -31,6 +31,7 @@
 #include "../Core/Timer.h"
 
 #include <cstdio>
+#include <cstdlib>
 
 #ifdef ANDROID
 #include <android/log.h>
@@ -53,11 +54,56 @@ const char* logLevelPrefixes[] =
     0
 };
 
+static const unsigned DEFAULT_LOG_QUEUE_SIZE = 4096;
+static const unsigned MAX_LOG_WRITE_BATCH = 256;
+static const unsigned LOG_WRITER_SLEEP_MS = 5;
+
 static Log* logInstance = 0;
 static bool threadErrorDisplayed = false;
+static bool exitHandlerRegistered = false;
+
+static void FlushLogAtExit()
+{
+    Log::FlushInstance();
+}
+
+/// %Log writer thread, which performs the console and file output of queued messages.
+class LogWriterThread : public RefCounted, public Thread
+{
+public:
+    /// Construct.
+    LogWriterThread(Log* owner) :
+        owner_(owner)
+    {
+    }
+    
+    /// Write out queued messages until stopped.
+    virtual void ThreadFunction()
+    {
+        while (shouldRun_)
+        {
+            if (!owner_->WriteQueuedMessages())
+                Time::Sleep(LOG_WRITER_SLEEP_MS);
+        }
+        
+        // Write out whatever remains before exiting
+        while (owner_->WriteQueuedMessages())
+        {
+        }
+    }
+    
+private:
+    /// Log subsystem.
+    Log* owner_;
+};
 
 Log::Log(Context* context) :
     Object(context),
+    queueStart_(0),
+    queueCount_(0),
+    numDroppedMessages_(0),
+    overflowMode_(LOG_OVERFLOW_DROP),
+    timeStampTime_(0),
 #ifdef _DEBUG
     level_(LOG_DEBUG),
 #else
@@ -68,12 +114,21 @@ Log::Log(Context* context) :
     quiet_(false)
 {
     logInstance = this;
+    queue_.Resize(DEFAULT_LOG_QUEUE_SIZE);
+    
+    // Write out queued messages also when the program calls exit() without shutting down the engine
+    if (!exitHandlerRegistered)
+    {
+        atexit(FlushLogAtExit);
+        exitHandlerRegistered = true;
+    }
     
     SubscribeToEvent(E_ENDFRAME, HANDLER(Log, HandleEndFrame));
 }
 
 Log::~Log()
 {
+    SetAsync(false);
     logInstance = 0;
 }
 
@@ -90,20 +145,26 @@ void Log::Open(const String& fileName)
             Close();
     }
 
-    logFile_ = new File(context_);
-    if (logFile_->Open(fileName, FILE_WRITE))
+    SharedPtr<File> newLogFile(new File(context_));
+    if (newLogFile->Open(fileName, FILE_WRITE))
+    {
+        {
+            MutexLock lock(outputMutex_);
+            logFile_ = newLogFile;
+        }
         Write(LOG_INFO, "Opened log file " + fileName);
+    }
     else
-    {
-        logFile_.Reset();
         Write(LOG_ERROR, "Failed to create log file " + fileName);
-    }
     #endif
 }
 
 void Log::Close()
 {
     #if !defined(ANDROID) && !defined(IOS)
+    Flush();
+    
+    MutexLock lock(outputMutex_);
     if (logFile_ && logFile_->IsOpen())
     {
         logFile_->Close();
@@ -129,32 +190,150 @@ void Log::SetQuiet(bool quiet)
     quiet_ = quiet;
 }
 
+void Log::SetAsync(bool enable)
+{
+    #if !defined(ANDROID) && !defined(IOS)
+    if (enable == IsAsync())
+        return;
+    
+    if (enable)
+    {
+        writerThread_ = new LogWriterThread(this);
+        if (!writerThread_->Run())
+            writerThread_.Reset();
+    }
+    else
+    {
+        // Stopping the thread writes out the remaining messages
+        writerThread_->Stop();
+        writerThread_.Reset();
+    }
+    #endif
+}
+
+void Log::SetQueueSize(unsigned size)
+{
+    if (!size)
+        size = 1;
+    if (size == queue_.Size())
+        return;
+    
+    // The queue must be empty before it can be resized
+    bool async = IsAsync();
+    SetAsync(false);
+    queue_.Clear();
+    queue_.Resize(size);
+    queueStart_ = 0;
+    SetAsync(async);
+}
+
+void Log::SetOverflowMode(LogOverflowMode mode)
+{
+    overflowMode_ = mode;
+}
+
+void Log::Flush()
+{
+    while (WriteQueuedMessages())
+    {
+    }
+}
+
+bool Log::IsLevelEnabled(int level)
+{
+    return logInstance && logInstance->level_ <= level;
+}
+
+void Log::FlushInstance()
+{
+    if (logInstance)
+        logInstance->Flush();
+}
+
+bool Log::WriteQueuedMessages()
+{
+    // Hold the output mutex while taking messages from the queue, so that concurrent calls can not reorder the output
+    MutexLock outputLock(outputMutex_);
+    unsigned batchSize;
+    
+    {
+        MutexLock queueLock(queueMutex_);
+        if (!queueCount_)
+            return false;
+        
+        batchSize = queueCount_ < MAX_LOG_WRITE_BATCH ? queueCount_ : MAX_LOG_WRITE_BATCH;
+        if (writeBatch_.Size() < batchSize)
+            writeBatch_.Resize(batchSize);
+        for (unsigned i = 0; i < batchSize; ++i)
+        {
+            writeBatch_[i].message_.Swap(queue_[queueStart_].message_);
+            writeBatch_[i].level_ = queue_[queueStart_].level_;
+            writeBatch_[i].error_ = queue_[queueStart_].error_;
+            queueStart_ = (queueStart_ + 1) % queue_.Size();
+        }
+        queueCount_ -= batchSize;
+    }
+    
+    writeBuffer_.Clear();
+    
+    for (unsigned i = 0; i < batchSize; ++i)
+    {
+        const StoredLogMessage& stored = writeBatch_[i];
+        bool raw = stored.level_ == LOG_RAW;
+        
+        if (!quiet_ || stored.error_)
+        {
+            if (raw)
+                PrintUnicode(stored.message_, stored.error_);
+            else
+                PrintUnicodeLine(stored.message_, stored.error_);
+        }
+        
+        if (logFile_)
+        {
+            writeBuffer_ += stored.message_;
+            if (!raw)
+                writeBuffer_ += "\r\n";
+        }
+    }
+    
+    // Write the whole batch to the file at once
+    if (logFile_ && !writeBuffer_.Empty())
+    {
+        logFile_->Write(writeBuffer_.CString(), writeBuffer_.Length());
+        logFile_->Flush();
+    }
+    
+    return true;
+}
+
 void Log::Write(int level, const String& message)
 {
     assert(level >= LOG_DEBUG && level < LOG_NONE);
 
+    // Do not log if message level excluded
+    if (!logInstance || logInstance->level_ > level)
+        return;
+
     // If not in the main thread, store message for later processing
     if (!Thread::IsMainThread())
     {
-        if (logInstance)
-        {
-            MutexLock lock(logInstance->logMutex_);
-            logInstance->threadMessages_.Push(StoredLogMessage(message, level, false));
-        }
-        
+        MutexLock lock(logInstance->logMutex_);
+        logInstance->threadMessages_.Push(StoredLogMessage(message, level, false));
         return;
     }
 
-    // Do not log if message level excluded or if currently sending a log event
-    if (!logInstance || logInstance->level_ > level || logInstance->inWrite_)
+    // Do not log if currently sending a log event
+    if (logInstance->inWrite_)
         return;
 
-    String formattedMessage = logLevelPrefixes[level];
-    formattedMessage += ": " + message;
-    logInstance->lastMessage_ = message;
-
+    String formattedMessage;
     if (logInstance->timeStamp_)
-        formattedMessage = "[" + Time::GetTimeStamp() + "] " + formattedMessage;
+        formattedMessage = logInstance->GetTimeStampPrefix();
+    formattedMessage += logLevelPrefixes[level];
+    formattedMessage += ": ";
+    formattedMessage += message;
+    logInstance->lastMessage_ = message;
 
     #if defined(ANDROID)
     int androidLevel = ANDROID_LOG_DEBUG + level;
@@ -162,21 +341,31 @@ void Log::Write(int level, const String& message)
     #elif defined(IOS)
     SDL_IOS_LogMessage(message.CString());
     #else
-    if (logInstance->quiet_)
+    if (logInstance->writerThread_)
     {
-        // If in quiet mode, still print the error message to the standard error stream
+        logInstance->QueueOutput(formattedMessage, level, level == LOG_ERROR);
+        // Write errors out before returning, so that they survive an exit or crash that follows
         if (level == LOG_ERROR)
-            PrintUnicodeLine(formattedMessage, true);
+            logInstance->Flush();
     }
     else
-        PrintUnicodeLine(formattedMessage, level == LOG_ERROR);
-    #endif
-
-    if (logInstance->logFile_)
     {
-        logInstance->logFile_->WriteLine(formattedMessage);
-        logInstance->logFile_->Flush();
+        if (logInstance->quiet_)
+        {
+            // If in quiet mode, still print the error message to the standard error stream
+            if (level == LOG_ERROR)
+                PrintUnicodeLine(formattedMessage, true);
+        }
+        else
+            PrintUnicodeLine(formattedMessage, level == LOG_ERROR);
+
+        if (logInstance->logFile_)
+        {
+            logInstance->logFile_->WriteLine(formattedMessage);
+            logInstance->logFile_->Flush();
+        }
     }
+    #endif
 
     logInstance->inWrite_ = true;
 
@@ -221,21 +410,30 @@ void Log::WriteRaw(const String& message, bool error)
     #elif defined(IOS)
     SDL_IOS_LogMessage(message.CString());
     #else
-    if (logInstance->quiet_)
+    if (logInstance->writerThread_)
     {
-        // If in quiet mode, still print the error message to the standard error stream
+        logInstance->QueueOutput(message, LOG_RAW, error);
         if (error)
-            PrintUnicode(message, true);
+            logInstance->Flush();
     }
     else
-        PrintUnicode(message, error);
-    #endif
-
-    if (logInstance->logFile_)
     {
-        logInstance->logFile_->Write(message.CString(), message.Length());
-        logInstance->logFile_->Flush();
+        if (logInstance->quiet_)
+        {
+            // If in quiet mode, still print the error message to the standard error stream
+            if (error)
+                PrintUnicode(message, true);
+        }
+        else
+            PrintUnicode(message, error);
+
+        if (logInstance->logFile_)
+        {
+            logInstance->logFile_->Write(message.CString(), message.Length());
+            logInstance->logFile_->Flush();
+        }
     }
+    #endif
 
     logInstance->inWrite_ = true;
 
@@ -278,4 +476,45 @@ void Log::HandleEndFrame(StringHash eventType, VariantMap& eventData)
     }
 }
 
+void Log::QueueOutput(const String& message, int level, bool error)
+{
+    for (;;)
+    {
+        {
+            MutexLock lock(queueMutex_);
+            if (queueCount_ < queue_.Size())
+            {
+                StoredLogMessage& stored = queue_[(queueStart_ + queueCount_) % queue_.Size()];
+                stored.message_ = message;
+                stored.level_ = level;
+                stored.error_ = error;
+                ++queueCount_;
+                return;
+            }
+            
+            // Queue is full. Drop the message unless blocking is requested, but never drop errors
+            if (overflowMode_ == LOG_OVERFLOW_DROP && !error)
+            {
+                ++numDroppedMessages_;
+                return;
+            }
+        }
+        
+        // Wait for the writer thread to make space
+        Time::Sleep(0);
+    }
+}
+
+const String& Log::GetTimeStampPrefix()
+{
+    unsigned time = Time::GetTimeSinceEpoch();
+    if (time != timeStampTime_ || timeStampPrefix_.Empty())
+    {
+        timeStampPrefix_ = "[" + Time::GetTimeStamp() + "] ";
+        timeStampTime_ = time;
+    }
+    
+    return timeStampPrefix_;
+}
+
 }
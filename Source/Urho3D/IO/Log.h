@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Container/List.h"
+#include "../Container/Vector.h"
 #include "../Core/Mutex.h"
 #include "../Core/Object.h"
 #include "../Core/StringUtils.h"
@@ -43,7 +44,15 @@ static const int LOG_ERROR = 3;
 /// Disable all log messages.
 static const int LOG_NONE = 4;
 
+/// %Log writer thread queue overflow behavior.
+enum LogOverflowMode
+{
+    LOG_OVERFLOW_DROP = 0,
+    LOG_OVERFLOW_BLOCK
+};
+
 class File;
+class LogWriterThread;
 
 /// Stored log message from another thread.
 struct StoredLogMessage
@@ -90,6 +99,14 @@ public:
     void SetTimeStamp(bool enable);
     /// Set quiet mode ie. only print error entries to standard error stream (which is normally redirected to console also). Output to log file is not affected by this mode.
     void SetQuiet(bool quiet);
+    /// Set whether to write console and file output in a background thread. The log event is still sent immediately.
+    void SetAsync(bool enable);
+    /// Set the maximum number of messages waiting for the writer thread. Default 4096.
+    void SetQueueSize(unsigned size);
+    /// Set what to do when the writer thread queue is full. Error messages always wait for space. Default LOG_OVERFLOW_DROP.
+    void SetOverflowMode(LogOverflowMode mode);
+    /// Write out all messages waiting for the writer thread.
+    void Flush();
 
     /// Return logging level.
     int GetLevel() const { return level_; }
@@ -99,20 +116,63 @@ public:
     String GetLastMessage() const { return lastMessage_; }
     /// Return whether log is in quiet mode (only errors printed to standard error stream).
     bool IsQuiet() const { return quiet_; }
+    /// Return whether console and file output is written in a background thread.
+    bool IsAsync() const { return writerThread_.NotNull(); }
+    /// Return the maximum number of messages waiting for the writer thread.
+    unsigned GetQueueSize() const { return queue_.Size(); }
+    /// Return writer thread queue overflow behavior.
+    LogOverflowMode GetOverflowMode() const { return overflowMode_; }
+    /// Return number of messages dropped because the writer thread queue was full.
+    unsigned GetNumDroppedMessages() const { return numDroppedMessages_; }
 
     /// Write to the log. If logging level is higher than the level of the message, the message is ignored.
     static void Write(int level, const String& message);
     /// Write raw output to the log.
     static void WriteRaw(const String& message, bool error = false);
+    /// Return whether messages of the level would be logged. Checked by the logging macros before formatting the message.
+    static bool IsLevelEnabled(int level);
+    /// Write out all messages waiting for the writer thread of the log instance, if it exists. Called by ErrorExit() and at process exit.
+    static void FlushInstance();
+
+    /// Write out a batch of messages waiting for the writer thread. Return false if there was nothing to write. Called by the writer thread.
+    bool WriteQueuedMessages();
 
 private:
     /// Handle end of frame. Process the threaded log messages.
     void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+    /// Queue console and file output for the writer thread.
+    void QueueOutput(const String& message, int level, bool error);
+    /// Return the timestamp prefix, formatted at most once per second.
+    const String& GetTimeStampPrefix();
     
     /// Mutex for threaded operation.
     Mutex logMutex_;
     /// Log messages from other threads.
     List<StoredLogMessage> threadMessages_;
+    /// Mutex for the writer thread queue.
+    Mutex queueMutex_;
+    /// Mutex for console and file output when the writer thread is running.
+    Mutex outputMutex_;
+    /// Writer thread queue as a ring buffer.
+    Vector<StoredLogMessage> queue_;
+    /// Batch of messages being written out.
+    Vector<StoredLogMessage> writeBatch_;
+    /// File output of the batch being written out.
+    String writeBuffer_;
+    /// Writer thread.
+    SharedPtr<LogWriterThread> writerThread_;
+    /// Index of the oldest queued message.
+    unsigned queueStart_;
+    /// Number of queued messages.
+    unsigned queueCount_;
+    /// Number of messages dropped due to a full queue.
+    unsigned numDroppedMessages_;
+    /// Writer thread queue overflow behavior.
+    LogOverflowMode overflowMode_;
+    /// Formatted timestamp prefix.
+    String timeStampPrefix_;
+    /// Time in seconds when the timestamp prefix was formatted.
+    unsigned timeStampTime_;
     /// Log file.
     SharedPtr<File> logFile_;
     /// Last log message.
@@ -128,17 +188,19 @@ private:
 };
 
 #ifdef URHO3D_LOGGING
-#define LOGDEBUG(message) Urho3D::Log::Write(Urho3D::LOG_DEBUG, message)
-#define LOGINFO(message) Urho3D::Log::Write(Urho3D::LOG_INFO, message)
-#define LOGWARNING(message) Urho3D::Log::Write(Urho3D::LOG_WARNING, message)
-#define LOGERROR(message) Urho3D::Log::Write(Urho3D::LOG_ERROR, message)
+#define LOGLEVEL(level, message) do { if (Urho3D::Log::IsLevelEnabled(level)) Urho3D::Log::Write(level, message); } while (false)
+#define LOGDEBUG(message) LOGLEVEL(Urho3D::LOG_DEBUG, message)
+#define LOGINFO(message) LOGLEVEL(Urho3D::LOG_INFO, message)
+#define LOGWARNING(message) LOGLEVEL(Urho3D::LOG_WARNING, message)
+#define LOGERROR(message) LOGLEVEL(Urho3D::LOG_ERROR, message)
 #define LOGRAW(message) Urho3D::Log::WriteRaw(message)
-#define LOGDEBUGF(format, ...) Urho3D::Log::Write(Urho3D::LOG_DEBUG, Urho3D::ToString(format, ##__VA_ARGS__))
-#define LOGINFOF(format, ...) Urho3D::Log::Write(Urho3D::LOG_INFO, Urho3D::ToString(format, ##__VA_ARGS__))
-#define LOGWARNINGF(format, ...) Urho3D::Log::Write(Urho3D::LOG_WARNING, Urho3D::ToString(format, ##__VA_ARGS__))
-#define LOGERRORF(format, ...) Urho3D::Log::Write(Urho3D::LOG_ERROR, Urho3D::ToString(format, ##__VA_ARGS__))
+#define LOGDEBUGF(format, ...) LOGLEVEL(Urho3D::LOG_DEBUG, Urho3D::ToString(format, ##__VA_ARGS__))
+#define LOGINFOF(format, ...) LOGLEVEL(Urho3D::LOG_INFO, Urho3D::ToString(format, ##__VA_ARGS__))
+#define LOGWARNINGF(format, ...) LOGLEVEL(Urho3D::LOG_WARNING, Urho3D::ToString(format, ##__VA_ARGS__))
+#define LOGERRORF(format, ...) LOGLEVEL(Urho3D::LOG_ERROR, Urho3D::ToString(format, ##__VA_ARGS__))
 #define LOGRAWF(format, ...) Urho3D::Log::WriteRaw(Urho3D::ToString(format, ##__VA_ARGS__))
 #else
+#define LOGLEVEL(level, message)
 #define LOGDEBUG(message)
 #define LOGINFO(message)
 #define LOGWARNING(message)
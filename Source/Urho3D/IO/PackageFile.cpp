@@ -21,17 +21,96 @@
 //
 
 #include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
 
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace Urho3D
 {
 
+PackageMapping::PackageMapping(unsigned char* data, unsigned size) :
+    data_(data),
+    size_(size),
+    refs_(1)
+{
+}
+
+PackageMapping::~PackageMapping()
+{
+    #ifdef WIN32
+    UnmapViewOfFile(data_);
+    #else
+    munmap(data_, size_);
+    #endif
+}
+
+PackageMapping* PackageMapping::Create(const String& fileName, unsigned size)
+{
+    unsigned char* data = 0;
+    
+    // The file and mapping handles are not needed after the view has been mapped
+    #ifdef WIN32
+    HANDLE fileHandle = CreateFileW(GetWideNativePath(fileName).CString(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, 0);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+    {
+        HANDLE mappingHandle = CreateFileMappingW(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+        if (mappingHandle)
+        {
+            data = (unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mappingHandle);
+        }
+        CloseHandle(fileHandle);
+    }
+    #else
+    int fd = open(GetNativePath(fileName).CString(), O_RDONLY);
+    if (fd >= 0)
+    {
+        void* mapped = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED)
+            data = (unsigned char*)mapped;
+        close(fd);
+    }
+    #endif
+    
+    return data ? new PackageMapping(data, size) : 0;
+}
+
+void PackageMapping::AddRef()
+{
+    #ifdef WIN32
+    InterlockedIncrement(&refs_);
+    #else
+    __sync_fetch_and_add(&refs_, 1);
+    #endif
+}
+
+void PackageMapping::ReleaseRef()
+{
+    #ifdef WIN32
+    bool last = InterlockedDecrement(&refs_) == 0;
+    #else
+    bool last = __sync_sub_and_fetch(&refs_, 1) == 0;
+    #endif
+    if (last)
+        delete this;
+}
+
 PackageFile::PackageFile(Context* context) :
     Object(context),
     totalSize_(0),
     checksum_(0),
-    compressed_(false)
+    mapping_(0),
+    compressed_(false),
+    blockIndexed_(false)
 {
 }
 
@@ -39,13 +118,16 @@ PackageFile::PackageFile(Context* context, const String& fileName, unsigned star
     Object(context),
     totalSize_(0),
     checksum_(0),
-    compressed_(false)
+    mapping_(0),
+    compressed_(false),
+    blockIndexed_(false)
 {
     Open(fileName, startOffset);
 }
 
 PackageFile::~PackageFile()
 {
+    SetMemoryMapped(false);
 }
 
 bool PackageFile::Open(const String& fileName, unsigned startOffset)
@@ -62,10 +144,12 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     if (!file->IsOpen())
         return false;
     
+    SetMemoryMapped(false);
+    
     // Check ID, then read the directory
     file->Seek(startOffset);
     String id = file->ReadFileID();
-    if (id != "UPAK" && id != "ULZ4")
+    if (id != "UPAK" && id != "ULZ4" && id != "ULZB")
     {
         // If start offset has not been explicitly specified, also try to read package size from the end of file
         // to know how much we must rewind to find the package start
@@ -82,7 +166,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             }
         }
         
-        if (id != "UPAK" && id != "ULZ4")
+        if (id != "UPAK" && id != "ULZ4" && id != "ULZB")
         {
             LOGERROR(fileName + " is not a valid package file");
             return false;
@@ -92,7 +176,8 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     fileName_ = fileName;
     nameHash_ = fileName_;
     totalSize_ = file->GetSize();
-    compressed_ = id == "ULZ4";
+    compressed_ = id == "ULZ4" || id == "ULZB";
+    blockIndexed_ = id == "ULZB";
     
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
@@ -113,6 +198,40 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     return true;
 }
 
+bool PackageFile::SetMemoryMapped(bool enable)
+{
+    if (enable == (mapping_ != 0))
+        return true;
+    
+    // Files still open from the mapping hold their own references, so it stays valid until they are closed
+    if (!enable)
+    {
+        mapping_->ReleaseRef();
+        mapping_ = 0;
+        return true;
+    }
+    
+    if (fileName_.Empty() || !totalSize_)
+    {
+        LOGERROR("Package file not open, can not memory-map");
+        return false;
+    }
+    if (compressed_)
+    {
+        LOGERROR("Can not memory-map compressed package file " + fileName_);
+        return false;
+    }
+    
+    mapping_ = PackageMapping::Create(fileName_, totalSize_);
+    if (!mapping_)
+    {
+        LOGERROR("Could not memory-map package file " + fileName_);
+        return false;
+    }
+    
+    return true;
+}
+
 bool PackageFile::Exists(const String& fileName) const
 {
     return entries_.Find(fileName.ToLower()) != entries_.End();
@@ -38,6 +38,43 @@ struct PackageEntry
     unsigned checksum_;
 };
 
+/// Memory mapping of a package file. Every open file reading from the mapping holds a reference, and the mapping is removed when the last reference is released. The reference count is atomic, as files may be opened and closed from several threads at once.
+class URHO3D_API PackageMapping
+{
+public:
+    /// Map a file. The mapping starts with one reference. Return null if mapping failed.
+    static PackageMapping* Create(const String& fileName, unsigned size);
+    
+    /// Add a reference.
+    void AddRef();
+    /// Release a reference. Destroys the mapping when the last reference is released.
+    void ReleaseRef();
+    
+    /// Return the mapped file data.
+    const unsigned char* GetData() const { return data_; }
+    /// Return the mapped size.
+    unsigned GetSize() const { return size_; }
+    /// Return number of references.
+    unsigned Refs() const { return (unsigned)refs_; }
+    
+private:
+    /// Construct from mapped data.
+    PackageMapping(unsigned char* data, unsigned size);
+    /// Destruct. Unmap the file.
+    ~PackageMapping();
+    /// Prevent copy construction.
+    PackageMapping(const PackageMapping& rhs);
+    /// Prevent assignment.
+    PackageMapping& operator = (const PackageMapping& rhs);
+    
+    /// Mapped file data.
+    unsigned char* data_;
+    /// Mapped size.
+    unsigned size_;
+    /// Reference count. Modified atomically.
+    volatile long refs_;
+};
+
 /// Stores files of a directory tree sequentially for convenient access.
 class URHO3D_API PackageFile : public Object
 {
@@ -53,6 +90,8 @@ public:
     
     /// Open the package file. Return true if successful.
     bool Open(const String& fileName, unsigned startOffset = 0);
+    /// Set whether to memory-map the package file. Files within a mapped package are read directly from the mapping, and can be parsed in place by resources. Only uncompressed packages can be mapped. Files still open from the mapping keep it alive after it is disabled or the package is destroyed. Return true if successful.
+    bool SetMemoryMapped(bool enable);
     /// Check if a file exists within the package file.
     bool Exists(const String& fileName) const;
     /// Return the file entry corresponding to the name, or null if not found.
@@ -71,6 +110,14 @@ public:
     unsigned GetChecksum() const { return checksum_; }
     /// Return whether the files are compressed.
     bool IsCompressed() const { return compressed_; }
+    /// Return whether the compressed files have a block index, which allows random access and parallel decompression.
+    bool HasBlockIndex() const { return blockIndexed_; }
+    /// Return whether the package file is memory-mapped.
+    bool IsMemoryMapped() const { return mapping_ != 0; }
+    /// Return the memory mapping, or null if not mapped.
+    PackageMapping* GetMapping() const { return mapping_; }
+    /// Return the memory-mapped package file data, or null if not mapped.
+    const unsigned char* GetMappedData() const { return mapping_ ? mapping_->GetData() : 0; }
     /// Return list of entry names
     const Vector<String> GetEntryNames() const { return entries_.Keys(); }
     
@@ -85,8 +132,12 @@ private:
     unsigned totalSize_;
     /// Package file checksum.
     unsigned checksum_;
+    /// Memory mapping. The package holds one reference while mapped.
+    PackageMapping* mapping_;
     /// Compressed flag.
     bool compressed_;
+    /// Compressed block index flag.
+    bool blockIndexed_;
 };
 
 }
@@ -79,6 +79,7 @@ bool LuaFunction::BeginCall(const LuaScriptInstance* instance)
 
 bool LuaFunction::EndCall(int numReturns)
 {
+    MEMORY_TAG(MT_SCRIPT);
     if (lua_pcall(luaState_, numArguments_, numReturns, 0) != 0)
     {
         const char* message = lua_tostring(luaState_, -1);
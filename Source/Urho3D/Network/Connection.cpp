@@ -24,6 +24,7 @@
 #include "../Network/Connection.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
+#include "../Scene/InterpolatedTransform.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
 #include "../Network/Network.h"
@@ -36,8 +37,11 @@
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 #include "../Scene/SmoothedTransform.h"
+#include "../Container/Sort.h"
+#include "../Core/Timer.h"
 
 #include <kNet/kNet.h>
+#include <kNet/UDPMessageConnection.h>
 
 #include "../DebugNew.h"
 
@@ -45,6 +49,77 @@ namespace Urho3D
 {
 
 static const int STATS_INTERVAL_MSEC = 2000;
+/// Maximum distance in snapshots from the base snapshot of a delta encoded latest data update.
+static const unsigned MAX_SNAPSHOT_BASE_OFFSET = 255;
+/// Maximum size of the latest data in one snapshot message. Keeps the message within one UDP datagram, as kNet sends messages that need fragmenting reliably.
+static const unsigned MAX_SNAPSHOT_DATA_SIZE = 1200;
+/// Maximum number of snapshots sent during one update. Keeps the previous update's snapshots within the 32 covered by the acknowledgement bitmask, so that they can be used as delta bases.
+static const unsigned MAX_SNAPSHOT_PARTS = 16;
+
+/// Return the world transform of a node without updating the cached transform, as other connections may be querying it concurrently. Uses the same calculation as Node::UpdateWorldTransform(), so that the result is identical.
+static Matrix3x4 GetWorldTransformNoUpdate(const Node* node)
+{
+    if (!node->IsDirty())
+        return node->GetWorldTransform();
+    
+    Node* parent = node->GetParent();
+    if (parent == node->GetScene() || !parent)
+        return node->GetTransform();
+    else
+        return GetWorldTransformNoUpdate(parent) * node->GetTransform();
+}
+
+/// Compare pending new nodes for sending the nearest first.
+static bool ComparePendingNodes(const PendingNode& lhs, const PendingNode& rhs)
+{
+    return lhs.distanceSquared_ < rhs.distanceSquared_;
+}
+
+/// Write a latest data update XOR encoded against a base update. For each group of 8 bytes, write a bitmask of the changed bytes followed by the changed bytes XORed with the base. Bytes beyond the end of the base are compared against zero.
+static void WriteDeltaData(Serializer& dest, const unsigned char* data, unsigned size, const PODVector<unsigned char>& base)
+{
+    unsigned baseSize = base.Size();
+    
+    for (unsigned start = 0; start < size; start += 8)
+    {
+        unsigned end = Min((int)(start + 8), (int)size);
+        unsigned char delta[8];
+        unsigned char mask = 0;
+        unsigned numChanged = 0;
+        
+        for (unsigned i = start; i < end; ++i)
+        {
+            unsigned char xorByte = data[i] ^ (i < baseSize ? base[i] : 0);
+            if (xorByte)
+            {
+                mask |= 1 << (i - start);
+                delta[numChanged++] = xorByte;
+            }
+        }
+        
+        dest.WriteUByte(mask);
+        dest.Write(delta, numChanged);
+    }
+}
+
+/// Read a latest data update written by WriteDeltaData() into a buffer of the same size.
+static void ReadDeltaData(Deserializer& source, unsigned char* data, unsigned size, const PODVector<unsigned char>& base)
+{
+    unsigned baseSize = base.Size();
+    
+    for (unsigned start = 0; start < size; start += 8)
+    {
+        unsigned end = Min((int)(start + 8), (int)size);
+        unsigned char mask = source.ReadUByte();
+        
+        for (unsigned i = start; i < end; ++i)
+        {
+            data[i] = i < baseSize ? base[i] : 0;
+            if (mask & (1 << (i - start)))
+                data[i] ^= source.ReadUByte();
+        }
+    }
+}
 
 PackageDownload::PackageDownload() :
     totalFragments_(0),
@@ -63,11 +138,26 @@ Connection::Connection(Context* context, bool isClient, kNet::SharedPtr<kNet::Me
     Object(context),
     timeStamp_(0),
     connection_(connection),
+    interestGrid_(0),
+    resentMessagesBase_(0),
     sendMode_(OPSM_NONE),
+    snapshotID_(0),
+    ackedSnapshotID_(0),
+    ackedSnapshotMask_(0),
+    numSnapshotNodes_(0),
+    numSnapshotComponents_(0),
+    numSnapshotParts_(0),
+    newNodeBytes_(0),
+    serverTime_(0),
+    serverTimeBase_(0),
     isClient_(isClient),
     connectPending_(false),
     sceneLoaded_(false),
-    logStatistics_(false)
+    logStatistics_(false),
+    interestManaged_(false),
+    deltaSnapshots_(false),
+    snapshotAckPending_(false),
+    serverTimeBaseValid_(false)
 {
     sceneState_.connection_ = this;
     
@@ -121,6 +211,7 @@ void Connection::SendMessage(int msgID, bool reliable, bool inOrder, const unsig
         memcpy(msg->data, data, numBytes);
     
     connection_->EndAndQueueMessage(msg);
+    statistics_.sentMessages_[msgID].Add(numBytes);
 }
 
 void Connection::SendRemoteEvent(StringHash eventType, bool inOrder, const VariantMap& eventData)
@@ -177,6 +268,8 @@ void Connection::SetScene(Scene* newScene)
     if (isClient_)
     {
         sceneState_.Clear();
+        relevantGroups_.Clear();
+        interestManaged_ = false;
         
         // When scene is assigned on the server, instruct the client to load it. This may require downloading packages
         const Vector<SharedPtr<PackageFile> >& packages = scene_->GetRequiredPackageFiles();
@@ -235,6 +328,12 @@ void Connection::SetLogStatistics(bool enable)
     logStatistics_ = enable;
 }
 
+void Connection::ResetStatistics()
+{
+    statistics_.Reset();
+    resentMessagesBase_ = GetNumResentMessages();
+}
+
 void Connection::Disconnect(int waitMSec)
 {
     connection_->Disconnect(waitMSec);
@@ -245,6 +344,36 @@ void Connection::SendServerUpdate()
     if (!scene_ || !sceneLoaded_)
         return;
     
+    // Find out which node hierarchies entered or left the area of interest
+    interestGrid_ = GetSubsystem<Network>()->GetInterestGrid(scene_);
+    if (interestGrid_)
+        UpdateInterest();
+    else if (interestManaged_)
+    {
+        // Interest management has been disabled: check all replicated nodes to send the ones that were left out
+        PODVector<Node*> nodes;
+        scene_->GetChildren(nodes, true);
+        for (PODVector<Node*>::ConstIterator i = nodes.Begin(); i != nodes.End(); ++i)
+        {
+            if ((*i)->GetID() < FIRST_LOCAL_ID)
+                sceneState_.dirtyNodes_.Insert((*i)->GetID());
+        }
+        relevantGroups_.Clear();
+        interestManaged_ = false;
+    }
+    
+    // The server time is sent in each snapshot, and in each latest data message when the scene uses interpolation, so that
+    // the client can stamp the updates even if they are lost or arrive out of order
+    serverTime_ = Time::GetSystemTime();
+    
+    // Start a new snapshot for the latest data if enabled
+    deltaSnapshots_ = GetSubsystem<Network>()->GetDeltaSnapshots();
+    if (deltaSnapshots_)
+    {
+        numSnapshotParts_ = 0;
+        BeginSnapshot();
+    }
+    
     // Always check the root node (scene) first so that the scene-wide components get sent first,
     // and all other replicated nodes get added to the dirty set for sending the initial state
     unsigned sceneID = scene_->GetID();
@@ -255,11 +384,23 @@ void Connection::SendServerUpdate()
     nodesToProcess_.Insert(sceneState_.dirtyNodes_);
     nodesToProcess_.Erase(sceneID); // Do not process the root node twice
     
-    while (nodesToProcess_.Size())
+    unsigned budget = GetSubsystem<Network>()->GetInitialReplicationBudget();
+    if (budget)
+        ProcessNodesWithBudget(budget);
+    else
     {
-        unsigned nodeID = nodesToProcess_.Front();
-        ProcessNode(nodeID);
+        while (nodesToProcess_.Size())
+        {
+            unsigned nodeID = nodesToProcess_.Front();
+            ProcessNode(nodeID);
+        }
     }
+    
+    // Send the remaining latest data. Full snapshots have already been sent during processing
+    if (deltaSnapshots_)
+        SendSnapshot();
+    
+    interestGrid_ = 0;
 }
 
 void Connection::SendClientUpdate()
@@ -278,12 +419,27 @@ void Connection::SendClientUpdate()
     if (sendMode_ >= OPSM_POSITION_ROTATION)
         msg_.WritePackedQuaternion(rotation_);
     SendMessage(MSG_CONTROLS, false, false, msg_, CONTROLS_CONTENT_ID);
+    
+    // Acknowledge the snapshots received since the last update. The bitmask repeats the earlier acknowledgements in case
+    // they were lost
+    if (snapshotAckPending_)
+    {
+        msg_.Clear();
+        msg_.WriteUInt(ackedSnapshotID_);
+        msg_.WriteUInt(ackedSnapshotMask_);
+        SendMessage(MSG_SNAPSHOTACK, false, false, msg_);
+        snapshotAckPending_ = false;
+    }
 
     ++timeStamp_;
 }
 
 void Connection::SendRemoteEvents()
 {
+    // Sample the round trip time and resends once per network update
+    statistics_.AddRoundTripTime(connection_->RoundTripTime());
+    statistics_.resentMessages_ = GetNumResentMessages() - resentMessagesBase_;
+    
     #ifdef URHO3D_LOGGING
     if (logStatistics_ && statsTimer_.GetMSec(false) > STATS_INTERVAL_MSEC)
     {
@@ -292,6 +448,7 @@ void Connection::SendRemoteEvents()
         sprintf(statsBuffer, "RTT %.3f ms Pkt in %d Pkt out %d Data in %.3f KB/s Data out %.3f KB/s", connection_->RoundTripTime(), (int)connection_->PacketsInPerSec(),
             (int)connection_->PacketsOutPerSec(), connection_->BytesInPerSec() / 1000.0f, connection_->BytesOutPerSec() / 1000.0f);
         LOGINFO(statsBuffer);
+        LOGINFO(GetStatisticsText());
     }
     #endif
     
@@ -360,7 +517,6 @@ void Connection::ProcessPendingLatestData()
         if (node)
         {
             MemoryBuffer msg(current->second_);
-            msg.ReadNetID(); // Skip the node ID
             node->ReadLatestDataUpdate(msg);
             // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
             // Furthermore it would propagate to components and child nodes, which is not desired in this case
@@ -376,7 +532,6 @@ void Connection::ProcessPendingLatestData()
         if (component)
         {
             MemoryBuffer msg(current->second_);
-            msg.ReadNetID(); // Skip the component ID
             if (component->ReadLatestDataUpdate(msg))
                 component->ApplyAttributes();
             componentLatestData_.Erase(current);
@@ -386,6 +541,8 @@ void Connection::ProcessPendingLatestData()
 
 bool Connection::ProcessMessage(int msgID, MemoryBuffer &msg)
 {
+    statistics_.receivedMessages_[msgID].Add(msg.GetSize());
+    
     bool processed = true;
     
     switch (msgID)
@@ -418,10 +575,12 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer &msg)
         case MSG_CREATENODE:
         case MSG_NODEDELTAUPDATE:
         case MSG_NODELATESTDATA:
+        case MSG_TIMEDNODELATESTDATA:
         case MSG_REMOVENODE:
         case MSG_CREATECOMPONENT:
         case MSG_COMPONENTDELTAUPDATE:
         case MSG_COMPONENTLATESTDATA:
+        case MSG_TIMEDCOMPONENTLATESTDATA:
         case MSG_REMOVECOMPONENT:
             ProcessSceneUpdate(msgID, msg);
             break;
@@ -435,6 +594,14 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer &msg)
             ProcessPackageInfo(msgID, msg);
             break;
             
+        case MSG_SNAPSHOT:
+            ProcessSnapshot(msgID, msg);
+            break;
+            
+        case MSG_SNAPSHOTACK:
+            ProcessSnapshotAck(msgID, msg);
+            break;
+            
         default:
             processed = false;
             break;
@@ -463,7 +630,10 @@ void Connection::ProcessLoadScene(int msgID, MemoryBuffer& msg)
     // Clear previous pending latest data and package downloads if any
     nodeLatestData_.Clear();
     componentLatestData_.Clear();
+    nodeSnapshots_.Clear();
+    componentSnapshots_.Clear();
     downloads_.Clear();
+    serverTimeBaseValid_ = false;
     
     // In case we have joined other scenes in this session, remove first all downloaded package files from the resource system
     // to prevent resource conflicts
@@ -527,15 +697,21 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             {
                 // Add initially to the root level. May be moved as we receive the parent attribute
                 node = scene_->CreateChild(nodeID, REPLICATED);
-                // Create smoothed transform component
-                node->CreateComponent<SmoothedTransform>(LOCAL);
+                // Create interpolated or smoothed transform component as chosen by the scene
+                if (scene_->GetInterpolation())
+                    node->CreateComponent<InterpolatedTransform>(LOCAL);
+                else
+                    node->CreateComponent<SmoothedTransform>(LOCAL);
             }
             
-            // Read initial attributes, then snap the motion smoothing immediately to the end
+            // Read initial attributes, then snap the motion smoothing or interpolation immediately to the end
             node->ReadDeltaUpdate(msg);
             SmoothedTransform* transform = node->GetComponent<SmoothedTransform>();
             if (transform)
                 transform->Update(1.0f, 0.0f);
+            InterpolatedTransform* interpolated = node->GetComponent<InterpolatedTransform>();
+            if (interpolated)
+                interpolated->Update(interpolated->GetNewestTime(), 0.0f, 0.0f);
             
             // Read initial user variables
             unsigned numVars = msg.ReadVLE();
@@ -601,8 +777,11 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
         break;
         
     case MSG_NODELATESTDATA:
+    case MSG_TIMEDNODELATESTDATA:
         {
             unsigned nodeID = msg.ReadNetID();
+            if (msgID == MSG_TIMEDNODELATESTDATA)
+                ApplyServerTime(msg.ReadUInt());
             Node* node = scene_->GetNode(nodeID);
             if (node)
             {
@@ -612,10 +791,12 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             }
             else
             {
-                // Latest data messages may be received out-of-order relative to node creation, so cache if necessary
+                // Latest data messages may be received out-of-order relative to node creation, so cache if necessary.
+                // Only the update itself is cached, without the ID and the optional server time
                 PODVector<unsigned char>& data = nodeLatestData_[nodeID];
-                data.Resize(msg.GetSize());
-                memcpy(&data[0], msg.GetData(), msg.GetSize());
+                data.Resize(msg.GetSize() - msg.GetPosition());
+                if (data.Size())
+                    memcpy(&data[0], msg.GetData() + msg.GetPosition(), data.Size());
             }
         }
         break;
@@ -625,8 +806,22 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             unsigned nodeID = msg.ReadNetID();
             Node* node = scene_->GetNode(nodeID);
             if (node)
+            {
+                // The child nodes are removed along with the node, so forget their snapshots too
+                PODVector<Node*> nodes;
+                node->GetChildren(nodes, true);
+                nodes.Push(node);
+                for (unsigned i = 0; i < nodes.Size(); ++i)
+                {
+                    const Vector<SharedPtr<Component> >& components = nodes[i]->GetComponents();
+                    for (unsigned j = 0; j < components.Size(); ++j)
+                        componentSnapshots_.Erase(components[j]->GetID());
+                    nodeSnapshots_.Erase(nodes[i]->GetID());
+                }
                 node->Remove();
+            }
             nodeLatestData_.Erase(nodeID);
+            nodeSnapshots_.Erase(nodeID);
         }
         break;
         
@@ -679,8 +874,11 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
         break;
         
     case MSG_COMPONENTLATESTDATA:
+    case MSG_TIMEDCOMPONENTLATESTDATA:
         {
             unsigned componentID = msg.ReadNetID();
+            if (msgID == MSG_TIMEDCOMPONENTLATESTDATA)
+                ApplyServerTime(msg.ReadUInt());
             Component* component = scene_->GetComponent(componentID);
             if (component)
             {
@@ -689,10 +887,12 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             }
             else
             {
-                // Latest data messages may be received out-of-order relative to component creation, so cache if necessary
+                // Latest data messages may be received out-of-order relative to component creation, so cache if necessary.
+                // Only the update itself is cached, without the ID and the optional server time
                 PODVector<unsigned char>& data = componentLatestData_[componentID];
-                data.Resize(msg.GetSize());
-                memcpy(&data[0], msg.GetData(), msg.GetSize());
+                data.Resize(msg.GetSize() - msg.GetPosition());
+                if (data.Size())
+                    memcpy(&data[0], msg.GetData() + msg.GetPosition(), data.Size());
             }
         }
         break;
@@ -704,6 +904,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             if (component)
                 component->Remove();
             componentLatestData_.Erase(componentID);
+            componentSnapshots_.Erase(componentID);
         }
         break;
     }
@@ -972,6 +1173,90 @@ void Connection::ProcessRemoteEvent(int msgID, MemoryBuffer& msg)
     }
 }
 
+void Connection::ProcessSnapshot(int msgID, MemoryBuffer& msg)
+{
+    if (IsClient())
+    {
+        LOGWARNING("Received unexpected Snapshot message from client " + ToString());
+        return;
+    }
+    
+    if (!scene_)
+        return;
+    
+    // Discard snapshots received out of order. They are not acknowledged, so the server will not encode against them
+    unsigned snapshotID = msg.ReadUInt();
+    unsigned offset = snapshotID - ackedSnapshotID_;
+    if (ackedSnapshotID_ && (int)offset <= 0)
+        return;
+    
+    if (!ackedSnapshotID_ || offset > 32)
+        ackedSnapshotMask_ = 0;
+    else if (offset == 32)
+        ackedSnapshotMask_ = 1U << 31;
+    else
+        ackedSnapshotMask_ = (ackedSnapshotMask_ << offset) | (1U << (offset - 1));
+    ackedSnapshotID_ = snapshotID;
+    snapshotAckPending_ = true;
+    
+    // Stamp the updates with the server time of the snapshot, then decode and apply them like the ordinary latest data
+    // messages
+    ApplyServerTime(msg.ReadUInt());
+    unsigned numNodes = msg.ReadVLE();
+    while (numNodes-- && !msg.IsEof())
+    {
+        unsigned nodeID = msg.ReadNetID();
+        if (ReadSnapshotLatestData(msg, nodeID, nodeSnapshots_[nodeID]))
+        {
+            MemoryBuffer update(snapshotData_.GetData(), snapshotData_.GetSize());
+            ProcessSceneUpdate(MSG_NODELATESTDATA, update);
+        }
+    }
+    
+    unsigned numComponents = msg.ReadVLE();
+    while (numComponents-- && !msg.IsEof())
+    {
+        unsigned componentID = msg.ReadNetID();
+        if (ReadSnapshotLatestData(msg, componentID, componentSnapshots_[componentID]))
+        {
+            MemoryBuffer update(snapshotData_.GetData(), snapshotData_.GetSize());
+            ProcessSceneUpdate(MSG_COMPONENTLATESTDATA, update);
+        }
+    }
+}
+
+void Connection::ApplyServerTime(unsigned serverTime)
+{
+    // Measure the time from the first update after loading the scene, so that it stays accurate as a float
+    if (!serverTimeBaseValid_)
+    {
+        serverTimeBase_ = serverTime;
+        serverTimeBaseValid_ = true;
+    }
+    
+    // The update has been underway for half the round trip time. Compute the difference as signed, as an update arriving
+    // out of order may be older than the base
+    scene_->SetServerTime((int)(serverTime - serverTimeBase_) * 0.001f, GetRoundTripTime() * 0.0005f);
+}
+
+void Connection::ProcessSnapshotAck(int msgID, MemoryBuffer& msg)
+{
+    if (!IsClient())
+    {
+        LOGWARNING("Received unexpected SnapshotAck message from server");
+        return;
+    }
+    
+    // The client includes all earlier acknowledgements in the bitmask, so an older acknowledgement adds nothing new
+    unsigned snapshotID = msg.ReadUInt();
+    unsigned mask = msg.ReadUInt();
+    if (!ackedSnapshotID_ || (int)(snapshotID - ackedSnapshotID_) > 0)
+    {
+        ackedSnapshotID_ = snapshotID;
+        ackedSnapshotMask_ = mask;
+    }
+}
+
 kNet::MessageConnection* Connection::GetMessageConnection() const
 {
     return const_cast<kNet::MessageConnection*>(connection_.ptr());
@@ -1017,6 +1302,46 @@ float Connection::GetDownloadProgress() const
     return 1.0f;
 }
 
+float Connection::GetRoundTripTime() const
+{
+    return connection_->RoundTripTime();
+}
+
+float Connection::GetBytesInPerSec() const
+{
+    return connection_->BytesInPerSec();
+}
+
+float Connection::GetBytesOutPerSec() const
+{
+    return connection_->BytesOutPerSec();
+}
+
+int Connection::GetPacketsInPerSec() const
+{
+    return (int)connection_->PacketsInPerSec();
+}
+
+int Connection::GetPacketsOutPerSec() const
+{
+    return (int)connection_->PacketsOutPerSec();
+}
+
+unsigned long long Connection::GetBytesInTotal() const
+{
+    return connection_->BytesInTotal();
+}
+
+unsigned long long Connection::GetBytesOutTotal() const
+{
+    return connection_->BytesOutTotal();
+}
+
+String Connection::GetStatisticsText() const
+{
+    return statistics_.ToString(context_);
+}
+
 void Connection::SendPackageToClient(PackageFile* package)
 {
     if (!scene_)
@@ -1068,6 +1393,13 @@ void Connection::ProcessNode(unsigned nodeID)
     if (!nodesToProcess_.Erase(nodeID))
         return;
     
+    // Skip nodes outside the area of interest, and remove them from the client if they have been sent
+    if (interestGrid_ && !IsRelevant(nodeID))
+    {
+        RemoveIrrelevantNode(nodeID);
+        return;
+    }
+    
     // Find replication state for the node
     HashMap<unsigned, NodeReplicationState>::Iterator i = sceneState_.nodeStates_.Find(nodeID);
     if (i != sceneState_.nodeStates_.End())
@@ -1102,6 +1434,47 @@ void Connection::ProcessNode(unsigned nodeID)
     }
 }
 
+void Connection::ProcessNodesWithBudget(unsigned budget)
+{
+    // Separate the new nodes from the nodes the client already has. Irrelevant nodes are processed with the latter,
+    // which only stops tracking them
+    existingNodes_.Clear();
+    pendingNodes_.Clear();
+    for (HashSet<unsigned>::ConstIterator i = nodesToProcess_.Begin(); i != nodesToProcess_.End(); ++i)
+    {
+        unsigned nodeID = *i;
+        Node* node = sceneState_.nodeStates_.Contains(nodeID) ? 0 : scene_->GetNode(nodeID);
+        if (node && (!interestGrid_ || IsRelevant(nodeID)))
+        {
+            PendingNode pending;
+            pending.nodeID_ = nodeID;
+            pending.distanceSquared_ = node->GetOwner() == this ? 0.0f :
+                (GetWorldTransformNoUpdate(node).Translation() - position_).LengthSquared();
+            pendingNodes_.Push(pending);
+        }
+        else
+            existingNodes_.Push(nodeID);
+    }
+    
+    // Updates and removals are not limited. They may also send new nodes they depend on
+    newNodeBytes_ = 0;
+    for (unsigned i = 0; i < existingNodes_.Size(); ++i)
+        ProcessNode(existingNodes_[i]);
+    
+    // Then send the new nodes nearest first. Always send at least one to make progress. A node may already have been
+    // sent as a dependency, in which case ProcessNode() does nothing
+    Sort(pendingNodes_.Begin(), pendingNodes_.End(), ComparePendingNodes);
+    for (unsigned i = 0; i < pendingNodes_.Size(); ++i)
+    {
+        if (i && newNodeBytes_ >= budget)
+            break;
+        ProcessNode(pendingNodes_[i].nodeID_);
+    }
+    
+    // The nodes that were not sent remain dirty for the following updates
+    nodesToProcess_.Clear();
+}
+
 void Connection::ProcessNewNode(Node* node)
 {
     // Process depended upon nodes first, if they are dirty
@@ -1120,7 +1493,10 @@ void Connection::ProcessNewNode(Node* node)
     nodeState.connection_ = this;
     nodeState.sceneState_ = &sceneState_;
     nodeState.node_ = node;
-    node->AddReplicationState(&nodeState);
+    {
+        MutexLock lock(GetSubsystem<Network>()->GetReplicationMutex());
+        node->AddReplicationState(&nodeState);
+    }
     
     // Write node's attributes
     node->WriteInitialDeltaUpdate(msg_, timeStamp_);
@@ -1133,6 +1509,7 @@ void Connection::ProcessNewNode(Node* node)
         msg_.WriteStringHash(i->first_);
         msg_.WriteVariant(i->second_);
     }
+    AddReplicationTraffic(statistics_.initialUpdates_, node->GetType(), msg_.GetSize());
     
     // Write node's components
     msg_.WriteVLE(node->GetNumNetworkComponents());
@@ -1148,13 +1525,19 @@ void Connection::ProcessNewNode(Node* node)
         componentState.connection_ = this;
         componentState.nodeState_ = &nodeState;
         componentState.component_ = component;
-        component->AddReplicationState(&componentState);
+        {
+            MutexLock lock(GetSubsystem<Network>()->GetReplicationMutex());
+            component->AddReplicationState(&componentState);
+        }
         
+        unsigned start = msg_.GetSize();
         msg_.WriteStringHash(component->GetType());
         msg_.WriteNetID(component->GetID());
         component->WriteInitialDeltaUpdate(msg_, timeStamp_);
+        AddReplicationTraffic(statistics_.initialUpdates_, component->GetType(), msg_.GetSize() - start);
     }
     
+    newNodeBytes_ += msg_.GetSize();
     SendMessage(MSG_CREATENODE, true, true, msg_);
     
     nodeState.markedDirty_ = false;
@@ -1174,10 +1557,18 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
     
     // Check from the interest management component, if exists, whether should update
     /// \todo Searching for the component is a potential CPU hotspot. It should be cached
-    NetworkPriority* priority = node->GetComponent<NetworkPriority>();
+    NetworkPriority* priority;
+    if (interestGrid_)
+    {
+        // The interest management grid already holds the component
+        const InterestNode* interestNode = interestGrid_->FindNode(node->GetID());
+        priority = interestNode ? interestNode->priority_ : 0;
+    }
+    else
+        priority = node->GetComponent<NetworkPriority>();
     if (priority && (!priority->GetAlwaysUpdateOwner() || node->GetOwner() != this))
     {
-        float distance = (node->GetWorldPosition() - position_).Length();
+        float distance = (GetWorldTransformNoUpdate(node).Translation() - position_).Length();
         if (!priority->CheckUpdate(distance, nodeState.priorityAcc_))
             return;
     }
@@ -1198,14 +1589,22 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             }
         }
         
-        // Send latestdata message if necessary
+        // Send latestdata message if necessary, or add to the snapshot
         if (hasLatestData)
         {
-            msg_.Clear();
-            msg_.WriteNetID(node->GetID());
-            node->WriteLatestDataUpdate(msg_, timeStamp_);
-            
-            SendMessage(MSG_NODELATESTDATA, true, false, msg_, node->GetID());
+            if (!deltaSnapshots_ || !AddSnapshotLatestData(node, node->GetID(), nodeState, true))
+            {
+                // The server time is only needed by the client for interpolation
+                bool timed = scene_->GetInterpolation();
+                msg_.Clear();
+                msg_.WriteNetID(node->GetID());
+                if (timed)
+                    msg_.WriteUInt(serverTime_);
+                node->WriteLatestDataUpdate(msg_, timeStamp_);
+                AddReplicationTraffic(statistics_.latestDataUpdates_, node->GetType(), msg_.GetSize());
+                
+                SendMessage(timed ? MSG_TIMEDNODELATESTDATA : MSG_NODELATESTDATA, true, false, msg_, node->GetID());
+            }
         }
         
         // Send deltaupdate if remaining dirty bits, or vars have changed
@@ -1235,6 +1634,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 }
             }
             
+            AddReplicationTraffic(statistics_.deltaUpdates_, node->GetType(), msg_.GetSize());
             SendMessage(MSG_NODEDELTAUPDATE, true, true, msg_);
             
             nodeState.dirtyAttributes_.ClearAll();
@@ -1276,14 +1676,22 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                     }
                 }
                 
-                // Send latestdata message if necessary
+                // Send latestdata message if necessary, or add to the snapshot
                 if (hasLatestData)
                 {
-                    msg_.Clear();
-                    msg_.WriteNetID(component->GetID());
-                    component->WriteLatestDataUpdate(msg_, timeStamp_);
-                    
-                    SendMessage(MSG_COMPONENTLATESTDATA, true, false, msg_, component->GetID());
+                    if (!deltaSnapshots_ || !AddSnapshotLatestData(component, component->GetID(), componentState, false))
+                    {
+                        bool timed = scene_->GetInterpolation();
+                        msg_.Clear();
+                        msg_.WriteNetID(component->GetID());
+                        if (timed)
+                            msg_.WriteUInt(serverTime_);
+                        component->WriteLatestDataUpdate(msg_, timeStamp_);
+                        AddReplicationTraffic(statistics_.latestDataUpdates_, component->GetType(), msg_.GetSize());
+                        
+                        SendMessage(timed ? MSG_TIMEDCOMPONENTLATESTDATA : MSG_COMPONENTLATESTDATA, true, false, msg_,
+                            component->GetID());
+                    }
                 }
                 
                 // Send deltaupdate if remaining dirty bits
@@ -1292,6 +1700,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                     msg_.Clear();
                     msg_.WriteNetID(component->GetID());
                     component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_, timeStamp_);
+                    AddReplicationTraffic(statistics_.deltaUpdates_, component->GetType(), msg_.GetSize());
                     
                     SendMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
                     
@@ -1320,13 +1729,17 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 componentState.connection_ = this;
                 componentState.nodeState_ = &nodeState;
                 componentState.component_ = component;
-                component->AddReplicationState(&componentState);
+                {
+                    MutexLock lock(GetSubsystem<Network>()->GetReplicationMutex());
+                    component->AddReplicationState(&componentState);
+                }
                 
                 msg_.Clear();
                 msg_.WriteNetID(node->GetID());
                 msg_.WriteStringHash(component->GetType());
                 msg_.WriteNetID(component->GetID());
                 component->WriteInitialDeltaUpdate(msg_, timeStamp_);
+                AddReplicationTraffic(statistics_.initialUpdates_, component->GetType(), msg_.GetSize());
                 
                 SendMessage(MSG_CREATECOMPONENT, true, true, msg_);
             }
@@ -1337,6 +1750,227 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
     sceneState_.dirtyNodes_.Erase(node->GetID());
 }
 
+void Connection::UpdateInterest()
+{
+    interestManaged_ = true;
+    interestGrid_->Query(interestQuery_, position_, this, relevantGroups_);
+    
+    newRelevantGroups_.Clear();
+    for (PODVector<const InterestGroup*>::ConstIterator i = interestQuery_.Begin(); i != interestQuery_.End(); ++i)
+    {
+        const InterestGroup* group = *i;
+        newRelevantGroups_.Insert(group->nodeID_);
+        
+        // Mark the nodes of a group that entered the area of interest dirty for sending
+        if (!relevantGroups_.Erase(group->nodeID_))
+        {
+            const unsigned* nodeIDs = interestGrid_->GetGroupNodes(group);
+            for (unsigned j = 0; j < group->numNodes_; ++j)
+                sceneState_.dirtyNodes_.Insert(nodeIDs[j]);
+        }
+    }
+    
+    // The remaining groups left the area of interest. If a group no longer exists, its nodes were removed from the scene or
+    // now belong to other groups, and will be handled by ProcessNode()
+    for (HashSet<unsigned>::ConstIterator i = relevantGroups_.Begin(); i != relevantGroups_.End(); ++i)
+    {
+        const InterestGroup* group = interestGrid_->GetNodeGroup(*i);
+        if (group && group->nodeID_ == *i)
+        {
+            // The root is the first node of the group. Removing it on the client also removes the children, so they only
+            // need their own removal messages if the root had not been sent
+            const unsigned* nodeIDs = interestGrid_->GetGroupNodes(group);
+            bool rootRemoved = RemoveIrrelevantNode(nodeIDs[0]);
+            for (unsigned j = 1; j < group->numNodes_; ++j)
+                RemoveIrrelevantNode(nodeIDs[j], !rootRemoved);
+        }
+    }
+    
+    relevantGroups_.Swap(newRelevantGroups_);
+}
+
+void Connection::BeginSnapshot()
+{
+    // Snapshot ID 0 is reserved to mean no snapshot
+    if (!++snapshotID_)
+        ++snapshotID_;
+    snapshotNodes_.Clear();
+    snapshotComponents_.Clear();
+    numSnapshotNodes_ = 0;
+    numSnapshotComponents_ = 0;
+}
+
+void Connection::SendSnapshot()
+{
+    if (!numSnapshotNodes_ && !numSnapshotComponents_)
+        return;
+    
+    // The snapshot is unreliable, as the following snapshots will be encoded against the last one the client acknowledged
+    msg_.Clear();
+    msg_.WriteUInt(snapshotID_);
+    msg_.WriteUInt(serverTime_);
+    msg_.WriteVLE(numSnapshotNodes_);
+    msg_.Write(snapshotNodes_.GetData(), snapshotNodes_.GetSize());
+    msg_.WriteVLE(numSnapshotComponents_);
+    msg_.Write(snapshotComponents_.GetData(), snapshotComponents_.GetSize());
+    SendMessage(MSG_SNAPSHOT, false, false, msg_);
+    ++numSnapshotParts_;
+    
+    BeginSnapshot();
+}
+
+bool Connection::AddSnapshotLatestData(Serializable* serializable, unsigned id, ReplicationState& state, bool isNode)
+{
+    // If the update does not fit, send the snapshot and encode the update again, as the base offsets are relative to the
+    // snapshot ID. An update larger than the limit on its own is sent alone. When the snapshots of this update are used up,
+    // the caller sends the update as an ordinary latest data message instead
+    snapshotEntry_.Clear();
+    WriteSnapshotLatestData(serializable, id, state, snapshotEntry_);
+    if ((numSnapshotNodes_ || numSnapshotComponents_) && snapshotNodes_.GetSize() + snapshotComponents_.GetSize() +
+        snapshotEntry_.GetSize() > MAX_SNAPSHOT_DATA_SIZE)
+    {
+        if (numSnapshotParts_ + 1 >= MAX_SNAPSHOT_PARTS)
+            return false;
+        
+        SendSnapshot();
+        snapshotEntry_.Clear();
+        WriteSnapshotLatestData(serializable, id, state, snapshotEntry_);
+    }
+    
+    if (isNode)
+    {
+        snapshotNodes_.Write(snapshotEntry_.GetData(), snapshotEntry_.GetSize());
+        ++numSnapshotNodes_;
+    }
+    else
+    {
+        snapshotComponents_.Write(snapshotEntry_.GetData(), snapshotEntry_.GetSize());
+        ++numSnapshotComponents_;
+    }
+    
+    state.snapshotHistory_.Add(snapshotID_, snapshotData_.GetData(), snapshotData_.GetSize());
+    AddReplicationTraffic(statistics_.latestDataUpdates_, serializable->GetType(), snapshotEntry_.GetSize());
+    return true;
+}
+
+void Connection::WriteSnapshotLatestData(Serializable* serializable, unsigned id, ReplicationState& state, VectorBuffer& dest)
+{
+    snapshotData_.Clear();
+    serializable->WriteLatestDataUpdate(snapshotData_, timeStamp_);
+    
+    // Find the newest snapshot containing this object that the client has acknowledged
+    const Vector<LatestDataSnapshot>& snapshots = state.snapshotHistory_.snapshots_;
+    const LatestDataSnapshot* base = 0;
+    unsigned baseOffset = 0;
+    for (unsigned i = 0; i < snapshots.Size(); ++i)
+    {
+        unsigned offset = snapshotID_ - snapshots[i].snapshotID_;
+        if (offset && offset <= MAX_SNAPSHOT_BASE_OFFSET && (!base || offset < baseOffset) &&
+            IsSnapshotAcked(snapshots[i].snapshotID_))
+        {
+            base = &snapshots[i];
+            baseOffset = offset;
+        }
+    }
+    
+    // Base offset 0 means the update is sent whole
+    dest.WriteNetID(id);
+    dest.WriteUByte((unsigned char)baseOffset);
+    dest.WriteVLE(snapshotData_.GetSize());
+    if (base)
+        WriteDeltaData(dest, snapshotData_.GetData(), snapshotData_.GetSize(), base->data_);
+    else
+        dest.Write(snapshotData_.GetData(), snapshotData_.GetSize());
+}
+
+bool Connection::ReadSnapshotLatestData(MemoryBuffer& msg, unsigned id, SnapshotHistory& history)
+{
+    unsigned baseOffset = msg.ReadUByte();
+    unsigned size = msg.ReadVLE();
+    
+    // The decoded update is prefixed with the ID to have the same format as the latest data messages
+    snapshotData_.Clear();
+    snapshotData_.WriteNetID(id);
+    unsigned start = snapshotData_.GetSize();
+    snapshotData_.Resize(start + size);
+    unsigned char* data = snapshotData_.GetModifiableData() + start;
+    
+    if (!baseOffset)
+        msg.Read(data, size);
+    else
+    {
+        const LatestDataSnapshot* base = history.Find(ackedSnapshotID_ - baseOffset);
+        if (!base)
+        {
+            // Should not happen, as the server only encodes against acknowledged snapshots. Skip the update
+            LOGWARNING("Missing base snapshot for latest data of object " + String(id));
+            ReadDeltaData(msg, data, size, PODVector<unsigned char>());
+            return false;
+        }
+        ReadDeltaData(msg, data, size, base->data_);
+    }
+    
+    history.Add(ackedSnapshotID_, data, size);
+    return true;
+}
+
+bool Connection::IsSnapshotAcked(unsigned snapshotID) const
+{
+    if (!ackedSnapshotID_)
+        return false;
+    
+    unsigned offset = ackedSnapshotID_ - snapshotID;
+    if (!offset)
+        return true;
+    else if (offset <= 32)
+        return (ackedSnapshotMask_ & (1U << (offset - 1))) != 0;
+    else
+        return false;
+}
+
+bool Connection::IsRelevant(unsigned nodeID) const
+{
+    const InterestGroup* group = interestGrid_->GetNodeGroup(nodeID);
+    return !group || relevantGroups_.Contains(group->nodeID_);
+}
+
+bool Connection::RemoveIrrelevantNode(unsigned nodeID, bool sendRemoval)
+{
+    HashMap<unsigned, NodeReplicationState>::Iterator i = sceneState_.nodeStates_.Find(nodeID);
+    Node* node = i != sceneState_.nodeStates_.End() ? i->second_.node_.Get() : 0;
+    
+    // A node removed from the scene is still sent the usual way
+    if (i != sceneState_.nodeStates_.End() && !node)
+        return false;
+    
+    sceneState_.dirtyNodes_.Erase(nodeID);
+    nodesToProcess_.Erase(nodeID);
+    if (!node)
+        return false;
+    
+    NodeReplicationState& nodeState = i->second_;
+    {
+        MutexLock lock(GetSubsystem<Network>()->GetReplicationMutex());
+        for (HashMap<unsigned, ComponentReplicationState>::Iterator j = nodeState.componentStates_.Begin();
+            j != nodeState.componentStates_.End(); ++j)
+        {
+            Component* component = j->second_.component_;
+            if (component)
+                component->RemoveReplicationState(&j->second_);
+        }
+        node->RemoveReplicationState(&nodeState);
+    }
+    
+    if (sendRemoval)
+    {
+        msg_.Clear();
+        msg_.WriteNetID(nodeID);
+        SendMessage(MSG_REMOVENODE, true, true, msg_);
+    }
+    sceneState_.nodeStates_.Erase(i);
+    return true;
+}
+
 bool Connection::RequestNeededPackages(unsigned numPackages, MemoryBuffer& msg)
 {
     ResourceCache* cache = GetSubsystem<ResourceCache>();
@@ -1437,6 +2071,18 @@ void Connection::SendPackageError(const String& name)
     SendMessage(MSG_PACKAGEDATA, true, false, msg_);
 }
 
+void Connection::AddReplicationTraffic(NetworkTraffic& traffic, StringHash type, unsigned bytes)
+{
+    traffic.Add(bytes);
+    statistics_.replicatedTypes_[type].Add(bytes);
+}
+
+unsigned Connection::GetNumResentMessages() const
+{
+    const kNet::UDPMessageConnection* udpConnection = dynamic_cast<const kNet::UDPMessageConnection*>(connection_.ptr());
+    return udpConnection ? (unsigned)udpConnection->NumResentMessages() : 0;
+}
+
 void Connection::OnSceneLoadFailed()
 {
     sceneLoaded_ = false;
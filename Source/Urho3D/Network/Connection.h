@@ -25,6 +25,7 @@
 #include "../Input/Controls.h"
 #include "../Container/HashSet.h"
 #include "../Core/Object.h"
+#include "../Network/NetworkStatistics.h"
 #include "../Scene/ReplicationState.h"
 #include "../Core/Timer.h"
 #include "../IO/VectorBuffer.h"
@@ -40,12 +41,15 @@ namespace Urho3D
 {
 
 class File;
+class InterestGrid;
 class MemoryBuffer;
 class Node;
 class Scene;
 class Serializable;
 class PackageFile;
 
+struct InterestGroup;
+
 /// Queued remote event.
 struct RemoteEvent
 {
@@ -93,6 +97,15 @@ struct PackageUpload
     unsigned totalFragments_;
 };
 
+/// New node waiting to be sent to the client when the initial replication is rate limited.
+struct PendingNode
+{
+    /// Node ID.
+    unsigned nodeID_;
+    /// Squared distance to the observer position, or zero if owned by the connection.
+    float distanceSquared_;
+};
+
 /// Send modes for observer position/rotation. Activated by the client setting either position or rotation.
 enum ObserverPositionSendMode
 {
@@ -132,8 +145,10 @@ public:
     void SetRotation(const Quaternion& rotation);
     /// Set the connection pending status. Called by Network.
     void SetConnectPending(bool connectPending);
-    /// Set whether to log data in/out statistics.
+    /// Set whether to log data in/out statistics periodically, including the traffic counters.
     void SetLogStatistics(bool enable);
+    /// Reset the traffic counters.
+    void ResetStatistics();
     /// Disconnect. If wait time is non-zero, will block while waiting for disconnect to finish.
     void Disconnect(int waitMSec = 0);
     /// Send scene update messages. Called by Network.
@@ -185,6 +200,24 @@ public:
     const String& GetDownloadName() const;
     /// Return progress of current package download, or 1.0 if no downloads.
     float GetDownloadProgress() const;
+    /// Return the round trip time in milliseconds.
+    float GetRoundTripTime() const;
+    /// Return bytes received per second.
+    float GetBytesInPerSec() const;
+    /// Return bytes sent per second.
+    float GetBytesOutPerSec() const;
+    /// Return packets received per second.
+    int GetPacketsInPerSec() const;
+    /// Return packets sent per second.
+    int GetPacketsOutPerSec() const;
+    /// Return total bytes received.
+    unsigned long long GetBytesInTotal() const;
+    /// Return total bytes sent.
+    unsigned long long GetBytesOutTotal() const;
+    /// Return the traffic counters since the connection was established or the counters were reset.
+    const NetworkStatistics& GetStatistics() const { return statistics_; }
+    /// Return the traffic counters as a human-readable report.
+    String GetStatisticsText() const;
     /// Trigger client connection to download a package file from the server. Can be used to download additional resource packages when client is already joined in a scene. The package must have been added as a requirement to the scene the client is joined in, or else the eventual download will fail.
     void SendPackageToClient(PackageFile* package);
 
@@ -217,12 +250,38 @@ private:
     void ProcessSceneLoaded(int msgID, MemoryBuffer& msg);
     /// Process a remote event message from the client or server. Called by Network.
     void ProcessRemoteEvent(int msgID, MemoryBuffer& msg);
+    /// Process a Snapshot message from the server. Called by Network.
+    void ProcessSnapshot(int msgID, MemoryBuffer& msg);
+    /// Process a SnapshotAck message from the client. Called by Network.
+    void ProcessSnapshotAck(int msgID, MemoryBuffer& msg);
     /// Process a node for sending a network update. Recurses to process depended on node(s) first.
     void ProcessNode(unsigned nodeID);
+    /// Process the dirty nodes, sending new nodes nearest first until the byte budget is used. The rest of the new nodes stay dirty.
+    void ProcessNodesWithBudget(unsigned budget);
     /// Process a node that the client has not yet received.
     void ProcessNewNode(Node* node);
     /// Process a node that the client has already received.
     void ProcessExistingNode(Node* node, NodeReplicationState& nodeState);
+    /// Update the set of relevant interest groups from the interest management grid, and mark nodes that entered or left it.
+    void UpdateInterest();
+    /// Return whether a node is inside the area of interest.
+    bool IsRelevant(unsigned nodeID) const;
+    /// Remove a node outside the area of interest from the client, if it has been sent, and stop tracking it. Return true if the node had been sent.
+    bool RemoveIrrelevantNode(unsigned nodeID, bool sendRemoval = true);
+    /// Set the server time in milliseconds of the scene update being applied to the scene. Called on the client.
+    void ApplyServerTime(unsigned serverTime);
+    /// Start a new snapshot for the latest data.
+    void BeginSnapshot();
+    /// Send the snapshot being built if it is not empty, then start a new one.
+    void SendSnapshot();
+    /// Add the latest data update of a node or component to the snapshot being built. Send the snapshot first if the update would not fit in it. Return false if the snapshots of this update are used up.
+    bool AddSnapshotLatestData(Serializable* serializable, unsigned id, ReplicationState& state, bool isNode);
+    /// Write the latest data update of a node or component, delta encoded against the newest acknowledged snapshot that contained it.
+    void WriteSnapshotLatestData(Serializable* serializable, unsigned id, ReplicationState& state, VectorBuffer& dest);
+    /// Read the latest data update of a node or component from a snapshot and decode it. Return false if the update could not be decoded.
+    bool ReadSnapshotLatestData(MemoryBuffer& msg, unsigned id, SnapshotHistory& history);
+    /// Return whether the client has acknowledged a snapshot.
+    bool IsSnapshotAcked(unsigned snapshotID) const;
     /// Process a SyncPackagesInfo message from server.
     void ProcessPackageInfo(int msgID, MemoryBuffer& msg);
     /// Check a package list received from server and initiate package downloads as necessary. Return true on success, or false if failed to initialze downloads (cache dir not set)
@@ -237,6 +296,10 @@ private:
     void OnPackageDownloadFailed(const String& name);
     /// Handle all packages loaded successfully. Also called directly on MSG_LOADSCENE if there are none.
     void OnPackagesReady();
+    /// Count replication data of a node or component type.
+    void AddReplicationTraffic(NetworkTraffic& traffic, StringHash type, unsigned bytes);
+    /// Return the number of messages kNet has resent.
+    unsigned GetNumResentMessages() const;
     
     /// kNet message connection.
     kNet::SharedPtr<kNet::MessageConnection> connection_;
@@ -252,16 +315,44 @@ private:
     HashMap<unsigned, PODVector<unsigned char> > nodeLatestData_;
     /// Pending latest data for not yet received components.
     HashMap<unsigned, PODVector<unsigned char> > componentLatestData_;
+    /// Latest data of nodes received in snapshots, for decoding later snapshots.
+    HashMap<unsigned, SnapshotHistory> nodeSnapshots_;
+    /// Latest data of components received in snapshots, for decoding later snapshots.
+    HashMap<unsigned, SnapshotHistory> componentSnapshots_;
     /// Node ID's to process during a replication update.
     HashSet<unsigned> nodesToProcess_;
+    /// Node ID's the client already has to process during a rate limited replication update.
+    PODVector<unsigned> existingNodes_;
+    /// New nodes to send during a rate limited replication update.
+    PODVector<PendingNode> pendingNodes_;
+    /// Root node ID's of the interest groups relevant to the client.
+    HashSet<unsigned> relevantGroups_;
+    /// Root node ID's of the relevant interest groups being updated.
+    HashSet<unsigned> newRelevantGroups_;
+    /// Interest groups found relevant during a replication update.
+    PODVector<const InterestGroup*> interestQuery_;
+    /// Interest management grid of the scene during a replication update.
+    const InterestGrid* interestGrid_;
     /// Reusable message buffer.
     VectorBuffer msg_;
+    /// Node latest data of the snapshot being built.
+    VectorBuffer snapshotNodes_;
+    /// Component latest data of the snapshot being built.
+    VectorBuffer snapshotComponents_;
+    /// Reusable buffer for a latest data update being encoded or decoded.
+    VectorBuffer snapshotData_;
+    /// Reusable buffer for an encoded latest data update before adding it to the snapshot.
+    VectorBuffer snapshotEntry_;
     /// Queued remote events.
     Vector<RemoteEvent> remoteEvents_;
     /// Scene file to load once all packages (if any) have been downloaded.
     String sceneFileName_;
     /// Statistics timer.
     Timer statsTimer_;
+    /// Traffic counters.
+    NetworkStatistics statistics_;
+    /// Number of messages kNet had resent when the traffic counters were reset.
+    unsigned resentMessagesBase_;
     /// Remote endpoint address.
     String address_;
     /// Remote endpoint port.
@@ -272,6 +363,24 @@ private:
     Quaternion rotation_;
     /// Send mode for the observer position & rotation.
     ObserverPositionSendMode sendMode_;
+    /// ID of the snapshot being built on the server.
+    unsigned snapshotID_;
+    /// Newest snapshot acknowledged by the client (on the server) or received (on the client), or 0 if none.
+    unsigned ackedSnapshotID_;
+    /// Bitmask of the 32 snapshots preceding the newest acknowledged or received. Bit 0 is the snapshot immediately before it.
+    unsigned ackedSnapshotMask_;
+    /// Number of nodes in the snapshot being built.
+    unsigned numSnapshotNodes_;
+    /// Number of components in the snapshot being built.
+    unsigned numSnapshotComponents_;
+    /// Number of snapshots sent during the current replication update.
+    unsigned numSnapshotParts_;
+    /// Bytes of new nodes sent during a replication update.
+    unsigned newNodeBytes_;
+    /// Server time in milliseconds of the replication update being sent. Used on the server.
+    unsigned serverTime_;
+    /// First server time received after loading the scene, which the client measures the server time from.
+    unsigned serverTimeBase_;
     /// Client connection flag.
     bool isClient_;
     /// Connection pending flag.
@@ -280,6 +389,14 @@ private:
     bool sceneLoaded_;
     /// Show statistics flag.
     bool logStatistics_;
+    /// Interest management in use flag.
+    bool interestManaged_;
+    /// Delta snapshots in use flag during a replication update.
+    bool deltaSnapshots_;
+    /// Snapshot acknowledgement pending flag on the client.
+    bool snapshotAckPending_;
+    /// Server time base received flag on the client.
+    bool serverTimeBaseValid_;
 };
 
 }
@@ -0,0 +1,319 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Network/Connection.h"
+#include "../Network/InterestGrid.h"
+#include "../Network/NetworkPriority.h"
+#include "../Scene/Scene.h"
+#include "../Container/Sort.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Fraction of the relevance distance an observer may move past before a relevant group is removed, to avoid repeated removal and creation at the border.
+static const float RELEVANCE_HYSTERESIS = 0.1f;
+/// Cell coordinate range per axis, as the cell key packs 21 bits for each axis.
+static const int MAX_CELL_COORDINATE = (1 << 20) - 1;
+
+static bool CompareInterestNodes(const InterestNode& lhs, const InterestNode& rhs)
+{
+    return lhs.nodeID_ < rhs.nodeID_;
+}
+
+static bool CompareInterestCells(const InterestCell& lhs, const InterestCell& rhs)
+{
+    return lhs.key_ < rhs.key_;
+}
+
+InterestGrid::InterestGrid() :
+    scene_(0),
+    hierarchyVersion_(0),
+    cellSize_(1.0f),
+    maxDistance_(0.0f)
+{
+}
+
+void InterestGrid::Build(Scene* scene, float cellSize)
+{
+    groups_.Clear();
+    nodes_.Clear();
+    groupNodes_.Clear();
+    cells_.Clear();
+    ownedGroups_.Clear();
+    cellSize_ = Max(cellSize, M_EPSILON);
+    maxDistance_ = 0.0f;
+    scene_ = scene;
+
+    if (!scene)
+        return;
+
+    hierarchyVersion_ = scene->GetNetworkHierarchyVersion();
+
+    // The scene itself is always relevant, so start from its children
+    const Vector<SharedPtr<Node> >& children = scene->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        AddNode(*i, M_MAX_UNSIGNED);
+
+    cells_.Resize(groups_.Size());
+    for (unsigned i = 0; i < groups_.Size(); ++i)
+    {
+        const InterestGroup& group = groups_[i];
+        cells_[i].key_ = GetCellKey(GetCellCoordinate(group.position_.x_), GetCellCoordinate(group.position_.y_),
+            GetCellCoordinate(group.position_.z_));
+        cells_[i].group_ = i;
+        if (group.owner_)
+            ownedGroups_.Push(i);
+    }
+
+    Sort(nodes_.Begin(), nodes_.End(), CompareInterestNodes);
+    Sort(cells_.Begin(), cells_.End(), CompareInterestCells);
+}
+
+void InterestGrid::Update(Scene* scene, const PODVector<Node*>& updatedNodes, float cellSize)
+{
+    if (!scene || scene != scene_ || scene->GetNetworkHierarchyVersion() != hierarchyVersion_ || Max(cellSize, M_EPSILON) !=
+        cellSize_)
+    {
+        Build(scene, cellSize);
+        return;
+    }
+
+    // The groups and their nodes are unchanged, so only the positions of the moved groups need updating
+    for (PODVector<Node*>::ConstIterator i = updatedNodes.Begin(); i != updatedNodes.End(); ++i)
+    {
+        // The scene is always relevant and not expected to move
+        if (*i != scene)
+            UpdateNode(*i);
+    }
+}
+
+void InterestGrid::Query(PODVector<const InterestGroup*>& result, const Vector3& position, Connection* connection,
+    const HashSet<unsigned>& relevantGroups) const
+{
+    result.Clear();
+    if (groups_.Empty())
+        return;
+
+    float queryDistance = maxDistance_ * (1.0f + RELEVANCE_HYSTERESIS);
+    int minX = GetCellCoordinate(position.x_ - queryDistance);
+    int minY = GetCellCoordinate(position.y_ - queryDistance);
+    int minZ = GetCellCoordinate(position.z_ - queryDistance);
+    int maxX = GetCellCoordinate(position.x_ + queryDistance);
+    int maxY = GetCellCoordinate(position.y_ + queryDistance);
+    int maxZ = GetCellCoordinate(position.z_ + queryDistance);
+    float numCells = (float)(maxX - minX + 1) * (float)(maxY - minY + 1) * (float)(maxZ - minZ + 1);
+
+    // If the query covers more cells than there are groups, it is faster to check all groups
+    if (numCells >= (float)cells_.Size())
+    {
+        for (unsigned i = 0; i < groups_.Size(); ++i)
+        {
+            const InterestGroup& group = groups_[i];
+            if (group.owner_ == connection && connection)
+                continue;
+            float distance = relevantGroups.Contains(group.nodeID_) ? group.distance_ * (1.0f + RELEVANCE_HYSTERESIS) :
+                group.distance_;
+            if ((group.position_ - position).LengthSquared() <= distance * distance)
+                result.Push(&group);
+        }
+    }
+    else
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            for (int y = minY; y <= maxY; ++y)
+            {
+                for (int z = minZ; z <= maxZ; ++z)
+                {
+                    unsigned long long key = GetCellKey(x, y, z);
+                    for (unsigned i = FindCell(key); i < cells_.Size() && cells_[i].key_ == key; ++i)
+                    {
+                        const InterestGroup& group = groups_[cells_[i].group_];
+                        if (group.owner_ == connection && connection)
+                            continue;
+                        float distance = relevantGroups.Contains(group.nodeID_) ? group.distance_ * (1.0f +
+                            RELEVANCE_HYSTERESIS) : group.distance_;
+                        if ((group.position_ - position).LengthSquared() <= distance * distance)
+                            result.Push(&group);
+                    }
+                }
+            }
+        }
+    }
+
+    // Groups owned by the connection are relevant regardless of distance
+    if (connection)
+    {
+        for (unsigned i = 0; i < ownedGroups_.Size(); ++i)
+        {
+            const InterestGroup& group = groups_[ownedGroups_[i]];
+            if (group.owner_ == connection)
+                result.Push(&group);
+        }
+    }
+}
+
+const InterestNode* InterestGrid::FindNode(unsigned nodeID) const
+{
+    unsigned first = 0;
+    unsigned last = nodes_.Size();
+    while (first < last)
+    {
+        unsigned middle = (first + last) >> 1;
+        if (nodes_[middle].nodeID_ < nodeID)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    return first < nodes_.Size() && nodes_[first].nodeID_ == nodeID ? &nodes_[first] : 0;
+}
+
+const InterestGroup* InterestGrid::GetNodeGroup(unsigned nodeID) const
+{
+    const InterestNode* node = FindNode(nodeID);
+    return node && node->group_ != M_MAX_UNSIGNED ? &groups_[node->group_] : 0;
+}
+
+void InterestGrid::AddNode(Node* node, unsigned group)
+{
+    unsigned nodeID = node->GetID();
+    bool newGroup = false;
+
+    if (nodeID < FIRST_LOCAL_ID)
+    {
+        NetworkPriority* priority = node->GetComponent<NetworkPriority>();
+
+        // The topmost node with a relevance distance decides the relevance of its whole hierarchy, as removing a node on
+        // the client also removes its children
+        if (group == M_MAX_UNSIGNED && priority && priority->GetRelevanceDistance() > 0.0f)
+        {
+            InterestGroup newEntry;
+            newEntry.nodeID_ = nodeID;
+            newEntry.position_ = node->GetWorldPosition();
+            newEntry.distance_ = priority->GetRelevanceDistance();
+            newEntry.owner_ = 0;
+            newEntry.firstNode_ = groupNodes_.Size();
+            newEntry.numNodes_ = 0;
+            group = groups_.Size();
+            groups_.Push(newEntry);
+            maxDistance_ = Max(maxDistance_, newEntry.distance_);
+            newGroup = true;
+        }
+
+        if (group != M_MAX_UNSIGNED)
+        {
+            groupNodes_.Push(nodeID);
+            if (!groups_[group].owner_)
+                groups_[group].owner_ = node->GetOwner();
+        }
+
+        if (group != M_MAX_UNSIGNED || priority)
+        {
+            InterestNode newEntry;
+            newEntry.nodeID_ = nodeID;
+            newEntry.group_ = group;
+            newEntry.priority_ = priority;
+            nodes_.Push(newEntry);
+        }
+    }
+
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        AddNode(*i, group);
+
+    if (newGroup)
+        groups_[group].numNodes_ = groupNodes_.Size() - groups_[group].firstNode_;
+}
+
+void InterestGrid::UpdateNode(Node* node)
+{
+    const InterestNode* entry = FindNode(node->GetID());
+    if (entry && entry->group_ != M_MAX_UNSIGNED)
+    {
+        // Only the root decides the group position. The children belong to the same group
+        if (groups_[entry->group_].nodeID_ == entry->nodeID_)
+            MoveGroup(entry->group_, node->GetWorldPosition());
+        return;
+    }
+
+    // The node is always relevant, but moving it may move the groups in its child hierarchy
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        UpdateNode(*i);
+}
+
+void InterestGrid::MoveGroup(unsigned index, const Vector3& position)
+{
+    InterestGroup& group = groups_[index];
+    unsigned long long oldKey = GetCellKey(GetCellCoordinate(group.position_.x_), GetCellCoordinate(group.position_.y_),
+        GetCellCoordinate(group.position_.z_));
+    unsigned long long newKey = GetCellKey(GetCellCoordinate(position.x_), GetCellCoordinate(position.y_),
+        GetCellCoordinate(position.z_));
+    group.position_ = position;
+    if (newKey == oldKey)
+        return;
+
+    // Move the cell entry to keep the entries sorted by key
+    unsigned oldIndex = FindCell(oldKey);
+    while (oldIndex < cells_.Size() && cells_[oldIndex].group_ != index)
+        ++oldIndex;
+    if (oldIndex < cells_.Size())
+        cells_.Erase(oldIndex);
+
+    InterestCell newEntry;
+    newEntry.key_ = newKey;
+    newEntry.group_ = index;
+    cells_.Insert(FindCell(newKey), newEntry);
+}
+
+unsigned InterestGrid::FindCell(unsigned long long key) const
+{
+    unsigned first = 0;
+    unsigned last = cells_.Size();
+    while (first < last)
+    {
+        unsigned middle = (first + last) >> 1;
+        if (cells_[middle].key_ < key)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    return first;
+}
+
+unsigned long long InterestGrid::GetCellKey(int x, int y, int z) const
+{
+    return ((unsigned long long)(x & 0x1fffff) << 42) | ((unsigned long long)(y & 0x1fffff) << 21) |
+        (unsigned long long)(z & 0x1fffff);
+}
+
+int InterestGrid::GetCellCoordinate(float value) const
+{
+    float coordinate = floorf(value / cellSize_);
+    return (int)Clamp(coordinate, (float)-MAX_CELL_COORDINATE, (float)MAX_CELL_COORDINATE);
+}
+
+}
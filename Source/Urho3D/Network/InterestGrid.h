@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashSet.h"
+#include "../Math/Vector3.h"
+
+namespace Urho3D
+{
+
+class Connection;
+class NetworkPriority;
+class Node;
+class Scene;
+
+/// Replicated node hierarchy whose relevance to client connections is decided by the distance to its root node.
+struct InterestGroup
+{
+    /// Root node ID.
+    unsigned nodeID_;
+    /// Root node world position.
+    Vector3 position_;
+    /// Relevance distance.
+    float distance_;
+    /// Owner connection of the root node or of the first owned node in the hierarchy, if any.
+    Connection* owner_;
+    /// Index of the first node ID in the group node list.
+    unsigned firstNode_;
+    /// Number of replicated nodes in the hierarchy, including the root.
+    unsigned numNodes_;
+};
+
+/// Interest management information of a replicated node.
+struct InterestNode
+{
+    /// Node ID.
+    unsigned nodeID_;
+    /// Index of the interest group the node belongs to, or M_MAX_UNSIGNED if always relevant.
+    unsigned group_;
+    /// Network priority component, if any.
+    NetworkPriority* priority_;
+};
+
+/// Interest group index in a grid cell.
+struct InterestCell
+{
+    /// Cell key.
+    unsigned long long key_;
+    /// Interest group index.
+    unsigned group_;
+};
+
+/// Uniform spatial grid of the replicated node hierarchies of a scene that have a NetworkPriority relevance distance. Updated by Network on each server update and read by the client connections in parallel.
+class URHO3D_API InterestGrid
+{
+public:
+    /// Construct.
+    InterestGrid();
+
+    /// Rebuild from the scene's replicated nodes. Also caches the NetworkPriority components for the connections.
+    void Build(Scene* scene, float cellSize);
+    /// Move the interest groups that contain the given nodes or are below them in the hierarchy. Rebuild instead if the scene, its network hierarchy version or the cell size has changed since the last build.
+    void Update(Scene* scene, const PODVector<Node*>& updatedNodes, float cellSize);
+    /// Collect the interest groups relevant to an observer. Groups already relevant to the connection stay relevant until slightly past their relevance distance, and groups owned by the connection are always relevant.
+    void Query(PODVector<const InterestGroup*>& result, const Vector3& position, Connection* connection, const HashSet<unsigned>& relevantGroups) const;
+
+    /// Return interest management information of a replicated node, or null if it is always relevant and has no NetworkPriority component.
+    const InterestNode* FindNode(unsigned nodeID) const;
+    /// Return the interest group a node belongs to, or null if it is always relevant.
+    const InterestGroup* GetNodeGroup(unsigned nodeID) const;
+    /// Return the node IDs of an interest group.
+    const unsigned* GetGroupNodes(const InterestGroup* group) const { return &groupNodes_[group->firstNode_]; }
+    /// Return all interest groups.
+    const PODVector<InterestGroup>& GetGroups() const { return groups_; }
+    /// Return cell size.
+    float GetCellSize() const { return cellSize_; }
+
+private:
+    /// Add a node and its children recursively.
+    void AddNode(Node* node, unsigned group);
+    /// Move the interest group of a node if it is the group root, otherwise check its children recursively.
+    void UpdateNode(Node* node);
+    /// Move an interest group to a new position and update its cell.
+    void MoveGroup(unsigned index, const Vector3& position);
+    /// Return the index of the first cell entry with the key or a larger one.
+    unsigned FindCell(unsigned long long key) const;
+    /// Return the cell key of a world position.
+    unsigned long long GetCellKey(int x, int y, int z) const;
+    /// Return the cell coordinate of a world position component.
+    int GetCellCoordinate(float value) const;
+
+    /// Interest groups.
+    PODVector<InterestGroup> groups_;
+    /// Interest management information of nodes, sorted by ID.
+    PODVector<InterestNode> nodes_;
+    /// Node IDs of the interest groups.
+    PODVector<unsigned> groupNodes_;
+    /// Interest groups sorted by cell.
+    PODVector<InterestCell> cells_;
+    /// Indices of interest groups that have an owner connection.
+    PODVector<unsigned> ownedGroups_;
+    /// Scene the grid was built from.
+    Scene* scene_;
+    /// Network hierarchy version of the scene when built.
+    unsigned hierarchyVersion_;
+    /// Cell size.
+    float cellSize_;
+    /// Largest relevance distance of the interest groups.
+    float maxDistance_;
+};
+
+}
@@ -35,6 +35,7 @@
 #include "../Core/Profiler.h"
 #include "../Network/Protocol.h"
 #include "../Scene/Scene.h"
+#include "../Core/WorkQueue.h"
 
 #include <kNet/kNet.h>
 
@@ -44,12 +45,24 @@ namespace Urho3D
 {
 
 static const int DEFAULT_UPDATE_FPS = 30;
+static const float DEFAULT_INTEREST_CELL_SIZE = 100.0f;
+
+static void SendServerUpdateWork(const WorkItem* item, unsigned threadIndex)
+{
+    MEMORY_TAG(MT_NETWORK);
+    Connection* connection = reinterpret_cast<Connection*>(item->start_);
+    connection->SendServerUpdate();
+}
 
 Network::Network(Context* context) :
     Object(context),
     updateFps_(DEFAULT_UPDATE_FPS),
     simulatedLatency_(0),
     simulatedPacketLoss_(0.0f),
+    interestCellSize_(DEFAULT_INTEREST_CELL_SIZE),
+    initialReplicationBudget_(0),
+    interestManagement_(false),
+    deltaSnapshots_(false),
     updateInterval_(1.0f / (float)DEFAULT_UPDATE_FPS),
     updateAcc_(0.0f)
 {
@@ -150,6 +163,8 @@ u32 Network::ComputeContentID(kNet::message_id_t msgId, const char* data, size_t
         
     case MSG_NODELATESTDATA:
     case MSG_COMPONENTLATESTDATA:
+    case MSG_TIMEDNODELATESTDATA:
+    case MSG_TIMEDCOMPONENTLATESTDATA:
         {
             // Return the node or component ID, which is first in the message
             MemoryBuffer msg(data, (unsigned)numBytes);
@@ -351,6 +366,28 @@ void Network::SetSimulatedPacketLoss(float loss)
     ConfigureNetworkSimulator();
 }
 
+void Network::SetInterestManagement(bool enable)
+{
+    interestManagement_ = enable;
+    if (!interestManagement_)
+        interestGrids_.Clear();
+}
+
+void Network::SetInterestCellSize(float size)
+{
+    interestCellSize_ = Max(size, 1.0f);
+}
+
+void Network::SetDeltaSnapshots(bool enable)
+{
+    deltaSnapshots_ = enable;
+}
+
+void Network::SetInitialReplicationBudget(unsigned bytes)
+{
+    initialReplicationBudget_ = bytes;
+}
+
 void Network::RegisterRemoteEvent(StringHash eventType)
 {
     if (blacklistedRemoteEvents_.Find(eventType) != blacklistedRemoteEvents_.End())
@@ -446,9 +483,16 @@ bool Network::CheckRemoteEvent(StringHash eventType) const
     return allowedRemoteEvents_.Contains(eventType);
 }
 
+const InterestGrid* Network::GetInterestGrid(Scene* scene) const
+{
+    HashMap<Scene*, InterestGrid>::ConstIterator i = interestGrids_.Find(scene);
+    return i != interestGrids_.End() ? &i->second_ : 0;
+}
+
 void Network::Update(float timeStep)
 {
     PROFILE(UpdateNetwork);
+    MEMORY_TAG(MT_NETWORK);
     
     // Process server connection if it exists
     if (serverConnection_)
@@ -480,6 +524,7 @@ void Network::Update(float timeStep)
 void Network::PostUpdate(float timeStep)
 {
     PROFILE(PostUpdateNetwork);
+    MEMORY_TAG(MT_NETWORK);
     
     // Check if periodic update should happen now
     updateAcc_ += timeStep;
@@ -508,16 +553,20 @@ void Network::PostUpdate(float timeStep)
                 
                 for (HashSet<Scene*>::ConstIterator i = networkScenes_.Begin(); i != networkScenes_.End(); ++i)
                     (*i)->PrepareNetworkUpdate();
+                
+                if (interestManagement_)
+                    UpdateInterestGrids();
             }
             
             {
                 PROFILE(SendServerUpdate);
                 
                 // Then send server updates for each client connection
+                SendServerUpdates();
+                
                 for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
                     i != clientConnections_.End(); ++i)
                 {
-                    i->second_->SendServerUpdate();
                     i->second_->SendRemoteEvents();
                     i->second_->SendPackages();
                 }
@@ -592,6 +641,51 @@ void Network::ConfigureNetworkSimulator()
         i->second_->ConfigureNetworkSimulator(simulatedLatency_, simulatedPacketLoss_);
 }
 
+void Network::SendServerUpdates()
+{
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    
+    if (!queue || !queue->GetNumThreads() || clientConnections_.Size() < 2)
+    {
+        for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
+            i != clientConnections_.End(); ++i)
+            i->second_->SendServerUpdate();
+        return;
+    }
+    
+    // Each connection only modifies its own replication state and message buffer, so the connections can be updated in
+    // parallel with the same result as serially. Use one work item per connection, as the cost varies greatly, for example
+    // when a connection is receiving the initial scene state
+    for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
+        i != clientConnections_.End(); ++i)
+    {
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = SendServerUpdateWork;
+        item->start_ = i->second_.Get();
+        queue->AddWorkItem(item);
+    }
+    
+    queue->Complete(M_MAX_UNSIGNED);
+}
+
+void Network::UpdateInterestGrids()
+{
+    PROFILE(UpdateInterestGrids);
+    
+    // Remove grids of scenes that are no longer networked
+    for (HashMap<Scene*, InterestGrid>::Iterator i = interestGrids_.Begin(); i != interestGrids_.End();)
+    {
+        if (!networkScenes_.Contains(i->first_))
+            i = interestGrids_.Erase(i);
+        else
+            ++i;
+    }
+    
+    for (HashSet<Scene*>::ConstIterator i = networkScenes_.Begin(); i != networkScenes_.End(); ++i)
+        interestGrids_[*i].Update(*i, (*i)->GetNetworkUpdateNodes(), interestCellSize_);
+}
+
 void RegisterNetworkLibrary(Context* context)
 {
     NetworkPriority::RegisterObject(context);
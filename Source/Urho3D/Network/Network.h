@@ -23,7 +23,9 @@
 #pragma once
 
 #include "../Network/Connection.h"
+#include "../Network/InterestGrid.h"
 #include "../Container/HashSet.h"
+#include "../Core/Mutex.h"
 #include "../Core/Object.h"
 #include "../IO/VectorBuffer.h"
 
@@ -87,6 +89,14 @@ public:
     void SetSimulatedLatency(int ms);
     /// Set simulated packet loss probability between 0.0 - 1.0.
     void SetSimulatedPacketLoss(float probability);
+    /// Set whether to remove node hierarchies from clients beyond their NetworkPriority relevance distance, and skip their updates. Default false.
+    void SetInterestManagement(bool enable);
+    /// Set the cell size of the spatial grid used for interest management. Should be in the order of the typical relevance distance. Default 100.
+    void SetInterestCellSize(float size);
+    /// Set whether to send the latest data of each server update as a snapshot, delta encoded against the snapshots acknowledged by each client. Default false.
+    void SetDeltaSnapshots(bool enable);
+    /// Set the number of bytes of new nodes that may be sent to each client connection per server update. Nodes nearest to the client's observer position are sent first, and the rest on the following updates. Default 0 (unlimited.)
+    void SetInitialReplicationBudget(unsigned bytes);
     /// Register a remote event as allowed to be received. There is also a fixed blacklist of events that can not be allowed in any case, such as ConsoleCommand.
     void RegisterRemoteEvent(StringHash eventType);
     /// Unregister a remote event as allowed to received.
@@ -106,6 +116,16 @@ public:
     int GetSimulatedLatency() const { return simulatedLatency_; }
     /// Return simulated packet loss probability.
     float GetSimulatedPacketLoss() const { return simulatedPacketLoss_; }
+    /// Return whether interest management is enabled.
+    bool GetInterestManagement() const { return interestManagement_; }
+    /// Return the cell size of the interest management grid.
+    float GetInterestCellSize() const { return interestCellSize_; }
+    /// Return whether delta snapshots are enabled.
+    bool GetDeltaSnapshots() const { return deltaSnapshots_; }
+    /// Return the per-connection byte budget of new nodes per server update.
+    unsigned GetInitialReplicationBudget() const { return initialReplicationBudget_; }
+    /// Return the interest management grid of a scene, or null if interest management is disabled. Valid during the server update.
+    const InterestGrid* GetInterestGrid(Scene* scene) const;
     /// Return a client or server connection by kNet MessageConnection, or null if none exist.
     Connection* GetConnection(kNet::MessageConnection* connection) const;
     /// Return the connection to the server. Null if not connected.
@@ -118,6 +138,8 @@ public:
     bool CheckRemoteEvent(StringHash eventType) const;
     /// Return the package download cache directory.
     const String& GetPackageCacheDir() const { return packageCacheDir_; }
+    /// Return the mutex for registering replication states to scene nodes and components, as client connections are updated in parallel.
+    Mutex& GetReplicationMutex() { return replicationMutex_; }
     
     /// Process incoming messages from connections. Called by HandleBeginFrame.
     void Update(float timeStep);
@@ -135,6 +157,10 @@ private:
     void OnServerDisconnected();
     /// Reconfigure network simulator parameters on all existing connections.
     void ConfigureNetworkSimulator();
+    /// Send scene updates to the client connections, in parallel on the worker threads if available.
+    void SendServerUpdates();
+    /// Rebuild the interest management grids of the networked scenes.
+    void UpdateInterestGrids();
     
     /// kNet instance.
     kNet::Network* network_;
@@ -148,18 +174,30 @@ private:
     HashSet<StringHash> blacklistedRemoteEvents_;
     /// Networked scenes.
     HashSet<Scene*> networkScenes_;
+    /// Interest management grids of the networked scenes.
+    HashMap<Scene*, InterestGrid> interestGrids_;
     /// Update FPS.
     int updateFps_;
     /// Simulated latency (send delay) in milliseconds.
     int simulatedLatency_;
     /// Simulated packet loss probability between 0.0 - 1.0.
     float simulatedPacketLoss_;
+    /// Interest management grid cell size.
+    float interestCellSize_;
+    /// Per-connection byte budget of new nodes per server update.
+    unsigned initialReplicationBudget_;
+    /// Interest management flag.
+    bool interestManagement_;
+    /// Delta snapshots flag.
+    bool deltaSnapshots_;
     /// Update time interval.
     float updateInterval_;
     /// Update time accumulator.
     float updateAcc_;
     /// Package cache directory.
     String packageCacheDir_;
+    /// Mutex for registering replication states during the parallel server update.
+    Mutex replicationMutex_;
 };
 
 /// Register Network library objects.
@@ -22,6 +22,7 @@
 
 #include "../Core/Context.h"
 #include "../Network/NetworkPriority.h"
+#include "../Scene/Scene.h"
 
 #include "../DebugNew.h"
 
@@ -33,6 +34,7 @@ const char* NETWORK_CATEGORY = "Network";
 static const float DEFAULT_BASE_PRIORITY = 100.0f;
 static const float DEFAULT_DISTANCE_FACTOR = 0.0f;
 static const float DEFAULT_MIN_PRIORITY = 0.0f;
+static const float DEFAULT_RELEVANCE_DISTANCE = 0.0f;
 static const float UPDATE_THRESHOLD = 100.0f;
 
 NetworkPriority::NetworkPriority(Context* context) :
@@ -40,6 +42,7 @@ NetworkPriority::NetworkPriority(Context* context) :
     basePriority_(DEFAULT_BASE_PRIORITY),
     distanceFactor_(DEFAULT_DISTANCE_FACTOR),
     minPriority_(DEFAULT_MIN_PRIORITY),
+    relevanceDistance_(DEFAULT_RELEVANCE_DISTANCE),
     alwaysUpdateOwner_(true)
 {
 }
@@ -56,6 +59,7 @@ void NetworkPriority::RegisterObject(Context* context)
     ATTRIBUTE("Distance Factor", float, distanceFactor_, DEFAULT_DISTANCE_FACTOR, AM_DEFAULT);
     ATTRIBUTE("Minimum Priority", float, minPriority_, DEFAULT_MIN_PRIORITY, AM_DEFAULT);
     ATTRIBUTE("Always Update Owner", bool, alwaysUpdateOwner_, true, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Relevance Distance", GetRelevanceDistance, SetRelevanceDistance, float, DEFAULT_RELEVANCE_DISTANCE, AM_DEFAULT);
 }
 
 void NetworkPriority::SetBasePriority(float priority)
@@ -82,6 +86,21 @@ void NetworkPriority::SetAlwaysUpdateOwner(bool enable)
     MarkNetworkUpdate();
 }
 
+void NetworkPriority::SetRelevanceDistance(float distance)
+{
+    distance = Max(distance, 0.0f);
+    if (distance != relevanceDistance_)
+    {
+        relevanceDistance_ = distance;
+        
+        // The relevance distances decide the interest groups
+        Scene* scene = GetScene();
+        if (scene)
+            scene->MarkNetworkHierarchyDirty();
+    }
+    MarkNetworkUpdate();
+}
+
 bool NetworkPriority::CheckUpdate(float distance, float& accumulator)
 {
     float currentPriority = Max(basePriority_ - distanceFactor_ * distance, minPriority_);
@@ -95,4 +114,17 @@ bool NetworkPriority::CheckUpdate(float distance, float& accumulator)
         return false;
 }
 
+void NetworkPriority::OnNodeSet(Node* node)
+{
+    // Interest management caches the component, so notify the scene when it is removed from a node or added to one
+    Scene* oldScene = lastNode_ ? lastNode_->GetScene() : 0;
+    if (oldScene)
+        oldScene->MarkNetworkHierarchyDirty();
+    
+    lastNode_ = node;
+    Scene* scene = node ? node->GetScene() : 0;
+    if (scene)
+        scene->MarkNetworkHierarchyDirty();
+}
+
 }
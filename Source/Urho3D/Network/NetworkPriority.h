@@ -48,6 +48,8 @@ public:
     void SetMinPriority(float priority);
     /// Set whether updates to owner should be sent always at full rate. Default true.
     void SetAlwaysUpdateOwner(bool enable);
+    /// Set distance beyond which the node and its children are removed from clients, when interest management is enabled in Network. Default 0 (always relevant.)
+    void SetRelevanceDistance(float distance);
     
     /// Return base priority.
     float GetBasePriority() const { return basePriority_; }
@@ -57,17 +59,27 @@ public:
     float GetMinPriority() const { return minPriority_; }
     /// Return whether updates to owner should be sent always at full rate.
     bool GetAlwaysUpdateOwner() const { return alwaysUpdateOwner_; }
+    /// Return relevance distance.
+    float GetRelevanceDistance() const { return relevanceDistance_; }
     
     /// Increment and check priority accumulator. Return true if should update. Called by Connection.
     bool CheckUpdate(float distance, float& accumulator);
     
+protected:
+    /// Handle node being assigned.
+    virtual void OnNodeSet(Node* node);
+    
 private:
+    /// Node the component was last assigned to, for notifying its scene on removal.
+    WeakPtr<Node> lastNode_;
     /// Base priority.
     float basePriority_;
     /// Priority reduction distance factor.
     float distanceFactor_;
     /// Minimum priority.
     float minPriority_;
+    /// Relevance distance.
+    float relevanceDistance_;
     /// Update owner at full rate flag.
     bool alwaysUpdateOwner_;
 };
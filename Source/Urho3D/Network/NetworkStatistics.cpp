@@ -0,0 +1,204 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/Context.h"
+#include "../Container/Sort.h"
+#include "../Network/NetworkStatistics.h"
+#include "../Network/Protocol.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const float rttBucketLimits[NUM_RTT_BUCKETS - 1] =
+{
+    10.0f,
+    25.0f,
+    50.0f,
+    100.0f,
+    200.0f,
+    400.0f,
+    800.0f
+};
+
+static const char* messageNames[] =
+{
+    "Identity",
+    "Controls",
+    "SceneLoaded",
+    "RequestPackage",
+    "PackageData",
+    "LoadScene",
+    "SceneChecksumError",
+    "CreateNode",
+    "NodeDeltaUpdate",
+    "NodeLatestData",
+    "RemoveNode",
+    "CreateComponent",
+    "ComponentDeltaUpdate",
+    "ComponentLatestData",
+    "RemoveComponent",
+    "RemoteEvent",
+    "RemoteNodeEvent",
+    "PackageInfo",
+    "Snapshot",
+    "SnapshotAck",
+    "TimedNodeLatestData",
+    "TimedComponentLatestData"
+};
+
+/// Traffic report line for sorting by byte total.
+struct TrafficLine
+{
+    /// Name.
+    String name_;
+    /// Traffic.
+    NetworkTraffic traffic_;
+};
+
+static bool CompareTrafficLines(const TrafficLine& lhs, const TrafficLine& rhs)
+{
+    return lhs.traffic_.bytes_ > rhs.traffic_.bytes_;
+}
+
+static String GetMessageName(int msgID)
+{
+    if (msgID >= MSG_IDENTITY && msgID <= MSG_TIMEDCOMPONENTLATESTDATA)
+        return messageNames[msgID - MSG_IDENTITY];
+    else
+        return "Message " + String(msgID);
+}
+
+static void AppendTraffic(String& dest, const String& name, const NetworkTraffic& traffic)
+{
+    dest.AppendWithFormat("\n  %s %u, %.1f kB", name.CString(), traffic.count_, (float)traffic.bytes_ / 1024.0f);
+}
+
+static void AppendTrafficLines(String& dest, Vector<TrafficLine>& lines)
+{
+    Sort(lines.Begin(), lines.End(), CompareTrafficLines);
+    for (unsigned i = 0; i < lines.Size(); ++i)
+        AppendTraffic(dest, lines[i].name_, lines[i].traffic_);
+}
+
+static void AppendMessages(String& dest, const HashMap<int, NetworkTraffic>& messages)
+{
+    Vector<TrafficLine> lines;
+    for (HashMap<int, NetworkTraffic>::ConstIterator i = messages.Begin(); i != messages.End(); ++i)
+    {
+        TrafficLine line;
+        line.name_ = GetMessageName(i->first_);
+        line.traffic_ = i->second_;
+        lines.Push(line);
+    }
+    AppendTrafficLines(dest, lines);
+}
+
+NetworkStatistics::NetworkStatistics()
+{
+    Reset();
+}
+
+void NetworkStatistics::Reset()
+{
+    sentMessages_.Clear();
+    receivedMessages_.Clear();
+    replicatedTypes_.Clear();
+    initialUpdates_ = NetworkTraffic();
+    deltaUpdates_ = NetworkTraffic();
+    latestDataUpdates_ = NetworkTraffic();
+    resentMessages_ = 0;
+    for (unsigned i = 0; i < NUM_RTT_BUCKETS; ++i)
+        rttHistogram_[i] = 0;
+}
+
+void NetworkStatistics::Merge(const NetworkStatistics& statistics)
+{
+    for (HashMap<int, NetworkTraffic>::ConstIterator i = statistics.sentMessages_.Begin(); i != statistics.sentMessages_.End(); ++i)
+        sentMessages_[i->first_].Merge(i->second_);
+    for (HashMap<int, NetworkTraffic>::ConstIterator i = statistics.receivedMessages_.Begin(); i !=
+        statistics.receivedMessages_.End(); ++i)
+        receivedMessages_[i->first_].Merge(i->second_);
+    for (HashMap<StringHash, NetworkTraffic>::ConstIterator i = statistics.replicatedTypes_.Begin(); i !=
+        statistics.replicatedTypes_.End(); ++i)
+        replicatedTypes_[i->first_].Merge(i->second_);
+    
+    initialUpdates_.Merge(statistics.initialUpdates_);
+    deltaUpdates_.Merge(statistics.deltaUpdates_);
+    latestDataUpdates_.Merge(statistics.latestDataUpdates_);
+    resentMessages_ += statistics.resentMessages_;
+    for (unsigned i = 0; i < NUM_RTT_BUCKETS; ++i)
+        rttHistogram_[i] += statistics.rttHistogram_[i];
+}
+
+void NetworkStatistics::AddRoundTripTime(float rtt)
+{
+    unsigned bucket = 0;
+    while (bucket < NUM_RTT_BUCKETS - 1 && rtt >= rttBucketLimits[bucket])
+        ++bucket;
+    ++rttHistogram_[bucket];
+}
+
+String NetworkStatistics::ToString(Context* context) const
+{
+    String ret("Sent messages:");
+    AppendMessages(ret, sentMessages_);
+    ret += "\nReceived messages:";
+    AppendMessages(ret, receivedMessages_);
+    
+    ret += "\nReplication:";
+    AppendTraffic(ret, "Initial", initialUpdates_);
+    AppendTraffic(ret, "Delta", deltaUpdates_);
+    AppendTraffic(ret, "Latest data", latestDataUpdates_);
+    
+    ret += "\nReplicated types:";
+    Vector<TrafficLine> lines;
+    for (HashMap<StringHash, NetworkTraffic>::ConstIterator i = replicatedTypes_.Begin(); i != replicatedTypes_.End(); ++i)
+    {
+        TrafficLine line;
+        line.name_ = context->GetTypeName(i->first_);
+        if (line.name_.Empty())
+            line.name_ = i->first_.ToString();
+        line.traffic_ = i->second_;
+        lines.Push(line);
+    }
+    AppendTrafficLines(ret, lines);
+    
+    ret.AppendWithFormat("\nResent messages %u\nRTT ms", resentMessages_);
+    for (unsigned i = 0; i < NUM_RTT_BUCKETS; ++i)
+    {
+        if (i < NUM_RTT_BUCKETS - 1)
+            ret.AppendWithFormat(" <%d:%u", (int)rttBucketLimits[i], rttHistogram_[i]);
+        else
+            ret.AppendWithFormat(" >=%d:%u", (int)rttBucketLimits[i - 1], rttHistogram_[i]);
+    }
+    
+    return ret;
+}
+
+float NetworkStatistics::GetRoundTripTimeBucketLimit(unsigned index)
+{
+    return index < NUM_RTT_BUCKETS - 1 ? rttBucketLimits[index] : M_INFINITY;
+}
+
+}
@@ -0,0 +1,103 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Container/Str.h"
+#include "../Math/StringHash.h"
+
+namespace Urho3D
+{
+
+class Context;
+
+/// Number of round trip time histogram buckets.
+static const unsigned NUM_RTT_BUCKETS = 8;
+
+/// Message or update count and byte total.
+struct URHO3D_API NetworkTraffic
+{
+    /// Construct.
+    NetworkTraffic() :
+        count_(0),
+        bytes_(0)
+    {
+    }
+    
+    /// Add one message or update.
+    void Add(unsigned bytes)
+    {
+        ++count_;
+        bytes_ += bytes;
+    }
+    
+    /// Add counts from another traffic record.
+    void Merge(const NetworkTraffic& traffic)
+    {
+        count_ += traffic.count_;
+        bytes_ += traffic.bytes_;
+    }
+    
+    /// Number of messages or updates.
+    unsigned count_;
+    /// Total bytes.
+    unsigned long long bytes_;
+};
+
+/// Traffic counters of a connection.
+struct URHO3D_API NetworkStatistics
+{
+    /// Construct.
+    NetworkStatistics();
+    
+    /// Reset all counters.
+    void Reset();
+    /// Add counters from another connection.
+    void Merge(const NetworkStatistics& statistics);
+    /// Add a round trip time sample in milliseconds to the histogram.
+    void AddRoundTripTime(float rtt);
+    /// Return a human-readable report. The context is used to look up the replicated type names.
+    String ToString(Context* context) const;
+    
+    /// Return the upper bound of a round trip time histogram bucket in milliseconds. The last bucket is unbounded.
+    static float GetRoundTripTimeBucketLimit(unsigned index);
+    
+    /// Messages sent per message ID.
+    HashMap<int, NetworkTraffic> sentMessages_;
+    /// Messages received per message ID.
+    HashMap<int, NetworkTraffic> receivedMessages_;
+    /// Replication data sent per node or component type.
+    HashMap<StringHash, NetworkTraffic> replicatedTypes_;
+    /// Replication data sent for new nodes and components.
+    NetworkTraffic initialUpdates_;
+    /// Replication data sent as reliable delta updates.
+    NetworkTraffic deltaUpdates_;
+    /// Replication data sent as latest data updates, including delta snapshots.
+    NetworkTraffic latestDataUpdates_;
+    /// Number of messages resent due to packet loss.
+    unsigned resentMessages_;
+    /// Round trip time histogram, sampled on each network update.
+    unsigned rttHistogram_[NUM_RTT_BUCKETS];
+};
+
+}
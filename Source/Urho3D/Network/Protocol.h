@@ -63,6 +63,14 @@ static const int MSG_REMOTEEVENT = 0x14;
 static const int MSG_REMOTENODEEVENT = 0x15;
 /// Server->client: info about package.
 static const int MSG_PACKAGEINFO = 0x16;
+/// Server->client: server time and latest data of nodes and components, delta encoded against snapshots acknowledged by the client.
+static const int MSG_SNAPSHOT = 0x17;
+/// Client->server: acknowledge received snapshots.
+static const int MSG_SNAPSHOTACK = 0x18;
+/// Server->client: node latest data update with the server time. Sent instead of MSG_NODELATESTDATA when the scene uses interpolation.
+static const int MSG_TIMEDNODELATESTDATA = 0x19;
+/// Server->client: component latest data update with the server time. Sent instead of MSG_COMPONENTLATESTDATA when the scene uses interpolation.
+static const int MSG_TIMEDCOMPONENTLATESTDATA = 0x1a;
 
 /// Fixed content ID for client controls update.
 static const unsigned CONTROLS_CONTENT_ID = 1;
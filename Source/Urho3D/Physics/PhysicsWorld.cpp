@@ -231,6 +231,7 @@ void PhysicsWorld::draw3dText(const btVector3& location, const char* textString)
 void PhysicsWorld::Update(float timeStep)
 {
     PROFILE(UpdatePhysics);
+    MEMORY_TAG(MT_PHYSICS);
 
     float internalTimeStep = 1.0f / fps_;
     int maxSubSteps = (int)(timeStep * fps_) + 1;
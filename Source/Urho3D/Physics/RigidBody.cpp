@@ -128,6 +128,7 @@ void RigidBody::RegisterObject(Context* context)
     ATTRIBUTE("Is Kinematic", bool, kinematic_, false, AM_DEFAULT);
     ATTRIBUTE("Is Trigger", bool, trigger_, false, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Gravity Override", GetGravityOverride, SetGravityOverride, Vector3, Vector3::ZERO, AM_DEFAULT);
+    UPDATE_ATTRIBUTE_NETWORK_ENCODING("Linear Velocity", AttributeNetworkEncoding(0.001f));
 }
 
 void RigidBody::OnSetAttribute(const AttributeInfo& attr, const Variant& src)
@@ -23,6 +23,8 @@
 #include "../Resource/BackgroundLoader.h"
 #include "../Core/Context.h"
 #include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../Core/ProcessUtils.h"
 #include "../Core/Profiler.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/ResourceEvents.h"
@@ -33,73 +35,178 @@
 namespace Urho3D
 {
 
-BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
-    owner_(owner)
-{
-}
-
-void BackgroundLoader::ThreadFunction()
-{
-    while (shouldRun_)
-    {
-        backgroundLoadMutex_.Acquire();
-        
-        // Search for a queued resource that has not been loaded yet
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-        while (i != backgroundLoadQueue_.End())
-        {
-            if (i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
-        }
-        
-        if (i == backgroundLoadQueue_.End())
-        {
-            // No resources to load found
-            backgroundLoadMutex_.Release();
-            Time::Sleep(5);
-        }
-        else
-        {
-            BackgroundLoadItem& item = i->second_;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
-            
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
-            {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
-            }
-            
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.Size())
-            {
-                for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin(); i != item.dependents_.End();
-                    ++i)
-                {
-                    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j =
-                        backgroundLoadQueue_.Find(*i);
-                    if (j != backgroundLoadQueue_.End())
-                        j->second_.dependencies_.Erase(key);
-                }
-                
-                item.dependents_.Clear();
-            }
-            
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
-        }
-    }
-}
-
+/// Worker thread of the background loader.
+class BackgroundLoaderThread : public Thread, public RefCounted
+{
+public:
+    /// Construct.
+    BackgroundLoaderThread(BackgroundLoader* owner) :
+        owner_(owner)
+    {
+    }
+    
+    /// Load resources until stopped.
+    virtual void ThreadFunction()
+    {
+        MEMORY_TAG(MT_RESOURCE);
+        owner_->ProcessItems(this);
+    }
+    
+    /// Return whether should keep running.
+    bool ShouldRun() const { return shouldRun_; }
+    
+private:
+    /// Background loader.
+    BackgroundLoader* owner_;
+};
+
+/// Memory buffer for the file data of a reloaded resource. Returns the resource name like a resource file would.
+class ReloadBuffer : public MemoryBuffer
+{
+public:
+    /// Construct.
+    ReloadBuffer(const PODVector<unsigned char>& data, const String& name) :
+        MemoryBuffer(data),
+        name_(name)
+    {
+    }
+    
+    /// Return the resource name.
+    virtual const String& GetName() const { return name_; }
+    
+private:
+    /// Resource name.
+    String name_;
+};
+
+BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
+    owner_(owner),
+    numThreads_((unsigned)Clamp((int)GetNumPhysicalCPUs() - 1, 1, 4))
+{
+}
+
+BackgroundLoader::~BackgroundLoader()
+{
+    StopThreads();
+}
+
+void BackgroundLoader::ProcessItems(BackgroundLoaderThread* thread)
+{
+    while (thread->ShouldRun())
+    {
+        backgroundLoadMutex_.Acquire();
+        // We can be sure that the item is not removed from the queue as long as it is in the "loading" state
+        BackgroundLoadItem* item = TakeNextItem();
+        backgroundLoadMutex_.Release();
+        
+        if (item)
+            LoadItem(*item);
+        else
+        {
+            // No resources to load found
+            Time::Sleep(5);
+        }
+    }
+}
+
+void BackgroundLoader::LoadItem(BackgroundLoadItem& item)
+{
+    Resource* resource = item.resource_;
+    
+    bool success = false;
+    SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+    if (file)
+    {
+        if (item.reloadResource_)
+        {
+            item.reloadData_.Resize(file->GetSize());
+            success = item.reloadData_.Empty() || file->Read(&item.reloadData_[0], item.reloadData_.Size()) == item.reloadData_.Size();
+        }
+        else
+            success = resource->BeginLoad(*file);
+    }
+    
+    // Process dependencies now
+    // Need to lock the queue again when manipulating other entries
+    MutexLock lock(backgroundLoadMutex_);
+    // Resources depending on a reload instead wait until the reload has been applied
+    if (!item.reloadResource_)
+        ReleaseDependents(MakePair(resource->GetType(), resource->GetNameHash()), item);
+    
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+}
+
+void BackgroundLoader::ReleaseDependents(const Pair<StringHash, StringHash>& key, BackgroundLoadItem& item)
+{
+    if (item.dependents_.Size())
+    {
+        for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin(); i != item.dependents_.End(); ++i)
+        {
+            HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+            if (j != backgroundLoadQueue_.End())
+                j->second_.dependencies_.Erase(key);
+        }
+        
+        item.dependents_.Clear();
+    }
+}
+
+BackgroundLoadItem* BackgroundLoader::TakeNextItem()
+{
+    // The queues may contain stale entries of resources that were already taken through the other queue
+    while (priorityQueue_.Size() || loadQueue_.Size())
+    {
+        List<Pair<StringHash, StringHash> >& queue = priorityQueue_.Size() ? priorityQueue_ : loadQueue_;
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(queue.Front());
+        queue.PopFront();
+        
+        if (i != backgroundLoadQueue_.End() && i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+        {
+            // Change the state while holding the mutex so that no other worker thread takes the same resource
+            i->second_.resource_->SetAsyncLoadState(ASYNC_LOADING);
+            return &i->second_;
+        }
+    }
+    
+    return 0;
+}
+
+void BackgroundLoader::Prioritize(const Pair<StringHash, StringHash>& key)
+{
+    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
+    if (i == backgroundLoadQueue_.End())
+        return;
+    
+    BackgroundLoadItem& item = i->second_;
+    if (item.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+    {
+        priorityQueue_.PushFront(key);
+        item.priority_ = true;
+    }
+    
+    // The dependency graph is acyclic, as a resource can only depend on resources queued after it
+    for (HashSet<Pair<StringHash, StringHash> >::ConstIterator j = item.dependencies_.Begin(); j != item.dependencies_.End(); ++j)
+        Prioritize(*j);
+}
+
+void BackgroundLoader::StartThreads()
+{
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        SharedPtr<BackgroundLoaderThread> thread(new BackgroundLoaderThread(this));
+        thread->Run();
+        threads_.Push(thread);
+    }
+}
+
+void BackgroundLoader::StopThreads()
+{
+    // A resource being loaded is finished before its thread stops
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        threads_[i]->Stop();
+    threads_.Clear();
+}
+
 bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller)
 {
     StringHash nameHash(name);
@@ -113,6 +220,8 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
     
     BackgroundLoadItem& item = backgroundLoadQueue_[key];
     item.sendEventOnFailure_ = sendEventOnFailure;
+    item.priority_ = false;
+    item.reloadAgain_ = false;
     
     // Make sure the pointer is non-null and is a Resource subclass
     item.resource_ = DynamicCast<Resource>(owner_->GetContext()->CreateObject(type));
@@ -138,7 +247,8 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
     item.resource_->SetName(name);
     item.resource_->SetAsyncLoadState(ASYNC_QUEUED);
     
-    // If this is a resource calling for the background load of more resources, mark the dependency as necessary
+    // If this is a resource calling for the background load of more resources, mark the dependency as necessary.
+    // The caller can not finish before its dependencies are loaded, so load them before other queued resources
     if (caller)
     {
         Pair<StringHash, StringHash> callerKey = MakePair(caller->GetType(), caller->GetNameHash());
@@ -148,14 +258,63 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
             BackgroundLoadItem& callerItem = j->second_;
             item.dependents_.Insert(callerKey);
             callerItem.dependencies_.Insert(key);
+            item.priority_ = true;
         }
         else
             LOGWARNING("Resource " + caller->GetName() + " requested for a background loaded resource but was not in the background load queue");
     }
     
-    // Start the background loader thread now
+    if (item.priority_)
+        priorityQueue_.Push(key);
+    else
+        loadQueue_.Push(key);
+    
+    // Start the background loader threads now
     if (!IsStarted())
-        Run();
+        StartThreads();
+    
+    return true;
+}
+
+bool BackgroundLoader::QueueReload(Resource* resource, const PODVector<Resource*>& dependencies)
+{
+    Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
+    
+    MutexLock lock(backgroundLoadMutex_);
+    
+    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
+    if (i != backgroundLoadQueue_.End())
+    {
+        // If the file was already read for a pending reload, read it again once that reload has been applied
+        if (i->second_.reloadResource_ && i->second_.resource_->GetAsyncLoadState() != ASYNC_QUEUED)
+            i->second_.reloadAgain_ = true;
+        return false;
+    }
+    
+    BackgroundLoadItem& item = backgroundLoadQueue_[key];
+    item.sendEventOnFailure_ = true;
+    item.priority_ = false;
+    item.reloadAgain_ = false;
+    item.reloadResource_ = resource;
+    item.resource_ = new Resource(owner_->GetContext());
+    item.resource_->SetName(resource->GetName());
+    item.resource_->SetAsyncLoadState(ASYNC_QUEUED);
+    
+    for (unsigned j = 0; j < dependencies.Size(); ++j)
+    {
+        Pair<StringHash, StringHash> dependencyKey = MakePair(dependencies[j]->GetType(), dependencies[j]->GetNameHash());
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator k = backgroundLoadQueue_.Find(dependencyKey);
+        if (k != backgroundLoadQueue_.End() && k->second_.reloadResource_)
+        {
+            k->second_.dependents_.Insert(key);
+            item.dependencies_.Insert(dependencyKey);
+        }
+    }
+    
+    loadQueue_.Push(key);
+    
+    if (!IsStarted())
+        StartThreads();
     
     return true;
 }
@@ -164,11 +323,14 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 {
     backgroundLoadMutex_.Acquire();
     
-    // Check if the resource in question is being background loaded
+    // Check if the resource in question is being background loaded. A resource being reloaded remains usable, and the
+    // reload is applied when finishing resources
     Pair<StringHash, StringHash> key = MakePair(type, nameHash);
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
-    if (i != backgroundLoadQueue_.End())
+    if (i != backgroundLoadQueue_.End() && !i->second_.reloadResource_)
     {
+        // The main thread is blocked until the resource and its dependencies are loaded, so load them first
+        Prioritize(key);
         backgroundLoadMutex_.Release();
         
         {
@@ -222,12 +384,30 @@ void BackgroundLoader::FinishResources(int maxMs)
                 ++i;
             else
             {
+                BackgroundLoadItem& item = i->second_;
+                
                 // Finishing a resource may need it to wait for other resources to load, in which case we can not
                 // hold on to the mutex
                 backgroundLoadMutex_.Release();
-                FinishBackgroundLoading(i->second_);
+                if (item.reloadResource_)
+                    FinishReload(item);
+                else
+                    FinishBackgroundLoading(item);
                 backgroundLoadMutex_.Acquire();
-                i = backgroundLoadQueue_.Erase(i);
+                
+                if (item.reloadAgain_)
+                {
+                    item.reloadAgain_ = false;
+                    item.resource_->SetAsyncLoadState(ASYNC_QUEUED);
+                    loadQueue_.Push(i->first_);
+                    ++i;
+                }
+                else
+                {
+                    if (item.reloadResource_)
+                        ReleaseDependents(i->first_, item);
+                    i = backgroundLoadQueue_.Erase(i);
+                }
             }
             
             // Break when the time limit passed so that we keep sufficient FPS
@@ -239,6 +419,20 @@ void BackgroundLoader::FinishResources(int maxMs)
     }
 }
 
+void BackgroundLoader::SetNumThreads(unsigned num)
+{
+    if (!num)
+        num = 1;
+    if (num == numThreads_)
+        return;
+    
+    bool restart = IsStarted();
+    StopThreads();
+    numThreads_ = num;
+    if (restart)
+        StartThreads();
+}
+
 unsigned BackgroundLoader::GetNumQueuedResources() const
 {
     MutexLock lock(backgroundLoadMutex_);
@@ -293,6 +487,28 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
     // Store to the cache; use same mechanism as for manual resources
     if (success || owner_->GetReturnFailedResources())
         owner_->AddManualResource(resource);
-}
-
-}
+}
+
+void BackgroundLoader::FinishReload(BackgroundLoadItem& item)
+{
+    Resource* resource = item.reloadResource_;
+    
+    // Skip if the resource was released from the cache while its file was read
+    if (owner_->GetExistingResource(resource->GetType(), resource->GetName()) == resource)
+    {
+        LOGDEBUG("Reloading changed resource " + resource->GetName());
+        
+        if (item.resource_->GetAsyncLoadState() == ASYNC_SUCCESS)
+        {
+            ReloadBuffer buffer(item.reloadData_, resource->GetName());
+            owner_->ApplyReload(resource, &buffer);
+        }
+        else
+            owner_->ApplyReload(resource, 0);
+    }
+    
+    item.resource_->SetAsyncLoadState(ASYNC_DONE);
+    item.reloadData_.Clear();
+}
+
+}
@@ -24,15 +24,16 @@
 
 #include "../Container/HashMap.h"
 #include "../Container/HashSet.h"
+#include "../Container/List.h"
 #include "../Core/Mutex.h"
 #include "../Container/Ptr.h"
 #include "../Container/RefCounted.h"
 #include "../Math/StringHash.h"
-#include "../Core/Thread.h"
 
 namespace Urho3D
 {
 
+class BackgroundLoaderThread;
 class Resource;
 class ResourceCache;
 
@@ -47,31 +48,64 @@ struct BackgroundLoadItem
     HashSet<Pair<StringHash, StringHash> > dependents_;
     /// Whether to send failure event.
     bool sendEventOnFailure_;
+    /// Whether is in the priority queue.
+    bool priority_;
+    /// Cached resource being reloaded, or null when loading a new resource. For a reload only the file is read on a worker thread, as the resource may be in use; the item's own resource then only tracks the load state.
+    SharedPtr<Resource> reloadResource_;
+    /// File data read for reloading.
+    PODVector<unsigned char> reloadData_;
+    /// Whether the file changed again after it was read for reloading.
+    bool reloadAgain_;
 };
 
-/// Background loader of resources. Owned by the ResourceCache.
-class BackgroundLoader : public RefCounted, public Thread
+/// Background loader of resources. Owned by the ResourceCache. Runs the BeginLoad() of queued resources on a pool of worker threads.
+class BackgroundLoader : public RefCounted
 {
+    friend class BackgroundLoaderThread;
+    
 public:
     /// Construct.
     BackgroundLoader(ResourceCache* owner);
-    
-    /// Resource background loading loop.
-    virtual void ThreadFunction();
+    /// Destruct. Stop the worker threads.
+    ~BackgroundLoader();
     
     /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
     bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller);
+    /// Queue reloading of a cached resource after its file changed. The reload is applied after the resources it depends on, which must have been queued for reloading first. Return true if queued (not a duplicate.)
+    bool QueueReload(Resource* resource, const PODVector<Resource*>& dependencies);
     /// Wait and finish possible loading of a resource when being requested from the cache.
     void WaitForResource(StringHash type, StringHash nameHash);
     /// Process resources that are ready to finish.
     void FinishResources(int maxMs);
+    /// Set number of worker threads. Restarts the worker threads if they are running.
+    void SetNumThreads(unsigned num);
     
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
+    /// Return number of worker threads.
+    unsigned GetNumThreads() const { return numThreads_; }
+    /// Return whether the worker threads have been started.
+    bool IsStarted() const { return !threads_.Empty(); }
     
 private:
+    /// Resource background loading loop of a worker thread.
+    void ProcessItems(BackgroundLoaderThread* thread);
+    /// Load one resource on a worker thread.
+    void LoadItem(BackgroundLoadItem& item);
+    /// Return the next resource to load, or null if none. Priority resources are returned first. Called with the mutex held.
+    BackgroundLoadItem* TakeNextItem();
+    /// Move a queued resource and the resources it depends on to the front of the priority queue. Called with the mutex held.
+    void Prioritize(const Pair<StringHash, StringHash>& key);
+    /// Start the worker threads.
+    void StartThreads();
+    /// Stop the worker threads.
+    void StopThreads();
+    /// Remove a resource from the dependencies of the resources waiting for it. Called with the mutex held.
+    void ReleaseDependents(const Pair<StringHash, StringHash>& key, BackgroundLoadItem& item);
     /// Finish one background loaded resource.
     void FinishBackgroundLoading(BackgroundLoadItem& item);
+    /// Apply the reload of a resource from its file data.
+    void FinishReload(BackgroundLoadItem& item);
     
     /// Resource cache.
     ResourceCache* owner_;
@@ -79,6 +113,14 @@ private:
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem> backgroundLoadQueue_;
+    /// Resources waiting for BeginLoad() in queuing order.
+    List<Pair<StringHash, StringHash> > loadQueue_;
+    /// Resources waiting for BeginLoad() that block the finishing of other resources or the main thread. Loaded before the load queue.
+    List<Pair<StringHash, StringHash> > priorityQueue_;
+    /// Worker threads.
+    Vector<SharedPtr<BackgroundLoaderThread> > threads_;
+    /// Number of worker threads to start.
+    unsigned numThreads_;
 };
 
 }
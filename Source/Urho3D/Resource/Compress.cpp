@@ -0,0 +1,556 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/WorkQueue.h"
+#include "../Resource/Compress.h"
+#include "../Resource/Decompress.h"
+
+#include <cstring>
+#if defined(URHO3D_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define URHO3D_COMPRESS_SSE2
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Number of least squares refinement passes for DXT colour endpoints.
+static const unsigned DXT_REFINE_ITERATIONS = 2;
+
+/// Parameters for compressing rows of blocks.
+struct CompressParams
+{
+    /// Destination blocks.
+    unsigned char* dest_;
+    /// Source pixel data.
+    const unsigned char* src_;
+    /// Image width.
+    int width_;
+    /// Image height.
+    int height_;
+    /// Number of source color components.
+    unsigned components_;
+    /// Compression format.
+    CompressedFormat format_;
+};
+
+/// Read a 4x4 block of pixels as RGBA. Pixels outside the image repeat the edge pixels, so that they do not affect the result.
+static void GatherBlock(unsigned char* rgba, const unsigned char* src, int width, int height, unsigned components, int x, int y)
+{
+    for (int py = 0; py < 4; ++py)
+    {
+        int sy = Min(y + py, height - 1);
+        for (int px = 0; px < 4; ++px)
+        {
+            const unsigned char* s = src + (sy * width + Min(x + px, width - 1)) * components;
+            unsigned char* d = rgba + (py * 4 + px) * 4;
+            
+            switch (components)
+            {
+            case 1:
+                d[0] = d[1] = d[2] = s[0];
+                d[3] = 255;
+                break;
+                
+            case 2:
+                d[0] = d[1] = d[2] = s[0];
+                d[3] = s[1];
+                break;
+                
+            case 3:
+                d[0] = s[0];
+                d[1] = s[1];
+                d[2] = s[2];
+                d[3] = 255;
+                break;
+                
+            default:
+                memcpy(d, s, 4);
+                break;
+            }
+        }
+    }
+}
+
+/// Quantize a color to 5:6:5 bits with rounding.
+static inline unsigned Pack565(float r, float g, float b)
+{
+    int r5 = Clamp((int)(r * (31.0f / 255.0f) + 0.5f), 0, 31);
+    int g6 = Clamp((int)(g * (63.0f / 255.0f) + 0.5f), 0, 63);
+    int b5 = Clamp((int)(b * (31.0f / 255.0f) + 0.5f), 0, 31);
+    return (unsigned)((r5 << 11) | (g6 << 5) | b5);
+}
+
+/// Expand a 5:6:5 color to RGBA bytes the same way as the decompressor.
+static inline void Unpack565(unsigned value, unsigned char* colour)
+{
+    unsigned char red = (unsigned char)((value >> 11) & 0x1f);
+    unsigned char green = (unsigned char)((value >> 5) & 0x3f);
+    unsigned char blue = (unsigned char)(value & 0x1f);
+    colour[0] = (red << 3) | (red >> 2);
+    colour[1] = (green << 2) | (green >> 4);
+    colour[2] = (blue << 3) | (blue >> 2);
+    colour[3] = 255;
+}
+
+/// Build the colour palette of a DXT block the same way as the decompressor.
+static void BuildPalette(unsigned char* palette, unsigned colour0, unsigned colour1, bool fourColours)
+{
+    Unpack565(colour0, palette);
+    Unpack565(colour1, palette + 4);
+    
+    for (int i = 0; i < 3; ++i)
+    {
+        int c = palette[i];
+        int d = palette[4 + i];
+        
+        if (fourColours)
+        {
+            palette[8 + i] = (unsigned char)((2 * c + d) / 3);
+            palette[12 + i] = (unsigned char)((c + 2 * d) / 3);
+        }
+        else
+        {
+            palette[8 + i] = (unsigned char)((c + d) / 2);
+            palette[12 + i] = 0;
+        }
+    }
+    
+    palette[11] = 255;
+    palette[15] = fourColours ? 255 : 0;
+}
+
+/// Choose the nearest palette colour for each pixel by RGB distance. Transparent pixels, marked in the bitmask, get index 3 and are not counted in the error. Return the total squared error.
+static unsigned FindColourIndices(const unsigned char* rgba, const unsigned char* palette, unsigned numColours, unsigned transparentMask,
+    unsigned char* indices)
+{
+    int distances[16];
+    
+    #ifdef URHO3D_COMPRESS_SSE2
+    // Compare 4 pixels at a time against each palette colour. The squared differences of R and G, and of B and the
+    // zeroed alpha, are summed pairwise by the multiply-add, then combined into one distance per pixel
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rgbMask = _mm_set1_epi32(0x00ffffff);
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128i pixels = _mm_and_si128(_mm_loadu_si128((const __m128i*)(rgba + i * 4)), rgbMask);
+        __m128i low = _mm_unpacklo_epi8(pixels, zero);
+        __m128i high = _mm_unpackhi_epi8(pixels, zero);
+        __m128i bestDistance = _mm_set1_epi32(0x7fffffff);
+        __m128i bestIndex = zero;
+        
+        for (unsigned j = 0; j < numColours; ++j)
+        {
+            int colour;
+            memcpy(&colour, palette + j * 4, 4);
+            __m128i paletteColour = _mm_unpacklo_epi8(_mm_and_si128(_mm_set1_epi32(colour), rgbMask), zero);
+            __m128i lowDiff = _mm_sub_epi16(low, paletteColour);
+            __m128i highDiff = _mm_sub_epi16(high, paletteColour);
+            __m128 lowSums = _mm_castsi128_ps(_mm_madd_epi16(lowDiff, lowDiff));
+            __m128 highSums = _mm_castsi128_ps(_mm_madd_epi16(highDiff, highDiff));
+            __m128i distance = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(lowSums, highSums, _MM_SHUFFLE(2, 0, 2, 0))),
+                _mm_castps_si128(_mm_shuffle_ps(lowSums, highSums, _MM_SHUFFLE(3, 1, 3, 1))));
+            
+            __m128i closer = _mm_cmplt_epi32(distance, bestDistance);
+            bestDistance = _mm_or_si128(_mm_and_si128(closer, distance), _mm_andnot_si128(closer, bestDistance));
+            bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(j)), _mm_andnot_si128(closer, bestIndex));
+        }
+        
+        int bestIndices[4];
+        _mm_storeu_si128((__m128i*)&distances[i], bestDistance);
+        _mm_storeu_si128((__m128i*)bestIndices, bestIndex);
+        for (int j = 0; j < 4; ++j)
+            indices[i + j] = (unsigned char)bestIndices[j];
+    }
+    #else
+    for (int i = 0; i < 16; ++i)
+    {
+        const unsigned char* pixel = rgba + i * 4;
+        distances[i] = M_MAX_INT;
+        
+        for (unsigned j = 0; j < numColours; ++j)
+        {
+            const unsigned char* colour = palette + j * 4;
+            int dr = (int)pixel[0] - colour[0];
+            int dg = (int)pixel[1] - colour[1];
+            int db = (int)pixel[2] - colour[2];
+            int distance = dr * dr + dg * dg + db * db;
+            if (distance < distances[i])
+            {
+                distances[i] = distance;
+                indices[i] = (unsigned char)j;
+            }
+        }
+    }
+    #endif
+    
+    unsigned error = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        if (transparentMask & (1 << i))
+            indices[i] = 3;
+        else
+            error += distances[i];
+    }
+    
+    return error;
+}
+
+/// Order the endpoints for the block mode, build the palette and choose the indices. Return the total squared error.
+static unsigned EvaluateEndpoints(const unsigned char* rgba, unsigned& colour0, unsigned& colour1, bool isDxt1, unsigned transparentMask,
+    unsigned char* indices)
+{
+    // DXT1 selects the 4-colour mode when the first endpoint is greater, and the 3-colour mode with transparency otherwise.
+    // DXT3 and DXT5 always use the 4-colour mode
+    bool fourColours = !isDxt1 || !transparentMask;
+    if (isDxt1 && (fourColours ? colour0 < colour1 : colour0 > colour1))
+        Swap(colour0, colour1);
+    if (isDxt1 && fourColours && colour0 == colour1)
+        fourColours = false;
+    
+    unsigned char palette[16];
+    BuildPalette(palette, colour0, colour1, fourColours);
+    return FindColourIndices(rgba, palette, fourColours ? 4 : 3, transparentMask, indices);
+}
+
+/// Compress the colour part of a DXT block. DXT1 blocks with pixels below half opacity use 1-bit alpha.
+static void CompressColourDXT(unsigned char* dest, const unsigned char* rgba, bool isDxt1)
+{
+    unsigned transparentMask = 0;
+    if (isDxt1)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            if (rgba[i * 4 + 3] < 128)
+                transparentMask |= 1 << i;
+        }
+    }
+    
+    unsigned colour0 = 0;
+    unsigned colour1 = 0;
+    unsigned char indices[16];
+    
+    if (transparentMask == 0xffff)
+    {
+        // Fully transparent: black endpoints in the 3-colour mode, all pixels use the transparent index
+        memset(indices, 3, sizeof indices);
+    }
+    else
+    {
+        // Find the principal axis of the opaque pixel colours
+        float mean[3] = { 0.0f, 0.0f, 0.0f };
+        unsigned count = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (transparentMask & (1 << i))
+                continue;
+            for (int c = 0; c < 3; ++c)
+                mean[c] += rgba[i * 4 + c];
+            ++count;
+        }
+        for (int c = 0; c < 3; ++c)
+            mean[c] /= (float)count;
+        
+        // Covariance as xx, xy, xz, yy, yz, zz
+        float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; ++i)
+        {
+            if (transparentMask & (1 << i))
+                continue;
+            float r = rgba[i * 4] - mean[0];
+            float g = rgba[i * 4 + 1] - mean[1];
+            float b = rgba[i * 4 + 2] - mean[2];
+            covariance[0] += r * r;
+            covariance[1] += r * g;
+            covariance[2] += r * b;
+            covariance[3] += g * g;
+            covariance[4] += g * b;
+            covariance[5] += b * b;
+        }
+        
+        // Power iteration, starting from the luminance direction
+        float axis[3] = { 1.0f, 1.0f, 1.0f };
+        for (int i = 0; i < 8; ++i)
+        {
+            float x = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+            float y = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+            float z = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+            float largest = Max(Max(Abs(x), Abs(y)), Abs(z));
+            if (largest < M_EPSILON)
+                break;
+            axis[0] = x / largest;
+            axis[1] = y / largest;
+            axis[2] = z / largest;
+        }
+        float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        for (int c = 0; c < 3; ++c)
+            axis[c] /= length;
+        
+        // Use the extent of the colours along the axis as the endpoints
+        float minT = M_INFINITY;
+        float maxT = -M_INFINITY;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (transparentMask & (1 << i))
+                continue;
+            float t = (rgba[i * 4] - mean[0]) * axis[0] + (rgba[i * 4 + 1] - mean[1]) * axis[1] + (rgba[i * 4 + 2] - mean[2]) * axis[2];
+            minT = Min(minT, t);
+            maxT = Max(maxT, t);
+        }
+        
+        colour0 = Pack565(mean[0] + axis[0] * maxT, mean[1] + axis[1] * maxT, mean[2] + axis[2] * maxT);
+        colour1 = Pack565(mean[0] + axis[0] * minT, mean[1] + axis[1] * minT, mean[2] + axis[2] * minT);
+        unsigned error = EvaluateEndpoints(rgba, colour0, colour1, isDxt1, transparentMask, indices);
+        
+        // Refine the endpoints by least squares fitting to the chosen indices, and keep the result if the error decreases
+        for (unsigned iteration = 0; iteration < DXT_REFINE_ITERATIONS && error; ++iteration)
+        {
+            bool fourColours = !isDxt1 || (colour0 > colour1);
+            // Weight of the first endpoint for each index
+            static const float weights4[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+            static const float weights3[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+            const float* weights = fourColours ? weights4 : weights3;
+            
+            float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+            float ax[3] = { 0.0f, 0.0f, 0.0f };
+            float bx[3] = { 0.0f, 0.0f, 0.0f };
+            for (int i = 0; i < 16; ++i)
+            {
+                if (transparentMask & (1 << i))
+                    continue;
+                float a = weights[indices[i]];
+                float b = 1.0f - a;
+                aa += a * a;
+                ab += a * b;
+                bb += b * b;
+                for (int c = 0; c < 3; ++c)
+                {
+                    ax[c] += a * rgba[i * 4 + c];
+                    bx[c] += b * rgba[i * 4 + c];
+                }
+            }
+            
+            float determinant = aa * bb - ab * ab;
+            if (Abs(determinant) < M_EPSILON)
+                break;
+            float invDeterminant = 1.0f / determinant;
+            float end0[3], end1[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                end0[c] = (ax[c] * bb - bx[c] * ab) * invDeterminant;
+                end1[c] = (bx[c] * aa - ax[c] * ab) * invDeterminant;
+            }
+            
+            unsigned newColour0 = Pack565(end0[0], end0[1], end0[2]);
+            unsigned newColour1 = Pack565(end1[0], end1[1], end1[2]);
+            unsigned char newIndices[16];
+            unsigned newError = EvaluateEndpoints(rgba, newColour0, newColour1, isDxt1, transparentMask, newIndices);
+            if (newError >= error)
+                break;
+            
+            colour0 = newColour0;
+            colour1 = newColour1;
+            memcpy(indices, newIndices, sizeof indices);
+            error = newError;
+        }
+    }
+    
+    dest[0] = (unsigned char)(colour0 & 0xff);
+    dest[1] = (unsigned char)(colour0 >> 8);
+    dest[2] = (unsigned char)(colour1 & 0xff);
+    dest[3] = (unsigned char)(colour1 >> 8);
+    for (int i = 0; i < 4; ++i)
+        dest[4 + i] = (unsigned char)(indices[i * 4] | (indices[i * 4 + 1] << 2) | (indices[i * 4 + 2] << 4) | (indices[i * 4 + 3] << 6));
+}
+
+/// Compress the explicit 4-bit alpha of a DXT3 block.
+static void CompressAlphaDXT3(unsigned char* dest, const unsigned char* rgba)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        unsigned lo = (rgba[i * 8 + 3] * 15 + 127) / 255;
+        unsigned hi = (rgba[i * 8 + 7] * 15 + 127) / 255;
+        dest[i] = (unsigned char)(lo | (hi << 4));
+    }
+}
+
+/// Choose the nearest alpha code for each pixel. Return the total squared error.
+static unsigned FindAlphaIndices(const unsigned char* rgba, const unsigned char* codes, unsigned char* indices)
+{
+    unsigned error = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int alpha = rgba[i * 4 + 3];
+        int bestDistance = M_MAX_INT;
+        for (int j = 0; j < 8; ++j)
+        {
+            int distance = (alpha - codes[j]) * (alpha - codes[j]);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                indices[i] = (unsigned char)j;
+            }
+        }
+        error += bestDistance;
+    }
+    
+    return error;
+}
+
+/// Build the alpha codebook of a DXT5 block the same way as the decompressor.
+static void BuildAlphaCodes(unsigned char* codes, int alpha0, int alpha1)
+{
+    codes[0] = (unsigned char)alpha0;
+    codes[1] = (unsigned char)alpha1;
+    if (alpha0 <= alpha1)
+    {
+        for (int i = 1; i < 5; ++i)
+            codes[1 + i] = (unsigned char)(((5 - i) * alpha0 + i * alpha1) / 5);
+        codes[6] = 0;
+        codes[7] = 255;
+    }
+    else
+    {
+        for (int i = 1; i < 7; ++i)
+            codes[1 + i] = (unsigned char)(((7 - i) * alpha0 + i * alpha1) / 7);
+    }
+}
+
+/// Compress the interpolated alpha of a DXT5 block. Both the 8-alpha mode and the 6-alpha mode with exact 0 and 255 are tried.
+static void CompressAlphaDXT5(unsigned char* dest, const unsigned char* rgba)
+{
+    int minAlpha = 255, maxAlpha = 0;
+    int minInner = 255, maxInner = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int alpha = rgba[i * 4 + 3];
+        minAlpha = Min(minAlpha, alpha);
+        maxAlpha = Max(maxAlpha, alpha);
+        if (alpha != 0 && alpha != 255)
+        {
+            minInner = Min(minInner, alpha);
+            maxInner = Max(maxInner, alpha);
+        }
+    }
+    if (minInner > maxInner)
+    {
+        minInner = 0;
+        maxInner = 255;
+    }
+    
+    unsigned char codes[8];
+    unsigned char indices[16];
+    int alpha0 = maxAlpha;
+    int alpha1 = minAlpha;
+    unsigned error = 0;
+    if (alpha0 > alpha1)
+    {
+        BuildAlphaCodes(codes, alpha0, alpha1);
+        error = FindAlphaIndices(rgba, codes, indices);
+    }
+    else
+        memset(indices, 0, sizeof indices);
+    
+    if (error)
+    {
+        unsigned char innerCodes[8];
+        unsigned char innerIndices[16];
+        BuildAlphaCodes(innerCodes, minInner, maxInner);
+        unsigned innerError = FindAlphaIndices(rgba, innerCodes, innerIndices);
+        if (innerError < error)
+        {
+            alpha0 = minInner;
+            alpha1 = maxInner;
+            memcpy(indices, innerIndices, sizeof indices);
+        }
+    }
+    
+    dest[0] = (unsigned char)alpha0;
+    dest[1] = (unsigned char)alpha1;
+    for (int i = 0; i < 2; ++i)
+    {
+        unsigned value = 0;
+        for (int j = 0; j < 8; ++j)
+            value |= (unsigned)indices[i * 8 + j] << (3 * j);
+        for (int j = 0; j < 3; ++j)
+            dest[2 + i * 3 + j] = (unsigned char)(value >> (8 * j));
+    }
+}
+
+static void CompressBlockRowsDXT(const void* params, int startRow, int endRow)
+{
+    const CompressParams& p = *reinterpret_cast<const CompressParams*>(params);
+    unsigned bytesPerBlock = p.format_ == CF_DXT1 ? 8 : 16;
+    unsigned blocksPerRow = (p.width_ + 3) / 4;
+    
+    for (int row = startRow; row < endRow; ++row)
+    {
+        unsigned char* destBlock = p.dest_ + row * blocksPerRow * bytesPerBlock;
+        
+        for (int x = 0; x < p.width_; x += 4)
+        {
+            unsigned char rgba[16 * 4];
+            GatherBlock(rgba, p.src_, p.width_, p.height_, p.components_, x, row * 4);
+            
+            switch (p.format_)
+            {
+            case CF_DXT1:
+                CompressColourDXT(destBlock, rgba, true);
+                break;
+                
+            case CF_DXT3:
+                CompressAlphaDXT3(destBlock, rgba);
+                CompressColourDXT(destBlock + 8, rgba, false);
+                break;
+                
+            default:
+                CompressAlphaDXT5(destBlock, rgba);
+                CompressColourDXT(destBlock + 8, rgba, false);
+                break;
+            }
+            
+            destBlock += bytesPerBlock;
+        }
+    }
+}
+
+unsigned GetCompressedImageSizeDXT(int width, int height, CompressedFormat format)
+{
+    return ((width + 3) / 4) * ((height + 3) / 4) * (format == CF_DXT1 ? 8 : 16);
+}
+
+void CompressImageDXT(unsigned char* dest, const unsigned char* src, int width, int height, unsigned components, CompressedFormat format,
+    WorkQueue* queue)
+{
+    CompressParams params;
+    params.dest_ = dest;
+    params.src_ = src;
+    params.width_ = width;
+    params.height_ = height;
+    params.components_ = components;
+    params.format_ = format;
+    ProcessImageRows(queue, (height + 3) / 4, width * 16, CompressBlockRowsDXT, &params);
+}
+
+}
@@ -0,0 +1,37 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Resource/Image.h"
+
+namespace Urho3D
+{
+
+class WorkQueue;
+
+/// Return the size in bytes of an image compressed to DXT1, DXT3 or DXT5.
+URHO3D_API unsigned GetCompressedImageSizeDXT(int width, int height, CompressedFormat format);
+/// Compress an image with 1-4 components to DXT1, DXT3 or DXT5. Images with 1 or 2 components are treated as luminance and luminance-alpha. DXT1 uses 1-bit alpha for blocks with pixels below half opacity. If a work queue is given, large images are compressed in parallel when called from the main thread.
+URHO3D_API void CompressImageDXT(unsigned char* dest, const unsigned char* src, int width, int height, unsigned components, CompressedFormat format, WorkQueue* queue = 0);
+
+}
@@ -20,13 +20,94 @@
 // THE SOFTWARE.
 //
 
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Resource/Decompress.h"
 
-// DXT decompression based on the Squish library, modified for Urho3D
+#include <cstring>
 
 namespace Urho3D
 {
 
+/// Minimum output size in bytes for processing image rows on the worker threads.
+static const unsigned MIN_PARALLEL_IMAGE_BYTES = 256 * 1024;
+
+/// Range of image rows to process on a worker thread.
+struct ImageRowRange
+{
+    /// Row processing function.
+    ImageRowFunction function_;
+    /// Parameter structure.
+    const void* params_;
+    /// First row.
+    int startRow_;
+    /// Row after the last.
+    int endRow_;
+};
+
+/// Parameters for decompressing rows of compressed blocks.
+struct BlockRowParams
+{
+    /// Destination RGBA pixel data.
+    unsigned char* dest_;
+    /// Compressed blocks.
+    const unsigned char* blocks_;
+    /// Image width.
+    int width_;
+    /// Image height.
+    int height_;
+    /// Compression format.
+    CompressedFormat format_;
+};
+
+void ProcessImageRowsWork(const WorkItem* item, unsigned threadIndex)
+{
+    const ImageRowRange* range = reinterpret_cast<const ImageRowRange*>(item->start_);
+    range->function_(range->params_, range->startRow_, range->endRow_);
+}
+
+void ProcessImageRows(WorkQueue* queue, int numRows, unsigned rowBytes, ImageRowFunction function, const void* params)
+{
+    if (queue && queue->GetNumThreads() && numRows > 1 && numRows * rowBytes >= MIN_PARALLEL_IMAGE_BYTES &&
+        Thread::IsMainThread())
+    {
+        int numRanges = Min((int)queue->GetNumThreads() + 1, numRows);
+        int rowsPerRange = numRows / numRanges;
+        PODVector<ImageRowRange> ranges(numRanges);
+        
+        int startRow = 0;
+        for (int i = 0; i < numRanges; ++i)
+        {
+            ImageRowRange& range = ranges[i];
+            range.function_ = function;
+            range.params_ = params;
+            range.startRow_ = startRow;
+            range.endRow_ = i < numRanges - 1 ? startRow + rowsPerRange : numRows;
+            startRow = range.endRow_;
+            
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = ProcessImageRowsWork;
+            item->start_ = &range;
+            queue->AddWorkItem(item);
+        }
+        
+        // Help the worker threads, then wait for all ranges to finish
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+        function(params, 0, numRows);
+}
+
+/// Copy the part of a decompressed 4x4 RGBA block that is inside the image.
+static void CopyPartialBlock(unsigned char* dest, unsigned pitch, const unsigned char* block, int columns, int rows)
+{
+    for (int y = 0; y < rows; ++y)
+        memcpy(dest + y * pitch, block + y * 16, columns * 4);
+}
+
+// DXT decompression based on the Squish library, modified for Urho3D
+
 /* -----------------------------------------------------------------------------
 
     Copyright (c) 2006 Simon Brown                          si@sjbrown.co.uk
@@ -72,7 +153,7 @@ static int Unpack565( unsigned char const* packed, unsigned char* colour )
     return value;
 }
 
-static void DecompressColourDXT( unsigned char* rgba, void const* block, bool isDxt1 )
+static void DecompressColourDXT( unsigned char* rgba, unsigned pitch, void const* block, bool isDxt1 )
 {
     // get the block bytes
     unsigned char const* bytes = reinterpret_cast< unsigned char const* >( block );
@@ -104,29 +185,23 @@ static void DecompressColourDXT( unsigned char* rgba, void const* block, bool is
     codes[8 + 3] = 255;
     codes[12 + 3] = ( isDxt1 && a <= b ) ? 0 : 255;
     
-    // unpack the indices
-    unsigned char indices[16];
+    // store out the colours a row at a time, indexing the codes as whole pixels
+    unsigned palette[4];
+    memcpy( palette, codes, sizeof( palette ) );
     for( int i = 0; i < 4; ++i )
     {
-        unsigned char* ind = indices + 4*i;
         unsigned char packed = bytes[4 + i];
+        unsigned row[4];
         
-        ind[0] = packed & 0x3;
-        ind[1] = ( packed >> 2 ) & 0x3;
-        ind[2] = ( packed >> 4 ) & 0x3;
-        ind[3] = ( packed >> 6 ) & 0x3;
-    }
-    
-    // store out the colours
-    for( int i = 0; i < 16; ++i )
-    {
-        unsigned char offset = 4*indices[i];
-        for( int j = 0; j < 4; ++j )
-            rgba[4*i + j] = codes[offset + j];
+        row[0] = palette[packed & 0x3];
+        row[1] = palette[( packed >> 2 ) & 0x3];
+        row[2] = palette[( packed >> 4 ) & 0x3];
+        row[3] = palette[( packed >> 6 ) & 0x3];
+        memcpy( rgba + i*pitch, row, sizeof( row ) );
     }
 }
 
-static void DecompressAlphaDXT3( unsigned char* rgba, void const* block )
+static void DecompressAlphaDXT3( unsigned char* rgba, unsigned pitch, void const* block )
 {
     unsigned char const* bytes = reinterpret_cast< unsigned char const* >( block );
     
@@ -141,12 +216,13 @@ static void DecompressAlphaDXT3( unsigned char* rgba, void const* block )
         unsigned char hi = quant & 0xf0;
         
         // convert back up to bytes
-        rgba[8*i + 3] = lo | ( lo << 4 );
-        rgba[8*i + 7] = hi | ( hi >> 4 );
+        unsigned char* pixel = rgba + ( i >> 1 )*pitch + 8*( i & 1 );
+        pixel[3] = lo | ( lo << 4 );
+        pixel[7] = hi | ( hi >> 4 );
     }
 }
 
-static void DecompressAlphaDXT5( unsigned char* rgba, void const* block )
+static void DecompressAlphaDXT5( unsigned char* rgba, unsigned pitch, void const* block )
 {
     // get the two alpha values
     unsigned char const* bytes = reinterpret_cast< unsigned char const* >( block );
@@ -196,10 +272,10 @@ static void DecompressAlphaDXT5( unsigned char* rgba, void const* block )
     
     // write out the indexed codebook values
     for( int i = 0; i < 16; ++i )
-        rgba[4*i + 3] = codes[indices[i]];
+        rgba[( i >> 2 )*pitch + 4*( i & 3 ) + 3] = codes[indices[i]];
 }
 
-static void DecompressDXT( unsigned char* rgba, const void* block, CompressedFormat format)
+static void DecompressDXT( unsigned char* rgba, unsigned pitch, const void* block, CompressedFormat format)
 {
     // get the block locations
     void const* colourBlock = block;
@@ -208,65 +284,59 @@ static void DecompressDXT( unsigned char* rgba, const void* block, CompressedFor
         colourBlock = reinterpret_cast< unsigned char const* >( block ) + 8;
     
     // decompress colour
-    DecompressColourDXT( rgba, colourBlock, format == CF_DXT1 );
+    DecompressColourDXT( rgba, pitch, colourBlock, format == CF_DXT1 );
     
     // decompress alpha separately if necessary
     if( format == CF_DXT3 )
-        DecompressAlphaDXT3( rgba, alphaBock );
+        DecompressAlphaDXT3( rgba, pitch, alphaBock );
     else if ( format == CF_DXT5 )
-        DecompressAlphaDXT5( rgba, alphaBock );
+        DecompressAlphaDXT5( rgba, pitch, alphaBock );
 }
 
-void DecompressImageDXT( unsigned char* rgba, const void* blocks, int width, int height, int depth, CompressedFormat format )
+static void DecompressBlockRowsDXT(const void* params, int startRow, int endRow)
 {
-    // initialise the block input
-    unsigned char const* sourceBlock = reinterpret_cast< unsigned char const* >( blocks );
-    int bytesPerBlock = format == CF_DXT1 ? 8 : 16;
+    const BlockRowParams& p = *reinterpret_cast<const BlockRowParams*>(params);
+    int bytesPerBlock = p.format_ == CF_DXT1 ? 8 : 16;
+    int blocksPerRow = (p.width_ + 3) / 4;
+    int blockRowsPerSlice = (p.height_ + 3) / 4;
+    unsigned pitch = p.width_ * 4;
     
-    // loop over blocks
-    for( int z = 0; z < depth; ++z )
+    for (int row = startRow; row < endRow; ++row)
     {
-        int sz = width*height*4*z;
-        for( int y = 0; y < height; y += 4 )
+        // The block rows of all depth slices are numbered consecutively
+        int y = (row % blockRowsPerSlice) * 4;
+        unsigned char* slice = p.dest_ + (row / blockRowsPerSlice) * p.width_ * p.height_ * 4;
+        const unsigned char* sourceBlock = p.blocks_ + row * blocksPerRow * bytesPerBlock;
+        
+        for (int x = 0; x < p.width_; x += 4)
         {
-            for( int x = 0; x < width; x += 4 )
+            unsigned char* targetPixel = slice + 4 * (p.width_ * y + x);
+            if (x + 4 <= p.width_ && y + 4 <= p.height_)
+                DecompressDXT(targetPixel, pitch, sourceBlock, p.format_);
+            else
             {
-                // decompress the block
+                // Decompress blocks crossing the image edge to a temporary buffer
                 unsigned char targetRgba[4*16];
-                DecompressDXT( targetRgba, sourceBlock, format );
-                
-                // write the decompressed pixels to the correct image locations
-                unsigned char const* sourcePixel = targetRgba;
-                for( int py = 0; py < 4; ++py )
-                {
-                    for( int px = 0; px < 4; ++px )
-                    {
-                        // get the target location
-                        int sx = x + px;
-                        int sy = y + py;
-                        if( sx < width && sy < height )
-                        {
-                            unsigned char* targetPixel = rgba + sz + 4*( width*sy + sx );
-                            
-                            // copy the rgba value
-                            for( int i = 0; i < 4; ++i )
-                                *targetPixel++ = *sourcePixel++;
-                        }
-                        else
-                        {
-                            // skip this pixel as its outside the image
-                            sourcePixel += 4;
-                        }
-                    }
-                }
-                
-                // advance
-                sourceBlock += bytesPerBlock;
+                DecompressDXT(targetRgba, 16, sourceBlock, p.format_);
+                CopyPartialBlock(targetPixel, pitch, targetRgba, Min(p.width_ - x, 4), Min(p.height_ - y, 4));
             }
+            
+            sourceBlock += bytesPerBlock;
         }
     }
 }
 
+void DecompressImageDXT(unsigned char* rgba, const void* blocks, int width, int height, int depth, CompressedFormat format, WorkQueue* queue)
+{
+    BlockRowParams params;
+    params.dest_ = rgba;
+    params.blocks_ = reinterpret_cast<const unsigned char*>(blocks);
+    params.width_ = width;
+    params.height_ = height;
+    params.format_ = format;
+    ProcessImageRows(queue, ((height + 3) / 4) * depth, width * 16, DecompressBlockRowsDXT, &params);
+}
+
 // ETC and PVRTC decompression based on the Oolong Engine, modified for Urho3D
 
 /*
@@ -302,10 +372,10 @@ const int mod[8][4]={{2, 8,-2,-8},
                     {47, 183, -47, -183}};
 
 // lsb: hgfedcba ponmlkji msb: hgfedcba ponmlkji due to endianness
-static unsigned long ModifyPixel(int red, int green, int blue, int x, int y, unsigned long modBlock, int modTable)
+static unsigned ModifyPixel(int red, int green, int blue, int x, int y, unsigned modBlock, int modTable)
 {
     int index = x*4+y, pixelMod;
-    unsigned long mostSig = modBlock<<1;
+    unsigned mostSig = modBlock<<1;
     if (index<8)    //hgfedcba
         pixelMod = mod[modTable][((modBlock>>(index+24))&0x1)+((mostSig>>(index+8))&0x2)];
     else    // ponmlkj
@@ -318,17 +388,23 @@ static unsigned long ModifyPixel(int red, int green, int blue, int x, int y, uns
     return ((blue<<16) + (green<<8) + red)|0xff000000;
 }
 
-static void DecompressETC(unsigned char* pDestData, const void* pSrcData)
+/// Store an ETC decompressed pixel.
+static inline void StorePixelETC(unsigned char* pDestData, unsigned pitch, int x, int y, unsigned pixel)
+{
+    memcpy(pDestData + y*pitch + x*4, &pixel, 4);
+}
+
+static void DecompressETC(unsigned char* pDestData, unsigned pitch, const void* pSrcData)
 {
-    unsigned long blockTop, blockBot, *input = (unsigned long*)pSrcData, *output;
+    // The block consists of two 32-bit words regardless of the size of long on the platform
+    unsigned blockTop, blockBot;
     unsigned char red1, green1, blue1, red2, green2, blue2;
     bool bFlip, bDiff;
     int modtable1,modtable2;
     
-    blockTop = *(input++);
-    blockBot = *(input++);
+    memcpy(&blockTop, pSrcData, 4);
+    memcpy(&blockBot, (const unsigned char*)pSrcData + 4, 4);
     
-    output = (unsigned long*)pDestData;
     // check flipbit
     bFlip = (blockTop & ETC_FLIP) != 0;
     bDiff = (blockTop & ETC_DIFF) != 0;
@@ -385,8 +461,8 @@ static void DecompressETC(unsigned char* pDestData, const void* pSrcData)
         {
             for(int k=0;k<2;k++)    // horizontal
             {
-                *(output+j*4+k) = ModifyPixel(red1,green1,blue1,k,j,blockBot,modtable1);
-                *(output+j*4+k+2) = ModifyPixel(red2,green2,blue2,k+2,j,blockBot,modtable2);
+                StorePixelETC(pDestData, pitch, k, j, ModifyPixel(red1,green1,blue1,k,j,blockBot,modtable1));
+                StorePixelETC(pDestData, pitch, k+2, j, ModifyPixel(red2,green2,blue2,k+2,j,blockBot,modtable2));
             }
         }
     }
@@ -396,59 +472,53 @@ static void DecompressETC(unsigned char* pDestData, const void* pSrcData)
         {
             for(int k=0;k<4;k++)
             {
-                *(output+j*4+k) = ModifyPixel(red1,green1,blue1,k,j,blockBot,modtable1);
-                *(output+(j+2)*4+k) = ModifyPixel(red2,green2,blue2,k,j+2,blockBot,modtable2);
+                StorePixelETC(pDestData, pitch, k, j, ModifyPixel(red1,green1,blue1,k,j,blockBot,modtable1));
+                StorePixelETC(pDestData, pitch, k, j+2, ModifyPixel(red2,green2,blue2,k,j+2,blockBot,modtable2));
             }
         }
     }
 }
 
-void DecompressImageETC( unsigned char* rgba, const void* blocks, int width, int height )
+static void DecompressBlockRowsETC(const void* params, int startRow, int endRow)
 {
-    // initialise the block input
-    unsigned char const* sourceBlock = reinterpret_cast< unsigned char const* >( blocks );
-    int bytesPerBlock = 8;
+    const BlockRowParams& p = *reinterpret_cast<const BlockRowParams*>(params);
+    int blocksPerRow = (p.width_ + 3) / 4;
+    unsigned pitch = p.width_ * 4;
     
-    // loop over blocks
-    for( int y = 0; y < height; y += 4 )
+    for (int row = startRow; row < endRow; ++row)
     {
-        for( int x = 0; x < width; x += 4 )
+        int y = row * 4;
+        const unsigned char* sourceBlock = p.blocks_ + row * blocksPerRow * 8;
+        
+        for (int x = 0; x < p.width_; x += 4)
         {
-            // decompress the block
-            unsigned char targetRgba[4*16];
-            DecompressETC( targetRgba, sourceBlock );
-            
-            // write the decompressed pixels to the correct image locations
-            unsigned char const* sourcePixel = targetRgba;
-            for( int py = 0; py < 4; ++py )
+            unsigned char* targetPixel = p.dest_ + 4 * (p.width_ * y + x);
+            if (x + 4 <= p.width_ && y + 4 <= p.height_)
+                DecompressETC(targetPixel, pitch, sourceBlock);
+            else
             {
-                for( int px = 0; px < 4; ++px )
-                {
-                    // get the target location
-                    int sx = x + px;
-                    int sy = y + py;
-                    if( sx < width && sy < height )
-                    {
-                        unsigned char* targetPixel = rgba + 4*( width*sy + sx );
-                        
-                        // copy the rgba value
-                        for( int i = 0; i < 4; ++i )
-                            *targetPixel++ = *sourcePixel++;
-                    }
-                    else
-                    {
-                        // skip this pixel as its outside the image
-                        sourcePixel += 4;
-                    }
-                }
+                // Decompress blocks crossing the image edge to a temporary buffer
+                unsigned char targetRgba[4*16];
+                DecompressETC(targetRgba, 16, sourceBlock);
+                CopyPartialBlock(targetPixel, pitch, targetRgba, Min(p.width_ - x, 4), Min(p.height_ - y, 4));
             }
             
-            // advance
-            sourceBlock += bytesPerBlock;
+            sourceBlock += 8;
         }
     }
 }
 
+void DecompressImageETC(unsigned char* rgba, const void* blocks, int width, int height, WorkQueue* queue)
+{
+    BlockRowParams params;
+    params.dest_ = rgba;
+    params.blocks_ = reinterpret_cast<const unsigned char*>(blocks);
+    params.width_ = width;
+    params.height_ = height;
+    params.format_ = CF_ETC1;
+    ProcessImageRows(queue, (height + 3) / 4, width * 16, DecompressBlockRowsETC, &params);
+}
+
 #define PT_INDEX    (2) /*The Punch-through index*/
 #define BLK_Y_SIZE  (4) /*always 4 for all 2D block types*/
 #define BLK_X_MAX   (8) /*Max X dimension for blocks*/
@@ -797,9 +867,15 @@ static unsigned TwiddleUV(unsigned YSize, unsigned XSize, unsigned YPos, unsigne
     return Twiddled;
 }
 
-void DecompressImagePVRTC(unsigned char* dest, const void *blocks, int width, int height, CompressedFormat format)
+static void DecompressRowsPVRTC(const void* params, int startRow, int endRow)
 {
-    AMTC_BLOCK_STRUCT* pCompressedData = (AMTC_BLOCK_STRUCT*)blocks;
+    const BlockRowParams& p = *reinterpret_cast<const BlockRowParams*>(params);
+    unsigned char* dest = p.dest_;
+    int width = p.width_;
+    int height = p.height_;
+    CompressedFormat format = p.format_;
+    
+    AMTC_BLOCK_STRUCT* pCompressedData = (AMTC_BLOCK_STRUCT*)p.blocks_;
     int AssumeImageTiles = 1;
     int Do2bitMode = format == CF_PVRTC_RGB_2BPP || format == CF_PVRTC_RGBA_2BPP;
     
@@ -851,7 +927,7 @@ void DecompressImagePVRTC(unsigned char* dest, const void *blocks, int width, in
     // Step through the pixels of the image decompressing each one in turn
     //
     // Note that this is a hideously inefficient way to do this!
-    for(y = 0; y < height; y++)
+    for(y = startRow; y < endRow; y++)
     {
         for(x = 0; x < width; x++)
         {
@@ -942,6 +1018,18 @@ void DecompressImagePVRTC(unsigned char* dest, const void *blocks, int width, in
     }
 }
 
+void DecompressImagePVRTC(unsigned char* dest, const void* blocks, int width, int height, CompressedFormat format, WorkQueue* queue)
+{
+    // Each pixel is decompressed independently from the neighbourhood of its blocks, so pixel rows can be processed in parallel
+    BlockRowParams params;
+    params.dest_ = dest;
+    params.blocks_ = reinterpret_cast<const unsigned char*>(blocks);
+    params.width_ = width;
+    params.height_ = height;
+    params.format_ = format;
+    ProcessImageRows(queue, height, width * 4, DecompressRowsPVRTC, &params);
+}
+
 void FlipBlockVertical(unsigned char* dest, unsigned char* src, CompressedFormat format)
 {
     switch (format)
@@ -27,15 +27,22 @@
 namespace Urho3D
 {
 
-/// Decompress a DXT compressed image to RGBA.
-URHO3D_API void DecompressImageDXT(unsigned char* dest, const void* blocks, int width, int height, int depth, CompressedFormat format);
-/// Decompress an ETC1 compressed image to RGBA.
-URHO3D_API void DecompressImageETC(unsigned char* dest, const void* blocks, int width, int height);
-/// Decompress a PVRTC compressed image to RGBA.
-URHO3D_API void DecompressImagePVRTC(unsigned char* dest, const void* blocks, int width, int height, CompressedFormat format);
+class WorkQueue;
+
+/// Image row processing function. Called with the parameter structure and the row range to process.
+typedef void (*ImageRowFunction)(const void* params, int startRow, int endRow);
+
+/// Decompress a DXT compressed image to RGBA. If a work queue is given, large images are decompressed in parallel when called from the main thread.
+URHO3D_API void DecompressImageDXT(unsigned char* dest, const void* blocks, int width, int height, int depth, CompressedFormat format, WorkQueue* queue = 0);
+/// Decompress an ETC1 compressed image to RGBA. If a work queue is given, large images are decompressed in parallel when called from the main thread.
+URHO3D_API void DecompressImageETC(unsigned char* dest, const void* blocks, int width, int height, WorkQueue* queue = 0);
+/// Decompress a PVRTC compressed image to RGBA. If a work queue is given, large images are decompressed in parallel when called from the main thread.
+URHO3D_API void DecompressImagePVRTC(unsigned char* dest, const void* blocks, int width, int height, CompressedFormat format, WorkQueue* queue = 0);
 /// Flip a compressed block vertically.
 URHO3D_API void FlipBlockVertical(unsigned char* dest, unsigned char* src, CompressedFormat format);
 /// Flip a compressed block horizontally.
 URHO3D_API void FlipBlockHorizontal(unsigned char* dest, unsigned char* src, CompressedFormat format);
+/// Process image rows. If a work queue is given, called from the main thread and the output is large enough, the rows are split to the worker threads, so they must be independent of each other.
+URHO3D_API void ProcessImageRows(WorkQueue* queue, int numRows, unsigned rowBytes, ImageRowFunction function, const void* params);
 
 }
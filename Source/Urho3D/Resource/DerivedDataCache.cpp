@@ -0,0 +1,266 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Resource/DerivedDataCache.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../IO/VectorBuffer.h"
+#include "../Container/Sort.h"
+
+#include <ctime>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const unsigned DEFAULT_MAX_SIZE = 256 * 1024 * 1024;
+static const char* CACHE_FILE_EXTENSION = ".ddc";
+
+/// Cache file entry sorted for trimming.
+struct DerivedDataTrimEntry
+{
+    /// File name.
+    String fileName_;
+    /// Last access time.
+    unsigned lastAccess_;
+};
+
+static bool CompareTrimEntries(const DerivedDataTrimEntry& lhs, const DerivedDataTrimEntry& rhs)
+{
+    return lhs.lastAccess_ < rhs.lastAccess_;
+}
+
+DerivedDataCache::DerivedDataCache(Context* context) :
+    Object(context),
+    maxSize_(DEFAULT_MAX_SIZE),
+    size_(0),
+    tempFileIndex_(0)
+{
+}
+
+DerivedDataCache::~DerivedDataCache()
+{
+}
+
+bool DerivedDataCache::SetCacheDir(const String& pathName)
+{
+    MutexLock lock(mutex_);
+    
+    cacheDir_.Clear();
+    entries_.Clear();
+    size_ = 0;
+    
+    if (pathName.Empty())
+        return true;
+    
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    String fixedPath = AddTrailingSlash(pathName);
+    if (!fileSystem || !fileSystem->CreateDir(fixedPath))
+    {
+        LOGERROR("Could not create derived data cache directory " + fixedPath);
+        return false;
+    }
+    
+    // Index the existing cache files. The modification time of a file is its last access time
+    Vector<String> fileNames;
+    fileSystem->ScanDir(fileNames, fixedPath, String("*") + CACHE_FILE_EXTENSION, SCAN_FILES, false);
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
+    {
+        File file(context_, fixedPath + fileNames[i]);
+        if (!file.IsOpen())
+            continue;
+        
+        DerivedDataEntry& entry = entries_[fileNames[i]];
+        entry.size_ = file.GetSize();
+        entry.lastAccess_ = fileSystem->GetLastModifiedTime(fixedPath + fileNames[i]);
+        size_ += entry.size_;
+    }
+    
+    cacheDir_ = fixedPath;
+    LOGINFO("Using derived data cache " + cacheDir_ + " with " + String(entries_.Size()) + " files");
+    Trim();
+    return true;
+}
+
+void DerivedDataCache::SetMaxSize(unsigned size)
+{
+    MutexLock lock(mutex_);
+    
+    maxSize_ = size;
+    Trim();
+}
+
+bool DerivedDataCache::Load(const String& key, VectorBuffer& dest)
+{
+    String fileName = GetFileName(key);
+    String fullName;
+    {
+        MutexLock lock(mutex_);
+        if (!IsEnabled())
+            return false;
+        
+        HashMap<String, DerivedDataEntry>::Iterator i = entries_.Find(fileName);
+        if (i == entries_.End())
+            return false;
+        
+        i->second_.lastAccess_ = (unsigned)time(NULL);
+        fullName = cacheDir_ + fileName;
+    }
+    
+    File file(context_);
+    if (!file.Open(fullName))
+        return false;
+    
+    // Verify the full key, as the file name is only a hash of it
+    if (file.ReadFileID() != "UDDC" || file.ReadString() != key)
+        return false;
+    
+    unsigned size = file.ReadUInt();
+    if (size > file.GetSize() - file.GetPosition())
+        return false;
+    
+    dest.Clear();
+    dest.Resize(size);
+    if (size && file.Read(dest.GetModifiableData(), size) != size)
+        return false;
+    dest.Seek(0);
+    file.Close();
+    
+    // Record the access for least recently used trimming on later runs
+    GetSubsystem<FileSystem>()->SetLastModifiedTime(fullName, (unsigned)time(NULL));
+    return true;
+}
+
+bool DerivedDataCache::Store(const String& key, const void* data, unsigned size)
+{
+    String fileName = GetFileName(key);
+    String fullName;
+    String tempName;
+    {
+        MutexLock lock(mutex_);
+        if (!IsEnabled())
+            return false;
+        
+        fullName = cacheDir_ + fileName;
+        tempName = fullName + "." + String(tempFileIndex_++) + ".tmp";
+    }
+    
+    // Write to a temporary file first, so that a concurrent or interrupted write never leaves a partial file to be read
+    unsigned fileSize;
+    {
+        File file(context_);
+        if (!file.Open(tempName, FILE_WRITE))
+            return false;
+        
+        bool success = file.WriteFileID("UDDC") && file.WriteString(key) && file.WriteUInt(size) &&
+            file.Write(data, size) == size;
+        fileSize = file.GetSize();
+        file.Close();
+        
+        if (!success)
+        {
+            LOGERROR("Could not write derived data cache file " + tempName);
+            GetSubsystem<FileSystem>()->Delete(tempName);
+            return false;
+        }
+    }
+    
+    MutexLock lock(mutex_);
+    
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    HashMap<String, DerivedDataEntry>::Iterator i = entries_.Find(fileName);
+    if (i != entries_.End())
+    {
+        fileSystem->Delete(fullName);
+        size_ -= i->second_.size_;
+        entries_.Erase(i);
+    }
+    
+    if (!fileSystem->Rename(tempName, fullName))
+    {
+        LOGERROR("Could not write derived data cache file " + fullName);
+        fileSystem->Delete(tempName);
+        return false;
+    }
+    
+    DerivedDataEntry& entry = entries_[fileName];
+    entry.size_ = fileSize;
+    entry.lastAccess_ = (unsigned)time(NULL);
+    size_ += fileSize;
+    
+    Trim();
+    return true;
+}
+
+void DerivedDataCache::Clear()
+{
+    MutexLock lock(mutex_);
+    
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    for (HashMap<String, DerivedDataEntry>::Iterator i = entries_.Begin(); i != entries_.End(); ++i)
+        fileSystem->Delete(cacheDir_ + i->first_);
+    
+    entries_.Clear();
+    size_ = 0;
+}
+
+String DerivedDataCache::GetKey(StringHash type, const String& name, unsigned checksum, unsigned version)
+{
+    return type.ToString() + "/" + name.ToLower() + "/" + ToStringHex(checksum) + "/" + String(version);
+}
+
+String DerivedDataCache::GetFileName(const String& key) const
+{
+    return StringHash(key).ToString() + CACHE_FILE_EXTENSION;
+}
+
+void DerivedDataCache::Trim()
+{
+    if (size_ <= maxSize_)
+        return;
+    
+    // Delete down to three quarters of the limit, so that trimming is not repeated on every store
+    Vector<DerivedDataTrimEntry> sorted;
+    sorted.Reserve(entries_.Size());
+    for (HashMap<String, DerivedDataEntry>::ConstIterator i = entries_.Begin(); i != entries_.End(); ++i)
+    {
+        DerivedDataTrimEntry entry;
+        entry.fileName_ = i->first_;
+        entry.lastAccess_ = i->second_.lastAccess_;
+        sorted.Push(entry);
+    }
+    Sort(sorted.Begin(), sorted.End(), CompareTrimEntries);
+    
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    unsigned targetSize = maxSize_ / 4 * 3;
+    for (unsigned i = 0; i < sorted.Size() && size_ > targetSize; ++i)
+    {
+        HashMap<String, DerivedDataEntry>::Iterator j = entries_.Find(sorted[i].fileName_);
+        fileSystem->Delete(cacheDir_ + j->first_);
+        size_ -= j->second_.size_;
+        entries_.Erase(j);
+    }
+}
+
+}
@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Core/Mutex.h"
+#include "../Core/Object.h"
+
+namespace Urho3D
+{
+
+class VectorBuffer;
+
+/// Derived data cache file entry.
+struct DerivedDataEntry
+{
+    /// File size.
+    unsigned size_;
+    /// Last access time.
+    unsigned lastAccess_;
+};
+
+/// Persistent on-disk cache of processed resource data, such as decoded images, to speed up later loads of the same resources. Entries are keyed by resource type, name, source data checksum and processing version, so modified sources miss the cache and stale files are eventually deleted to keep within the size limit. Load and store can be called from worker threads.
+class URHO3D_API DerivedDataCache : public Object
+{
+    OBJECT(DerivedDataCache);
+    
+public:
+    /// Construct. The cache is disabled until a directory is set.
+    DerivedDataCache(Context* context);
+    /// Destruct.
+    virtual ~DerivedDataCache();
+    
+    /// Set the cache directory, which is created if necessary. Empty disables the cache. Return true if successful.
+    bool SetCacheDir(const String& pathName);
+    /// Set maximum total size of the cache files in bytes. Least recently used files are deleted when exceeded. Default 256 MB.
+    void SetMaxSize(unsigned size);
+    /// Read cached data by key. Return true if found.
+    bool Load(const String& key, VectorBuffer& dest);
+    /// Store data by key. Return true if successful.
+    bool Store(const String& key, const void* data, unsigned size);
+    /// Delete all cache files.
+    void Clear();
+    
+    /// Return whether the cache is enabled.
+    bool IsEnabled() const { return !cacheDir_.Empty(); }
+    /// Return the cache directory.
+    const String& GetCacheDir() const { return cacheDir_; }
+    /// Return maximum total size of the cache files.
+    unsigned GetMaxSize() const { return maxSize_; }
+    /// Return current total size of the cache files.
+    unsigned GetSize() const { return size_; }
+    /// Return number of cache files.
+    unsigned GetNumEntries() const { return entries_.Size(); }
+    
+    /// Return a key for the derived data of a resource. The version should be increased whenever the processing or the data layout changes.
+    static String GetKey(StringHash type, const String& name, unsigned checksum, unsigned version);
+    
+private:
+    /// Return the cache file name for a key.
+    String GetFileName(const String& key) const;
+    /// Delete least recently used files until below the size limit. Called with the mutex acquired.
+    void Trim();
+    
+    /// Mutex for the cache entries.
+    Mutex mutex_;
+    /// Cache directory.
+    String cacheDir_;
+    /// Cache file entries by file name.
+    HashMap<String, DerivedDataEntry> entries_;
+    /// Maximum total size.
+    unsigned maxSize_;
+    /// Current total size.
+    unsigned size_;
+    /// Counter for unique temporary file names.
+    unsigned tempFileIndex_;
+};
+
+}
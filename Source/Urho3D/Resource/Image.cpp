@@ -21,14 +21,22 @@
 //
 
 #include "../Core/Context.h"
+#include "../Core/WorkQueue.h"
+#include "../Resource/Compress.h"
 #include "../Resource/Decompress.h"
+#include "../Resource/DerivedDataCache.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
+#include "../IO/VectorBuffer.h"
 #include "../Core/Profiler.h"
 
 #include <cstdlib>
 #include <cstring>
+#if defined(URHO3D_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define URHO3D_IMAGE_SSE2
+#endif
 #include <STB/stb_image.h>
 #include <STB/stb_image_write.h>
 #include <JO/jo_jpeg.h>
@@ -51,6 +59,9 @@ extern "C" unsigned char *stbi_write_png_to_mem(unsigned char *pixels, int strid
 namespace Urho3D
 {
 
+/// Version of the decoded image data stored in the derived data cache.
+static const unsigned IMAGE_DERIVED_DATA_VERSION = 1;
+
 /// DirectDraw color key definition.
 struct DDColorKey
 {
@@ -168,7 +179,295 @@ struct DDSurfaceDesc2
     unsigned dwTextureStage_;
 };
 
-bool CompressedLevel::Decompress(unsigned char* dest)
+/// Parameters for 2D mip level generation by box filtering.
+struct DownsampleParams
+{
+    /// Source pixel data.
+    const unsigned char* in_;
+    /// Destination pixel data.
+    unsigned char* out_;
+    /// Source width.
+    int widthIn_;
+    /// Destination width.
+    int widthOut_;
+    /// Number of color components.
+    unsigned components_;
+};
+
+/// Calculate rows of a 2D mip level by averaging 2x2 pixel blocks.
+static void DownsampleRows(const void* params, int startRow, int endRow)
+{
+    const DownsampleParams& p = *reinterpret_cast<const DownsampleParams*>(params);
+    const int widthIn = p.widthIn_;
+    const int widthOut = p.widthOut_;
+    
+    switch (p.components_)
+    {
+    case 1:
+        for (int y = startRow; y < endRow; ++y)
+        {
+            const unsigned char* inUpper = &p.in_[(y*2)*widthIn];
+            const unsigned char* inLower = &p.in_[(y*2+1)*widthIn];
+            unsigned char* out = &p.out_[y*widthOut];
+            int x = 0;
+            
+            #ifdef URHO3D_IMAGE_SSE2
+            // 32 source pixels into 16 destination pixels per iteration. Sum even and odd bytes in 16-bit lanes
+            const __m128i lowMask = _mm_set1_epi16(0xff);
+            for (; x + 16 <= widthOut; x += 16)
+            {
+                __m128i sums[2];
+                for (int i = 0; i < 2; ++i)
+                {
+                    __m128i upper = _mm_loadu_si128((const __m128i*)&inUpper[x*2 + i*16]);
+                    __m128i lower = _mm_loadu_si128((const __m128i*)&inLower[x*2 + i*16]);
+                    __m128i sum = _mm_add_epi16(_mm_and_si128(upper, lowMask), _mm_srli_epi16(upper, 8));
+                    sum = _mm_add_epi16(sum, _mm_and_si128(lower, lowMask));
+                    sum = _mm_add_epi16(sum, _mm_srli_epi16(lower, 8));
+                    sums[i] = _mm_srli_epi16(sum, 2);
+                }
+                _mm_storeu_si128((__m128i*)&out[x], _mm_packus_epi16(sums[0], sums[1]));
+            }
+            #endif
+            
+            for (; x < widthOut; ++x)
+                out[x] = ((unsigned)inUpper[x*2] + inUpper[x*2+1] + inLower[x*2] + inLower[x*2+1]) >> 2;
+        }
+        break;
+
+    case 2:
+        for (int y = startRow; y < endRow; ++y)
+        {
+            const unsigned char* inUpper = &p.in_[(y*2)*widthIn*2];
+            const unsigned char* inLower = &p.in_[(y*2+1)*widthIn*2];
+            unsigned char* out = &p.out_[y*widthOut*2];
+
+            for (int x = 0; x < widthOut*2; x += 2)
+            {
+                out[x] = ((unsigned)inUpper[x*2] + inUpper[x*2+2] + inLower[x*2] + inLower[x*2+2]) >> 2;
+                out[x+1] = ((unsigned)inUpper[x*2+1] + inUpper[x*2+3] + inLower[x*2+1] + inLower[x*2+3]) >> 2;
+            }
+        }
+        break;
+
+    case 3:
+        for (int y = startRow; y < endRow; ++y)
+        {
+            const unsigned char* inUpper = &p.in_[(y*2)*widthIn*3];
+            const unsigned char* inLower = &p.in_[(y*2+1)*widthIn*3];
+            unsigned char* out = &p.out_[y*widthOut*3];
+
+            for (int x = 0; x < widthOut*3; x += 3)
+            {
+                out[x] = ((unsigned)inUpper[x*2] + inUpper[x*2+3] + inLower[x*2] + inLower[x*2+3]) >> 2;
+                out[x+1] = ((unsigned)inUpper[x*2+1] + inUpper[x*2+4] + inLower[x*2+1] + inLower[x*2+4]) >> 2;
+                out[x+2] = ((unsigned)inUpper[x*2+2] + inUpper[x*2+5] + inLower[x*2+2] + inLower[x*2+5]) >> 2;
+            }
+        }
+        break;
+
+    case 4:
+        for (int y = startRow; y < endRow; ++y)
+        {
+            const unsigned char* inUpper = &p.in_[(y*2)*widthIn*4];
+            const unsigned char* inLower = &p.in_[(y*2+1)*widthIn*4];
+            unsigned char* out = &p.out_[y*widthOut*4];
+            int x = 0;
+            
+            #ifdef URHO3D_IMAGE_SSE2
+            // 8 source pixels into 4 destination pixels per iteration. Widen to 16-bit lanes, add the rows, then
+            // add each pixel to its right neighbour
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 4 <= widthOut; x += 4)
+            {
+                __m128i sums[2];
+                for (int i = 0; i < 2; ++i)
+                {
+                    __m128i upper = _mm_loadu_si128((const __m128i*)&inUpper[x*8 + i*16]);
+                    __m128i lower = _mm_loadu_si128((const __m128i*)&inLower[x*8 + i*16]);
+                    __m128i left = _mm_add_epi16(_mm_unpacklo_epi8(upper, zero), _mm_unpacklo_epi8(lower, zero));
+                    __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(upper, zero), _mm_unpackhi_epi8(lower, zero));
+                    left = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+                    right = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+                    sums[i] = _mm_srli_epi16(_mm_unpacklo_epi64(left, right), 2);
+                }
+                _mm_storeu_si128((__m128i*)&out[x*4], _mm_packus_epi16(sums[0], sums[1]));
+            }
+            #endif
+            
+            for (x *= 4; x < widthOut*4; x += 4)
+            {
+                out[x] = ((unsigned)inUpper[x*2] + inUpper[x*2+4] + inLower[x*2] + inLower[x*2+4]) >> 2;
+                out[x+1] = ((unsigned)inUpper[x*2+1] + inUpper[x*2+5] + inLower[x*2+1] + inLower[x*2+5]) >> 2;
+                out[x+2] = ((unsigned)inUpper[x*2+2] + inUpper[x*2+6] + inLower[x*2+2] + inLower[x*2+6]) >> 2;
+                out[x+3] = ((unsigned)inUpper[x*2+3] + inUpper[x*2+7] + inLower[x*2+3] + inLower[x*2+7]) >> 2;
+            }
+        }
+        break;
+    }
+}
+
+/// Parameters for bilinear resizing.
+struct ResizeParams
+{
+    /// Source pixel data.
+    const unsigned char* in_;
+    /// Destination pixel data.
+    unsigned char* out_;
+    /// Source width.
+    int widthIn_;
+    /// Source height.
+    int heightIn_;
+    /// Destination width.
+    int widthOut_;
+    /// Destination height.
+    int heightOut_;
+    /// Number of color components.
+    unsigned components_;
+    /// Left source pixel offset in bytes for each destination column.
+    const unsigned* leftOffsets_;
+    /// Right source pixel offset in bytes for each destination column.
+    const unsigned* rightOffsets_;
+    /// Horizontal interpolation factor for each destination column.
+    const float* xFractions_;
+};
+
+/// Calculate the clamped source pixel indices and interpolation factor for bilinear sampling at a normalized coordinate, as in GetPixelBilinear().
+static inline void GetBilinearCoords(float coord, int size, int& first, int& second, float& fraction)
+{
+    coord = Clamp(coord * size - 0.5f, 0.0f, (float)(size - 1));
+    first = (int)coord;
+    second = Min(first + 1, size - 1);
+    fraction = coord - floorf(coord);
+}
+
+/// Calculate rows of a resized image by bilinear sampling. Gives the same result as sampling with GetPixelBilinear() and converting back to integer color.
+static void ResizeRows(const void* params, int startRow, int endRow)
+{
+    const ResizeParams& p = *reinterpret_cast<const ResizeParams*>(params);
+    const unsigned components = p.components_;
+    const unsigned rowSizeIn = p.widthIn_ * components;
+    
+    for (int y = startRow; y < endRow; ++y)
+    {
+        float yF = (p.heightIn_ > 1 && p.heightOut_ > 1) ? (float)y / (float)(p.heightOut_ - 1) : 0.0f;
+        int top, bottom;
+        float yFraction;
+        GetBilinearCoords(yF, p.heightIn_, top, bottom, yFraction);
+        const unsigned char* inTop = p.in_ + top * rowSizeIn;
+        const unsigned char* inBottom = p.in_ + bottom * rowSizeIn;
+        unsigned char* out = p.out_ + y * p.widthOut_ * components;
+        
+        #ifdef URHO3D_IMAGE_SSE2
+        if (components == 4)
+        {
+            // Interpolate all four channels at once
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 scale = _mm_set1_ps(255.0f);
+            const __m128 yFractionV = _mm_set1_ps(yFraction);
+            const __m128 yInvFractionV = _mm_set1_ps(1.0f - yFraction);
+            
+            for (int x = 0; x < p.widthOut_; ++x)
+            {
+                int pixels[4];
+                memcpy(&pixels[0], inTop + p.leftOffsets_[x], 4);
+                memcpy(&pixels[1], inTop + p.rightOffsets_[x], 4);
+                memcpy(&pixels[2], inBottom + p.leftOffsets_[x], 4);
+                memcpy(&pixels[3], inBottom + p.rightOffsets_[x], 4);
+                __m128i packed = _mm_loadu_si128((const __m128i*)pixels);
+                __m128i low = _mm_unpacklo_epi8(packed, zero);
+                __m128i high = _mm_unpackhi_epi8(packed, zero);
+                __m128 topLeft = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale);
+                __m128 topRight = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale);
+                __m128 bottomLeft = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale);
+                __m128 bottomRight = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale);
+                
+                __m128 xFractionV = _mm_set1_ps(p.xFractions_[x]);
+                __m128 xInvFractionV = _mm_set1_ps(1.0f - p.xFractions_[x]);
+                __m128 topColor = _mm_add_ps(_mm_mul_ps(topLeft, xInvFractionV), _mm_mul_ps(topRight, xFractionV));
+                __m128 bottomColor = _mm_add_ps(_mm_mul_ps(bottomLeft, xInvFractionV), _mm_mul_ps(bottomRight, xFractionV));
+                __m128 color = _mm_add_ps(_mm_mul_ps(topColor, yInvFractionV), _mm_mul_ps(bottomColor, yFractionV));
+                
+                // Truncate and saturate to 0-255 like Color::ToUInt()
+                __m128i result = _mm_cvttps_epi32(_mm_mul_ps(color, scale));
+                result = _mm_packs_epi32(result, result);
+                result = _mm_packus_epi16(result, result);
+                int outPixel = _mm_cvtsi128_si32(result);
+                memcpy(out + x * 4, &outPixel, 4);
+            }
+            continue;
+        }
+        #endif
+        
+        for (int x = 0; x < p.widthOut_; ++x)
+        {
+            const unsigned char* topLeft = inTop + p.leftOffsets_[x];
+            const unsigned char* topRight = inTop + p.rightOffsets_[x];
+            const unsigned char* bottomLeft = inBottom + p.leftOffsets_[x];
+            const unsigned char* bottomRight = inBottom + p.rightOffsets_[x];
+            float xFraction = p.xFractions_[x];
+            float xInvFraction = 1.0f - xFraction;
+            float yInvFraction = 1.0f - yFraction;
+            
+            for (unsigned c = 0; c < components; ++c)
+            {
+                float topColor = (float)topLeft[c] / 255.0f * xInvFraction + (float)topRight[c] / 255.0f * xFraction;
+                float bottomColor = (float)bottomLeft[c] / 255.0f * xInvFraction + (float)bottomRight[c] / 255.0f * xFraction;
+                float color = topColor * yInvFraction + bottomColor * yFraction;
+                out[x * components + c] = (unsigned char)Clamp((int)(color * 255.0f), 0, 255);
+            }
+        }
+    }
+}
+
+/// Parameters for horizontal flipping.
+struct FlipParams
+{
+    /// Source pixel data.
+    const unsigned char* in_;
+    /// Destination pixel data.
+    unsigned char* out_;
+    /// Width.
+    int width_;
+    /// Number of color components.
+    unsigned components_;
+};
+
+/// Flip image rows horizontally.
+static void FlipRowsHorizontal(const void* params, int startRow, int endRow)
+{
+    const FlipParams& p = *reinterpret_cast<const FlipParams*>(params);
+    const int width = p.width_;
+    const unsigned components = p.components_;
+    const unsigned rowSize = width * components;
+    
+    for (int y = startRow; y < endRow; ++y)
+    {
+        const unsigned char* in = p.in_ + y * rowSize;
+        unsigned char* out = p.out_ + y * rowSize;
+        int x = 0;
+        
+        #ifdef URHO3D_IMAGE_SSE2
+        // Reverse the order of 4 pixels per iteration
+        if (components == 4)
+        {
+            for (; x + 4 <= width; x += 4)
+            {
+                __m128i pixels = _mm_loadu_si128((const __m128i*)&in[(width - x - 4) * 4]);
+                _mm_storeu_si128((__m128i*)&out[x * 4], _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 1, 2, 3)));
+            }
+        }
+        #endif
+        
+        for (; x < width; ++x)
+        {
+            for (unsigned c = 0; c < components; ++c)
+                out[x * components + c] = in[(width - x - 1) * components + c];
+        }
+    }
+}
+
+bool CompressedLevel::Decompress(unsigned char* dest, WorkQueue* queue)
 {
     if (!data_)
         return false;
@@ -178,18 +477,18 @@ bool CompressedLevel::Decompress(unsigned char* dest)
     case CF_DXT1:
     case CF_DXT3:
     case CF_DXT5:
-        DecompressImageDXT(dest, data_, width_, height_, depth_, format_);
+        DecompressImageDXT(dest, data_, width_, height_, depth_, format_, queue);
         return true;
 
     case CF_ETC1:
-        DecompressImageETC(dest, data_, width_, height_);
+        DecompressImageETC(dest, data_, width_, height_, queue);
         return true;
 
     case CF_PVRTC_RGB_2BPP:
     case CF_PVRTC_RGBA_2BPP:
     case CF_PVRTC_RGB_4BPP:
     case CF_PVRTC_RGBA_4BPP:
-        DecompressImagePVRTC(dest, data_, width_, height_, format_);
+        DecompressImagePVRTC(dest, data_, width_, height_, format_, queue);
         return true;
 
     default:
@@ -569,7 +868,27 @@ bool Image::BeginLoad(Deserializer& source)
     }
     else
     {
-        // Not DDS, KTX or PVR, use STBImage to load other image formats as uncompressed
+        // Not DDS, KTX or PVR. If the source is unchanged, reuse the decoded data from the derived data cache
+        DerivedDataCache* derivedCache = GetSubsystem<DerivedDataCache>();
+        String derivedKey;
+        if (derivedCache && derivedCache->IsEnabled())
+        {
+            unsigned checksum = source.GetChecksum();
+            if (checksum)
+            {
+                derivedKey = DerivedDataCache::GetKey(GetType(), source.GetName(), checksum, IMAGE_DERIVED_DATA_VERSION);
+                VectorBuffer derivedData;
+                if (derivedCache->Load(derivedKey, derivedData) && LoadDerivedData(derivedData))
+                {
+                    // If the mip levels were not cached yet, store them once precalculated
+                    if (!nextLevel_)
+                        derivedDataKey_ = derivedKey;
+                    return true;
+                }
+            }
+        }
+        
+        // Use STBImage to load other image formats as uncompressed
         source.Seek(0);
         int width, height;
         unsigned components;
@@ -582,6 +901,12 @@ bool Image::BeginLoad(Deserializer& source)
         SetSize(width, height, components);
         SetData(pixelData);
         FreeImageData(pixelData);
+        
+        if (!derivedKey.Empty())
+        {
+            derivedDataKey_ = derivedKey;
+            StoreDerivedData();
+        }
     }
 
     return true;
@@ -638,6 +963,7 @@ bool Image::SetSize(int width, int height, int depth, unsigned components)
     compressedFormat_ = CF_NONE;
     numCompressedLevels_ = 0;
     nextLevel_.Reset();
+    derivedDataKey_.Clear();
 
     SetMemoryUse(width * height * depth * components);
     return true;
@@ -696,6 +1022,7 @@ void Image::SetData(const unsigned char* pixelData)
 
     memcpy(data_.Get(), pixelData, width_ * height_ * depth_ * components_);
     nextLevel_.Reset();
+    derivedDataKey_.Clear();
 }
 
 bool Image::LoadColorLUT(Deserializer& source)
@@ -763,16 +1090,13 @@ bool Image::FlipHorizontal()
     if (!IsCompressed())
     {
         SharedArrayPtr<unsigned char> newData(new unsigned char[width_ * height_ * components_]);
-        unsigned rowSize = width_ * components_;
-
-        for (int y = 0; y < height_; ++y)
-        {
-            for (int x = 0; x < width_; ++x)
-            {
-                for (unsigned c = 0; c < components_; ++c)
-                    newData[y * rowSize + x * components_ + c] = data_[y * rowSize + (width_ - x - 1) * components_ + c];
-            }
-        }
+        
+        FlipParams params;
+        params.in_ = data_.Get();
+        params.out_ = newData.Get();
+        params.width_ = width_;
+        params.components_ = components_;
+        ProcessImageRows(GetSubsystem<WorkQueue>(), height_, width_ * components_, FlipRowsHorizontal, &params);
         
         data_ = newData;
     }
@@ -897,34 +1221,33 @@ bool Image::Resize(int width, int height)
 
     /// \todo Reducing image size does not sample all needed pixels
     SharedArrayPtr<unsigned char> newData(new unsigned char[width * height * components_]);
-    for (int y = 0; y < height; ++y)
-    {
-        for (int x = 0; x < width; ++x)
-        {
-            // Calculate float coordinates between 0 - 1 for resampling
-            float xF = (width_ > 1) ? (float)x / (float)(width - 1) : 0.0f;
-            float yF = (height_ > 1) ? (float)y / (float)(height - 1) : 0.0f;
-            unsigned uintColor = GetPixelBilinear(xF, yF).ToUInt();
-            unsigned char* dest = newData + (y * width + x) * components_;
-            unsigned char* src = (unsigned char*)&uintColor;
-
-            switch (components_)
-            {
-            case 4:
-                dest[3] = src[3];
-                // Fall through
-            case 3:
-                dest[2] = src[2];
-                // Fall through
-            case 2:
-                dest[1] = src[1];
-                // Fall through
-            default:
-                dest[0] = src[0];
-                break;
-            }
-        }
+    
+    // The horizontal sampling positions are the same for every row, so calculate them once
+    PODVector<unsigned> leftOffsets(width);
+    PODVector<unsigned> rightOffsets(width);
+    PODVector<float> xFractions(width);
+    for (int x = 0; x < width; ++x)
+    {
+        // Calculate float coordinates between 0 - 1 for resampling
+        float xF = (width_ > 1 && width > 1) ? (float)x / (float)(width - 1) : 0.0f;
+        int left, right;
+        GetBilinearCoords(xF, width_, left, right, xFractions[x]);
+        leftOffsets[x] = left * components_;
+        rightOffsets[x] = right * components_;
     }
+    
+    ResizeParams params;
+    params.in_ = data_.Get();
+    params.out_ = newData.Get();
+    params.widthIn_ = width_;
+    params.heightIn_ = height_;
+    params.widthOut_ = width;
+    params.heightOut_ = height;
+    params.components_ = components_;
+    params.leftOffsets_ = &leftOffsets[0];
+    params.rightOffsets_ = &rightOffsets[0];
+    params.xFractions_ = &xFractions[0];
+    ProcessImageRows(GetSubsystem<WorkQueue>(), height, width * components_, ResizeRows, &params);
 
     width_ = width;
     height_ = height;
@@ -951,9 +1274,81 @@ void Image::ClearInt(unsigned uintColor)
         return;
     }
 
-    unsigned char* src = (unsigned char*)&uintColor;
-    for (unsigned i = 0; i < width_ * height_ * depth_ * components_; ++i)
-        data_[i] = src[i % components_];
+    // Write the first pixel, then fill the rest by copying the already filled part
+    unsigned dataSize = width_ * height_ * depth_ * components_;
+    if (!dataSize)
+        return;
+    memcpy(data_.Get(), &uintColor, components_);
+    for (unsigned filled = components_; filled < dataSize; filled *= 2)
+        memcpy(data_.Get() + filled, data_.Get(), (unsigned)Min((int)filled, (int)(dataSize - filled)));
+}
+
+bool Image::Compress(CompressedFormat format)
+{
+    if (!data_)
+        return false;
+    
+    if (format != CF_DXT1 && format != CF_DXT3 && format != CF_DXT5)
+    {
+        LOGERROR("Compress only supports DXT1, DXT3 and DXT5 formats");
+        return false;
+    }
+
+    if (IsCompressed())
+    {
+        LOGERROR("Image is already compressed");
+        return false;
+    }
+
+    if (depth_ > 1)
+    {
+        LOGERROR("Compress not supported for 3D images");
+        return false;
+    }
+
+    PROFILE(CompressImage);
+
+    // Calculate the combined size of the compressed mip levels
+    unsigned dataSize = 0;
+    unsigned numLevels = 0;
+    for (int width = width_, height = height_;; width = Max(width / 2, 1), height = Max(height / 2, 1))
+    {
+        dataSize += GetCompressedImageSizeDXT(width, height, format);
+        ++numLevels;
+        if (width == 1 && height == 1)
+            break;
+    }
+
+    SharedArrayPtr<unsigned char> newData(new unsigned char[dataSize]);
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    unsigned dataOffset = 0;
+    SharedPtr<Image> nextLevel;
+    const Image* level = this;
+
+    for (unsigned i = 0; i < numLevels; ++i)
+    {
+        if (i)
+        {
+            nextLevel = level->GetNextLevel();
+            if (!nextLevel)
+                return false;
+            level = nextLevel;
+        }
+
+        CompressImageDXT(newData.Get() + dataOffset, level->data_.Get(), level->width_, level->height_, level->components_, format, queue);
+        dataOffset += GetCompressedImageSizeDXT(level->width_, level->height_, format);
+    }
+
+    // DXT1 keeps 1-bit alpha only if the source had alpha
+    bool hasAlpha = components_ == 2 || components_ == 4;
+    data_ = newData;
+    compressedFormat_ = format;
+    numCompressedLevels_ = numLevels;
+    components_ = (format == CF_DXT1 && !hasAlpha) ? 3 : 4;
+    nextLevel_.Reset();
+    derivedDataKey_.Clear();
+    SetMemoryUse(dataSize);
+    return true;
 }
 
 bool Image::SaveBMP(const String& fileName) const
@@ -1048,6 +1443,49 @@ bool Image::SaveJPG(const String & fileName, int quality) const
         return false;
 }
 
+bool Image::SaveDDS(const String& fileName) const
+{
+    PROFILE(SaveImageDDS);
+
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (fileSystem && !fileSystem->CheckAccess(GetPath(fileName)))
+    {
+        LOGERROR("Access denied to " + fileName);
+        return false;
+    }
+
+    if (compressedFormat_ != CF_DXT1 && compressedFormat_ != CF_DXT3 && compressedFormat_ != CF_DXT5)
+    {
+        LOGERROR("Can only save DXT compressed images to DDS");
+        return false;
+    }
+
+    File outFile(context_, fileName, FILE_WRITE);
+    if (!outFile.IsOpen())
+        return false;
+
+    DDSurfaceDesc2 ddsd;
+    memset(&ddsd, 0, sizeof ddsd);
+    ddsd.dwSize_ = sizeof ddsd;
+    // Caps, height, width, pixel format, mipmap count and linear size
+    ddsd.dwFlags_ = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+    ddsd.dwWidth_ = width_;
+    ddsd.dwHeight_ = height_;
+    ddsd.dwLinearSize_ = GetCompressedImageSizeDXT(width_, height_, compressedFormat_);
+    ddsd.dwMipMapCount_ = numCompressedLevels_;
+    ddsd.ddpfPixelFormat_.dwSize_ = sizeof ddsd.ddpfPixelFormat_;
+    // FourCC
+    ddsd.ddpfPixelFormat_.dwFlags_ = 0x4;
+    ddsd.ddpfPixelFormat_.dwFourCC_ = compressedFormat_ == CF_DXT1 ? FOURCC_DXT1 : (compressedFormat_ == CF_DXT3 ? FOURCC_DXT3 :
+        FOURCC_DXT5);
+    // Texture, plus complex and mipmap when there are several levels
+    ddsd.ddsCaps_.dwCaps_ = 0x1000 | (numCompressedLevels_ > 1 ? 0x8 | 0x400000 : 0);
+
+    outFile.WriteFileID("DDS ");
+    outFile.Write(&ddsd, sizeof ddsd);
+    return outFile.Write(data_.Get(), GetMemoryUse()) == GetMemoryUse();
+}
+
 Color Image::GetPixel(int x, int y) const
 {
     return GetPixel(x, y, 0);
@@ -1124,16 +1562,13 @@ unsigned Image::GetPixelInt(int x, int y, int z) const
 
 Color Image::GetPixelBilinear(float x, float y) const
 {
-    x = Clamp(x * width_ - 0.5f, 0.0f, (float)(width_ - 1));
-    y = Clamp(y * height_ - 0.5f, 0.0f, (float)(height_ - 1));
+    int left, right, top, bottom;
+    float xF, yF;
+    GetBilinearCoords(x, width_, left, right, xF);
+    GetBilinearCoords(y, height_, top, bottom, yF);
 
-    int xI = (int)x;
-    int yI = (int)y;
-    float xF = x - floorf(x);
-    float yF = y - floorf(y);
-
-    Color topColor = GetPixel(xI, yI).Lerp(GetPixel(xI + 1, yI), xF);
-    Color bottomColor = GetPixel(xI, yI + 1).Lerp(GetPixel(xI + 1, yI + 1), xF);
+    Color topColor = GetPixel(left, top).Lerp(GetPixel(right, top), xF);
+    Color bottomColor = GetPixel(left, bottom).Lerp(GetPixel(right, bottom), xF);
     return topColor.Lerp(bottomColor, yF);
 }
 
@@ -1248,70 +1683,13 @@ SharedPtr<Image> Image::GetNextLevel() const
     // 2D case
     else if (depth_ == 1)
     {
-        switch (components_)
-        {
-        case 1:
-            for (int y = 0; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y*2)*width_];
-                const unsigned char* inLower = &pixelDataIn[(y*2+1)*width_];
-                unsigned char* out = &pixelDataOut[y*widthOut];
-
-                for (int x = 0; x < widthOut; ++x)
-                {
-                    out[x] = ((unsigned)inUpper[x*2] + inUpper[x*2+1] + inLower[x*2] + inLower[x*2+1]) >> 2;
-                }
-            }
-            break;
-
-        case 2:
-            for (int y = 0; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y*2)*width_*2];
-                const unsigned char* inLower = &pixelDataIn[(y*2+1)*width_*2];
-                unsigned char* out = &pixelDataOut[y*widthOut*2];
-
-                for (int x = 0; x < widthOut*2; x += 2)
-                {
-                    out[x] = ((unsigned)inUpper[x*2] + inUpper[x*2+2] + inLower[x*2] + inLower[x*2+2]) >> 2;
-                    out[x+1] = ((unsigned)inUpper[x*2+1] + inUpper[x*2+3] + inLower[x*2+1] + inLower[x*2+3]) >> 2;
-                }
-            }
-            break;
-
-        case 3:
-            for (int y = 0; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y*2)*width_*3];
-                const unsigned char* inLower = &pixelDataIn[(y*2+1)*width_*3];
-                unsigned char* out = &pixelDataOut[y*widthOut*3];
-
-                for (int x = 0; x < widthOut*3; x += 3)
-                {
-                    out[x] = ((unsigned)inUpper[x*2] + inUpper[x*2+3] + inLower[x*2] + inLower[x*2+3]) >> 2;
-                    out[x+1] = ((unsigned)inUpper[x*2+1] + inUpper[x*2+4] + inLower[x*2+1] + inLower[x*2+4]) >> 2;
-                    out[x+2] = ((unsigned)inUpper[x*2+2] + inUpper[x*2+5] + inLower[x*2+2] + inLower[x*2+5]) >> 2;
-                }
-            }
-            break;
-
-        case 4:
-            for (int y = 0; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y*2)*width_*4];
-                const unsigned char* inLower = &pixelDataIn[(y*2+1)*width_*4];
-                unsigned char* out = &pixelDataOut[y*widthOut*4];
-
-                for (int x = 0; x < widthOut*4; x += 4)
-                {
-                    out[x] = ((unsigned)inUpper[x*2] + inUpper[x*2+4] + inLower[x*2] + inLower[x*2+4]) >> 2;
-                    out[x+1] = ((unsigned)inUpper[x*2+1] + inUpper[x*2+5] + inLower[x*2+1] + inLower[x*2+5]) >> 2;
-                    out[x+2] = ((unsigned)inUpper[x*2+2] + inUpper[x*2+6] + inLower[x*2+2] + inLower[x*2+6]) >> 2;
-                    out[x+3] = ((unsigned)inUpper[x*2+3] + inUpper[x*2+7] + inLower[x*2+3] + inLower[x*2+7]) >> 2;
-                }
-            }
-            break;
-        }
+        DownsampleParams params;
+        params.in_ = pixelDataIn;
+        params.out_ = pixelDataOut;
+        params.widthIn_ = width_;
+        params.widthOut_ = widthOut;
+        params.components_ = components_;
+        ProcessImageRows(GetSubsystem<WorkQueue>(), heightOut, widthOut * components_, DownsampleRows, &params);
     }
     // 3D case
     else
@@ -1736,7 +2114,7 @@ SDL_Surface* Image::GetSDLSurface(const IntRect& rect) const
 
 void Image::PrecalculateLevels()
 {
-    if (!data_ || IsCompressed())
+    if (!data_ || IsCompressed() || nextLevel_)
         return;
 
     PROFILE(PrecalculateImageMipLevels);
@@ -1752,13 +2130,86 @@ void Image::PrecalculateLevels()
             current->nextLevel_ = current->GetNextLevel();
             current = current->nextLevel_;
         }
+        
+        // Store the levels so that later loads of the same source do not need to calculate them
+        if (!derivedDataKey_.Empty())
+        {
+            StoreDerivedData();
+            derivedDataKey_.Clear();
+        }
     }
 }
 
+bool Image::LoadDerivedData(Deserializer& source)
+{
+    unsigned numLevels = source.ReadUInt();
+    if (!numLevels)
+        return false;
+    
+    Image* current = this;
+    for (unsigned i = 0; i < numLevels; ++i)
+    {
+        int width = source.ReadInt();
+        int height = source.ReadInt();
+        unsigned components = source.ReadUInt();
+        
+        if (i)
+        {
+            SharedPtr<Image> next(new Image(context_));
+            current->nextLevel_ = next;
+            current = next;
+        }
+        
+        if (!current->SetSize(width, height, components))
+        {
+            nextLevel_.Reset();
+            return false;
+        }
+        current->nextLevel_.Reset();
+        
+        unsigned dataSize = width * height * components;
+        if (source.Read(current->data_.Get(), dataSize) != dataSize)
+        {
+            nextLevel_.Reset();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void Image::StoreDerivedData()
+{
+    DerivedDataCache* derivedCache = GetSubsystem<DerivedDataCache>();
+    if (!derivedCache || derivedDataKey_.Empty())
+        return;
+    
+    unsigned numLevels = 0;
+    for (const Image* level = this; level; level = level->nextLevel_)
+        ++numLevels;
+    
+    VectorBuffer derivedData;
+    derivedData.WriteUInt(numLevels);
+    for (const Image* level = this; level; level = level->nextLevel_)
+    {
+        derivedData.WriteInt(level->width_);
+        derivedData.WriteInt(level->height_);
+        derivedData.WriteUInt(level->components_);
+        derivedData.Write(level->data_.Get(), level->width_ * level->height_ * level->components_);
+    }
+    
+    derivedCache->Store(derivedDataKey_, derivedData.GetData(), derivedData.GetSize());
+}
+
 unsigned char* Image::GetImageData(Deserializer& source, int& width, int& height, unsigned& components)
 {
     unsigned dataSize = source.GetSize();
 
+    // Decode directly from memory-mapped or in-memory data if possible
+    const unsigned char* data = source.GetInPlaceData();
+    if (data)
+        return stbi_load_from_memory(data, dataSize, &width, &height, (int *)&components, 0);
+
     SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
     source.Read(buffer.Get(), dataSize);
     return stbi_load_from_memory(buffer.Get(), dataSize, &width, &height, (int *)&components, 0);
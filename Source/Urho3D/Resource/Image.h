@@ -30,6 +30,8 @@ struct SDL_Surface;
 namespace Urho3D
 {
 
+class WorkQueue;
+
 static const int COLOR_LUT_SIZE = 16;
 
 /// Supported compressed image formats.
@@ -63,8 +65,8 @@ struct CompressedLevel
     {
     }
 
-    /// Decompress to RGBA. The destination buffer required is width * height * 4 bytes. Return true if successful.
-    bool Decompress(unsigned char* dest);
+    /// Decompress to RGBA. The destination buffer required is width * height * 4 bytes. If a work queue is given, large levels are decompressed in parallel when called from the main thread. Return true if successful.
+    bool Decompress(unsigned char* dest, WorkQueue* queue = 0);
 
     /// Compressed image data.
     unsigned char* data_;
@@ -126,6 +128,8 @@ public:
     bool FlipVertical();
     /// Resize image by bilinear resampling. Return true if successful.
     bool Resize(int width, int height);
+    /// Compress to DXT1, DXT3 or DXT5 including a full mip level chain. Not supported for 3D images. Return true if successful.
+    bool Compress(CompressedFormat format);
     /// Clear the image with a color.
     void Clear(const Color& color);
     /// Clear the image with an integer color. R component is in the 8 lowest bits.
@@ -138,6 +142,8 @@ public:
     bool SaveTGA(const String& fileName) const;
     /// Save in JPG format with compression quality. Return true if successful.
     bool SaveJPG(const String& fileName, int quality) const;
+    /// Save in DDS format. Only DXT compressed images are supported. Return true if successful.
+    bool SaveDDS(const String& fileName) const;
 
     /// Return a 2D pixel color.
     Color GetPixel(int x, int y) const;
@@ -183,6 +189,10 @@ private:
     static unsigned char* GetImageData(Deserializer& source, int& width, int& height, unsigned& components);
     /// Free an image file's pixel data.
     static void FreeImageData(unsigned char* pixelData);
+    /// Load decoded pixel data and mip levels from the derived data cache format. Return true if successful.
+    bool LoadDerivedData(Deserializer& source);
+    /// Store decoded pixel data and any precalculated mip levels to the derived data cache.
+    void StoreDerivedData();
 
     /// Width.
     int width_;
@@ -200,6 +210,8 @@ private:
     SharedArrayPtr<unsigned char> data_;
     /// Precalculated mip level image.
     SharedPtr<Image> nextLevel_;
+    /// Derived data cache key of the decoded source file. Empty if not cached or if modified since.
+    String derivedDataKey_;
 };
 
 }
@@ -22,6 +22,7 @@
 
 #include "../Resource/BackgroundLoader.h"
 #include "../Core/Context.h"
+#include "../Container/Sort.h"
 #include "../Core/CoreEvents.h"
 #include "../IO/FileSystem.h"
 #include "../IO/FileWatcher.h"
@@ -61,18 +62,61 @@ static const char* checkDirs[] = {
 };
 
 static const SharedPtr<Resource> noResource;
+static const unsigned MEMORY_BUDGET_CHECK_INTERVAL = 1000;
+
+/// Resource that can be released for exceeding the memory budget.
+struct EvictionCandidate
+{
+    /// Time since last use in milliseconds.
+    unsigned useTimer_;
+    /// Memory use.
+    unsigned memoryUse_;
+    /// Name hash.
+    StringHash nameHash_;
+};
+
+static bool CompareEvictionCandidates(const EvictionCandidate& lhs, const EvictionCandidate& rhs)
+{
+    return lhs.useTimer_ > rhs.useTimer_;
+}
+
+/// Lock for modifying the resource groups from the main thread. Acquires all lookup shards, so that no other thread is looking up resources meanwhile.
+class ResourceGroupsLock
+{
+public:
+    /// Construct and acquire the lookup mutexes.
+    ResourceGroupsLock(Mutex* mutexes) :
+        mutexes_(mutexes)
+    {
+        for (unsigned i = 0; i < NUM_RESOURCE_LOOKUP_SHARDS; ++i)
+            mutexes_[i].Acquire();
+    }
+    
+    /// Destruct and release the lookup mutexes.
+    ~ResourceGroupsLock()
+    {
+        for (int i = (int)NUM_RESOURCE_LOOKUP_SHARDS - 1; i >= 0; --i)
+            mutexes_[i].Release();
+    }
+    
+private:
+    /// Lookup mutexes.
+    Mutex* mutexes_;
+};
 
 ResourceCache::ResourceCache(Context* context) :
     Object(context),
     autoReloadResources_(false),
     returnFailedResources_(false),
     searchPackagesFirst_(true),
-    finishBackgroundResourcesMs_(5)
+    memoryMapPackages_(false),
+    finishBackgroundResourcesMs_(5),
+    memoryBudgetHysteresis_(0.0f)
 {
     // Register Resource library object factories
     RegisterResourceLibrary(context_);
     
-    // Create resource background loader. Its thread will start on the first background request
+    // Create resource background loader. Its threads will start on the first background request
     backgroundLoader_ = new BackgroundLoader(this);
     
     // Subscribe BeginFrame for handling directory watchers and background loaded resource finalization
@@ -143,7 +187,14 @@ bool ResourceCache::AddPackageFile(PackageFile* package, unsigned priority)
 bool ResourceCache::AddPackageFile(const String& fileName, unsigned priority)
 {
     SharedPtr<PackageFile> package(new PackageFile(context_));
-    return package->Open(fileName) && AddPackageFile(package);
+    if (!package->Open(fileName))
+        return false;
+    
+    // If mapping fails, the package is still usable through regular file reads
+    if (memoryMapPackages_ && !package->IsCompressed())
+        package->SetMemoryMapped(true);
+    
+    return AddPackageFile(package);
 }
 
 bool ResourceCache::AddManualResource(Resource* resource)
@@ -162,6 +213,7 @@ bool ResourceCache::AddManualResource(Resource* resource)
     }
     
     resource->ResetUseTimer();
+    ResourceGroupsLock lock(lookupMutexes_);
     resourceGroups_[resource->GetType()].resources_[resource->GetNameHash()] = resource;
     UpdateResourceGroup(resource->GetType());
     return true;
@@ -240,6 +292,7 @@ void ResourceCache::ReleaseResource(StringHash type, const String& name, bool fo
     // If other references exist, do not release, unless forced
     if ((existingRes.Refs() == 1 && existingRes.WeakRefs() == 0) || force)
     {
+        ResourceGroupsLock lock(lookupMutexes_);
         resourceGroups_[type].resources_.Erase(nameHash);
         UpdateResourceGroup(type);
     }
@@ -247,6 +300,7 @@ void ResourceCache::ReleaseResource(StringHash type, const String& name, bool fo
 
 void ResourceCache::ReleaseResources(StringHash type, bool force)
 {
+    ResourceGroupsLock lock(lookupMutexes_);
     bool released = false;
     
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
@@ -271,6 +325,7 @@ void ResourceCache::ReleaseResources(StringHash type, bool force)
 
 void ResourceCache::ReleaseResources(StringHash type, const String& partialName, bool force)
 {
+    ResourceGroupsLock lock(lookupMutexes_);
     bool released = false;
     
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
@@ -300,6 +355,7 @@ void ResourceCache::ReleaseResources(const String& partialName, bool force)
 {
     // Some resources refer to others, like materials to textures. Release twice to ensure these get released.
     // This is not necessary if forcing release
+    ResourceGroupsLock lock(lookupMutexes_);
     unsigned repeat = force ? 1 : 2;
     
     while (repeat--)
@@ -330,6 +386,7 @@ void ResourceCache::ReleaseResources(const String& partialName, bool force)
 
 void ResourceCache::ReleaseAllResources(bool force)
 {
+    ResourceGroupsLock lock(lookupMutexes_);
     unsigned repeat = force ? 1 : 2;
     
     while (repeat--)
@@ -361,12 +418,17 @@ bool ResourceCache::ReloadResource(Resource* resource)
     if (!resource)
         return false;
     
+    SharedPtr<File> file = GetFile(resource->GetName());
+    return ApplyReload(resource, file);
+}
+
+bool ResourceCache::ApplyReload(Resource* resource, Deserializer* source)
+{
     resource->SendEvent(E_RELOADSTARTED);
     
     bool success = false;
-    SharedPtr<File> file = GetFile(resource->GetName());
-    if (file)
-        success = resource->Load(*(file.Get()));
+    if (source)
+        success = resource->Load(*source);
     
     if (success)
     {
@@ -420,11 +482,94 @@ void ResourceCache::ReloadResourceWithDependencies(const String& fileName)
     }
 }
 
+void ResourceCache::QueueReloads(const Vector<String>& fileNames)
+{
+    // Collect the resources to reload in breadth-first order, so that a resource only depends on resources collected
+    // before it, and reloading the dependencies in turn can not form a cycle. Index M_MAX_UNSIGNED marks a changed file
+    // that is not a resource
+    Vector<SharedPtr<Resource> > resources;
+    Vector<PODVector<Resource*> > dependencies;
+    HashMap<StringHash, unsigned> visited;
+    PODVector<StringHash> queue;
+    PODVector<unsigned> parents;
+    
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
+    {
+        queue.Push(StringHash(fileNames[i]));
+        parents.Push(M_MAX_UNSIGNED);
+    }
+    
+    {
+        MutexLock lock(dependencyMutex_);
+        
+        for (unsigned i = 0; i < queue.Size(); ++i)
+        {
+            StringHash nameHash = queue[i];
+            unsigned parent = parents[i];
+            
+            HashMap<StringHash, unsigned>::ConstIterator j = visited.Find(nameHash);
+            if (j != visited.End())
+            {
+                unsigned index = j->second_;
+                if (index != M_MAX_UNSIGNED && parent != M_MAX_UNSIGNED && parent < index &&
+                    !dependencies[index].Contains(resources[parent]))
+                    dependencies[index].Push(resources[parent]);
+                continue;
+            }
+            
+            const SharedPtr<Resource>& resource = FindResource(nameHash);
+            unsigned index = M_MAX_UNSIGNED;
+            if (resource)
+            {
+                index = resources.Size();
+                resources.Push(resource);
+                dependencies.Resize(index + 1);
+                if (parent != M_MAX_UNSIGNED)
+                    dependencies[index].Push(resources[parent]);
+            }
+            visited[nameHash] = index;
+            
+            // Always perform dependency resource check for resource loaded from XML file as it could be used in inheritance
+            if (!resource || GetExtension(resource->GetName()) == ".xml")
+            {
+                HashMap<StringHash, HashSet<StringHash> >::ConstIterator k = dependentResources_.Find(nameHash);
+                if (k != dependentResources_.End())
+                {
+                    for (HashSet<StringHash>::ConstIterator l = k->second_.Begin(); l != k->second_.End(); ++l)
+                    {
+                        queue.Push(*l);
+                        parents.Push(index);
+                    }
+                }
+            }
+        }
+    }
+    
+    for (unsigned i = 0; i < resources.Size(); ++i)
+        backgroundLoader_->QueueReload(resources[i], dependencies[i]);
+}
+
 void ResourceCache::SetMemoryBudget(StringHash type, unsigned budget)
 {
+    ResourceGroupsLock lock(lookupMutexes_);
     resourceGroups_[type].memoryBudget_ = budget;
 }
 
+void ResourceCache::SetMemoryBudgetHysteresis(float hysteresis)
+{
+    memoryBudgetHysteresis_ = Clamp(hysteresis, 0.0f, 1.0f);
+}
+
+void ResourceCache::ResetStatistics()
+{
+    for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    {
+        i->second_.hits_ = 0;
+        i->second_.misses_ = 0;
+        i->second_.evictions_ = 0;
+    }
+}
+
 void ResourceCache::SetAutoReloadResources(bool enable)
 {
     if (enable != autoReloadResources_)
@@ -452,11 +597,13 @@ void ResourceCache::SetReturnFailedResources(bool enable)
 
 SharedPtr<File> ResourceCache::GetFile(const String& nameIn, bool sendEventOnFailure)
 {
-    MutexLock lock(resourceMutex_);
-    
-    String name = SanitateResourceName(nameIn);
-    if (resourceRouter_)
-        resourceRouter_->Route(name, RESOURCE_GETFILE);
+    String name;
+    {
+        MutexLock lock(resourceMutex_);
+        name = SanitateResourceName(nameIn);
+        if (resourceRouter_)
+            resourceRouter_->Route(name, RESOURCE_GETFILE);
+    }
     
     if (name.Length())
     {
@@ -501,6 +648,7 @@ SharedPtr<File> ResourceCache::GetFile(const String& nameIn, bool sendEventOnFai
 
 Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool sendEventOnFailure)
 {
+    MEMORY_TAG(MT_RESOURCE);
     String name = SanitateResourceName(nameIn);
     
     if (!Thread::IsMainThread())
@@ -520,7 +668,12 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
 
     const SharedPtr<Resource>& existing = FindResource(type, nameHash);
     if (existing)
+    {
+        // Mark as recently used so that the resource is released last if over memory budget
+        existing->ResetUseTimer();
+        ++resourceGroups_[type].hits_;
         return existing;
+    }
     
     SharedPtr<Resource> resource;
     // Make sure the pointer is non-null and is a Resource subclass
@@ -567,12 +720,24 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
     
     // Store to cache
     resource->ResetUseTimer();
-    resourceGroups_[type].resources_[nameHash] = resource;
+    ResourceGroupsLock lock(lookupMutexes_);
+    ResourceGroup& group = resourceGroups_[type];
+    group.resources_[nameHash] = resource;
+    ++group.misses_;
     UpdateResourceGroup(type);
     
     return resource;
 }
 
+Resource* ResourceCache::GetExistingResource(StringHash type, const String& nameIn)
+{
+    String name = SanitateResourceName(nameIn);
+    if (name.Empty())
+        return 0;
+    
+    return FindExistingResource(type, StringHash(name));
+}
+
 bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn, bool sendEventOnFailure, Resource* caller)
 {
     // If empty name, fail immediately
@@ -582,7 +747,7 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn
     
     // First check if already exists as a loaded resource
     StringHash nameHash(name);
-    if (FindResource(type, nameHash) != noResource)
+    if (FindExistingResource(type, nameHash))
         return false;
     
     return backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller);
@@ -590,6 +755,7 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn
 
 SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const String& nameIn, bool sendEventOnFailure)
 {
+    MEMORY_TAG(MT_RESOURCE);
     String name = SanitateResourceName(nameIn);
     
     // If empty name, return null pointer immediately
@@ -641,11 +807,21 @@ SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const String
     return resource;
 }
 
+void ResourceCache::SetNumBackgroundLoadThreads(unsigned num)
+{
+    backgroundLoader_->SetNumThreads(num);
+}
+
 unsigned ResourceCache::GetNumBackgroundLoadResources() const
 {
     return backgroundLoader_->GetNumQueuedResources();
 }
 
+unsigned ResourceCache::GetNumBackgroundLoadThreads() const
+{
+    return backgroundLoader_->GetNumThreads();
+}
+
 void ResourceCache::GetResources(PODVector<Resource*>& result, StringHash type) const
 {
     result.Clear();
@@ -707,6 +883,24 @@ unsigned ResourceCache::GetMemoryUse(StringHash type) const
         return 0;
 }
 
+unsigned ResourceCache::GetNumHits(StringHash type) const
+{
+    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    return i != resourceGroups_.End() ? i->second_.hits_ : 0;
+}
+
+unsigned ResourceCache::GetNumMisses(StringHash type) const
+{
+    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    return i != resourceGroups_.End() ? i->second_.misses_ : 0;
+}
+
+unsigned ResourceCache::GetNumEvictions(StringHash type) const
+{
+    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    return i != resourceGroups_.End() ? i->second_.evictions_ : 0;
+}
+
 unsigned ResourceCache::GetTotalMemoryUse() const
 {
     unsigned total = 0;
@@ -814,7 +1008,7 @@ void ResourceCache::StoreResourceDependency(Resource* resource, const String& de
     if (!resource || !autoReloadResources_)
         return;
     
-    MutexLock lock(resourceMutex_);
+    MutexLock lock(dependencyMutex_);
     
     StringHash nameHash(resource->GetName());
     HashSet<StringHash>& dependents = dependentResources_[dependency];
@@ -826,7 +1020,7 @@ void ResourceCache::ResetDependencies(Resource* resource)
     if (!resource || !autoReloadResources_)
         return;
     
-    MutexLock lock(resourceMutex_);
+    MutexLock lock(dependencyMutex_);
     
     StringHash nameHash(resource->GetName());
     
@@ -844,8 +1038,6 @@ void ResourceCache::ResetDependencies(Resource* resource)
 
 const SharedPtr<Resource>& ResourceCache::FindResource(StringHash type, StringHash nameHash)
 {
-    MutexLock lock(resourceMutex_);
-
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i == resourceGroups_.End())
         return noResource;
@@ -858,8 +1050,6 @@ const SharedPtr<Resource>& ResourceCache::FindResource(StringHash type, StringHa
 
 const SharedPtr<Resource>& ResourceCache::FindResource(StringHash nameHash)
 {
-    MutexLock lock(resourceMutex_);
-
     for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
     {
         HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Find(nameHash);
@@ -870,8 +1060,19 @@ const SharedPtr<Resource>& ResourceCache::FindResource(StringHash nameHash)
     return noResource;
 }
 
+Resource* ResourceCache::FindExistingResource(StringHash type, StringHash nameHash)
+{
+    // The main thread is the only one to modify the resource groups, so it does not need to lock
+    if (Thread::IsMainThread())
+        return FindResource(type, nameHash);
+    
+    MutexLock lock(lookupMutexes_[nameHash.Value() % NUM_RESOURCE_LOOKUP_SHARDS]);
+    return FindResource(type, nameHash);
+}
+
 void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
 {
+    ResourceGroupsLock lock(lookupMutexes_);
     HashSet<StringHash> affectedGroups;
     
     const HashMap<String, PackageEntry>& entries = package->GetEntries();
@@ -903,60 +1104,84 @@ void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
 
 void ResourceCache::UpdateResourceGroup(StringHash type)
 {
+    ResourceGroupsLock lock(lookupMutexes_);
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i == resourceGroups_.End())
         return;
     
-    for (;;)
+    ResourceGroup& group = i->second_;
+    unsigned totalSize = 0;
+    for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = group.resources_.Begin(); j != group.resources_.End(); ++j)
+        totalSize += j->second_->GetMemoryUse();
+    group.memoryUse_ = totalSize;
+    
+    if (!group.memoryBudget_ || group.memoryUse_ <= group.memoryBudget_)
+        return;
+    
+    // Memory budget exceeded: release least recently used resources until below the budget minus hysteresis
+    // (resources in use always return a zero timer and can not be released)
+    PODVector<EvictionCandidate> candidates;
+    for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = group.resources_.Begin(); j != group.resources_.End(); ++j)
     {
-        unsigned totalSize = 0;
-        unsigned oldestTimer = 0;
-        HashMap<StringHash, SharedPtr<Resource> >::Iterator oldestResource = i->second_.resources_.End();
-        
-        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
-            j != i->second_.resources_.End(); ++j)
+        unsigned useTimer = j->second_->GetUseTimer();
+        if (useTimer)
         {
-            totalSize += j->second_->GetMemoryUse();
-            unsigned useTimer = j->second_->GetUseTimer();
-            if (useTimer > oldestTimer)
-            {
-                oldestTimer = useTimer;
-                oldestResource = j;
-            }
-        }
-        
-        i->second_.memoryUse_ = totalSize;
-        
-        // If memory budget defined and is exceeded, remove the oldest resource and loop again
-        // (resources in use always return a zero timer and can not be removed)
-        if (i->second_.memoryBudget_ && i->second_.memoryUse_ > i->second_.memoryBudget_ &&
-            oldestResource != i->second_.resources_.End())
-        {
-            LOGDEBUG("Resource group " + oldestResource->second_->GetTypeName() + " over memory budget, releasing resource " +
-                oldestResource->second_->GetName());
-            i->second_.resources_.Erase(oldestResource);
+            EvictionCandidate candidate;
+            candidate.useTimer_ = useTimer;
+            candidate.memoryUse_ = j->second_->GetMemoryUse();
+            candidate.nameHash_ = j->first_;
+            candidates.Push(candidate);
         }
-        else
-            break;
+    }
+    
+    Sort(candidates.Begin(), candidates.End(), CompareEvictionCandidates);
+    
+    unsigned targetUse = (unsigned)(group.memoryBudget_ * (1.0f - memoryBudgetHysteresis_));
+    for (unsigned j = 0; j < candidates.Size() && group.memoryUse_ > targetUse; ++j)
+    {
+        HashMap<StringHash, SharedPtr<Resource> >::Iterator k = group.resources_.Find(candidates[j].nameHash_);
+        LOGDEBUG("Resource group " + k->second_->GetTypeName() + " over memory budget, releasing resource " +
+            k->second_->GetName());
+        group.resources_.Erase(k);
+        group.memoryUse_ -= candidates[j].memoryUse_;
+        ++group.evictions_;
     }
 }
 
 void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
+    // Collect the changes of all watchers first, so that a resource depending on several changed files is reloaded once
+    Vector<String> changedFiles;
     for (unsigned i = 0; i < fileWatchers_.Size(); ++i)
     {
-        String fileName;
-        while (fileWatchers_[i]->GetNextChange(fileName))
+        unsigned start = changedFiles.Size();
+        if (fileWatchers_[i]->GetNextChanges(changedFiles))
         {
-            ReloadResourceWithDependencies(fileName);
-
-            // Finally send a general file changed event even if the file was not a tracked resource
-            using namespace FileChanged;
-
-            VariantMap& eventData = GetEventDataMap();
-            eventData[P_FILENAME] = fileWatchers_[i]->GetPath() + fileName;
-            eventData[P_RESOURCENAME] = fileName;
-            SendEvent(E_FILECHANGED, eventData);
+            for (unsigned j = start; j < changedFiles.Size(); ++j)
+            {
+                // Send a general file changed event even if the file was not a tracked resource
+                using namespace FileChanged;
+                
+                VariantMap& eventData = GetEventDataMap();
+                eventData[P_FILENAME] = fileWatchers_[i]->GetPath() + changedFiles[j];
+                eventData[P_RESOURCENAME] = changedFiles[j];
+                SendEvent(E_FILECHANGED, eventData);
+            }
+        }
+    }
+    
+    // The files are read in the background, then the reloads are applied when finishing background loaded resources
+    if (!changedFiles.Empty())
+        QueueReloads(changedFiles);
+    
+    // Recheck exceeded memory budgets periodically, as resources may have gone out of use since they were last checked
+    if (memoryBudgetTimer_.GetMSec(false) >= MEMORY_BUDGET_CHECK_INTERVAL)
+    {
+        memoryBudgetTimer_.Reset();
+        for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+        {
+            if (i->second_.memoryBudget_ && i->second_.memoryUse_ > i->second_.memoryBudget_)
+                UpdateResourceGroup(i->first_);
         }
     }
     
@@ -970,17 +1195,29 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
 File* ResourceCache::SearchResourceDirs(const String& nameIn)
 {
     FileSystem* fileSystem = GetSubsystem<FileSystem>();
-    for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+    
+    // Only the directory search is done under the lock; the file is opened after releasing it
+    String fullPath;
     {
-        if (fileSystem->FileExists(resourceDirs_[i] + nameIn))
+        MutexLock lock(resourceMutex_);
+        for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
         {
-            // Construct the file first with full path, then rename it to not contain the resource path,
-            // so that the file's name can be used in further GetFile() calls (for example over the network)
-            File* file(new File(context_, resourceDirs_[i] + nameIn));
-            file->SetName(nameIn);
-            return file;
+            if (fileSystem->FileExists(resourceDirs_[i] + nameIn))
+            {
+                fullPath = resourceDirs_[i] + nameIn;
+                break;
+            }
         }
     }
+    
+    if (!fullPath.Empty())
+    {
+        // Construct the file first with full path, then rename it to not contain the resource path,
+        // so that the file's name can be used in further GetFile() calls (for example over the network)
+        File* file(new File(context_, fullPath));
+        file->SetName(nameIn);
+        return file;
+    }
 
     // Fallback using absolute path
     if (fileSystem->FileExists(nameIn))
@@ -991,6 +1228,8 @@ File* ResourceCache::SearchResourceDirs(const String& nameIn)
 
 File* ResourceCache::SearchPackages(const String& nameIn)
 {
+    MutexLock lock(resourceMutex_);
+    
     for (unsigned i = 0; i < packages_.Size(); ++i)
     {
         if (packages_[i]->Exists(nameIn))
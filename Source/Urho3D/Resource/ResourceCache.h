@@ -26,6 +26,7 @@
 #include "../Container/HashSet.h"
 #include "../Container/List.h"
 #include "../Core/Mutex.h"
+#include "../Core/Timer.h"
 #include "../Resource/Resource.h"
 
 namespace Urho3D
@@ -37,6 +38,8 @@ class PackageFile;
 
 /// Sets to priority so that a package or file is pushed to the end of the vector.
 static const unsigned PRIORITY_LAST = 0xffffffff;
+/// Number of lock shards for looking up loaded resources from outside the main thread.
+static const unsigned NUM_RESOURCE_LOOKUP_SHARDS = 8;
 
 /// Container of resources with specific type.
 struct ResourceGroup
@@ -44,7 +47,10 @@ struct ResourceGroup
     /// Construct with defaults.
     ResourceGroup() :
         memoryBudget_(0),
-        memoryUse_(0)
+        memoryUse_(0),
+        hits_(0),
+        misses_(0),
+        evictions_(0)
     {
     }
     
@@ -52,6 +58,12 @@ struct ResourceGroup
     unsigned memoryBudget_;
     /// Current memory use.
     unsigned memoryUse_;
+    /// Number of resource requests that found the resource already loaded.
+    unsigned hits_;
+    /// Number of resource requests that loaded the resource.
+    unsigned misses_;
+    /// Number of resources released for exceeding the memory budget.
+    unsigned evictions_;
     /// Resources.
     HashMap<StringHash, SharedPtr<Resource> > resources_;
 };
@@ -82,6 +94,8 @@ class URHO3D_API ResourceCache : public Object
 {
     OBJECT(ResourceCache);
     
+    friend class BackgroundLoader;
+    
 public:
     /// Construct.
     ResourceCache(Context* context);
@@ -98,9 +112,9 @@ public:
     bool AddManualResource(Resource* resource);
     /// Remove a resource load directory.
     void RemoveResourceDir(const String& pathName);
-    /// Remove a package file. Optionally release the resources loaded from it.
+    /// Remove a package file. Optionally release the resources loaded from it. Files still open from a memory-mapped package keep the mapping alive until they are closed.
     void RemovePackageFile(PackageFile* package, bool releaseResources = true, bool forceRelease = false);
-    /// Remove a package file by name. Optionally release the resources loaded from it.
+    /// Remove a package file by name. Optionally release the resources loaded from it. Files still open from a memory-mapped package keep the mapping alive until they are closed.
     void RemovePackageFile(const String& fileName, bool releaseResources = true, bool forceRelease = false);
     /// Release a resource by name.
     void ReleaseResource(StringHash type, const String& name, bool force = false);
@@ -116,16 +130,24 @@ public:
     bool ReloadResource(Resource* resource);
     /// Reload a resource based on filename. Causes also reload of dependent resources if necessary.
     void ReloadResourceWithDependencies(const String &fileName);
-    /// Set memory budget for a specific resource type, default 0 is unlimited.
+    /// Set memory budget for a specific resource type, default 0 is unlimited. When exceeded, the least recently requested resources that are not in use are released.
     void SetMemoryBudget(StringHash type, unsigned budget);
-    /// Enable or disable automatic reloading of resources as files are modified. Default false.
+    /// Set fraction of the memory budget to release in addition when a budget is exceeded, so that the next load does not immediately release another resource. Default 0.
+    void SetMemoryBudgetHysteresis(float hysteresis);
+    /// Reset the resource request hit, miss and eviction counters of all resource types.
+    void ResetStatistics();
+    /// Enable or disable automatic reloading of resources as files are modified. The files are read by the background loader and the reloads applied within the time limit for finishing background loaded resources. Default false.
     void SetAutoReloadResources(bool enable);
     /// Enable or disable returning resources that failed to load. Default false. This may be useful in editing to not lose resource ref attributes.
     void SetReturnFailedResources(bool enable);
     /// Define whether when getting resources should check package files or directories first. True for packages, false for directories.
     void SetSearchPackagesFirst(bool value) { searchPackagesFirst_ = value; }
+    /// Set whether to memory-map uncompressed package files added by name, so that files are read directly from the mapping. Default false.
+    void SetMemoryMapPackages(bool enable) { memoryMapPackages_ = enable; }
     /// Set how many milliseconds maximum per frame to spend on finishing background loaded resources.
     void SetFinishBackgroundResourcesMs(int ms) { finishBackgroundResourcesMs_ = Max(ms, 1); }
+    /// Set number of background loading threads. Default is the number of physical CPU cores minus one, between 1 and 4.
+    void SetNumBackgroundLoadThreads(unsigned num);
     /// Set the resource router object. By default there is none, so the routing process is skipped.
     void SetResourceRouter(ResourceRouter* router) { resourceRouter_ = router; }
     
@@ -133,12 +155,16 @@ public:
     SharedPtr<File> GetFile(const String& name, bool sendEventOnFailure = true);
     /// Return a resource by type and name. Load if not loaded yet. Return null if not found or if fails, unless SetReturnFailedResources(true) has been called. Can be called only from the main thread.
     Resource* GetResource(StringHash type, const String& name, bool sendEventOnFailure = true);
+    /// Return an already loaded resource by type and name, or null if not loaded. Does not attempt loading. Can be called from outside the main thread, in which case the caller must ensure the resource is not released by the main thread while in use.
+    Resource* GetExistingResource(StringHash type, const String& name);
     /// Load a resource without storing it in the resource cache. Return null if not found or if fails. Can be called from outside the main thread if the resource itself is safe to load completely (it does not possess for example GPU data.)
     SharedPtr<Resource> GetTempResource(StringHash type, const String& name, bool sendEventOnFailure = true);
     /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
     bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = 0);
     /// Return number of pending background-loaded resources.
     unsigned GetNumBackgroundLoadResources() const;
+    /// Return number of background loading threads.
+    unsigned GetNumBackgroundLoadThreads() const;
     /// Return all loaded resources of a specific type.
     void GetResources(PODVector<Resource*>& result, StringHash type) const;
     /// Return all loaded resources.
@@ -149,6 +175,8 @@ public:
     const Vector<SharedPtr<PackageFile> >& GetPackageFiles() const { return packages_; }
     /// Template version of returning a resource by name.
     template <class T> T* GetResource(const String& name, bool sendEventOnFailure = true);
+    /// Template version of returning an already loaded resource by name.
+    template <class T> T* GetExistingResource(const String& name);
     /// Template version of loading a resource without storing it to the cache.
     template <class T> SharedPtr<T> GetTempResource(const String& name, bool sendEventOnFailure = true);
     /// Template version of queueing a resource background load.
@@ -163,6 +191,14 @@ public:
     unsigned GetMemoryUse(StringHash type) const;
     /// Return total memory use for all resources.
     unsigned GetTotalMemoryUse() const;
+    /// Return fraction of the memory budget to release in addition when a budget is exceeded.
+    float GetMemoryBudgetHysteresis() const { return memoryBudgetHysteresis_; }
+    /// Return number of GetResource() requests for a resource type that found the resource already loaded.
+    unsigned GetNumHits(StringHash type) const;
+    /// Return number of GetResource() requests for a resource type that loaded the resource.
+    unsigned GetNumMisses(StringHash type) const;
+    /// Return number of resources of a type released for exceeding the memory budget.
+    unsigned GetNumEvictions(StringHash type) const;
     /// Return full absolute file name of resource if possible.
     String GetResourceFileName(const String& name) const;
     /// Return whether automatic resource reloading is enabled.
@@ -171,6 +207,8 @@ public:
     bool GetReturnFailedResources() const { return returnFailedResources_; }
     /// Return whether when getting resources should check package files or directories first.
     bool GetSearchPackagesFirst() const { return searchPackagesFirst_; }
+    /// Return whether uncompressed package files added by name are memory-mapped.
+    bool GetMemoryMapPackages() const { return memoryMapPackages_; }
     /// Return how many milliseconds maximum to spend on finishing background loaded resources.
     int GetFinishBackgroundResourcesMs() const { return finishBackgroundResourcesMs_; }
     /// Return the resource router.
@@ -192,6 +230,12 @@ private:
     const SharedPtr<Resource>& FindResource(StringHash type, StringHash nameHash);
     /// Find a resource by name only. Searches all type groups.
     const SharedPtr<Resource>& FindResource(StringHash nameHash);
+    /// Find a resource from any thread. Locks the lookup shard of the name hash when called from outside the main thread.
+    Resource* FindExistingResource(StringHash type, StringHash nameHash);
+    /// Reload a resource from its file data, or send the reload failed event if the file could not be read. Return true on success.
+    bool ApplyReload(Resource* resource, Deserializer* source);
+    /// Queue the background reload of resources depending on changed files, including the resources depending on them in turn. Each resource is queued once and reloaded after the resources it depends on.
+    void QueueReloads(const Vector<String>& fileNames);
     /// Release resources loaded from a package file.
     void ReleasePackageResources(PackageFile* package, bool force = false);
     /// Update a resource group. Recalculate memory use and release resources if over memory budget.
@@ -203,8 +247,12 @@ private:
     /// Search resource packages for file.
     File* SearchPackages(const String& nameIn);
     
-    /// Mutex for thread-safe access to the resource directories, resource packages and resource dependencies.
+    /// Mutex for thread-safe access to the resource directories, resource packages and resource router.
     mutable Mutex resourceMutex_;
+    /// Mutex for thread-safe access to the resource dependencies.
+    Mutex dependencyMutex_;
+    /// Mutexes for looking up resources from outside the main thread, selected by name hash. The resource groups are only modified by the main thread, which then acquires all of them, so main thread lookups need no locking.
+    Mutex lookupMutexes_[NUM_RESOURCE_LOOKUP_SHARDS];
     /// Resources by type.
     HashMap<StringHash, ResourceGroup> resourceGroups_;
     /// Resource load directories.
@@ -225,8 +273,14 @@ private:
     bool returnFailedResources_;
     /// Search priority flag.
     bool searchPackagesFirst_;
+    /// Memory-map package files flag.
+    bool memoryMapPackages_;
     /// How many milliseconds maximum per frame to spend on finishing background loaded resources.
     int finishBackgroundResourcesMs_;
+    /// Fraction of the memory budget to release in addition when a budget is exceeded.
+    float memoryBudgetHysteresis_;
+    /// Timer for rechecking exceeded memory budgets.
+    Timer memoryBudgetTimer_;
 };
 
 template <class T> T* ResourceCache::GetResource(const String& name, bool sendEventOnFailure)
@@ -235,6 +289,12 @@ template <class T> T* ResourceCache::GetResource(const String& name, bool sendEv
     return static_cast<T*>(GetResource(type, name, sendEventOnFailure));
 }
 
+template <class T> T* ResourceCache::GetExistingResource(const String& name)
+{
+    StringHash type = T::GetTypeStatic();
+    return static_cast<T*>(GetExistingResource(type, name));
+}
+
 template <class T> SharedPtr<T> ResourceCache::GetTempResource(const String& name, bool sendEventOnFailure)
 {
     StringHash type = T::GetTypeStatic();
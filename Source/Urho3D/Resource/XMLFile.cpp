@@ -88,11 +88,18 @@ bool XMLFile::BeginLoad(Deserializer& source)
         return false;
     }
 
-    SharedArrayPtr<char> buffer(new char[dataSize]);
-    if (source.Read(buffer.Get(), dataSize) != dataSize)
-        return false;
+    // Parse directly from memory-mapped or in-memory data if possible
+    const void* data = source.GetInPlaceData();
+    SharedArrayPtr<char> buffer;
+    if (!data)
+    {
+        buffer = new char[dataSize];
+        if (source.Read(buffer.Get(), dataSize) != dataSize)
+            return false;
+        data = buffer.Get();
+    }
 
-    if (!document_->load_buffer(buffer.Get(), dataSize))
+    if (!document_->load_buffer(data, dataSize))
     {
         LOGERROR("Could not parse XML data from " + source.GetName());
         document_->reset();
@@ -132,7 +132,20 @@ void Component::AddReplicationState(ComponentReplicationState* state)
     networkState_->replicationStates_.Push(state);
 }
 
+void Component::RemoveReplicationState(ComponentReplicationState* state)
+{
+    if (networkState_)
+        networkState_->replicationStates_.Remove(state);
+}
+
 void Component::PrepareNetworkUpdate()
+{
+    GatherNetworkUpdate();
+    CompareNetworkUpdate();
+    MarkNetworkUpdateDirty();
+}
+
+void Component::GatherNetworkUpdate()
 {
     if (!networkState_)
         AllocateNetworkState();
@@ -141,19 +154,10 @@ void Component::PrepareNetworkUpdate()
     if (!attributes)
         return;
 
-    unsigned numAttributes = attributes->Size();
-
-    if (networkState_->currentValues_.Size() != numAttributes)
-    {
-        networkState_->currentValues_.Resize(numAttributes);
-        networkState_->previousValues_.Resize(numAttributes);
+    InitNetworkValues();
 
-        // Copy the default attribute values to the previous state as a starting point
-        for (unsigned i = 0; i < numAttributes; ++i)
-            networkState_->previousValues_[i] = attributes->At(i).defaultValue_;
-    }
-
-    // Check for attribute changes
+    // Read the attributes. Accessors may not be thread-safe, so this is done before the comparison
+    unsigned numAttributes = attributes->Size();
     for (unsigned i = 0; i < numAttributes; ++i)
     {
         const AttributeInfo& attr = attributes->At(i);
@@ -162,25 +166,45 @@ void Component::PrepareNetworkUpdate()
             continue;
 
         OnGetAttribute(attr, networkState_->currentValues_[i]);
+    }
+
+    // Compare the variable-size values here, as the comparison in the worker threads must not copy Variants
+    DetectVariableNetworkChanges();
+}
 
-        if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
+void Component::CompareNetworkUpdate()
+{
+    if (networkState_ && networkState_->attributes_)
+        DetectNetworkChanges();
+}
+
+void Component::MarkNetworkUpdateDirty()
+{
+    if (!networkState_ || !networkState_->attributes_)
+        return;
+
+    unsigned numAttributes = networkState_->attributes_->Size();
+    const DirtyBits& changedAttributes = networkState_->changedAttributes_;
+
+    if (changedAttributes.Count())
+    {
+        // Mark the attributes dirty in all replication states that are tracking this component
+        for (PODVector<ReplicationState*>::Iterator i = networkState_->replicationStates_.Begin(); i !=
+            networkState_->replicationStates_.End(); ++i)
         {
-            networkState_->previousValues_[i] = networkState_->currentValues_[i];
+            ComponentReplicationState* compState = static_cast<ComponentReplicationState*>(*i);
+            for (unsigned j = 0; j < numAttributes; ++j)
+            {
+                if (changedAttributes.IsSet(j))
+                    compState->dirtyAttributes_.Set(j);
+            }
 
-            // Mark the attribute dirty in all replication states that are tracking this component
-            for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin(); j !=
-                networkState_->replicationStates_.End(); ++j)
+            // Add component's parent node to the dirty set if not added yet
+            NodeReplicationState* nodeState = compState->nodeState_;
+            if (!nodeState->markedDirty_)
             {
-                ComponentReplicationState* compState = static_cast<ComponentReplicationState*>(*j);
-                compState->dirtyAttributes_.Set(i);
-
-                // Add component's parent node to the dirty set if not added yet
-                NodeReplicationState* nodeState = compState->nodeState_;
-                if (!nodeState->markedDirty_)
-                {
-                    nodeState->markedDirty_ = true;
-                    nodeState->sceneState_->dirtyNodes_.Insert(node_->GetID());
-                }
+                nodeState->markedDirty_ = true;
+                nodeState->sceneState_->dirtyNodes_.Insert(node_->GetID());
             }
         }
     }
@@ -87,8 +87,16 @@ public:
 
     /// Add a replication state that is tracking this component.
     void AddReplicationState(ComponentReplicationState* state);
+    /// Remove a replication state that no longer tracks this component.
+    void RemoveReplicationState(ComponentReplicationState* state);
     /// Prepare network update by comparing attributes and marking replication states dirty as necessary.
     void PrepareNetworkUpdate();
+    /// Read the network attribute values and detect the changed variable-size attributes. Called by Scene in the main thread.
+    void GatherNetworkUpdate();
+    /// Detect the changed fixed-size attributes and encode the update. Called by Scene, possibly in a worker thread.
+    void CompareNetworkUpdate();
+    /// Mark the changed attributes dirty in the replication states. Called by Scene in the main thread.
+    void MarkNetworkUpdateDirty();
     /// Clean up all references to a network connection that is about to be removed.
     void CleanupConnection(Connection* connection);
 
@@ -0,0 +1,574 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/Context.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../Scene/Component.h"
+#include "../Scene/FlatScene.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneResolver.h"
+#include "../Scene/UnknownComponent.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Object type of a flat binary scene being loaded.
+struct FlatSceneLoaderType
+{
+    /// Type.
+    StringHash type_;
+    /// Type name.
+    String typeName_;
+    /// Stored attribute types.
+    PODVector<unsigned char> storedTypes_;
+    /// Matching current attribute for each stored attribute, or null to skip the value.
+    PODVector<const AttributeInfo*> attributes_;
+    /// Current file attributes of the type.
+    PODVector<const AttributeInfo*> fileAttributes_;
+    /// Matching stored attribute index for each current file attribute, or M_MAX_UNSIGNED if not stored.
+    PODVector<unsigned> storedIndices_;
+    /// Values of the object being loaded, in stored order.
+    Vector<Variant> values_;
+    /// Read position in the type's data block.
+    unsigned position_;
+    /// Registered type flag. Components of unregistered types are loaded as UnknownComponent.
+    bool registered_;
+};
+
+static Variant ReadValue(MemoryBuffer& source, VariantType type, const Vector<String>& strings)
+{
+    switch (type)
+    {
+    case VAR_STRING:
+        {
+            unsigned index = source.ReadUInt();
+            return index < strings.Size() ? strings[index] : String::EMPTY;
+        }
+
+    case VAR_RESOURCEREF:
+        {
+            ResourceRef ref;
+            ref.type_ = source.ReadStringHash();
+            unsigned index = source.ReadUInt();
+            if (index < strings.Size())
+                ref.name_ = strings[index];
+            return ref;
+        }
+
+    case VAR_RESOURCEREFLIST:
+        {
+            ResourceRefList refList;
+            refList.type_ = source.ReadStringHash();
+            refList.names_.Resize(source.ReadVLE());
+            for (unsigned i = 0; i < refList.names_.Size(); ++i)
+            {
+                unsigned index = source.ReadUInt();
+                if (index < strings.Size())
+                    refList.names_[i] = strings[index];
+            }
+            return refList;
+        }
+
+    default:
+        return source.ReadVariant(type);
+    }
+}
+
+static void ReadValues(MemoryBuffer& source, FlatSceneLoaderType& type, const Vector<String>& strings)
+{
+    source.Seek(type.position_);
+
+    for (unsigned i = 0; i < type.storedTypes_.Size(); ++i)
+        type.values_[i] = ReadValue(source, (VariantType)type.storedTypes_[i], strings);
+
+    type.position_ = source.GetPosition();
+}
+
+static void LoadNodeAttributes(Node* node, const FlatSceneLoaderType& type)
+{
+    // Same as the attribute loading of Node::Load(), which does not go through a virtual Load() either
+    for (unsigned i = 0; i < type.values_.Size(); ++i)
+    {
+        if (type.attributes_[i])
+            node->OnSetAttribute(*type.attributes_[i], type.values_[i]);
+    }
+}
+
+static void LoadComponentAttributes(Component* component, const FlatSceneLoaderType& type, VectorBuffer& buffer)
+{
+    // Convert the values to the ordinary binary component format and load them through the component's own Load(), so
+    // that components which depend on knowing they are being loaded, such as AnimatedModel, behave as in a binary scene
+    buffer.Clear();
+    if (!type.registered_)
+    {
+        // The stored order is the attribute order of the type when saved, so UnknownComponent keeps a valid payload
+        for (unsigned i = 0; i < type.values_.Size(); ++i)
+            buffer.WriteVariantData(type.values_[i]);
+    }
+    else
+    {
+        // Attributes missing from the stored data keep their current values
+        Variant value;
+        for (unsigned i = 0; i < type.fileAttributes_.Size(); ++i)
+        {
+            unsigned index = type.storedIndices_[i];
+            if (index != M_MAX_UNSIGNED)
+                buffer.WriteVariantData(type.values_[index]);
+            else
+            {
+                component->OnGetAttribute(*type.fileAttributes_[i], value);
+                buffer.WriteVariantData(value);
+            }
+        }
+    }
+
+    buffer.Seek(0);
+    component->Load(buffer);
+}
+
+FlatSceneWriter::FlatSceneWriter(Context* context) :
+    context_(context),
+    currentType_(M_MAX_UNSIGNED),
+    currentAttribute_(0)
+{
+}
+
+unsigned FlatSceneWriter::AddNode(StringHash type, unsigned id, unsigned parentIndex)
+{
+    FinishObject();
+
+    if (parentIndex != M_MAX_UNSIGNED && parentIndex >= nodes_.Size())
+    {
+        LOGERROR("Invalid parent node index for flat scene node");
+        parentIndex = nodes_.Size() ? 0 : M_MAX_UNSIGNED;
+    }
+
+    currentType_ = GetTypeIndex(type);
+    nodes_.Push(FlatSceneObject(id, parentIndex, currentType_));
+    return nodes_.Size() - 1;
+}
+
+void FlatSceneWriter::AddComponent(StringHash type, unsigned id)
+{
+    FinishObject();
+
+    if (nodes_.Empty())
+    {
+        LOGERROR("Can not add a component to a flat scene without nodes");
+        return;
+    }
+
+    currentType_ = GetTypeIndex(type);
+    components_.Push(FlatSceneObject(id, nodes_.Size() - 1, currentType_));
+}
+
+void FlatSceneWriter::AddAttribute(const Variant& value)
+{
+    if (currentType_ >= types_.Size())
+        return;
+
+    FlatSceneWriterType& type = types_[currentType_];
+    if (currentAttribute_ >= type.attributes_.Size())
+    {
+        LOGERROR("Too many attribute values for flat scene object");
+        return;
+    }
+
+    // If the value is of the wrong type, substitute the default to keep the data block readable
+    const AttributeInfo& attr = *type.attributes_[currentAttribute_];
+    WriteValue(type.data_, value.GetType() == attr.type_ ? value : attr.defaultValue_);
+    ++currentAttribute_;
+}
+
+void FlatSceneWriter::AddAttributes(const Serializable* object)
+{
+    if (currentType_ >= types_.Size())
+        return;
+
+    FlatSceneWriterType& type = types_[currentType_];
+    Variant value;
+
+    while (currentAttribute_ < type.attributes_.Size())
+    {
+        object->OnGetAttribute(*type.attributes_[currentAttribute_], value);
+        AddAttribute(value);
+    }
+}
+
+bool FlatSceneWriter::Save(Serializer& dest)
+{
+    FinishObject();
+
+    if (nodes_.Empty())
+    {
+        LOGERROR("Can not save a flat scene without nodes");
+        return false;
+    }
+
+    // Register type and attribute names to the string table before it is written
+    PODVector<unsigned> typeNames(types_.Size());
+    Vector<PODVector<unsigned> > attributeNames(types_.Size());
+    for (unsigned i = 0; i < types_.Size(); ++i)
+    {
+        typeNames[i] = GetStringIndex(context_->GetTypeName(types_[i].type_));
+        attributeNames[i].Resize(types_[i].attributes_.Size());
+        for (unsigned j = 0; j < types_[i].attributes_.Size(); ++j)
+            attributeNames[i][j] = GetStringIndex(types_[i].attributes_[j]->name_);
+    }
+
+    bool success = true;
+    success &= dest.WriteFileID("USCF");
+    success &= dest.WriteUInt(FLAT_SCENE_VERSION);
+    success &= dest.WriteUInt(strings_.Size());
+    success &= dest.WriteUInt(types_.Size());
+    success &= dest.WriteUInt(nodes_.Size());
+    success &= dest.WriteUInt(components_.Size());
+
+    for (unsigned i = 0; i < strings_.Size(); ++i)
+        success &= dest.WriteString(strings_[i]);
+
+    for (unsigned i = 0; i < types_.Size(); ++i)
+    {
+        const FlatSceneWriterType& type = types_[i];
+        success &= dest.WriteStringHash(type.type_);
+        success &= dest.WriteUInt(typeNames[i]);
+        success &= dest.WriteUInt(type.attributes_.Size());
+        for (unsigned j = 0; j < type.attributes_.Size(); ++j)
+        {
+            success &= dest.WriteUInt(attributeNames[i][j]);
+            success &= dest.WriteUByte((unsigned char)type.attributes_[j]->type_);
+        }
+        success &= dest.WriteUInt(type.data_.GetSize());
+    }
+
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+    {
+        success &= dest.WriteUInt(nodes_[i].id_);
+        success &= dest.WriteUInt(nodes_[i].parentIndex_);
+        success &= dest.WriteUInt(nodes_[i].typeIndex_);
+    }
+
+    for (unsigned i = 0; i < components_.Size(); ++i)
+    {
+        success &= dest.WriteUInt(components_[i].id_);
+        success &= dest.WriteUInt(components_[i].parentIndex_);
+        success &= dest.WriteUInt(components_[i].typeIndex_);
+    }
+
+    for (unsigned i = 0; i < types_.Size(); ++i)
+    {
+        const VectorBuffer& data = types_[i].data_;
+        if (data.GetSize())
+            success &= dest.Write(data.GetData(), data.GetSize()) == data.GetSize();
+    }
+
+    if (!success)
+        LOGERROR("Could not save flat scene, writing to stream failed");
+
+    return success;
+}
+
+unsigned FlatSceneWriter::GetTypeIndex(StringHash type)
+{
+    HashMap<StringHash, unsigned>::ConstIterator i = typeIndices_.Find(type);
+    if (i != typeIndices_.End())
+        return i->second_;
+
+    unsigned index = types_.Size();
+    types_.Resize(index + 1);
+    FlatSceneWriterType& newType = types_.Back();
+    newType.type_ = type;
+
+    const Vector<AttributeInfo>* attributes = context_->GetAttributes(type);
+    if (attributes)
+    {
+        for (unsigned j = 0; j < attributes->Size(); ++j)
+        {
+            if (attributes->At(j).mode_ & AM_FILE)
+                newType.attributes_.Push(&attributes->At(j));
+        }
+    }
+
+    typeIndices_[type] = index;
+    return index;
+}
+
+unsigned FlatSceneWriter::GetStringIndex(const String& str)
+{
+    HashMap<String, unsigned>::ConstIterator i = stringIndices_.Find(str);
+    if (i != stringIndices_.End())
+        return i->second_;
+
+    unsigned index = strings_.Size();
+    strings_.Push(str);
+    stringIndices_[str] = index;
+    return index;
+}
+
+void FlatSceneWriter::FinishObject()
+{
+    if (currentType_ >= types_.Size())
+        return;
+
+    FlatSceneWriterType& type = types_[currentType_];
+    while (currentAttribute_ < type.attributes_.Size())
+        AddAttribute(type.attributes_[currentAttribute_]->defaultValue_);
+
+    currentType_ = M_MAX_UNSIGNED;
+    currentAttribute_ = 0;
+}
+
+void FlatSceneWriter::WriteValue(VectorBuffer& dest, const Variant& value)
+{
+    switch (value.GetType())
+    {
+    case VAR_STRING:
+        dest.WriteUInt(GetStringIndex(value.GetString()));
+        break;
+
+    case VAR_RESOURCEREF:
+        {
+            const ResourceRef& ref = value.GetResourceRef();
+            dest.WriteStringHash(ref.type_);
+            dest.WriteUInt(GetStringIndex(ref.name_));
+        }
+        break;
+
+    case VAR_RESOURCEREFLIST:
+        {
+            const ResourceRefList& refList = value.GetResourceRefList();
+            dest.WriteStringHash(refList.type_);
+            dest.WriteVLE(refList.names_.Size());
+            for (unsigned i = 0; i < refList.names_.Size(); ++i)
+                dest.WriteUInt(GetStringIndex(refList.names_[i]));
+        }
+        break;
+
+    default:
+        dest.WriteVariantData(value);
+        break;
+    }
+}
+
+bool LoadFlatScene(Scene* scene, const void* data, unsigned size)
+{
+    Context* context = scene->GetContext();
+    MemoryBuffer source(data, size);
+
+    if (source.ReadUInt() != FLAT_SCENE_VERSION)
+    {
+        LOGERROR("Unsupported flat scene version");
+        return false;
+    }
+
+    unsigned numStrings = source.ReadUInt();
+    unsigned numTypes = source.ReadUInt();
+    unsigned numNodes = source.ReadUInt();
+    unsigned numComponents = source.ReadUInt();
+
+    // Each string takes at least one byte, each type and object at least 12 bytes
+    if (numStrings > size || numTypes > size / 12 || numNodes > size / 12 || numComponents > size / 12)
+    {
+        LOGERROR("Corrupt flat scene data");
+        return false;
+    }
+
+    Vector<String> strings(numStrings);
+    for (unsigned i = 0; i < numStrings; ++i)
+        strings[i] = source.ReadString();
+
+    // Match the stored attributes of each type to the current attributes by name, so that data saved with an older
+    // attribute layout can still be loaded
+    Vector<FlatSceneLoaderType> types(numTypes);
+    PODVector<unsigned> dataSizes(numTypes);
+    for (unsigned i = 0; i < numTypes; ++i)
+    {
+        FlatSceneLoaderType& type = types[i];
+        type.type_ = source.ReadStringHash();
+        unsigned typeNameIndex = source.ReadUInt();
+        if (typeNameIndex < numStrings)
+            type.typeName_ = strings[typeNameIndex];
+        type.registered_ = !context->GetTypeName(type.type_).Empty();
+
+        const Vector<AttributeInfo>* attributes = context->GetAttributes(type.type_);
+        unsigned numAttributes = source.ReadUInt();
+        if (numAttributes > size)
+        {
+            LOGERROR("Corrupt flat scene data");
+            return false;
+        }
+        type.storedTypes_.Resize(numAttributes);
+        type.attributes_.Resize(numAttributes);
+        type.values_.Resize(numAttributes);
+
+        if (attributes)
+        {
+            for (unsigned j = 0; j < attributes->Size(); ++j)
+            {
+                if (attributes->At(j).mode_ & AM_FILE)
+                    type.fileAttributes_.Push(&attributes->At(j));
+            }
+        }
+        type.storedIndices_.Resize(type.fileAttributes_.Size());
+        for (unsigned j = 0; j < type.storedIndices_.Size(); ++j)
+            type.storedIndices_[j] = M_MAX_UNSIGNED;
+
+        for (unsigned j = 0; j < numAttributes; ++j)
+        {
+            unsigned nameIndex = source.ReadUInt();
+            type.storedTypes_[j] = source.ReadUByte();
+            type.attributes_[j] = 0;
+            if (!attributes || nameIndex >= numStrings)
+                continue;
+
+            const String& name = strings[nameIndex];
+            // Usually the layout is unchanged, so check the attribute at the same index first
+            if (j < attributes->Size() && attributes->At(j).name_ == name)
+                type.attributes_[j] = &attributes->At(j);
+            else
+            {
+                for (unsigned k = 0; k < attributes->Size(); ++k)
+                {
+                    if (attributes->At(k).name_ == name)
+                    {
+                        type.attributes_[j] = &attributes->At(k);
+                        break;
+                    }
+                }
+            }
+
+            if (type.attributes_[j] && (type.attributes_[j]->type_ != type.storedTypes_[j] ||
+                !(type.attributes_[j]->mode_ & AM_FILE)))
+                type.attributes_[j] = 0;
+
+            if (type.attributes_[j])
+            {
+                for (unsigned k = 0; k < type.fileAttributes_.Size(); ++k)
+                {
+                    if (type.fileAttributes_[k] == type.attributes_[j])
+                    {
+                        type.storedIndices_[k] = j;
+                        break;
+                    }
+                }
+            }
+        }
+
+        dataSizes[i] = source.ReadUInt();
+    }
+
+    unsigned objectsStart = source.GetPosition();
+    unsigned dataStart = objectsStart + (numNodes + numComponents) * 3 * sizeof(unsigned);
+    unsigned dataEnd = dataStart;
+    for (unsigned i = 0; i < numTypes; ++i)
+    {
+        types[i].position_ = dataEnd;
+        dataEnd += dataSizes[i];
+    }
+    if (dataEnd > size)
+    {
+        LOGERROR("Truncated flat scene data");
+        return false;
+    }
+
+    const unsigned char* objects = static_cast<const unsigned char*>(data) + objectsStart;
+    const unsigned char* components = objects + numNodes * 3 * sizeof(unsigned);
+    unsigned componentIndex = 0;
+    PODVector<Node*> nodes(numNodes);
+    SceneResolver resolver;
+    VectorBuffer componentBuffer;
+
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        FlatSceneObject nodeEntry;
+        memcpy(&nodeEntry, objects + i * sizeof(FlatSceneObject), sizeof(FlatSceneObject));
+        if (nodeEntry.typeIndex_ >= numTypes || (i && nodeEntry.parentIndex_ >= i))
+        {
+            LOGERROR("Corrupt flat scene data");
+            return false;
+        }
+
+        // The root node's ID is not applied, only stored for resolving possible references
+        Node* node;
+        if (!i)
+            node = scene;
+        else
+        {
+            node = nodes[nodeEntry.parentIndex_]->CreateChild(String::EMPTY, nodeEntry.id_ < FIRST_LOCAL_ID ? REPLICATED :
+                LOCAL, nodeEntry.id_);
+        }
+        nodes[i] = node;
+        resolver.AddNode(nodeEntry.id_, node);
+        ReadValues(source, types[nodeEntry.typeIndex_], strings);
+        LoadNodeAttributes(node, types[nodeEntry.typeIndex_]);
+
+        // Components are stored in node order
+        while (componentIndex < numComponents)
+        {
+            FlatSceneObject compEntry;
+            memcpy(&compEntry, components + componentIndex * sizeof(FlatSceneObject), sizeof(FlatSceneObject));
+            if (compEntry.parentIndex_ != i)
+                break;
+            if (compEntry.typeIndex_ >= numTypes)
+            {
+                LOGERROR("Corrupt flat scene data");
+                return false;
+            }
+
+            FlatSceneLoaderType& type = types[compEntry.typeIndex_];
+            CreateMode mode = compEntry.id_ < FIRST_LOCAL_ID && node->GetID() < FIRST_LOCAL_ID ? REPLICATED : LOCAL;
+            Component* newComponent;
+            if (type.registered_)
+                newComponent = node->CreateComponent(type.type_, mode, compEntry.id_);
+            else
+            {
+                // Keep unregistered components as placeholders, like Node::Load() does
+                LOGWARNING("Component type " + type.type_.ToString() + " not known, creating UnknownComponent as placeholder");
+                SharedPtr<UnknownComponent> unknown(new UnknownComponent(context));
+                if (type.typeName_.Empty())
+                    unknown->SetType(type.type_);
+                else
+                    unknown->SetTypeName(type.typeName_);
+                node->AddComponent(unknown, compEntry.id_, mode);
+                newComponent = unknown;
+            }
+
+            // The values are read even without a component to advance the data position
+            ReadValues(source, type, strings);
+            if (newComponent)
+            {
+                resolver.AddComponent(compEntry.id_, newComponent);
+                LoadComponentAttributes(newComponent, type, componentBuffer);
+            }
+            ++componentIndex;
+        }
+    }
+
+    resolver.Resolve();
+    scene->ApplyAttributes();
+    return true;
+}
+
+}
@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../IO/VectorBuffer.h"
+
+namespace Urho3D
+{
+
+class Context;
+class Scene;
+class Serializable;
+struct AttributeInfo;
+
+/// Flat binary scene format version.
+static const unsigned FLAT_SCENE_VERSION = 1;
+
+/// %Node or component entry of a flat binary scene.
+struct FlatSceneObject
+{
+    /// Construct undefined.
+    FlatSceneObject()
+    {
+    }
+
+    /// Construct with values.
+    FlatSceneObject(unsigned id, unsigned parentIndex, unsigned typeIndex) :
+        id_(id),
+        parentIndex_(parentIndex),
+        typeIndex_(typeIndex)
+    {
+    }
+
+    /// Object ID.
+    unsigned id_;
+    /// Index of the parent node, or the owner node for a component. M_MAX_UNSIGNED for the root node.
+    unsigned parentIndex_;
+    /// Index into the type table.
+    unsigned typeIndex_;
+};
+
+/// Object type of a flat binary scene being written. All attribute data of the type is stored in one block.
+struct FlatSceneWriterType
+{
+    /// Type.
+    StringHash type_;
+    /// File attributes of the type.
+    PODVector<const AttributeInfo*> attributes_;
+    /// Attribute data of all objects of the type.
+    VectorBuffer data_;
+};
+
+/// Writer of the flat binary scene format. Nodes must be added in hierarchy order: each node is followed by its components and then its child nodes, and each object is followed by its attribute values.
+class URHO3D_API FlatSceneWriter
+{
+public:
+    /// Construct.
+    FlatSceneWriter(Context* context);
+
+    /// Add a node. The parent index is the return value of an earlier call, or M_MAX_UNSIGNED for the root node. Return the node index.
+    unsigned AddNode(StringHash type, unsigned id, unsigned parentIndex);
+    /// Add a component to the most recently added node.
+    void AddComponent(StringHash type, unsigned id);
+    /// Add the value of the next file attribute of the most recently added object.
+    void AddAttribute(const Variant& value);
+    /// Add the values of all file attributes of a live object, which must match the most recently added object's type.
+    void AddAttributes(const Serializable* object);
+    /// Write the scene. Return true if successful.
+    bool Save(Serializer& dest);
+
+    /// Return number of nodes added.
+    unsigned GetNumNodes() const { return nodes_.Size(); }
+    /// Return number of components added.
+    unsigned GetNumComponents() const { return components_.Size(); }
+
+private:
+    /// Return type table index, adding the type if necessary.
+    unsigned GetTypeIndex(StringHash type);
+    /// Return string table index, adding the string if necessary.
+    unsigned GetStringIndex(const String& str);
+    /// Write defaults for the attributes not given for the most recently added object.
+    void FinishObject();
+    /// Write an attribute value to a type's data block.
+    void WriteValue(VectorBuffer& dest, const Variant& value);
+
+    /// Context.
+    Context* context_;
+    /// Type table.
+    Vector<FlatSceneWriterType> types_;
+    /// Type table indices by type.
+    HashMap<StringHash, unsigned> typeIndices_;
+    /// String table.
+    Vector<String> strings_;
+    /// String table indices by string.
+    HashMap<String, unsigned> stringIndices_;
+    /// Nodes in hierarchy order.
+    PODVector<FlatSceneObject> nodes_;
+    /// Components in node order.
+    PODVector<FlatSceneObject> components_;
+    /// Type index of the most recently added object.
+    unsigned currentType_;
+    /// Number of attributes written for the most recently added object.
+    unsigned currentAttribute_;
+};
+
+/// Load a flat binary scene into an empty scene from the data that follows the USCF file ID. The data is read in place and may reside in a memory-mapped file. Return true if successful.
+URHO3D_API bool LoadFlatScene(Scene* scene, const void* data, unsigned size);
+
+}
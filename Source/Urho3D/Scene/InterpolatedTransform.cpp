@@ -0,0 +1,183 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/Context.h"
+#include "../Scene/InterpolatedTransform.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+InterpolatedTransform::InterpolatedTransform(Context* context) :
+    Component(context),
+    extrapolating_(false),
+    subscribed_(false)
+{
+}
+
+InterpolatedTransform::~InterpolatedTransform()
+{
+}
+
+void InterpolatedTransform::RegisterObject(Context* context)
+{
+    context->RegisterFactory<InterpolatedTransform>();
+}
+
+void InterpolatedTransform::Update(float time, float extrapolationLimit, float squaredSnapThreshold)
+{
+    extrapolating_ = false;
+
+    if (samples_.Size() && node_)
+    {
+        // Drop the samples that playback has passed, but keep two for interpolating or extrapolating
+        unsigned passed = 0;
+        while (passed + 2 < samples_.Size() && samples_[passed + 1].time_ <= time)
+            ++passed;
+        if (passed)
+            samples_.Erase(0, passed);
+
+        const TransformSample& from = samples_[0];
+        Vector3 position = from.position_;
+        Quaternion rotation = from.rotation_;
+
+        if (samples_.Size() > 1 && time > from.time_)
+        {
+            const TransformSample& to = samples_[1];
+            // Sample times are always increasing, so the interval is positive
+            float interval = to.time_ - from.time_;
+            float t = (time - from.time_) / interval;
+
+            if (t > 1.0f)
+            {
+                t = Min(t, 1.0f + extrapolationLimit / interval);
+                extrapolating_ = true;
+                rotation = to.rotation_;
+            }
+            else
+                rotation = from.rotation_.Slerp(to.rotation_, t);
+
+            // If position snaps, hold the previous position until the next sample's time
+            if ((to.position_ - from.position_).LengthSquared() > squaredSnapThreshold)
+            {
+                position = t < 1.0f ? from.position_ : to.position_;
+                extrapolating_ = false;
+            }
+            else
+                position = from.position_ + (to.position_ - from.position_) * t;
+        }
+
+        node_->SetPosition(position);
+        node_->SetRotation(rotation);
+
+        // When only one sample remains and it has been reached, the transform can not change until more are received
+        if (samples_.Size() == 1 && time >= from.time_)
+        {
+            UnsubscribeFromEvent(GetScene(), E_UPDATESMOOTHING);
+            subscribed_ = false;
+        }
+    }
+}
+
+void InterpolatedTransform::AddPosition(const Vector3& position)
+{
+    TransformSample* sample = GetLatestSample();
+    if (sample)
+        sample->position_ = position;
+}
+
+void InterpolatedTransform::AddRotation(const Quaternion& rotation)
+{
+    TransformSample* sample = GetLatestSample();
+    if (sample)
+        sample->rotation_ = rotation;
+}
+
+void InterpolatedTransform::ClearSamples()
+{
+    samples_.Clear();
+    extrapolating_ = false;
+}
+
+void InterpolatedTransform::OnNodeSet(Node* node)
+{
+    if (!node)
+        ClearSamples();
+}
+
+TransformSample* InterpolatedTransform::GetLatestSample()
+{
+    if (!node_)
+        return 0;
+
+    Scene* scene = GetScene();
+    float time = scene ? scene->GetServerTime() : 0.0f;
+
+    // Subscribe to smoothing update if not yet subscribed
+    if (!subscribed_)
+    {
+        SubscribeToEvent(scene, E_UPDATESMOOTHING, HANDLER(InterpolatedTransform, HandleUpdateSmoothing));
+        subscribed_ = true;
+    }
+
+    if (samples_.Size())
+    {
+        // The position and rotation of one update go to the same sample. Updates arriving out of order are discarded
+        if (samples_.Back().time_ == time)
+            return &samples_.Back();
+        else if (samples_.Back().time_ > time)
+            return 0;
+    }
+
+    // Start from the previous sample, or from the current transform, as only the position or rotation may be received
+    TransformSample sample;
+    sample.time_ = time;
+    if (samples_.Size())
+    {
+        sample.position_ = samples_.Back().position_;
+        sample.rotation_ = samples_.Back().rotation_;
+    }
+    else
+    {
+        sample.position_ = node_->GetPosition();
+        sample.rotation_ = node_->GetRotation();
+    }
+
+    if (samples_.Size() >= MAX_TRANSFORM_SAMPLES)
+        samples_.Erase(0);
+    samples_.Push(sample);
+    return &samples_.Back();
+}
+
+void InterpolatedTransform::HandleUpdateSmoothing(StringHash eventType, VariantMap& eventData)
+{
+    using namespace UpdateSmoothing;
+
+    Scene* scene = GetScene();
+    if (scene)
+        Update(scene->GetInterpolationTime(), scene->GetExtrapolationLimit(), eventData[P_SQUAREDSNAPTHRESHOLD].GetFloat());
+}
+
+}
@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Scene/Component.h"
+
+namespace Urho3D
+{
+
+/// Maximum number of buffered transform samples.
+static const unsigned MAX_TRANSFORM_SAMPLES = 32;
+
+/// Transform received from the server, stamped with the server time of the update.
+struct TransformSample
+{
+    /// Server time in seconds.
+    float time_;
+    /// Position in parent space.
+    Vector3 position_;
+    /// Rotation in parent space.
+    Quaternion rotation_;
+};
+
+/// Transform interpolation component for network updates. Buffers the received transforms and plays them back with a delay.
+class URHO3D_API InterpolatedTransform : public Component
+{
+    OBJECT(InterpolatedTransform);
+
+public:
+    /// Construct.
+    InterpolatedTransform(Context* context);
+    /// Destruct.
+    ~InterpolatedTransform();
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Update the node transform for a playback time in server time. Past the newest sample the position is extrapolated, at most by the extrapolation limit. Samples further apart than the snap threshold are not interpolated.
+    void Update(float time, float extrapolationLimit, float squaredSnapThreshold);
+    /// Add a received position in parent space, stamped with the server time of the latest update.
+    void AddPosition(const Vector3& position);
+    /// Add a received rotation in parent space, stamped with the server time of the latest update.
+    void AddRotation(const Quaternion& rotation);
+    /// Remove all buffered samples.
+    void ClearSamples();
+
+    /// Return number of buffered samples.
+    unsigned GetNumSamples() const { return samples_.Size(); }
+    /// Return server time of the newest sample, or 0 if none.
+    float GetNewestTime() const { return samples_.Size() ? samples_.Back().time_ : 0.0f; }
+    /// Return whether the position was extrapolated past the newest sample on the last update.
+    bool IsExtrapolating() const { return extrapolating_; }
+
+protected:
+    /// Handle scene node being assigned at creation.
+    virtual void OnNodeSet(Node* node);
+
+private:
+    /// Return the sample for the latest update, adding it if necessary, or null if the update is older than the buffered samples.
+    TransformSample* GetLatestSample();
+    /// Handle smoothing update event.
+    void HandleUpdateSmoothing(StringHash eventType, VariantMap& eventData);
+
+    /// Buffered samples ordered by time.
+    PODVector<TransformSample> samples_;
+    /// Extrapolating flag.
+    bool extrapolating_;
+    /// Subscribed to smoothing update event flag.
+    bool subscribed_;
+};
+
+}
@@ -22,6 +22,7 @@
 
 #include "../Scene/Component.h"
 #include "../Core/Context.h"
+#include "../Scene/InterpolatedTransform.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
 #include "../Scene/ObjectAnimation.h"
@@ -77,8 +78,10 @@ void Node::RegisterObject(Context* context)
     ACCESSOR_ATTRIBUTE("Scale", GetScale, SetScale, Vector3, Vector3::ONE, AM_DEFAULT);
     ATTRIBUTE("Variables", VariantMap, vars_, Variant::emptyVariantMap, AM_FILE); // Network replication of vars uses custom data
     ACCESSOR_ATTRIBUTE("Network Position", GetNetPositionAttr, SetNetPositionAttr, Vector3, Vector3::ZERO, AM_NET | AM_LATESTDATA | AM_NOEDIT);
-    ACCESSOR_ATTRIBUTE("Network Rotation", GetNetRotationAttr, SetNetRotationAttr, PODVector<unsigned char>, Variant::emptyBuffer, AM_NET | AM_LATESTDATA | AM_NOEDIT);
+    ACCESSOR_ATTRIBUTE("Network Rotation", GetNetRotationAttr, SetNetRotationAttr, Quaternion, Quaternion::IDENTITY, AM_NET | AM_LATESTDATA | AM_NOEDIT);
     ACCESSOR_ATTRIBUTE("Network Parent Node", GetNetParentAttr, SetNetParentAttr, PODVector<unsigned char>, Variant::emptyBuffer, AM_NET | AM_NOEDIT);
+    UPDATE_ATTRIBUTE_NETWORK_ENCODING("Network Position", AttributeNetworkEncoding(0.001f));
+    UPDATE_ATTRIBUTE_NETWORK_ENCODING("Network Rotation", AttributeNetworkEncoding(0.0f, 0.0f, 15));
 }
 
 bool Node::Load(Deserializer& source, bool setInstanceDefault)
@@ -223,6 +226,12 @@ void Node::AddReplicationState(NodeReplicationState* state)
     networkState_->replicationStates_.Push(state);
 }
 
+void Node::RemoveReplicationState(NodeReplicationState* state)
+{
+    if (networkState_)
+        networkState_->replicationStates_.Remove(state);
+}
+
 bool Node::SaveXML(Serializer& dest, const String& indentation) const
 {
     SharedPtr<XMLFile> xml(new XMLFile(context_));
@@ -537,6 +546,8 @@ void Node::SetEnabledRecursive(bool enable)
 void Node::SetOwner(Connection* owner)
 {
     owner_ = owner;
+    if (scene_)
+        scene_->MarkNetworkHierarchyDirty();
 }
 
 void Node::MarkDirty()
@@ -602,6 +613,7 @@ void Node::AddChild(Node* node, unsigned index)
                 eventData[P_NODE] = node;
                 
                 scene_->SendEvent(E_NODEREMOVED, eventData);
+                scene_->MarkNetworkHierarchyDirty();
             }
             
             oldParent->children_.Remove(nodeShared);
@@ -1080,6 +1092,13 @@ void Node::ResetScene()
 
 void Node::SetNetPositionAttr(const Vector3& value)
 {
+    InterpolatedTransform* interpolated = GetComponent<InterpolatedTransform>();
+    if (interpolated)
+    {
+        interpolated->AddPosition(value);
+        return;
+    }
+
     SmoothedTransform* transform = GetComponent<SmoothedTransform>();
     if (transform)
         transform->SetTargetPosition(value);
@@ -1087,14 +1106,20 @@ void Node::SetNetPositionAttr(const Vector3& value)
         SetPosition(value);
 }
 
-void Node::SetNetRotationAttr(const PODVector<unsigned char>& value)
+void Node::SetNetRotationAttr(const Quaternion& value)
 {
-    MemoryBuffer buf(value);
+    InterpolatedTransform* interpolated = GetComponent<InterpolatedTransform>();
+    if (interpolated)
+    {
+        interpolated->AddRotation(value);
+        return;
+    }
+
     SmoothedTransform* transform = GetComponent<SmoothedTransform>();
     if (transform)
-        transform->SetTargetRotation(buf.ReadPackedQuaternion());
+        transform->SetTargetRotation(value);
     else
-        SetRotation(buf.ReadPackedQuaternion());
+        SetRotation(value);
 }
 
 void Node::SetNetParentAttr(const PODVector<unsigned char>& value)
@@ -1139,11 +1164,9 @@ const Vector3& Node::GetNetPositionAttr() const
     return position_;
 }
 
-const PODVector<unsigned char>& Node::GetNetRotationAttr() const
+const Quaternion& Node::GetNetRotationAttr() const
 {
-    attrBuffer_.Clear();
-    attrBuffer_.WritePackedQuaternion(rotation_);
-    return attrBuffer_.GetBuffer();
+    return rotation_;
 }
 
 const PODVector<unsigned char>& Node::GetNetParentAttr() const
@@ -1264,6 +1287,13 @@ bool Node::LoadXML(const XMLElement& source, SceneResolver& resolver, bool readC
 
 
 void Node::PrepareNetworkUpdate()
+{
+    GatherNetworkUpdate();
+    CompareNetworkUpdate();
+    MarkNetworkUpdateDirty();
+}
+
+void Node::GatherNetworkUpdate()
 {
     // Update dependency nodes list first
     dependencyNodes_.Clear();
@@ -1286,24 +1316,15 @@ void Node::PrepareNetworkUpdate()
             component->GetDependencyNodes(dependencyNodes_);
     }
 
-    // Then check for node attribute changes
+    // Then read the node attributes. Accessors may not be thread-safe, so this is done before the comparison
     if (!networkState_)
         AllocateNetworkState();
 
+    InitNetworkValues();
+
     const Vector<AttributeInfo>* attributes = networkState_->attributes_;
     unsigned numAttributes = attributes->Size();
 
-    if (networkState_->currentValues_.Size() != numAttributes)
-    {
-        networkState_->currentValues_.Resize(numAttributes);
-        networkState_->previousValues_.Resize(numAttributes);
-
-        // Copy the default attribute values to the previous state as a starting point
-        for (unsigned i = 0; i < numAttributes; ++i)
-            networkState_->previousValues_[i] = attributes->At(i).defaultValue_;
-    }
-
-    // Check for attribute changes
     for (unsigned i = 0; i < numAttributes; ++i)
     {
         const AttributeInfo& attr = attributes->At(i);
@@ -1312,49 +1333,55 @@ void Node::PrepareNetworkUpdate()
             continue;
 
         OnGetAttribute(attr, networkState_->currentValues_[i]);
+    }
 
-        if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
-        {
-            networkState_->previousValues_[i] = networkState_->currentValues_[i];
+    // Compare the variable-size values here, as the comparison in the worker threads must not copy Variants
+    DetectVariableNetworkChanges();
+}
 
-            // Mark the attribute dirty in all replication states that are tracking this node
-            for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin(); j !=
-                networkState_->replicationStates_.End();
-                ++j)
-            {
-                NodeReplicationState* nodeState = static_cast<NodeReplicationState*>(*j);
-                nodeState->dirtyAttributes_.Set(i);
-
-                // Add node to the dirty set if not added yet
-                if (!nodeState->markedDirty_)
-                {
-                    nodeState->markedDirty_ = true;
-                    nodeState->sceneState_->dirtyNodes_.Insert(id_);
-                }
-            }
-        }
-    }
+void Node::CompareNetworkUpdate()
+{
+    DetectNetworkChanges();
+}
 
-    // Finally check for user var changes
+void Node::MarkNetworkUpdateDirty()
+{
+    // Check for user var changes. This copies Variants, so it is done in the main thread
+    networkState_->changedVars_.Clear();
     for (VariantMap::ConstIterator i = vars_.Begin(); i != vars_.End(); ++i)
     {
         VariantMap::ConstIterator j = networkState_->previousVars_.Find(i->first_);
         if (j == networkState_->previousVars_.End() || j->second_ != i->second_)
         {
             networkState_->previousVars_[i->first_] = i->second_;
+            networkState_->changedVars_.Push(i->first_);
+        }
+    }
+
+    unsigned numAttributes = networkState_->attributes_->Size();
+    const DirtyBits& changedAttributes = networkState_->changedAttributes_;
+    const PODVector<StringHash>& changedVars = networkState_->changedVars_;
 
-            // Mark the var dirty in all replication states that are tracking this node
-            for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin(); j !=
-                networkState_->replicationStates_.End(); ++j)
+    if (changedAttributes.Count() || changedVars.Size())
+    {
+        // Mark the attributes and vars dirty in all replication states that are tracking this node
+        for (PODVector<ReplicationState*>::Iterator i = networkState_->replicationStates_.Begin(); i !=
+            networkState_->replicationStates_.End(); ++i)
+        {
+            NodeReplicationState* nodeState = static_cast<NodeReplicationState*>(*i);
+            for (unsigned j = 0; j < numAttributes; ++j)
             {
-                NodeReplicationState* nodeState = static_cast<NodeReplicationState*>(*j);
-                nodeState->dirtyVars_.Insert(i->first_);
-
-                if (!nodeState->markedDirty_)
-                {
-                    nodeState->markedDirty_ = true;
-                    nodeState->sceneState_->dirtyNodes_.Insert(id_);
-                }
+                if (changedAttributes.IsSet(j))
+                    nodeState->dirtyAttributes_.Set(j);
+            }
+            for (PODVector<StringHash>::ConstIterator j = changedVars.Begin(); j != changedVars.End(); ++j)
+                nodeState->dirtyVars_.Insert(*j);
+
+            // Add node to the dirty set if not added yet
+            if (!nodeState->markedDirty_)
+            {
+                nodeState->markedDirty_ = true;
+                nodeState->sceneState_->dirtyNodes_.Insert(id_);
             }
         }
     }
@@ -56,6 +56,7 @@ class URHO3D_API Node : public Animatable
 {
     OBJECT(Node);
     BASEOBJECT(Node);
+    POOL_ALLOCATED();
 
     friend class Connection;
 
@@ -83,6 +84,8 @@ public:
     virtual void MarkNetworkUpdate();
     /// Add a replication state that is tracking this node.
     virtual void AddReplicationState(NodeReplicationState* state);
+    /// Remove a replication state that no longer tracks this node.
+    void RemoveReplicationState(NodeReplicationState* state);
 
     /// Save to an XML file. Return true if successful.
     bool SaveXML(Serializer& dest, const String& indentation = "\t") const;
@@ -426,13 +429,13 @@ public:
     /// Set network position attribute.
     void SetNetPositionAttr(const Vector3& value);
     /// Set network rotation attribute.
-    void SetNetRotationAttr(const PODVector<unsigned char>& value);
+    void SetNetRotationAttr(const Quaternion& value);
     /// Set network parent attribute.
     void SetNetParentAttr(const PODVector<unsigned char>& value);
     /// Return network position attribute.
     const Vector3& GetNetPositionAttr() const;
     /// Return network rotation attribute.
-    const PODVector<unsigned char>& GetNetRotationAttr() const;
+    const Quaternion& GetNetRotationAttr() const;
     /// Return network parent attribute.
     const PODVector<unsigned char>& GetNetParentAttr() const;
     /// Load components and optionally load child nodes.
@@ -443,6 +446,12 @@ public:
     const PODVector<Node*>& GetDependencyNodes() const { return dependencyNodes_; }
     /// Prepare network update by comparing attributes and marking replication states dirty as necessary.
     void PrepareNetworkUpdate();
+    /// Update the dependency nodes, read the network attribute values and detect the changed variable-size attributes. Called by Scene in the main thread.
+    void GatherNetworkUpdate();
+    /// Detect the changed fixed-size attributes and encode the update. Called by Scene, possibly in a worker thread.
+    void CompareNetworkUpdate();
+    /// Detect the changed user variables and mark them and the changed attributes dirty in the replication states. Called by Scene in the main thread.
+    void MarkNetworkUpdateDirty();
     /// Clean up all references to a network connection that is about to be removed.
     void CleanupConnection(Connection* connection);
     /// Mark node dirty in scene replication states.
@@ -26,6 +26,7 @@
 #include "../Container/HashMap.h"
 #include "../Container/HashSet.h"
 #include "../Container/Ptr.h"
+#include "../IO/VectorBuffer.h"
 #include "../Math/StringHash.h"
 
 #include <cstring>
@@ -34,6 +35,7 @@ namespace Urho3D
 {
 
 static const unsigned MAX_NETWORK_ATTRIBUTES = 64;
+static const unsigned SNAPSHOT_HISTORY_SIZE = 16;
 
 class Component;
 class Connection;
@@ -112,6 +114,11 @@ struct URHO3D_API DirtyBits
             return false;
     }
     
+    /// Test for equality with another bit set.
+    bool operator ==(const DirtyBits& rhs) const { return count_ == rhs.count_ && !memcmp(data_, rhs.data_, MAX_NETWORK_ATTRIBUTES / 8); }
+    /// Test for inequality with another bit set.
+    bool operator !=(const DirtyBits& rhs) const { return !(*this == rhs); }
+
     /// Return number of set bits.
     unsigned Count() const { return count_; }
     
@@ -126,7 +133,8 @@ struct URHO3D_API NetworkState
 {
     /// Construct with defaults.
     NetworkState() :
-        interceptMask_(0)
+        interceptMask_(0),
+        latestDataValid_(false)
     {
     }
 
@@ -134,14 +142,80 @@ struct URHO3D_API NetworkState
     const Vector<AttributeInfo>* attributes_;
     /// Current network attribute values.
     Vector<Variant> currentValues_;
-    /// Previous network attribute values.
+    /// Previous network attribute values of variable-size types. Fixed-size values are kept packed instead.
     Vector<Variant> previousValues_;
+    /// Offsets of the fixed-size network attribute values in the packed buffers, or M_MAX_UNSIGNED if compared as variants.
+    PODVector<unsigned> packedOffsets_;
+    /// Current fixed-size network attribute values packed for comparison.
+    PODVector<unsigned char> currentPacked_;
+    /// Previous fixed-size network attribute values packed for comparison.
+    PODVector<unsigned char> previousPacked_;
+    /// Attributes found changed during the network update.
+    DirtyBits changedAttributes_;
     /// Replication states that are tracking this object.
     PODVector<ReplicationState*> replicationStates_;
     /// Previous user variables.
     VariantMap previousVars_;
+    /// User variables found changed during the network update.
+    PODVector<StringHash> changedVars_;
     /// Bitmask for intercepting network messages. Used on the client only.
     unsigned long long interceptMask_;
+    /// Attribute bits of the cached delta update.
+    DirtyBits deltaUpdateBits_;
+    /// Cached delta update without the timestamp, shared by all connections that have the same dirty bits.
+    VectorBuffer deltaUpdateData_;
+    /// Cached latest data update without the timestamp, shared by all connections.
+    VectorBuffer latestData_;
+    /// Whether the cached latest data update is valid.
+    bool latestDataValid_;
+};
+
+/// Latest data update of an object sent or received in a snapshot.
+struct LatestDataSnapshot
+{
+    /// Snapshot ID.
+    unsigned snapshotID_;
+    /// Latest data update including the timestamp.
+    PODVector<unsigned char> data_;
+};
+
+/// History of the latest data updates of an object in snapshots, for delta encoding against an older snapshot.
+struct URHO3D_API SnapshotHistory
+{
+    /// Construct.
+    SnapshotHistory() :
+        next_(0)
+    {
+    }
+
+    /// Add a latest data update. Replaces the oldest update if the history is full.
+    void Add(unsigned snapshotID, const unsigned char* data, unsigned size)
+    {
+        if (snapshots_.Size() < SNAPSHOT_HISTORY_SIZE)
+            snapshots_.Resize(snapshots_.Size() + 1);
+        LatestDataSnapshot& snapshot = snapshots_[next_];
+        snapshot.snapshotID_ = snapshotID;
+        snapshot.data_.Resize(size);
+        if (size)
+            memcpy(&snapshot.data_[0], data, size);
+        next_ = (next_ + 1) % SNAPSHOT_HISTORY_SIZE;
+    }
+
+    /// Return the latest data update of a snapshot, or null if not in the history.
+    const LatestDataSnapshot* Find(unsigned snapshotID) const
+    {
+        for (unsigned i = 0; i < snapshots_.Size(); ++i)
+        {
+            if (snapshots_[i].snapshotID_ == snapshotID)
+                return &snapshots_[i];
+        }
+        return 0;
+    }
+
+    /// Latest data updates, used as a ring buffer.
+    Vector<LatestDataSnapshot> snapshots_;
+    /// Index of the next update to replace.
+    unsigned next_;
 };
 
 /// Base class for per-user network replication states.
@@ -149,6 +223,8 @@ struct URHO3D_API ReplicationState
 {
     /// Parent network connection.
     Connection* connection_;
+    /// Latest data updates sent in snapshots. Used only when delta snapshots are enabled.
+    SnapshotHistory snapshotHistory_;
 };
 
 /// Per-user component network replication state.
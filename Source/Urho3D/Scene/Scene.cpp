@@ -24,6 +24,8 @@
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../IO/File.h"
+#include "../Scene/FlatScene.h"
+#include "../Scene/InterpolatedTransform.h"
 #include "../IO/Log.h"
 #include "../Scene/ObjectAnimation.h"
 #include "../IO/PackageFile.h"
@@ -51,6 +53,81 @@ const char* SUBSYSTEM_CATEGORY = "Subsystem";
 
 static const float DEFAULT_SMOOTHING_CONSTANT = 50.0f;
 static const float DEFAULT_SNAP_THRESHOLD = 5.0f;
+static const float DEFAULT_INTERPOLATION_DELAY = 0.1f;
+static const float DEFAULT_EXTRAPOLATION_LIMIT = 0.25f;
+static const float NETWORK_TIME_CORRECTION = 0.05f;
+static const float NETWORK_TIME_RESYNC_THRESHOLD = 1.0f;
+static const unsigned MIN_THREADED_NETWORK_UPDATE = 64;
+
+template <class T> static void CompareNetworkUpdateWork(const WorkItem* item, unsigned threadIndex)
+{
+    T** start = reinterpret_cast<T**>(item->start_);
+    T** end = reinterpret_cast<T**>(item->end_);
+
+    while (start != end)
+    {
+        (*start)->CompareNetworkUpdate();
+        ++start;
+    }
+}
+
+template <class T> static void QueueNetworkUpdateWork(WorkQueue* queue, PODVector<T*>& objects)
+{
+    if (objects.Empty())
+        return;
+
+    int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
+    int objectsPerItem = Max((int)(objects.Size() / numWorkItems), 1);
+
+    typename PODVector<T*>::Iterator start = objects.Begin();
+    // Create a work item for each thread, or less if there are only a few objects
+    for (int i = 0; i < numWorkItems && start != objects.End(); ++i)
+    {
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = CompareNetworkUpdateWork<T>;
+
+        typename PODVector<T*>::Iterator end = objects.End();
+        if (i < numWorkItems - 1 && end - start > objectsPerItem)
+            end = start + objectsPerItem;
+
+        item->start_ = &(*start);
+        item->end_ = &(*end);
+        queue->AddWorkItem(item);
+
+        start = end;
+    }
+}
+
+static void WriteFlatNode(FlatSceneWriter& writer, const Node* node, unsigned parentIndex)
+{
+    unsigned nodeIndex = writer.AddNode(node->GetType(), node->GetID(), parentIndex);
+    writer.AddAttributes(node);
+
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        Component* component = components[i];
+        if (component->IsTemporary())
+            continue;
+        // The attribute types of an unregistered component are not known, so its data can not be split into values
+        if (node->GetContext()->GetTypeName(component->GetType()).Empty())
+        {
+            LOGWARNING("Can not save data of unknown component type " + component->GetTypeName() + " in a flat scene");
+            continue;
+        }
+    
+        writer.AddComponent(component->GetType(), component->GetID());
+        writer.AddAttributes(component);
+    }
+
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        if (!children[i]->IsTemporary())
+            WriteFlatNode(writer, children[i], nodeIndex);
+    }
+}
 
 Scene::Scene(Context* context) :
     Node(context),
@@ -59,11 +136,19 @@ Scene::Scene(Context* context) :
     localNodeID_(FIRST_LOCAL_ID),
     localComponentID_(FIRST_LOCAL_ID),
     checksum_(0),
+    networkHierarchyVersion_(0),
     asyncLoadingMs_(5),
     timeScale_(1.0f),
     elapsedTime_(0),
     smoothingConstant_(DEFAULT_SMOOTHING_CONSTANT),
     snapThreshold_(DEFAULT_SNAP_THRESHOLD),
+    interpolationDelay_(DEFAULT_INTERPOLATION_DELAY),
+    extrapolationLimit_(DEFAULT_EXTRAPOLATION_LIMIT),
+    serverTime_(0.0f),
+    newestServerTime_(0.0f),
+    networkTime_(0.0f),
+    interpolation_(false),
+    networkTimeValid_(false),
     updateEnabled_(true),
     asyncLoading_(false),
     threadedUpdate_(false)
@@ -98,6 +183,9 @@ void Scene::RegisterObject(Context* context)
     ACCESSOR_ATTRIBUTE("Time Scale", GetTimeScale, SetTimeScale, float, 1.0f, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Smoothing Constant", GetSmoothingConstant, SetSmoothingConstant, float, DEFAULT_SMOOTHING_CONSTANT, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Snap Threshold", GetSnapThreshold, SetSnapThreshold, float, DEFAULT_SNAP_THRESHOLD, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Interpolation", GetInterpolation, SetInterpolation, bool, false, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Interpolation Delay", GetInterpolationDelay, SetInterpolationDelay, float, DEFAULT_INTERPOLATION_DELAY, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Extrapolation Limit", GetExtrapolationLimit, SetExtrapolationLimit, float, DEFAULT_EXTRAPOLATION_LIMIT, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Elapsed Time", GetElapsedTime, SetElapsedTime, float, 0.0f, AM_FILE);
     ATTRIBUTE("Next Replicated Node ID", int, replicatedNodeID_, FIRST_REPLICATED_ID, AM_FILE | AM_NOEDIT);
     ATTRIBUTE("Next Replicated Component ID", int, replicatedComponentID_, FIRST_REPLICATED_ID, AM_FILE | AM_NOEDIT);
@@ -110,11 +198,13 @@ void Scene::RegisterObject(Context* context)
 bool Scene::Load(Deserializer& source, bool setInstanceDefault)
 {
     PROFILE(LoadScene);
+    MEMORY_TAG(MT_SCENE);
 
     StopAsyncLoading();
 
     // Check ID
-    if (source.ReadFileID() != "USCN")
+    String fileID = source.ReadFileID();
+    if (fileID != "USCN" && fileID != "USCF")
     {
         LOGERROR(source.GetName() + " is not a valid scene file");
         return false;
@@ -124,6 +214,28 @@ bool Scene::Load(Deserializer& source, bool setInstanceDefault)
 
     Clear();
 
+    // The flat format is read in place without per-object stream reads, directly from a memory-mapped package file
+    // if possible
+    if (fileID == "USCF")
+    {
+        unsigned dataSize = source.GetSize() - source.GetPosition();
+        const unsigned char* inPlaceData = source.GetInPlaceData();
+        if (inPlaceData)
+        {
+            if (!LoadFlatScene(this, inPlaceData + source.GetPosition(), dataSize))
+                return false;
+        }
+        else
+        {
+            SharedArrayPtr<unsigned char> data(new unsigned char[dataSize]);
+            if (source.Read(data.Get(), dataSize) != dataSize || !LoadFlatScene(this, data.Get(), dataSize))
+                return false;
+        }
+
+        FinishLoading(&source);
+        return true;
+    }
+
     // Load the whole scene, then perform post-load if successfully loaded
     if (Node::Load(source, setInstanceDefault))
     {
@@ -161,6 +273,7 @@ bool Scene::Save(Serializer& dest) const
 bool Scene::LoadXML(const XMLElement& source, bool setInstanceDefault)
 {
     PROFILE(LoadSceneXML);
+    MEMORY_TAG(MT_SCENE);
 
     StopAsyncLoading();
 
@@ -193,6 +306,23 @@ void Scene::AddReplicationState(NodeReplicationState* state)
         state->sceneState_->dirtyNodes_.Insert(i->first_);
 }
 
+bool Scene::SaveFlat(Serializer& dest) const
+{
+    PROFILE(SaveFlatScene);
+
+    Deserializer* ptr = dynamic_cast<Deserializer*>(&dest);
+    if (ptr)
+        LOGINFO("Saving flat scene to " + ptr->GetName());
+
+    FlatSceneWriter writer(context_);
+    WriteFlatNode(writer, this, M_MAX_UNSIGNED);
+    if (!writer.Save(dest))
+        return false;
+
+    FinishSaving(&dest);
+    return true;
+}
+
 bool Scene::LoadXML(Deserializer& source)
 {
     PROFILE(LoadSceneXML);
@@ -249,7 +379,13 @@ bool Scene::LoadAsync(File* file, LoadMode mode)
     StopAsyncLoading();
 
     // Check ID
-    bool isSceneFile = file->ReadFileID() == "USCN";
+    String fileID = file->ReadFileID();
+    if (fileID == "USCF")
+    {
+        LOGERROR(file->GetName() + " is a flat scene file, which can not be loaded asynchronously. Use Load() instead");
+        return false;
+    }
+    bool isSceneFile = fileID == "USCN";
     if (!isSceneFile)
     {
         // In resource load mode can load also object prefabs, which have no identifier
@@ -393,6 +529,7 @@ void Scene::StopAsyncLoading()
 Node* Scene::Instantiate(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode)
 {
     PROFILE(Instantiate);
+    MEMORY_TAG(MT_SCENE);
 
     SceneResolver resolver;
     unsigned nodeID = source.ReadInt();
@@ -416,6 +553,7 @@ Node* Scene::Instantiate(Deserializer& source, const Vector3& position, const Qu
 Node* Scene::InstantiateXML(const XMLElement& source, const Vector3& position, const Quaternion& rotation, CreateMode mode)
 {
     PROFILE(InstantiateXML);
+    MEMORY_TAG(MT_SCENE);
 
     SceneResolver resolver;
     unsigned nodeID = source.GetInt("id");
@@ -497,6 +635,45 @@ void Scene::SetSnapThreshold(float threshold)
     Node::MarkNetworkUpdate();
 }
 
+void Scene::SetInterpolation(bool enable)
+{
+    interpolation_ = enable;
+    Node::MarkNetworkUpdate();
+}
+
+void Scene::SetInterpolationDelay(float delay)
+{
+    interpolationDelay_ = Max(delay, 0.0f);
+    Node::MarkNetworkUpdate();
+}
+
+void Scene::SetExtrapolationLimit(float limit)
+{
+    extrapolationLimit_ = Max(limit, 0.0f);
+    Node::MarkNetworkUpdate();
+}
+
+void Scene::SetServerTime(float time, float latency)
+{
+    serverTime_ = time;
+
+    // Synchronize the network clock to the server time advanced by the latency. Correct gradually to not pass the arrival
+    // jitter on to the interpolation, unless the clocks are far apart, for example after connecting. Updates of the same
+    // or an older server update arriving later do not correct the clock again
+    float estimate = time + latency;
+    if (!networkTimeValid_ || Abs(estimate - networkTime_) > NETWORK_TIME_RESYNC_THRESHOLD)
+    {
+        networkTime_ = estimate;
+        newestServerTime_ = time;
+        networkTimeValid_ = true;
+    }
+    else if (time > newestServerTime_)
+    {
+        networkTime_ += (estimate - networkTime_) * NETWORK_TIME_CORRECTION;
+        newestServerTime_ = time;
+    }
+}
+
 void Scene::SetAsyncLoadingMs(int ms)
 {
     asyncLoadingMs_ = Max(ms, 1);
@@ -595,6 +772,7 @@ const String& Scene::GetVarName(StringHash hash) const
 
 void Scene::Update(float timeStep)
 {
+    MEMORY_TAG(MT_SCENE);
     if (asyncLoading_)
     {
         UpdateAsyncLoading();
@@ -605,6 +783,8 @@ void Scene::Update(float timeStep)
 
     PROFILE(UpdateScene);
 
+    // The network clock advances in real time regardless of the time scale
+    networkTime_ += timeStep;
     timeStep *= timeScale_;
 
     using namespace SceneUpdate;
@@ -777,6 +957,7 @@ void Scene::NodeAdded(Node* node)
 
         MarkNetworkUpdate(node);
         MarkReplicationDirty(node);
+        MarkNetworkHierarchyDirty();
     }
     else
     {
@@ -801,6 +982,7 @@ void Scene::NodeRemoved(Node* node)
     {
         replicatedNodes_.Erase(id);
         MarkReplicationDirty(node);
+        MarkNetworkHierarchyDirty();
     }
     else
         localNodes_.Erase(id);
@@ -886,22 +1068,60 @@ String Scene::GetVarNamesAttr() const
 
 void Scene::PrepareNetworkUpdate()
 {
+    // Resolve the IDs once into contiguous arrays for the update phases below
+    preparedNetworkNodes_.Clear();
+    preparedNetworkComponents_.Clear();
+
     for (HashSet<unsigned>::Iterator i = networkUpdateNodes_.Begin(); i != networkUpdateNodes_.End(); ++i)
     {
         Node* node = GetNode(*i);
         if (node)
-            node->PrepareNetworkUpdate();
+            preparedNetworkNodes_.Push(node);
     }
 
     for (HashSet<unsigned>::Iterator i = networkUpdateComponents_.Begin(); i != networkUpdateComponents_.End(); ++i)
     {
         Component* component = GetComponent(*i);
         if (component)
-            component->PrepareNetworkUpdate();
+            preparedNetworkComponents_.Push(component);
     }
 
     networkUpdateNodes_.Clear();
     networkUpdateComponents_.Clear();
+
+    // Read the attribute values and compare the variable-size ones in the main thread, as accessors (for example script
+    // properties) may not be thread-safe and copying Variants is not thread-safe either
+    for (PODVector<Node*>::Iterator i = preparedNetworkNodes_.Begin(); i != preparedNetworkNodes_.End(); ++i)
+        (*i)->GatherNetworkUpdate();
+    for (PODVector<Component*>::Iterator i = preparedNetworkComponents_.Begin(); i != preparedNetworkComponents_.End(); ++i)
+        (*i)->GatherNetworkUpdate();
+
+    // Compare the packed fixed-size values and encode the updates. Each object only touches its own network state, so
+    // this can be split to the worker threads when there is enough work
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue && queue->GetNumThreads() && preparedNetworkNodes_.Size() + preparedNetworkComponents_.Size() >=
+        MIN_THREADED_NETWORK_UPDATE)
+    {
+        BeginThreadedUpdate();
+        QueueNetworkUpdateWork(queue, preparedNetworkNodes_);
+        QueueNetworkUpdateWork(queue, preparedNetworkComponents_);
+        queue->Complete(M_MAX_UNSIGNED);
+        EndThreadedUpdate();
+    }
+    else
+    {
+        for (PODVector<Node*>::Iterator i = preparedNetworkNodes_.Begin(); i != preparedNetworkNodes_.End(); ++i)
+            (*i)->CompareNetworkUpdate();
+        for (PODVector<Component*>::Iterator i = preparedNetworkComponents_.Begin(); i != preparedNetworkComponents_.End(); ++i)
+            (*i)->CompareNetworkUpdate();
+    }
+
+    // Finally compare the node vars and mark the changes dirty in the replication states, which are shared between
+    // objects, in the main thread
+    for (PODVector<Node*>::Iterator i = preparedNetworkNodes_.Begin(); i != preparedNetworkNodes_.End(); ++i)
+        (*i)->MarkNetworkUpdateDirty();
+    for (PODVector<Component*>::Iterator i = preparedNetworkComponents_.Begin(); i != preparedNetworkComponents_.End(); ++i)
+        (*i)->MarkNetworkUpdateDirty();
 }
 
 void Scene::CleanupConnection(Connection* connection)
@@ -1230,6 +1450,7 @@ void RegisterSceneLibrary(Context* context)
     Node::RegisterObject(context);
     Scene::RegisterObject(context);
     SmoothedTransform::RegisterObject(context);
+    InterpolatedTransform::RegisterObject(context);
     UnknownComponent::RegisterObject(context);
     SplinePath::RegisterObject(context);
 }
@@ -104,7 +104,9 @@ public:
     bool LoadXML(Deserializer& source);
     /// Save to an XML file. Return true if successful.
     bool SaveXML(Serializer& dest, const String& indentation = "\t") const;
-    /// Load from a binary file asynchronously. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files.
+    /// Save to a flat binary file, which loads faster than the regular binary format and is loaded with Load(). Return true if successful.
+    bool SaveFlat(Serializer& dest) const;
+    /// Load from a binary file asynchronously. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files. Flat scene files are not supported.
     bool LoadAsync(File* file, LoadMode mode = LOAD_SCENE_AND_RESOURCES);
     /// Load from an XML file asynchronously. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files.
     bool LoadAsyncXML(File* file, LoadMode mode = LOAD_SCENE_AND_RESOURCES);
@@ -128,6 +130,14 @@ public:
     void SetSmoothingConstant(float constant);
     /// Set network client motion smoothing snap threshold.
     void SetSnapThreshold(float threshold);
+    /// Set whether network clients interpolate the transforms of new replicated nodes with a jitter buffer instead of smoothing.
+    void SetInterpolation(bool enable);
+    /// Set network client interpolation delay in seconds behind the estimated server time.
+    void SetInterpolationDelay(float delay);
+    /// Set network client maximum time in seconds to extrapolate past the newest received transform.
+    void SetExtrapolationLimit(float limit);
+    /// Set server time of the scene update being received and synchronize the network clock to it if it is the newest. Called by Connection on the client.
+    void SetServerTime(float time, float latency);
     /// Set maximum milliseconds per frame to spend on async scene loading.
     void SetAsyncLoadingMs(int ms);
     /// Add a required package file for networking. To be called on the server.
@@ -165,6 +175,18 @@ public:
     float GetSmoothingConstant() const { return smoothingConstant_; }
     /// Return motion smoothing snap threshold.
     float GetSnapThreshold() const { return snapThreshold_; }
+    /// Return whether network clients interpolate the transforms of new replicated nodes.
+    bool GetInterpolation() const { return interpolation_; }
+    /// Return interpolation delay.
+    float GetInterpolationDelay() const { return interpolationDelay_; }
+    /// Return extrapolation limit.
+    float GetExtrapolationLimit() const { return extrapolationLimit_; }
+    /// Return server time of the latest received scene update.
+    float GetServerTime() const { return serverTime_; }
+    /// Return estimated current server time on the network client.
+    float GetNetworkTime() const { return networkTime_; }
+    /// Return interpolation playback time: the estimated server time minus the interpolation delay.
+    float GetInterpolationTime() const { return networkTime_ - interpolationDelay_; }
     /// Return maximum milliseconds per frame to spend on async loading.
     int GetAsyncLoadingMs() const { return asyncLoadingMs_; }
     /// Return required package files.
@@ -200,6 +222,12 @@ public:
     String GetVarNamesAttr() const;
     /// Prepare network update by comparing attributes and marking replication states dirty as necessary.
     void PrepareNetworkUpdate();
+    /// Return the nodes that were checked for attribute changes on the last network update.
+    const PODVector<Node*>& GetNetworkUpdateNodes() const { return preparedNetworkNodes_; }
+    /// Note a change in the replicated node hierarchy, node ownership or relevance distances. Called when replicated nodes are added, removed or reparented.
+    void MarkNetworkHierarchyDirty() { ++networkHierarchyVersion_; }
+    /// Return the version number of the replicated node hierarchy, which changes on each MarkNetworkHierarchyDirty(). Used by interest management to rebuild only when needed.
+    unsigned GetNetworkHierarchyVersion() const { return networkHierarchyVersion_; }
     /// Clean up all references to a network connection that is about to be removed.
     void CleanupConnection(Connection* connection);
     /// Mark a node for attribute check on the next network update.
@@ -249,6 +277,10 @@ private:
     HashSet<unsigned> networkUpdateNodes_;
     /// Components to check for attribute changes on the next network update.
     HashSet<unsigned> networkUpdateComponents_;
+    /// Nodes resolved for the network update in progress. Kept to avoid reallocation.
+    PODVector<Node*> preparedNetworkNodes_;
+    /// Components resolved for the network update in progress. Kept to avoid reallocation.
+    PODVector<Component*> preparedNetworkComponents_;
     /// Delayed dirty notification queue for components.
     PODVector<Component*> delayedDirtyComponents_;
     /// Mutex for the delayed dirty notification queue.
@@ -265,6 +297,8 @@ private:
     unsigned localComponentID_;
     /// Scene source file checksum.
     mutable unsigned checksum_;
+    /// Replicated node hierarchy version.
+    unsigned networkHierarchyVersion_;
     /// Maximum milliseconds per frame to spend on async scene loading.
     int asyncLoadingMs_;
     /// Scene update time scale.
@@ -275,6 +309,20 @@ private:
     float smoothingConstant_;
     /// Motion smoothing snap threshold.
     float snapThreshold_;
+    /// Interpolation delay.
+    float interpolationDelay_;
+    /// Extrapolation limit.
+    float extrapolationLimit_;
+    /// Server time of the latest received scene update.
+    float serverTime_;
+    /// Server time of the newest received scene update.
+    float newestServerTime_;
+    /// Estimated current server time.
+    float networkTime_;
+    /// Interpolation enabled flag.
+    bool interpolation_;
+    /// Network time synchronized flag.
+    bool networkTimeValid_;
     /// Update enabled flag.
     bool updateEnabled_;
     /// Asynchronous loading flag.
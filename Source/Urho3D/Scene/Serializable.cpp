@@ -21,8 +21,10 @@
 //
 
 #include "../Core/Context.h"
+#include "../IO/BitStream.h"
 #include "../IO/Deserializer.h"
 #include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
 #include "../Scene/ReplicationState.h"
 #include "../Scene/SceneEvents.h"
 #include "../Scene/Serializable.h"
@@ -34,6 +36,108 @@
 namespace Urho3D
 {
 
+static bool IsQuantized(const AttributeInfo& attr)
+{
+    const AttributeNetworkEncoding& encoding = attr.netEncoding_;
+
+    switch (attr.type_)
+    {
+    case VAR_FLOAT:
+    case VAR_VECTOR2:
+    case VAR_VECTOR3:
+    case VAR_VECTOR4:
+        return encoding.precision_ > 0.0f || (encoding.bits_ && encoding.maxValue_ > encoding.minValue_);
+
+    case VAR_QUATERNION:
+        return encoding.bits_ > 0;
+
+    default:
+        return false;
+    }
+}
+
+static void WriteQuantizedComponent(BitWriter& writer, float value, const AttributeNetworkEncoding& encoding)
+{
+    if (encoding.precision_ > 0.0f)
+        writer.WritePrecisionFloat(value, encoding.precision_);
+    else
+        writer.WriteQuantizedFloat(value, encoding.minValue_, encoding.maxValue_, encoding.bits_);
+}
+
+static float ReadQuantizedComponent(BitReader& reader, const AttributeNetworkEncoding& encoding)
+{
+    if (encoding.precision_ > 0.0f)
+        return reader.ReadPrecisionFloat(encoding.precision_);
+    else
+        return reader.ReadQuantizedFloat(encoding.minValue_, encoding.maxValue_, encoding.bits_);
+}
+
+static void WriteQuantizedValue(BitWriter& writer, const AttributeInfo& attr, const Variant& value)
+{
+    const AttributeNetworkEncoding& encoding = attr.netEncoding_;
+    const float* data;
+    unsigned numComponents;
+
+    switch (attr.type_)
+    {
+    case VAR_QUATERNION:
+        writer.WriteQuantizedQuaternion(value.GetQuaternion(), encoding.bits_);
+        return;
+
+    case VAR_VECTOR2:
+        data = value.GetVector2().Data();
+        numComponents = 2;
+        break;
+
+    case VAR_VECTOR3:
+        data = value.GetVector3().Data();
+        numComponents = 3;
+        break;
+
+    case VAR_VECTOR4:
+        data = value.GetVector4().Data();
+        numComponents = 4;
+        break;
+
+    default:
+        WriteQuantizedComponent(writer, value.GetFloat(), encoding);
+        return;
+    }
+
+    for (unsigned i = 0; i < numComponents; ++i)
+        WriteQuantizedComponent(writer, data[i], encoding);
+}
+
+static Variant ReadQuantizedValue(BitReader& reader, const AttributeInfo& attr)
+{
+    const AttributeNetworkEncoding& encoding = attr.netEncoding_;
+    float data[4];
+
+    switch (attr.type_)
+    {
+    case VAR_QUATERNION:
+        return reader.ReadQuantizedQuaternion(encoding.bits_);
+
+    case VAR_VECTOR2:
+        for (unsigned i = 0; i < 2; ++i)
+            data[i] = ReadQuantizedComponent(reader, encoding);
+        return Vector2(data);
+
+    case VAR_VECTOR3:
+        for (unsigned i = 0; i < 3; ++i)
+            data[i] = ReadQuantizedComponent(reader, encoding);
+        return Vector3(data);
+
+    case VAR_VECTOR4:
+        for (unsigned i = 0; i < 4; ++i)
+            data[i] = ReadQuantizedComponent(reader, encoding);
+        return Vector4(data);
+
+    default:
+        return ReadQuantizedComponent(reader, encoding);
+    }
+}
+
 static unsigned RemapAttributeIndex(const Vector<AttributeInfo>* attributes, const AttributeInfo& netAttr, unsigned netAttrIndex)
 {
     if (!attributes)
@@ -52,6 +156,172 @@ static unsigned RemapAttributeIndex(const Vector<AttributeInfo>* attributes, con
     return netAttrIndex; // Could not remap
 }
 
+static unsigned GetPackedSize(VariantType type)
+{
+    switch (type)
+    {
+    case VAR_INT:
+        return sizeof(int);
+
+    case VAR_BOOL:
+        return sizeof(unsigned char);
+
+    case VAR_FLOAT:
+        return sizeof(float);
+
+    case VAR_VECTOR2:
+        return sizeof(Vector2);
+
+    case VAR_VECTOR3:
+        return sizeof(Vector3);
+
+    case VAR_VECTOR4:
+        return sizeof(Vector4);
+
+    case VAR_QUATERNION:
+        return sizeof(Quaternion);
+
+    case VAR_COLOR:
+        return sizeof(Color);
+
+    case VAR_INTRECT:
+        return sizeof(IntRect);
+
+    case VAR_INTVECTOR2:
+        return sizeof(IntVector2);
+
+    default:
+        // Variable-size types are compared as variants
+        return 0;
+    }
+}
+
+static void PackValue(unsigned char* dest, VariantType type, const Variant& value)
+{
+    // Use the attribute's type, so that a value of wrong type packs as zero instead of overrunning its slot
+    switch (type)
+    {
+    case VAR_INT:
+        {
+            int intValue = value.GetInt();
+            memcpy(dest, &intValue, sizeof intValue);
+        }
+        break;
+
+    case VAR_BOOL:
+        *dest = value.GetBool() ? 1 : 0;
+        break;
+
+    case VAR_FLOAT:
+        {
+            float floatValue = value.GetFloat();
+            memcpy(dest, &floatValue, sizeof floatValue);
+        }
+        break;
+
+    case VAR_VECTOR2:
+        memcpy(dest, &value.GetVector2(), sizeof(Vector2));
+        break;
+
+    case VAR_VECTOR3:
+        memcpy(dest, &value.GetVector3(), sizeof(Vector3));
+        break;
+
+    case VAR_VECTOR4:
+        memcpy(dest, &value.GetVector4(), sizeof(Vector4));
+        break;
+
+    case VAR_QUATERNION:
+        memcpy(dest, &value.GetQuaternion(), sizeof(Quaternion));
+        break;
+
+    case VAR_COLOR:
+        memcpy(dest, &value.GetColor(), sizeof(Color));
+        break;
+
+    case VAR_INTRECT:
+        memcpy(dest, &value.GetIntRect(), sizeof(IntRect));
+        break;
+
+    case VAR_INTVECTOR2:
+        memcpy(dest, &value.GetIntVector2(), sizeof(IntVector2));
+        break;
+
+    default:
+        break;
+    }
+}
+
+static unsigned GetNetworkPackedSize(const AttributeInfo& attr)
+{
+    // A quantized float component is encoded in at most 37 bits, so four extra bytes always fit the encoding
+    unsigned size = GetPackedSize(attr.type_);
+    return size && IsQuantized(attr) ? size + sizeof(unsigned) : size;
+}
+
+static void PackNetworkValue(unsigned char* dest, const AttributeInfo& attr, const Variant& value)
+{
+    if (!IsQuantized(attr))
+    {
+        PackValue(dest, attr.type_, value);
+        return;
+    }
+
+    // Pack the quantized encoding, so that changes too small to survive quantization are not detected as changes
+    unsigned size = GetNetworkPackedSize(attr);
+    memset(dest, 0, size);
+    MemoryBuffer buffer(dest, size);
+    BitWriter writer(buffer);
+    WriteQuantizedValue(writer, attr, value);
+    writer.Flush();
+}
+
+/// Buffer for decoding received network attribute values, to not construct and destruct them for each message. Network updates are read in the main thread.
+static Variant receivedValueBuffer[MAX_NETWORK_ATTRIBUTES];
+/// Whether the received values buffer is in use.
+static bool receivedValueBufferInUse = false;
+
+/// Scoped access to the received values buffer. Uses a temporary buffer instead if an update is read while applying another.
+class ReceivedValues
+{
+public:
+    /// Construct. Acquire the shared buffer if free.
+    ReceivedValues(const DirtyBits& attributeBits) :
+        attributeBits_(attributeBits),
+        shared_(!receivedValueBufferInUse)
+    {
+        if (shared_)
+            receivedValueBufferInUse = true;
+        else
+            nestedValues_.Resize(MAX_NETWORK_ATTRIBUTES);
+    }
+
+    /// Destruct. Release the decoded values and the shared buffer.
+    ~ReceivedValues()
+    {
+        if (shared_)
+        {
+            for (unsigned i = 0; i < MAX_NETWORK_ATTRIBUTES; ++i)
+            {
+                if (attributeBits_.IsSet(i))
+                    receivedValueBuffer[i].Clear();
+            }
+            receivedValueBufferInUse = false;
+        }
+    }
+
+    /// Return the values.
+    Variant* Get() { return shared_ ? receivedValueBuffer : &nestedValues_[0]; }
+
+private:
+    /// Attributes that may have been decoded.
+    const DirtyBits& attributeBits_;
+    /// Temporary buffer for a nested read.
+    Vector<Variant> nestedValues_;
+    /// Shared buffer in use flag.
+    bool shared_;
+};
+
 Serializable::Serializable(Context* context) :
     Object(context),
     networkState_(0),
@@ -595,12 +865,7 @@ void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeS
     // First write the change bitfield, then attribute data for non-default attributes
     dest.WriteUByte(timeStamp);
     dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
-
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
-    }
+    WriteNetworkValues(dest, attributeBits);
 }
 
 void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp)
@@ -617,16 +882,19 @@ void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attribute
 
     unsigned numAttributes = attributes->Size();
 
+    // Reuse the update encoded during PrepareNetworkUpdate() if the dirty bits match
+    if (attributeBits.Count() && attributeBits == networkState_->deltaUpdateBits_)
+    {
+        dest.WriteUByte(timeStamp);
+        dest.Write(networkState_->deltaUpdateData_.GetData(), networkState_->deltaUpdateData_.GetSize());
+        return;
+    }
+
     // First write the change bitfield, then attribute data for changed attributes
     // Note: the attribute bits should not contain LATESTDATA attributes
     dest.WriteUByte(timeStamp);
     dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
-
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
-    }
+    WriteNetworkValues(dest, attributeBits);
 }
 
 void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp)
@@ -645,10 +913,153 @@ void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeSta
 
     dest.WriteUByte(timeStamp);
 
+    if (networkState_->latestDataValid_)
+    {
+        dest.Write(networkState_->latestData_.GetData(), networkState_->latestData_.GetSize());
+        return;
+    }
+
+    DirtyBits latestDataBits;
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        if (attributes->At(i).mode_ & AM_LATESTDATA)
+            latestDataBits.Set(i);
+    }
+    WriteNetworkValues(dest, latestDataBits);
+}
+
+void Serializable::InitNetworkValues()
+{
+    const Vector<AttributeInfo>* attributes = networkState_->attributes_;
+    unsigned numAttributes = attributes->Size();
+    if (networkState_->currentValues_.Size() == numAttributes)
+        return;
+
+    networkState_->currentValues_.Resize(numAttributes);
+    networkState_->previousValues_.Resize(numAttributes);
+    networkState_->packedOffsets_.Resize(numAttributes);
+
+    // Copy the default attribute values to the current and previous state as a starting point, and assign the
+    // fixed-size values their slots in the packed buffers
+    unsigned packedSize = 0;
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        unsigned size = GetNetworkPackedSize(attr);
+        networkState_->currentValues_[i] = attr.defaultValue_;
+        networkState_->previousValues_[i] = attr.defaultValue_;
+        networkState_->packedOffsets_[i] = size ? packedSize : M_MAX_UNSIGNED;
+        packedSize += size;
+    }
+
+    networkState_->currentPacked_.Resize(packedSize);
+    networkState_->previousPacked_.Resize(packedSize);
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        unsigned offset = networkState_->packedOffsets_[i];
+        if (offset != M_MAX_UNSIGNED)
+            PackNetworkValue(&networkState_->previousPacked_[offset], attributes->At(i), attributes->At(i).defaultValue_);
+    }
+}
+
+void Serializable::DetectVariableNetworkChanges()
+{
+    unsigned numAttributes = networkState_->attributes_->Size();
+    const PODVector<unsigned>& offsets = networkState_->packedOffsets_;
+    DirtyBits& changedAttributes = networkState_->changedAttributes_;
+    changedAttributes.ClearAll();
+
+    // Variant payloads may be shared with a non-atomic reference count, so they are only copied in the main thread
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        if (offsets[i] == M_MAX_UNSIGNED && networkState_->currentValues_[i] != networkState_->previousValues_[i])
+        {
+            networkState_->previousValues_[i] = networkState_->currentValues_[i];
+            changedAttributes.Set(i);
+        }
+    }
+}
+
+void Serializable::DetectNetworkChanges()
+{
+    const Vector<AttributeInfo>* attributes = networkState_->attributes_;
+    unsigned numAttributes = attributes->Size();
+    const PODVector<unsigned>& offsets = networkState_->packedOffsets_;
+    unsigned packedSize = networkState_->currentPacked_.Size();
+    unsigned char* current = packedSize ? &networkState_->currentPacked_[0] : 0;
+    unsigned char* previous = packedSize ? &networkState_->previousPacked_[0] : 0;
+    DirtyBits& changedAttributes = networkState_->changedAttributes_;
+
+    // Pack the fixed-size values and compare them all at once; look for the individual changes only if they differ
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        if (offsets[i] != M_MAX_UNSIGNED)
+            PackNetworkValue(current + offsets[i], attributes->At(i), networkState_->currentValues_[i]);
+    }
+    bool packedChanged = packedSize && memcmp(current, previous, packedSize) != 0;
+
+    if (packedChanged)
+    {
+        for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            unsigned offset = offsets[i];
+            if (offset != M_MAX_UNSIGNED && memcmp(current + offset, previous + offset,
+                GetNetworkPackedSize(attributes->At(i))) != 0)
+                changedAttributes.Set(i);
+        }
+        memcpy(previous, current, packedSize);
+    }
+
+    CacheNetworkUpdate(changedAttributes);
+}
+
+void Serializable::CacheNetworkUpdate(const DirtyBits& changedAttributes)
+{
+    const Vector<AttributeInfo>* attributes = networkState_->attributes_;
+    unsigned numAttributes = attributes->Size();
+
+    // Split the changed attributes into delta and latest data
+    DirtyBits deltaBits;
+    DirtyBits latestDataBits;
+    bool latestDataChanged = false;
     for (unsigned i = 0; i < numAttributes; ++i)
     {
         if (attributes->At(i).mode_ & AM_LATESTDATA)
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+        {
+            latestDataBits.Set(i);
+            if (changedAttributes.IsSet(i))
+                latestDataChanged = true;
+        }
+        else if (changedAttributes.IsSet(i))
+            deltaBits.Set(i);
+    }
+
+    // The delta update is only valid for the current values, so always replace it. Connections that have accumulated
+    // a different set of dirty bits, for example due to interest management, will encode their own update instead
+    networkState_->deltaUpdateBits_ = deltaBits;
+    networkState_->deltaUpdateData_.Clear();
+    // When nobody is tracking the object there is nothing to send; invalidate the latest data to not leave it stale
+    if (networkState_->replicationStates_.Empty())
+    {
+        networkState_->deltaUpdateBits_.ClearAll();
+        networkState_->latestDataValid_ = false;
+        return;
+    }
+
+    if (deltaBits.Count())
+    {
+        VectorBuffer& dest = networkState_->deltaUpdateData_;
+        dest.Write(deltaBits.data_, (numAttributes + 7) >> 3);
+        WriteNetworkValues(dest, deltaBits);
+    }
+
+    // Latest data stays valid until one of its attributes changes
+    if (latestDataChanged || !networkState_->latestDataValid_)
+    {
+        VectorBuffer& dest = networkState_->latestData_;
+        dest.Clear();
+        WriteNetworkValues(dest, latestDataBits);
+        networkState_->latestDataValid_ = true;
     }
 }
 
@@ -666,14 +1077,18 @@ bool Serializable::ReadDeltaUpdate(Deserializer& source)
     unsigned char timeStamp = source.ReadUByte();
     source.Read(attributeBits.data_, (numAttributes + 7) >> 3);
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    ReceivedValues receivedValues(attributeBits);
+    Variant* values = receivedValues.Get();
+    ReadNetworkValues(source, attributeBits, values);
+
+    for (unsigned i = 0; i < numAttributes; ++i)
     {
         if (attributeBits.IsSet(i))
         {
             const AttributeInfo& attr = attributes->At(i);
             if (!(interceptMask & (1ULL << i)))
             {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+                OnSetAttribute(attr, values[i]);
                 changed = true;
             }
             else
@@ -685,7 +1100,7 @@ bool Serializable::ReadDeltaUpdate(Deserializer& source)
                 eventData[P_TIMESTAMP] = (unsigned)timeStamp;
                 eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
                 eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
+                eventData[P_VALUE] = values[i];
                 SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
             }
         }
@@ -706,14 +1121,25 @@ bool Serializable::ReadLatestDataUpdate(Deserializer& source)
     unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
     unsigned char timeStamp = source.ReadUByte();
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    DirtyBits attributeBits;
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        if (attributes->At(i).mode_ & AM_LATESTDATA)
+            attributeBits.Set(i);
+    }
+
+    ReceivedValues receivedValues(attributeBits);
+    Variant* values = receivedValues.Get();
+    ReadNetworkValues(source, attributeBits, values);
+
+    for (unsigned i = 0; i < numAttributes; ++i)
     {
         const AttributeInfo& attr = attributes->At(i);
-        if (attr.mode_ & AM_LATESTDATA)
+        if (attributeBits.IsSet(i))
         {
             if (!(interceptMask & (1ULL << i)))
             {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+                OnSetAttribute(attr, values[i]);
                 changed = true;
             }
             else
@@ -725,7 +1151,7 @@ bool Serializable::ReadLatestDataUpdate(Deserializer& source)
                 eventData[P_TIMESTAMP] = (unsigned)timeStamp;
                 eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
                 eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
+                eventData[P_VALUE] = values[i];
                 SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
             }
         }
@@ -851,6 +1277,78 @@ bool Serializable::GetInterceptNetworkUpdate(const String& attributeName) const
     return false;
 }
 
+void Serializable::WriteNetworkValues(Serializer& dest, const DirtyBits& attributeBits) const
+{
+    const Vector<AttributeInfo>* attributes = networkState_->attributes_;
+    unsigned numAttributes = attributes->Size();
+    bool hasQuantized = false;
+
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        if (attributeBits.IsSet(i))
+        {
+            if (!IsQuantized(attributes->At(i)))
+                dest.WriteVariantData(networkState_->currentValues_[i]);
+            else
+                hasQuantized = true;
+        }
+    }
+
+    if (!hasQuantized)
+        return;
+
+    // Pack the quantized values together so that they only pad to a whole byte once
+    BitWriter writer(dest);
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        if (attributeBits.IsSet(i) && IsQuantized(attr))
+            WriteQuantizedValue(writer, attr, networkState_->currentValues_[i]);
+    }
+    writer.Flush();
+}
+
+void Serializable::ReadNetworkValues(Deserializer& source, DirtyBits& attributeBits, Variant* values) const
+{
+    const Vector<AttributeInfo>* attributes = GetNetworkAttributes();
+    unsigned numAttributes = attributes->Size();
+    bool hasQuantized = false;
+
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        if (attributeBits.IsSet(i))
+        {
+            const AttributeInfo& attr = attributes->At(i);
+            if (IsQuantized(attr))
+                hasQuantized = true;
+            else if (!source.IsEof())
+            {
+                Variant value = source.ReadVariant(attr.type_);
+                values[i].Swap(value);
+            }
+            else
+                attributeBits.Clear(i);
+        }
+    }
+
+    if (!hasQuantized)
+        return;
+
+    bool eof = source.IsEof();
+    BitReader reader(source);
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        if (attributeBits.IsSet(i) && IsQuantized(attr))
+        {
+            if (!eof)
+                values[i] = ReadQuantizedValue(reader, attr);
+            else
+                attributeBits.Clear(i);
+        }
+    }
+}
+
 void Serializable::SetInstanceDefault(const String& name, const Variant& defaultValue)
 {
     // Allocate the instance level default value
@@ -118,6 +118,15 @@ public:
     NetworkState* GetNetworkState() const { return networkState_; }
 
 protected:
+    /// Resize the network attribute values and the packed comparison buffers if necessary, starting from the default values.
+    void InitNetworkValues();
+    /// Compare the current variable-size network attribute values to the previous and store the changed attribute bits. Copies Variants, so must be called from the main thread.
+    void DetectVariableNetworkChanges();
+    /// Compare the packed fixed-size network attribute values to the previous, add the changed attribute bits and cache the update. Does not copy Variants and only modifies own network state, so can be called from worker threads.
+    void DetectNetworkChanges();
+    /// Encode the delta and latest data updates for the attributes changed during this network update, so that all connections can reuse them.
+    void CacheNetworkUpdate(const DirtyBits& changedAttributes);
+
     /// Network attribute state.
     NetworkState* networkState_;
 
@@ -126,6 +135,10 @@ private:
     void SetInstanceDefault(const String& name, const Variant& defaultValue);
     /// Get instance-level default value.
     Variant GetInstanceDefault(const String& name) const;
+    /// Write current values of network attributes. Quantized attributes are bit-packed after the full-width values.
+    void WriteNetworkValues(Serializer& dest, const DirtyBits& attributeBits) const;
+    /// Read values of network attributes written by WriteNetworkValues(). Bits of attributes that could not be read are cleared.
+    void ReadNetworkValues(Deserializer& source, DirtyBits& attributeBits, Variant* values) const;
 
     /// Attribute default value at each instance level.
     VariantMap* instanceDefaultValues_;
@@ -272,5 +285,7 @@ public:
 #define MIXED_ACCESSOR_ATTRIBUTE(name, getFunction, setFunction, typeName, defaultValue, mode) context->RegisterAttribute<ClassName>(Urho3D::AttributeInfo(GetVariantType<typeName >(), name, new Urho3D::AttributeAccessorImpl<ClassName, typeName, MixedAttributeTrait<typeName > >(&ClassName::getFunction, &ClassName::setFunction), defaultValue, mode))
 /// Update the default value of an already registered attribute.
 #define UPDATE_ATTRIBUTE_DEFAULT_VALUE(name, defaultValue) context->UpdateAttributeDefaultValue<ClassName>(name, defaultValue)
+/// Update the network replication encoding of an attribute of the current class.
+#define UPDATE_ATTRIBUTE_NETWORK_ENCODING(name, encoding) context->UpdateAttributeNetworkEncoding<ClassName>(name, encoding)
 
 }
@@ -147,6 +147,12 @@ static void RegisterLog(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Log", "String get_lastMessage()", asMETHOD(Log, GetLastMessage), asCALL_THISCALL);
     engine->RegisterObjectMethod("Log", "void set_quiet(bool)", asMETHOD(Log, SetQuiet), asCALL_THISCALL);
     engine->RegisterObjectMethod("Log", "bool get_quiet() const", asMETHOD(Log, IsQuiet), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Log", "void Flush()", asMETHOD(Log, Flush), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Log", "void set_async(bool)", asMETHOD(Log, SetAsync), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Log", "bool get_async() const", asMETHOD(Log, IsAsync), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Log", "void set_queueSize(uint)", asMETHOD(Log, SetQueueSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Log", "uint get_queueSize() const", asMETHOD(Log, GetQueueSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Log", "uint get_numDroppedMessages() const", asMETHOD(Log, GetNumDroppedMessages), asCALL_THISCALL);
     engine->RegisterGlobalFunction("Log@+ get_log()", asFUNCTION(GetLog), asCALL_CDECL);
 
     // Register also Print() functions for convenience
@@ -391,6 +397,8 @@ static void RegisterPackageFile(asIScriptEngine* engine)
     engine->RegisterObjectMethod("PackageFile", "uint get_totalSize() const", asMETHOD(PackageFile, GetTotalSize), asCALL_THISCALL);
     engine->RegisterObjectMethod("PackageFile", "uint get_checksum() const", asMETHOD(PackageFile, GetChecksum), asCALL_THISCALL);
     engine->RegisterObjectMethod("PackageFile", "bool compressed() const", asMETHOD(PackageFile, IsCompressed), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PackageFile", "bool SetMemoryMapped(bool)", asMETHOD(PackageFile, SetMemoryMapped), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PackageFile", "bool get_memoryMapped() const", asMETHOD(PackageFile, IsMemoryMapped), asCALL_THISCALL);
     engine->RegisterObjectMethod("PackageFile", "Array<String>@ GetEntryNames() const", asFUNCTION(PackageFileGetEntryNames), asCALL_CDECL_OBJLAST);
 }
 
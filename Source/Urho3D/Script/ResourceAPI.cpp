@@ -21,6 +21,7 @@
 //
 
 #include "../Script/APITemplates.h"
+#include "../Resource/DerivedDataCache.h"
 #include "../Resource/Image.h"
 #include "../Resource/JSONFile.h"
 #include "../Resource/JSONValue.h"
@@ -42,6 +43,11 @@ static Resource* ResourceCacheGetResource(const String& type, const String& name
     return ptr->GetResource(StringHash(type), name, sendEventOnFailure);
 }
 
+static Resource* ResourceCacheGetExistingResource(const String& type, const String& name, ResourceCache* ptr)
+{
+    return ptr->GetExistingResource(StringHash(type), name);
+}
+
 static File* ResourceCacheGetFile(const String& name, ResourceCache* ptr)
 {
     SharedPtr<File> file = ptr->GetFile(name);
@@ -77,6 +83,21 @@ static unsigned ResourceCacheGetMemoryUse(const String& type, ResourceCache* ptr
     return ptr->GetMemoryUse(type);
 }
 
+static unsigned ResourceCacheGetNumHits(const String& type, ResourceCache* ptr)
+{
+    return ptr->GetNumHits(type);
+}
+
+static unsigned ResourceCacheGetNumMisses(const String& type, ResourceCache* ptr)
+{
+    return ptr->GetNumMisses(type);
+}
+
+static unsigned ResourceCacheGetNumEvictions(const String& type, ResourceCache* ptr)
+{
+    return ptr->GetNumEvictions(type);
+}
+
 static ResourceCache* GetResourceCache()
 {
     return GetScriptContext()->GetSubsystem<ResourceCache>();
@@ -122,15 +143,25 @@ static void RegisterResourceCache(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ResourceCache", "String GetResourceFileName(const String&in) const", asMETHOD(ResourceCache, GetResourceFileName), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetResource(const String&in, const String&in, bool sendEventOnFailure = true)", asFUNCTION(ResourceCacheGetResource), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetResource(StringHash, const String&in, bool sendEventOnFailure = true)", asMETHODPR(ResourceCache, GetResource, (StringHash, const String&, bool), Resource*), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetExistingResource(const String&in, const String&in)", asFUNCTION(ResourceCacheGetExistingResource), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetExistingResource(StringHash, const String&in)", asMETHODPR(ResourceCache, GetExistingResource, (StringHash, const String&), Resource*), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool BackgroundLoadResource(const String&in, const String&in, bool sendEventOnFailure = true)", asFUNCTION(ResourceCacheBackgroundLoadResource), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "void set_memoryBudget(const String&in, uint)", asFUNCTION(ResourceCacheSetMemoryBudget), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "uint get_memoryBudget(const String&in) const", asFUNCTION(ResourceCacheGetMemoryBudget), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "uint get_memoryUse(const String&in) const", asFUNCTION(ResourceCacheGetMemoryUse), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "uint get_totalMemoryUse() const", asMETHOD(ResourceCache, GetTotalMemoryUse), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_memoryBudgetHysteresis(float)", asMETHOD(ResourceCache, SetMemoryBudgetHysteresis), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "float get_memoryBudgetHysteresis() const", asMETHOD(ResourceCache, GetMemoryBudgetHysteresis), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_numHits(const String&in) const", asFUNCTION(ResourceCacheGetNumHits), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_numMisses(const String&in) const", asFUNCTION(ResourceCacheGetNumMisses), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_numEvictions(const String&in) const", asFUNCTION(ResourceCacheGetNumEvictions), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "void ResetStatistics()", asMETHOD(ResourceCache, ResetStatistics), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "Array<String>@ get_resourceDirs() const", asFUNCTION(ResourceCacheGetResourceDirs), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "Array<PackageFile@>@ get_packageFiles() const", asFUNCTION(ResourceCacheGetPackageFiles), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "void set_searchPackagesFirst(bool)", asMETHOD(ResourceCache, SetSearchPackagesFirst), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool get_seachPackagesFirst() const", asMETHOD(ResourceCache, GetSearchPackagesFirst), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_memoryMapPackages(bool)", asMETHOD(ResourceCache, SetMemoryMapPackages), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "bool get_memoryMapPackages() const", asMETHOD(ResourceCache, GetMemoryMapPackages), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "void set_autoReloadResources(bool)", asMETHOD(ResourceCache, SetAutoReloadResources), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool get_autoReloadResources() const", asMETHOD(ResourceCache, GetAutoReloadResources), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "void set_returnFailedResources(bool)", asMETHOD(ResourceCache, SetReturnFailedResources), asCALL_THISCALL);
@@ -138,10 +169,31 @@ static void RegisterResourceCache(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ResourceCache", "void set_finishBackgroundResourcesMs(int)", asMETHOD(ResourceCache, SetFinishBackgroundResourcesMs), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "int get_finishBackgroundResourcesMs() const", asMETHOD(ResourceCache, GetFinishBackgroundResourcesMs), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "uint get_numBackgroundLoadResources() const", asMETHOD(ResourceCache, GetNumBackgroundLoadResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_numBackgroundLoadThreads(uint)", asMETHOD(ResourceCache, SetNumBackgroundLoadThreads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_numBackgroundLoadThreads() const", asMETHOD(ResourceCache, GetNumBackgroundLoadThreads), asCALL_THISCALL);
     engine->RegisterGlobalFunction("ResourceCache@+ get_resourceCache()", asFUNCTION(GetResourceCache), asCALL_CDECL);
     engine->RegisterGlobalFunction("ResourceCache@+ get_cache()", asFUNCTION(GetResourceCache), asCALL_CDECL);
 }
 
+static DerivedDataCache* GetDerivedDataCache()
+{
+    return GetScriptContext()->GetSubsystem<DerivedDataCache>();
+}
+
+static void RegisterDerivedDataCache(asIScriptEngine* engine)
+{
+    RegisterObject<DerivedDataCache>(engine, "DerivedDataCache");
+    engine->RegisterObjectMethod("DerivedDataCache", "void Clear()", asMETHOD(DerivedDataCache, Clear), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "bool SetCacheDir(const String&in)", asMETHOD(DerivedDataCache, SetCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "const String& get_cacheDir() const", asMETHOD(DerivedDataCache, GetCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "bool get_enabled() const", asMETHOD(DerivedDataCache, IsEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "void set_maxSize(uint)", asMETHOD(DerivedDataCache, SetMaxSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "uint get_maxSize() const", asMETHOD(DerivedDataCache, GetMaxSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "uint get_size() const", asMETHOD(DerivedDataCache, GetSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "uint get_numEntries() const", asMETHOD(DerivedDataCache, GetNumEntries), asCALL_THISCALL);
+    engine->RegisterGlobalFunction("DerivedDataCache@+ get_derivedDataCache()", asFUNCTION(GetDerivedDataCache), asCALL_CDECL);
+}
+
 static bool ImageLoadColorLUT(File* file, Image* ptr)
 {
     return file && ptr->LoadColorLUT(*file);
@@ -178,12 +230,14 @@ static void RegisterImage(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Image", "bool FlipHorizontal()", asMETHOD(Image, FlipHorizontal), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "bool FlipVertical()", asMETHOD(Image, FlipVertical), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "bool Resize(int, int)", asMETHOD(Image, Resize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Image", "bool Compress(CompressedFormat)", asMETHOD(Image, Compress), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "void Clear(const Color&in)", asMETHOD(Image, Clear), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "void ClearInt(uint)", asMETHOD(Image, ClearInt), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "void SaveBMP(const String&in) const", asMETHOD(Image, SaveBMP), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "void SavePNG(const String&in) const", asMETHOD(Image, SavePNG), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "void SaveTGA(const String&in) const", asMETHOD(Image, SaveTGA), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "void SaveJPG(const String&in, int) const", asMETHOD(Image, SaveJPG), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Image", "bool SaveDDS(const String&in) const", asMETHOD(Image, SaveDDS), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "Color GetPixel(int, int) const", asMETHODPR(Image, GetPixel, (int, int) const, Color), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "Color GetPixel(int, int, int) const", asMETHODPR(Image, GetPixel, (int, int, int) const, Color), asCALL_THISCALL);
     engine->RegisterObjectMethod("Image", "uint GetPixelInt(int, int) const", asMETHODPR(Image, GetPixelInt, (int, int) const, unsigned), asCALL_THISCALL);
@@ -543,6 +597,7 @@ void RegisterResourceAPI(asIScriptEngine* engine)
 {
     RegisterResource(engine);
     RegisterResourceCache(engine);
+    RegisterDerivedDataCache(engine);
     RegisterImage(engine);
     RegisterJSONValue(engine);
     RegisterJSONFile(engine);
@@ -23,6 +23,7 @@
 #include "../Script/APITemplates.h"
 #include "../Scene/Animatable.h"
 #include "../Graphics/DebugRenderer.h"
+#include "../Scene/InterpolatedTransform.h"
 #include "../Scene/ObjectAnimation.h"
 #include "../IO/PackageFile.h"
 #include "../Scene/Scene.h"
@@ -162,6 +163,16 @@ static bool SceneSaveXMLVectorBuffer(VectorBuffer& buffer, const String& indenta
     return ptr->SaveXML(buffer, indentation);
 }
 
+static bool SceneSaveFlat(File* file, Scene* ptr)
+{
+    return file && ptr->SaveFlat(*file);
+}
+
+static bool SceneSaveFlatVectorBuffer(VectorBuffer& buffer, Scene* ptr)
+{
+    return ptr->SaveFlat(buffer);
+}
+
 static Node* SceneInstantiate(File* file, const Vector3& position, const Quaternion& rotation, CreateMode mode, Scene* ptr)
 {
     return file ? ptr->Instantiate(*file, position, rotation, mode) : 0;
@@ -238,6 +249,18 @@ static void RegisterSmoothedTransform(asIScriptEngine* engine)
     engine->RegisterObjectMethod("SmoothedTransform", "bool get_inProgress() const", asMETHOD(SmoothedTransform, IsInProgress), asCALL_THISCALL);
 }
 
+static void RegisterInterpolatedTransform(asIScriptEngine* engine)
+{
+    RegisterComponent<InterpolatedTransform>(engine, "InterpolatedTransform");
+    engine->RegisterObjectMethod("InterpolatedTransform", "void Update(float, float, float)", asMETHOD(InterpolatedTransform, Update), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "void AddPosition(const Vector3&in)", asMETHOD(InterpolatedTransform, AddPosition), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "void AddRotation(const Quaternion&in)", asMETHOD(InterpolatedTransform, AddRotation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "void ClearSamples()", asMETHOD(InterpolatedTransform, ClearSamples), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "uint get_numSamples() const", asMETHOD(InterpolatedTransform, GetNumSamples), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "float get_newestTime() const", asMETHOD(InterpolatedTransform, GetNewestTime), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "bool get_extrapolating() const", asMETHOD(InterpolatedTransform, IsExtrapolating), asCALL_THISCALL);
+}
+
 static void RegisterSplinePath(asIScriptEngine* engine)
 {
     RegisterComponent<SplinePath>(engine, "SplinePath");
@@ -277,6 +300,8 @@ static void RegisterScene(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Scene", "bool LoadXML(VectorBuffer&)", asFUNCTION(SceneLoadXMLVectorBuffer), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "bool SaveXML(File@+, const String&in indentation = \"\t\")", asFUNCTION(SceneSaveXML), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "bool SaveXML(VectorBuffer&, const String&in indentation = \"\t\")", asFUNCTION(SceneSaveXMLVectorBuffer), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "bool SaveFlat(File@+)", asFUNCTION(SceneSaveFlat), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "bool SaveFlat(VectorBuffer&)", asFUNCTION(SceneSaveFlatVectorBuffer), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "bool LoadAsync(File@+, LoadMode mode = LOAD_SCENE_AND_RESOURCES)", asMETHOD(Scene, LoadAsync), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "bool LoadAsyncXML(File@+, LoadMode mode = LOAD_SCENE_AND_RESOURCES)", asMETHOD(Scene, LoadAsyncXML), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void StopAsyncLoading()", asMETHOD(Scene, StopAsyncLoading), asCALL_THISCALL);
@@ -306,6 +331,14 @@ static void RegisterScene(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Scene", "float get_smoothingConstant() const", asMETHOD(Scene, GetSmoothingConstant), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_snapThreshold(float)", asMETHOD(Scene, SetSnapThreshold), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "float get_snapThreshold() const", asMETHOD(Scene, GetSnapThreshold), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_interpolation(bool)", asMETHOD(Scene, SetInterpolation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool get_interpolation() const", asMETHOD(Scene, GetInterpolation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_interpolationDelay(float)", asMETHOD(Scene, SetInterpolationDelay), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "float get_interpolationDelay() const", asMETHOD(Scene, GetInterpolationDelay), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_extrapolationLimit(float)", asMETHOD(Scene, SetExtrapolationLimit), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "float get_extrapolationLimit() const", asMETHOD(Scene, GetExtrapolationLimit), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "float get_serverTime() const", asMETHOD(Scene, GetServerTime), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "float get_networkTime() const", asMETHOD(Scene, GetNetworkTime), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "bool get_asyncLoading() const", asMETHOD(Scene, IsAsyncLoading), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "float get_asyncProgress() const", asMETHOD(Scene, GetAsyncProgress), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "LoadMode get_asyncLoadMode() const", asMETHOD(Scene, GetAsyncLoadMode), asCALL_THISCALL);
@@ -329,6 +362,7 @@ void RegisterSceneAPI(asIScriptEngine* engine)
     RegisterAnimatable(engine);
     RegisterNode(engine);
     RegisterSmoothedTransform(engine);
+    RegisterInterpolatedTransform(engine);
     RegisterSplinePath(engine);
     RegisterScene(engine);
 }
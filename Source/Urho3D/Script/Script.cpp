@@ -32,11 +32,39 @@
 
 #include <AngelScript/angelscript.h>
 
+#include <cstdlib>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
+#ifdef URHO3D_MEMORY_TRACKING
+/// Size of the header that stores the size of an AngelScript allocation.
+static const unsigned SCRIPT_ALLOCATION_HEADER_SIZE = 16;
+
+static void* ScriptAllocate(size_t size)
+{
+    unsigned char* ptr = static_cast<unsigned char*>(malloc(size + SCRIPT_ALLOCATION_HEADER_SIZE));
+    if (!ptr)
+        return 0;
+
+    *reinterpret_cast<size_t*>(ptr) = size;
+    TrackAllocation(MT_SCRIPT, (unsigned)size);
+    return ptr + SCRIPT_ALLOCATION_HEADER_SIZE;
+}
+
+static void ScriptFree(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    unsigned char* headerPtr = static_cast<unsigned char*>(ptr) - SCRIPT_ALLOCATION_HEADER_SIZE;
+    TrackFree(MT_SCRIPT, (unsigned)*reinterpret_cast<size_t*>(headerPtr));
+    free(headerPtr);
+}
+#endif
+
 Script::Script(Context* context) :
     Object(context),
     scriptEngine_(0),
@@ -44,6 +72,10 @@ Script::Script(Context* context) :
     scriptNestingLevel_(0),
     executeConsoleCommands_(false)
 {
+    #ifdef URHO3D_MEMORY_TRACKING
+    asSetGlobalMemoryFunctions(ScriptAllocate, ScriptFree);
+    #endif
+
     scriptEngine_ = asCreateScriptEngine(ANGELSCRIPT_VERSION);
     if (!scriptEngine_)
     {
@@ -285,6 +285,7 @@ bool ScriptFile::Execute(const String& declaration, const VariantVector& paramet
 bool ScriptFile::Execute(asIScriptFunction* function, const VariantVector& parameters, bool unprepare)
 {
     PROFILE(ExecuteFunction);
+    MEMORY_TAG(MT_SCRIPT);
     
     if (!compiled_ || !function)
         return false;
@@ -323,6 +324,7 @@ bool ScriptFile::Execute(asIScriptObject* object, const String& declaration, con
 bool ScriptFile::Execute(asIScriptObject* object, asIScriptFunction* method, const VariantVector& parameters, bool unprepare)
 {
     PROFILE(ExecuteMethod);
+    MEMORY_TAG(MT_SCRIPT);
     
     if (!compiled_ || !object || !method)
         return false;
@@ -295,6 +295,7 @@ void UI::Clear()
 
 void UI::Update(float timeStep)
 {
+    MEMORY_TAG(MT_UI);
     assert(rootElement_ && rootModalElement_);
 
     PROFILE(UpdateUI);
@@ -388,6 +389,7 @@ void UI::Update(float timeStep)
 
 void UI::RenderUpdate()
 {
+    MEMORY_TAG(MT_UI);
     assert(rootElement_ && rootModalElement_ && graphics_);
 
     PROFILE(GetUIBatches);
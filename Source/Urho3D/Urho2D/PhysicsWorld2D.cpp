@@ -223,6 +223,7 @@ void PhysicsWorld2D::DrawTransform(const b2Transform& xf)
 
 void PhysicsWorld2D::Update(float timeStep)
 {
+    MEMORY_TAG(MT_PHYSICS);
     using namespace PhysicsPreStep2D;
 
     VariantMap& eventData = GetEventDataMap();